@@ -1,10 +1,22 @@
 #include "NTask.hpp"
 #include "esp_log.h"
+#include "WTrace.hpp"
+#include "WRecord.h"
 
 #define NTASK_ID_STARTING (0x01)
 static const char *NTASK_LOG_TAG = "NTASK";
 
-std::vector<NTask *> NTask::ntask_list;
+constinit std::vector<NTask *> NTask::ntask_list; // no constructor to order : the global tasks of any unit can register
+
+/**
+ * @brief Reserve the NTask list for count more tasks (see TaskSet), so that their registrations do not reallocate it
+ *
+ * @param count
+ */
+void NTask::reserveTasks(std::size_t count)
+{
+    ntask_list.reserve(ntask_list.size() + count);
+};
 
 /**
  * @brief Check either if Identifier's ID is already taken or not
@@ -55,7 +67,13 @@ char NTask::getIDnotTaken(Identifier_t identifier)
  */
 BaseType_t NTask::sendNotificationTo(NTask *dest, Notification_t notif, TickType_t ticktowait, BaseType_t notif_position)
 {
-    return (dest == nullptr) ? pdFALSE : xQueueGenericSend(dest->notification_queue, &notif, ticktowait, notif_position);
+    if (dest == nullptr)
+        return pdFALSE;
+    WTRACE(WTRACE_NOTIF_SEND, notif.d0, dest->m_handle);
+    const BaseType_t sent = xQueueGenericSend(dest->notification_queue, &notif, ticktowait, notif_position);
+    if (sent == pdTRUE) // a notification that timed out must not be replayed
+        WRECORD((notif_position == queueSEND_TO_FRONT) ? WRECORD_NOTIF_FRONT : WRECORD_NOTIF, callerIdentifier(), dest->identifier.w_id, &notif, sizeof(notif));
+    return sent;
 };
 
 /**
@@ -69,7 +87,11 @@ BaseType_t NTask::sendNotificationTo(NTask *dest, Notification_t notif, TickType
 BaseType_t NTask::sendNotificationFromIsrTo(NTask *dest, uint16_t notif_value, BaseType_t *pxHigherPriorityTaskWoken)
 {
     Notification_t notif = NOTIFICATION_FROM_ISR(notif_value);
-    return xQueueSendFromISR(dest->notification_queue, &notif, pxHigherPriorityTaskWoken);
+    WTRACE(WTRACE_NOTIF_SEND, notif.d0, dest->m_handle);
+    const BaseType_t sent = xQueueSendFromISR(dest->notification_queue, &notif, pxHigherPriorityTaskWoken);
+    if (sent == pdTRUE)
+        WRECORD_FROM_ISR(pxHigherPriorityTaskWoken, WRECORD_NOTIF, notif.Identifier.w_id, dest->identifier.w_id, &notif, sizeof(notif));
+    return sent;
 };
 
 /**
@@ -83,7 +105,11 @@ BaseType_t NTask::sendNotificationFromIsrTo(NTask *dest, uint16_t notif_value, B
 BaseType_t NTask::sendNotificationToFrontFromIsrTo(NTask *dest, uint16_t notif_value, BaseType_t *pxHigherPriorityTaskWoken)
 {
     Notification_t notif = NOTIFICATION_FROM_ISR(notif_value);
-    return xQueueSendToFrontFromISR(dest->notification_queue, &notif, pxHigherPriorityTaskWoken);
+    WTRACE(WTRACE_NOTIF_SEND, notif.d0, dest->m_handle);
+    const BaseType_t sent = xQueueSendToFrontFromISR(dest->notification_queue, &notif, pxHigherPriorityTaskWoken);
+    if (sent == pdTRUE)
+        WRECORD_FROM_ISR(pxHigherPriorityTaskWoken, WRECORD_NOTIF_FRONT, notif.Identifier.w_id, dest->identifier.w_id, &notif, sizeof(notif));
+    return sent;
 };
 
 /**
@@ -95,13 +121,35 @@ BaseType_t NTask::sendNotificationToFrontFromIsrTo(NTask *dest, uint16_t notif_v
 Notification_t NTask::receiveNotification(TickType_t ticktowait)
 {
     Notification_t notif;
-    if (xQueueReceive(notification_queue, &notif, ticktowait))
+    BaseType_t received;
+    WTRACE_WAIT(ticktowait, received = xQueueReceive(notification_queue, &notif, ticktowait));
+    if (received)
     {
+        WTRACE(WTRACE_NOTIF_RECV, notif.d0, 0);
         return notif;
     }
     return (Notification_t){.d0 = 0};
 };
 
+#if CONFIG_WTASK_RECORD
+static_assert(CONFIG_WTASK_RECORD_TLS_INDEX < configNUM_THREAD_LOCAL_STORAGE_POINTERS, "WTASK_RECORD_TLS_INDEX needs more FreeRTOS thread local storage pointers");
+
+/**
+ * @brief Identifier of the sender of a record
+ * @details The Task is read from the thread local storage of the running task (set by Task::runTask) : no walk of the
+ *          NTask list, which other tasks can modify
+ *
+ * @return uint16_t w_id of the running NTask, NTASK_TYPE_NOTIF_ISR_CONTX from ISR, WRECORD_SOURCE_NONE from another task
+ */
+uint16_t NTask::callerIdentifier()
+{
+    if (xPortInIsrContext())
+        return NOTIFICATION_FROM_ISR(0).Identifier.w_id;
+    const Task *current = static_cast<const Task *>(pvTaskGetThreadLocalStoragePointer(nullptr, CONFIG_WTASK_RECORD_TLS_INDEX));
+    return (current != nullptr) ? current->getRecordSource() : WRECORD_SOURCE_NONE;
+};
+#endif
+
 /**
  * @brief Construct a new NTask::NTask object
  *
@@ -116,9 +164,33 @@ NTask::NTask(char ntype, std::string taskName, uint16_t stackSize, uint8_t prior
     setCore(coreId);
     identifier.type = ntype;
     identifier.ID = getIDnotTaken(identifier);
+    m_recordSource = identifier.w_id;
     ntask_list.push_back(this);
     notification_queue = xQueueCreate(notification_queue_size, sizeof(Notification_t));
 };
+
+/**
+ * @brief Construct a new NTask::NTask object from a static configuration (see TaskSet)
+ *
+ * The identifier is the one of the configuration, and the queue and the stack use the buffers of the configuration when they are given.
+ *
+ * @param config
+ */
+NTask::NTask(const TaskConfig_t &config) : Task(config.name, config.stack_size, config.priority)
+{
+    setCore(config.core);
+    setCriticality(config.criticality);
+    setStaticBuffers(config.stack_buffer, config.task_buffer);
+    identifier = config.identifier;
+    m_recordSource = identifier.w_id;
+    if (isIDTaken(identifier))
+        ESP_LOGE(NTASK_LOG_TAG, "Type:ID %X:%X of %s is already taken", identifier.type, identifier.ID, config.name);
+    ntask_list.push_back(this);
+    if (config.queue_storage != nullptr)
+        notification_queue = xQueueCreateStatic(config.queue_length, sizeof(Notification_t), config.queue_storage, config.queue_buffer);
+    else
+        notification_queue = xQueueCreate(config.queue_length, sizeof(Notification_t));
+};
 /**
  * @brief Destroy the NTask::NTask object
  *
@@ -3,6 +3,8 @@
 
 #include "Task.hpp"
 #include "freertos/queue.h"
+#include "freertos/ringbuf.h"
+#include "freertos/semphr.h"
 #include <vector>
 
 #define NTASK_QUEUE_LENGTH (8)
@@ -54,6 +56,30 @@ union Notification_t
 };
 #pragma pack()
 
+/**
+ * @brief Static configuration of a NTask or RTask, generated by a TaskSet (see TaskGraph.hpp)
+ * 
+ * The buffers are used instead of the heap when they are not nullptr.
+ */
+struct TaskConfig_t
+{
+    const char *name;
+    Identifier_t identifier;                //<! fixed identifier, not assigned at runtime
+    uint16_t stack_size;                    //<! in byte
+    uint8_t priority;
+    BaseType_t core;
+    TaskCriticality_t criticality;          //<! core partition (CONFIG_WTASK_PARTITION)
+    uint8_t queue_length;                   //<! length of the notification queue
+    uint32_t ringbuffer_size;               //<! RTask only, in byte
+    StackType_t *stack_buffer;              //<! stack_size bytes
+    StaticTask_t *task_buffer;
+    uint8_t *queue_storage;                 //<! queue_length notifications
+    StaticQueue_t *queue_buffer;
+    uint8_t *ringbuffer_storage;            //<! RTask only, ringbuffer_size bytes
+    StaticRingbuffer_t *ringbuffer_buffer;  //<! RTask only
+    StaticSemaphore_t *mutex_buffer;        //<! RTask only
+};
+
 /**
  * @brief Class that encapsulate a runnable task with ID and notification mechanism
  * 
@@ -117,15 +143,20 @@ protected:
         return sendNotificationTo(destination,TO_NOTIFICATION(notif_value),ticktowait,queueSEND_TO_FRONT);
     };
     Notification_t receiveNotification(TickType_t ticktowait);
+#if CONFIG_WTASK_RECORD
+    static uint16_t callerIdentifier();
+#endif
 
 public:
 static BaseType_t sendNotificationTo(NTask *dest, Notification_t notif, TickType_t ticktowait, BaseType_t notif_position);
     // add ID mechanism to the constructor
     NTask(char ntype = 0, std::string taskName = "Task", uint16_t stackSize = 10000, uint8_t priority = 2, uint8_t coreId = 0, uint8_t notification_queue_size = NTASK_QUEUE_LENGTH);
+    NTask(const TaskConfig_t &config);
     ~NTask();
     // get NTask by ID or type
     static NTask *getNTaskByIdentifier(Identifier_t Identifier);
     static std::vector<NTask *> getNTaskByType(char type);
+    static void reserveTasks(std::size_t count);
     // getter
     
     char getID(){
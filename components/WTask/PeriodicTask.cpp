@@ -0,0 +1,155 @@
+#include "esp_log.h"
+#include "PeriodicTask.hpp"
+#include "WTrace.hpp"
+
+static const char *PTASK_LOG_TAG = "PTASK";
+
+/**
+ * @brief Create an instance of the periodic task class.
+ * @param [in] taskName The name of the task to create.
+ * @param [in] periodMs The period of the step function in milliseconds.
+ * @param [in] stackSize The size of the stack.
+ * @param [in] priority The priority of the task.
+ * @return N/A.
+ */
+PeriodicTask::PeriodicTask(std::string taskName, uint32_t periodMs, uint16_t stackSize, uint8_t priority) : Task(taskName, stackSize, priority)
+{
+	m_overrun = 0;
+	m_timer = nullptr;
+	m_periodUs = 1000000 / configTICK_RATE_HZ; // one tick, kept when periodMs is refused
+	m_period = 1;
+	setPeriodMs(periodMs);
+} // PeriodicTask
+
+PeriodicTask::~PeriodicTask()
+{
+	if (m_timer != nullptr)
+	{
+		esp_timer_stop(m_timer);
+		esp_timer_delete(m_timer);
+	}
+}
+
+/**
+ * @brief Set the period of the step function, it is taken into account at the next period.
+ * @param [in] periodMs The period in milliseconds, 0 and periods above UINT32_MAX us are refused.
+ * @return N/A.
+ */
+void PeriodicTask::setPeriodMs(uint32_t periodMs)
+{
+	if (periodMs > UINT32_MAX / 1000)
+	{
+		ESP_LOGE(PTASK_LOG_TAG, "Period of %s can not exceed %u ms, keeping %u us\n", m_taskName.c_str(), (unsigned)(UINT32_MAX / 1000), (unsigned)m_periodUs);
+		return;
+	}
+	setPeriodUs(periodMs * 1000);
+} // setPeriodMs
+
+/**
+ * @brief Set the period of the step function, it is taken into account at the next period.
+ * A multiple of the tick period (1000000 / CONFIG_FREERTOS_HZ us) is kept with xTaskDelayUntil,
+ * other periods are driven by a periodic esp_timer (created at the first use) that notifies the task.
+ * @param [in] periodUs The period in microseconds, 0 is refused.
+ * @return N/A.
+ */
+void PeriodicTask::setPeriodUs(uint32_t periodUs)
+{
+	if (periodUs == 0)
+	{
+		ESP_LOGE(PTASK_LOG_TAG, "Period of %s can not be 0, keeping %u us\n", m_taskName.c_str(), (unsigned)m_periodUs);
+		return;
+	}
+	constexpr uint32_t tick_us = 1000000 / configTICK_RATE_HZ;
+	m_periodUs = periodUs;
+	if ((periodUs % tick_us) == 0)
+	{
+		m_period = periodUs / tick_us;
+		if ((m_timer != nullptr) && esp_timer_is_active(m_timer))
+		{
+			esp_timer_stop(m_timer);
+			if (m_handle != nullptr)
+				xTaskNotifyGive(m_handle); // releases a task waiting for the timer
+		}
+		return;
+	}
+	m_period = 0;
+	if (m_timer == nullptr)
+	{
+		const esp_timer_create_args_t args = {
+			.callback = &timerCallback,
+			.arg = this,
+			.dispatch_method = ESP_TIMER_TASK,
+			.name = "PeriodicTask",
+			.skip_unhandled_events = false,
+		};
+		if (esp_timer_create(&args, &m_timer) != ESP_OK)
+		{
+			ESP_LOGE(PTASK_LOG_TAG, "Can't create the timer of %s, using one tick\n", m_taskName.c_str());
+			m_timer = nullptr;
+			m_period = 1;
+			return;
+		}
+	}
+	else if (esp_timer_is_active(m_timer))
+	{
+		esp_timer_stop(m_timer);
+		esp_timer_start_periodic(m_timer, m_periodUs);
+	}
+} // setPeriodUs
+
+/**
+ * @brief Callback of the period timer (esp_timer task) : wakes the task up.
+ * @param [in] arg The PeriodicTask.
+ * @return N/A.
+ */
+void PeriodicTask::timerCallback(void *arg)
+{
+	PeriodicTask *task = (PeriodicTask *)arg;
+	TaskHandle_t handle = task->m_handle;
+	if (handle != nullptr)
+		xTaskNotifyGive(handle);
+} // timerCallback
+
+/**
+ * @brief Wait for the next expiry of the period timer, starting it if needed.
+ * Expiries that happened during the step are counted as overruns and the next step is started immediately.
+ * @return N/A.
+ */
+void PeriodicTask::waitTimer()
+{
+	if (!esp_timer_is_active(m_timer))
+	{
+		ulTaskNotifyTake(pdTRUE, 0); // expiries of a previous period
+		esp_timer_start_periodic(m_timer, m_periodUs);
+	}
+	uint32_t expiries;
+	WTRACE_WAIT(portMAX_DELAY, expiries = ulTaskNotifyTake(pdTRUE, portMAX_DELAY));
+	if (expiries > 1)
+		m_overrun += expiries - 1;
+} // waitTimer
+
+/**
+ * @brief Loop calling the step function at each period.
+ * @param [in] data Unused.
+ * @return N/A.
+ */
+void PeriodicTask::run(void *data)
+{
+	TickType_t lastWakeTime = xTaskGetTickCount();
+	while (true)
+	{
+		step();
+		if (m_period == 0)
+		{
+			waitTimer();
+			lastWakeTime = xTaskGetTickCount();
+		}
+		else
+		{
+			BaseType_t delayed;
+			WTRACE_WAIT(m_period, delayed = xTaskDelayUntil(&lastWakeTime, m_period));
+			if (delayed == pdFALSE)
+				m_overrun++; // step lasted longer than the period : the wake time was already elapsed
+		}
+	}
+} // run
@@ -0,0 +1,43 @@
+#ifndef PERIODICTASK_HPP_
+#define PERIODICTASK_HPP_
+
+#include "Task.hpp"
+#include "esp_timer.h"
+
+/**
+ * @brief Encapsulate a task that executes a step function at a fixed period.
+ *
+ * This class is designed to be subclassed with the method:
+ *
+ * @code{.cpp}
+ * void step() { ... }
+ * @endcode
+ *
+ * A period that is a multiple of the FreeRTOS tick is kept with xTaskDelayUntil so that the execution time of the step does not drift the period.
+ * Any other period (e.g. 1 ms with CONFIG_FREERTOS_HZ=100) is driven by a periodic esp_timer that notifies the task.
+ * A step that lasts longer than the period is counted as an overrun and the next step is started immediately.
+ */
+class PeriodicTask : public Task {
+public:
+	PeriodicTask(std::string taskName = "PeriodicTask", uint32_t periodMs = 10, uint16_t stackSize = 4096, uint8_t priority = 5);
+	virtual ~PeriodicTask();
+	void setPeriodMs(uint32_t periodMs);
+	void setPeriodUs(uint32_t periodUs);
+	uint32_t getPeriodMs(void){return m_periodUs / 1000;};
+	uint32_t getPeriodUs(void){return m_periodUs;};
+	uint32_t getOverrunCount(void){return m_overrun;};
+private:
+	uint32_t    m_periodUs;
+	TickType_t  m_period;   // period in ticks, 0 when the period is driven by m_timer
+	esp_timer_handle_t m_timer;
+	uint32_t    m_overrun;
+	void run(void* data);
+	void waitTimer();
+	static void timerCallback(void *arg);
+	/**
+	 * @brief Body of the periodic job, called once per period from the task context.
+	 */
+	virtual void step() = 0;
+};
+
+#endif /* PERIODICTASK_HPP_ */
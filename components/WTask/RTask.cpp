@@ -1,5 +1,7 @@
 #include "RTask.hpp"
 #include "esp_log.h"
+#include "WTrace.hpp"
+#include "WRecord.h"
 
 static const char *RTASK_LOG_TAG = "RTASK";
 
@@ -19,10 +21,13 @@ BaseType_t RTask::sendDataTo(RTask *destination, void *data, uint32_t size, Tick
     BaseType_t t;
     if ((destination==nullptr) || (data==nullptr))
         return pdFALSE;
+    WTRACE(WTRACE_DATA_SEND, size, destination->m_handle);
     if (xSemaphoreTake(destination->mutex_receiving_buff,ticktowait))
     {
         t = xRingbufferSend(destination->receiving_buff, data, size, ticktowait);
-         
+        if (t == pdTRUE) // recorded before its notification, as the receiver takes them
+            WRECORD(WRECORD_DATA, callerIdentifier(), destination->getIdentifier().w_id, data, size);
+
         if (usenotif){
             // infinite delay for the notification, otherwise, it could occure that the data are send to the ring buffer 
             // but no notification is sended because the notification is full for too long time, 
@@ -35,6 +40,30 @@ BaseType_t RTask::sendDataTo(RTask *destination, void *data, uint32_t size, Tick
     ESP_LOGE(RTASK_LOG_TAG, "Unable to take RingBuffer Semaphore of RTask %s", destination->getName().c_str());
     return pdFALSE;
 };
+/**
+ * @brief Send data to a RTask and a notification: should only be used from ISR context
+ * @details The mutex can't be taken from an ISR, so the item may be queued between the data and the notification
+ *          of a task sender: this is fine as long as the receiver takes one item per notification.
+ *          Nothing is sent if the ring buffer is full (no notification without data).
+ *
+ * @param [in] dest destination
+ * @param [in] data
+ * @param [in] size
+ * @param [in] notif_value
+ * @param [out] pxHigherPriorityTaskWoken
+ * @return BaseType_t pdTRUE on success
+ */
+BaseType_t RTask::sendDataFromIsrTo(RTask *dest, const void *data, uint32_t size, uint16_t notif_value, BaseType_t *pxHigherPriorityTaskWoken)
+{
+    if ((dest == nullptr) || (data == nullptr))
+        return pdFALSE;
+    WTRACE(WTRACE_DATA_SEND, size, dest->m_handle);
+    if (xRingbufferSendFromISR(dest->receiving_buff, data, size, pxHigherPriorityTaskWoken) != pdTRUE)
+        return pdFALSE;
+    WRECORD_FROM_ISR(pxHigherPriorityTaskWoken, WRECORD_DATA, NOTIFICATION_FROM_ISR(0).Identifier.w_id, dest->getIdentifier().w_id, data, size);
+    return sendNotificationFromIsrTo(dest, notif_value, pxHigherPriorityTaskWoken);
+};
+
 /**
  * @brief Construct a new RTask::RTask object
  * 
@@ -52,6 +81,26 @@ RTask::RTask(char ntype, std::string taskName, uint16_t stackSize, uint8_t prior
     mutex_receiving_buff = xSemaphoreCreateMutex();
 };
 
+/**
+ * @brief Construct a new RTask::RTask object from a static configuration (see TaskSet)
+ * 
+ * @param config the ring buffer and its mutex use the buffers of the configuration when they are given
+ */
+RTask::RTask(const TaskConfig_t &config) : NTask(config)
+{
+    configASSERT(config.ringbuffer_size>0);
+    if (config.ringbuffer_storage != nullptr)
+    {
+        receiving_buff = xRingbufferCreateStatic(config.ringbuffer_size, RINGBUF_TYPE_NOSPLIT, config.ringbuffer_storage, config.ringbuffer_buffer);
+        mutex_receiving_buff = xSemaphoreCreateMutexStatic(config.mutex_buffer);
+    }
+    else
+    {
+        receiving_buff = xRingbufferCreate(config.ringbuffer_size, RINGBUF_TYPE_NOSPLIT);
+        mutex_receiving_buff = xSemaphoreCreateMutex();
+    }
+};
+
 /**
  * @brief Destroy the RTask::RTask object
  * 
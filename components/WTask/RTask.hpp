@@ -2,6 +2,7 @@
 #define RTASK_HPP_
 
 #include "NTask.hpp"
+#include "WTrace.hpp"
 #include "freertos/ringbuf.h"
 #include "freertos/semphr.h"
 
@@ -21,7 +22,9 @@ protected:
     * @return void* pointer on data, or nullptr if timeout and no data available
     */
     void *receiveData(size_t *size, TickType_t tickToWait){
-        return xRingbufferReceive(receiving_buff, size, tickToWait);
+        void *data;
+        WTRACE_WAIT(tickToWait, data = xRingbufferReceive(receiving_buff, size, tickToWait));
+        return data;
     };
 
     /**
@@ -42,8 +45,6 @@ protected:
     void returnData(void *data){
         vRingbufferReturnItem(receiving_buff, data);
     };
-    
-    static BaseType_t sendDataTo(RTask *destination, void *data, uint32_t size, TickType_t ticktowait, bool usenotif, Notification_t notification);
 
     /**
      * @brief Send data to RTask and also send a notification
@@ -99,7 +100,10 @@ protected:
     };
 public:
     RTask(char ntype = 0, std::string taskName = "Task", uint16_t stackSize = 10000, uint8_t priority = 2, uint8_t coreId = 0, uint8_t notification_queue_size = NTASK_QUEUE_LENGTH, uint32_t ringbuffer_size = 128);
+    RTask(const TaskConfig_t &config);
     ~RTask();
+    static BaseType_t sendDataTo(RTask *destination, void *data, uint32_t size, TickType_t ticktowait, bool usenotif, Notification_t notification);
+    static BaseType_t sendDataFromIsrTo(RTask *dest, const void *data, uint32_t size, uint16_t notif_value, BaseType_t *pxHigherPriorityTaskWoken);
     //get_data and set_data are synchrounous functions that can't be implemented here
 };
 
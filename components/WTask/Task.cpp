@@ -1,5 +1,8 @@
 #include "esp_log.h"
 #include "Task.hpp"
+#include "WTrace.hpp"
+#include "WPartition.hpp"
+#include "WRecord.h"
 #include "sdkconfig.h"
 
 static const char *TASK_LOG_TAG = "Task";
@@ -16,9 +19,13 @@ Task::Task(std::string taskName, uint16_t stackSize, uint8_t priority)
 	m_stackSize = stackSize;
 	m_priority = priority;
 	m_taskData = nullptr;
+	m_stackBuffer = nullptr;
+	m_taskBuffer = nullptr;
 	m_handle = nullptr;
 	m_coreId = tskNO_AFFINITY;
+	m_criticality = TASK_BEST_EFFORT;
 	m_running = false;
+	m_recordSource = WRECORD_SOURCE_NONE;
 } // Task
 
 Task::~Task() {}
@@ -30,7 +37,7 @@ Task::~Task() {}
  */
 /*static*/ void Task::delay(int ms)
 {
-	::vTaskDelay(pdMS_TO_TICKS(ms));
+	WTRACE_WAIT(pdMS_TO_TICKS(ms), ::vTaskDelay(pdMS_TO_TICKS(ms)));
 }
 
 /**
@@ -43,7 +50,13 @@ void Task::runTask(void *pTaskInstance)
 	Task *pTask = (Task *)pTaskInstance;
 	ESP_LOGD(TASK_LOG_TAG, ">> runTask: taskName=%s\n", pTask->m_taskName.c_str());
 	pTask->m_running = true;
+#if CONFIG_WTASK_RECORD
+	vTaskSetThreadLocalStoragePointer(nullptr, CONFIG_WTASK_RECORD_TLS_INDEX, pTask); // read by NTask::callerIdentifier
+#endif
+	WTRACE_REGISTER_TASK(xTaskGetCurrentTaskHandle(), pTask->m_taskName.c_str());
+	WTRACE(WTRACE_TASK_BEGIN, 0, 0);
 	pTask->run(pTask->m_taskData);
+	WTRACE(WTRACE_TASK_END, 0, 0);
 	ESP_LOGD(TASK_LOG_TAG, "<< runTask: taskName=%s\n", pTask->m_taskName.c_str());
 	pTask->stop();
 } // runTask 
@@ -89,8 +102,19 @@ void Task::start(void *taskData)
 	{
 		ESP_LOGW(TASK_LOG_TAG, "Task::start - There might be a task already running!\n");
 	}
+#if CONFIG_WTASK_PARTITION
+	if (!WPartition::place(m_taskName.c_str(), m_coreId, m_priority, m_criticality))
+		return;
+#endif
 	m_taskData = taskData;
-	::xTaskCreatePinnedToCore(&runTask, m_taskName.c_str(), m_stackSize, this, m_priority, &m_handle, m_coreId);
+	if (m_stackBuffer != nullptr)
+		m_handle = ::xTaskCreateStaticPinnedToCore(&runTask, m_taskName.c_str(), m_stackSize, this, m_priority, m_stackBuffer, m_taskBuffer, m_coreId);
+	else
+		::xTaskCreatePinnedToCore(&runTask, m_taskName.c_str(), m_stackSize, this, m_priority, &m_handle, m_coreId);
+#if CONFIG_WTASK_PARTITION
+	if (m_handle != nullptr)
+		WPartition::registerTask(m_handle, m_coreId, m_criticality);
+#endif
 } // start
 
 /**
@@ -103,6 +127,9 @@ void Task::stop()
 		return;
 	TaskHandle_t temp = m_handle;
 	m_handle = nullptr;
+#if CONFIG_WTASK_PARTITION
+	WPartition::unregisterTask(temp);
+#endif
 	::vTaskDelete(temp);
 	m_running = false;
 } // stop
@@ -146,4 +173,28 @@ void Task::setName(std::string name)
 void Task::setCore(BaseType_t coreId)
 {
 	m_coreId = coreId;
+}
+
+/**
+ * @brief Use static buffers for the stack and the control block of the task instead of the heap.
+ * The stack buffer must hold the stack size set for the task, both buffers must outlive the task.
+ * @param [in] stackBuffer The stack of the task, nullptr to go back to heap allocation.
+ * @param [in] taskBuffer The control block of the task.
+ * @return N/A.
+ */
+void Task::setStaticBuffers(StackType_t *stackBuffer, StaticTask_t *taskBuffer)
+{
+	m_stackBuffer = stackBuffer;
+	m_taskBuffer = taskBuffer;
+}
+
+/**
+ * @brief Set the criticality of the task, used by the core partition (CONFIG_WTASK_PARTITION) when the task is started.
+ * A task without core is placed on the core of its criticality, a task pinned to the other core is not started.
+ * @param [in] criticality TASK_REAL_TIME or TASK_BEST_EFFORT (default).
+ * @return N/A.
+ */
+void Task::setCriticality(TaskCriticality_t criticality)
+{
+	m_criticality = criticality;
 }
\ No newline at end of file
@@ -5,6 +5,14 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 
+/**
+ * @brief Criticality of a task, for the core partition (see WPartition.hpp)
+ */
+enum TaskCriticality_t : uint8_t
+{
+	TASK_BEST_EFFORT = 0, //<! soft work, on the best effort core
+	TASK_REAL_TIME,       //<! hard real-time control and ISR deferral, on the real-time core
+};
 
 /**
  * @brief Encapsulate a runnable task.
@@ -35,6 +43,8 @@ public:
 	void setPriority(uint8_t priority);
 	void setName(std::string name);
 	void setCore(BaseType_t coreId);
+	void setStaticBuffers(StackType_t *stackBuffer, StaticTask_t *taskBuffer);
+	void setCriticality(TaskCriticality_t criticality);
 	void suspend();
 	void resume();
 	void start(void* taskData = nullptr);
@@ -50,17 +60,23 @@ public:
 	 * @param [in] data The data passed in to the newly started task.
 	 */
 	uint32_t getCore(void){return m_coreId;};
+	TaskCriticality_t getCriticality(void){return m_criticality;};
 	std::string getName(void){return m_taskName;};
 	bool is_task_running(){return m_running;};
+	uint16_t getRecordSource(void) const {return m_recordSource;};
 protected:
 	TaskHandle_t m_handle;
 	std::string m_taskName;
 	uint16_t    m_stackSize;
 	uint8_t     m_priority;
 	BaseType_t  m_coreId;
+	TaskCriticality_t m_criticality;
 	bool 		m_running;
+	uint16_t    m_recordSource; //< Source of the records sent by the task (w_id of a NTask, WRECORD_SOURCE_NONE otherwise)
 private:
 	void*       m_taskData;
+	StackType_t *m_stackBuffer;
+	StaticTask_t *m_taskBuffer;
 	static void runTask(void* data);
 	virtual void run(void* data) = 0; // Make run pure virtual
 };
@@ -0,0 +1,479 @@
+#ifndef TASKGRAPH_HPP_
+#define TASKGRAPH_HPP_
+
+#include "sdkconfig.h"
+#include <array>
+#include <tuple>
+#include <utility>
+#include <cstddef>
+#include <type_traits>
+#include "NTask.hpp"
+#include "WPartition.hpp"
+#if CONFIG_RTASK_SUPPORT
+#include "RTask.hpp"
+#endif
+
+#define TASKGRAPH_CORE_LOAD_MAX (1000)  //<! load of a full core, in per mille
+#define TASKGRAPH_RINGBUF_HEADER (8)    //<! header of an item of a no split ring buffer
+#define TASKGRAPH_RINGBUF_MIN (32)      //<! ring buffer of a RTask that receives no payload
+#define TASKGRAPH_NOT_FOUND ((std::size_t)-1)
+
+/**
+ * @brief Declaration of a task of a graph
+ *
+ */
+struct TaskSpec
+{
+    const char *name;
+    uint8_t type;            //<! NTask type
+    uint8_t ID = 0;          //<! NTask ID, 0 : index of the task in the graph + 1
+    BaseType_t core = 0;     //<! 0 or 1, the tasks of a graph are always pinned
+    uint8_t priority = 2;
+    uint16_t stack = 4096;   //<! in byte
+    uint16_t load = 0;       //<! expected load of the core, in per mille
+    TaskCriticality_t criticality = TASK_BEST_EFFORT; //<! core partition (CONFIG_WTASK_PARTITION)
+};
+
+/**
+ * @brief Declaration of a channel between two tasks of a graph
+ *
+ * Each message is a notification, and also an item of the ring buffer of the receiver when the payload is not empty.
+ */
+struct ChannelSpec
+{
+    const char *from;          //<! name of the sender
+    const char *to;            //<! name of the receiver
+    uint32_t payload = 0;      //<! in byte, 0 for notifications only
+    uint32_t rate = 1;         //<! maximum number of messages per second
+    uint32_t latency_ms = 100; //<! maximum time the receiver leaves the messages pending
+};
+
+/**
+ * @brief Declare a channel carrying a Payload (void for notifications only)
+ *
+ * @tparam Payload
+ * @param from name of the sender
+ * @param to name of the receiver
+ * @param rate maximum number of messages per second
+ * @param latency_ms maximum time the receiver leaves the messages pending
+ * @return constexpr ChannelSpec
+ */
+template <typename Payload>
+constexpr ChannelSpec makeChannel(const char *from, const char *to, uint32_t rate, uint32_t latency_ms)
+{
+    if constexpr (std::is_void_v<Payload>)
+        return {from, to, 0, rate, latency_ms};
+    else
+        return {from, to, sizeof(Payload), rate, latency_ms};
+};
+
+/**
+ * @brief Task graph known at compile time : the tasks, the channels between them, and the sizes derived from the channels
+ *
+ * The checks are constexpr functions, a TaskSet asserts them on its graph.
+ *
+ * @tparam NT number of tasks
+ * @tparam NC number of channels
+ */
+template <std::size_t NT, std::size_t NC>
+struct TaskGraph
+{
+    std::array<TaskSpec, NT> tasks;
+    std::array<ChannelSpec, NC> channels;
+
+    static constexpr bool sameName(const char *a, const char *b)
+    {
+        while ((*a != '\0') && (*a == *b))
+        {
+            a++;
+            b++;
+        }
+        return *a == *b;
+    };
+
+    /**
+     * @brief Index of a task
+     *
+     * @param name
+     * @return std::size_t TASKGRAPH_NOT_FOUND if there is no task with this name
+     */
+    constexpr std::size_t indexOf(const char *name) const
+    {
+        for (std::size_t i = 0; i < NT; i++)
+            if (sameName(tasks[i].name, name))
+                return i;
+        return TASKGRAPH_NOT_FOUND;
+    };
+
+    /**
+     * @brief Index of the first channel from a task to another
+     *
+     * @return std::size_t TASKGRAPH_NOT_FOUND if there is no such channel
+     */
+    constexpr std::size_t channelOf(const char *from, const char *to) const
+    {
+        for (std::size_t c = 0; c < NC; c++)
+            if (sameName(channels[c].from, from) && sameName(channels[c].to, to))
+                return c;
+        return TASKGRAPH_NOT_FOUND;
+    };
+
+    constexpr uint8_t ID(std::size_t task) const
+    {
+        return (tasks[task].ID != 0) ? tasks[task].ID : static_cast<uint8_t>(task + 1);
+    };
+
+    /**
+     * @brief Number of messages of a channel that can be pending at the receiver
+     */
+    constexpr uint32_t pendingMessages(std::size_t channel) const
+    {
+        const uint32_t n = (channels[channel].rate * channels[channel].latency_ms + 999) / 1000;
+        return (n > 0) ? n : 1;
+    };
+
+    /**
+     * @brief Length of the notification queue of a task : all the messages of its incoming channels can be pending
+     */
+    constexpr uint32_t queueLength(std::size_t task) const
+    {
+        uint32_t length = 0;
+        for (std::size_t c = 0; c < NC; c++)
+            if (indexOf(channels[c].to) == task)
+                length += pendingMessages(c);
+        return (length > 0) ? length : 1;
+    };
+
+    /**
+     * @brief Size of the ring buffer of a task, 0 if it receives no payload
+     *
+     * All the pending payloads fit, and the largest item fits in half of the buffer (limit of a no split ring buffer).
+     */
+    constexpr uint32_t ringbufferSize(std::size_t task) const
+    {
+        uint32_t size = 0;
+        uint32_t largest = 0;
+        for (std::size_t c = 0; c < NC; c++)
+        {
+            if ((indexOf(channels[c].to) != task) || (channels[c].payload == 0))
+                continue;
+            const uint32_t item = ((channels[c].payload + 3) & ~3u) + TASKGRAPH_RINGBUF_HEADER;
+            size += pendingMessages(c) * item;
+            largest = (item > largest) ? item : largest;
+        }
+        return (size > 2 * largest) ? size : 2 * largest;
+    };
+
+    /**
+     * @brief Sum of the loads of the tasks of a core, in per mille
+     */
+    constexpr uint32_t coreLoad(BaseType_t core) const
+    {
+        uint32_t load = 0;
+        for (std::size_t i = 0; i < NT; i++)
+            if (tasks[i].core == core)
+                load += tasks[i].load;
+        return load;
+    };
+
+    constexpr bool identifiersUnique() const
+    {
+        for (std::size_t i = 0; i < NT; i++)
+            for (std::size_t j = i + 1; j < NT; j++)
+                if ((tasks[i].type == tasks[j].type) && (ID(i) == ID(j)))
+                    return false;
+        return true;
+    };
+
+    /**
+     * @brief The types of the ISR and of the WorkQueue, and the ID 255 are reserved
+     */
+    constexpr bool identifiersValid() const
+    {
+        for (std::size_t i = 0; i < NT; i++)
+            if ((tasks[i].type == NTASK_TYPE_NOTIF_ISR_CONTX) || (tasks[i].type == NTASK_TYPE_NOTIF_WORK_QUEU) || (ID(i) == 255))
+                return false;
+        return true;
+    };
+
+    constexpr bool coresValid() const
+    {
+        for (std::size_t i = 0; i < NT; i++)
+            if ((tasks[i].core < 0) || (tasks[i].core >= portNUM_PROCESSORS))
+                return false;
+        return true;
+    };
+
+    constexpr bool coresNotOverloaded() const
+    {
+        for (BaseType_t core = 0; core < portNUM_PROCESSORS; core++)
+            if (coreLoad(core) > TASKGRAPH_CORE_LOAD_MAX)
+                return false;
+        return true;
+    };
+
+    constexpr bool prioritiesValid() const
+    {
+        for (std::size_t i = 0; i < NT; i++)
+            if (tasks[i].priority >= configMAX_PRIORITIES)
+                return false;
+        return true;
+    };
+
+    constexpr bool stacksValid() const
+    {
+        for (std::size_t i = 0; i < NT; i++)
+            if (tasks[i].stack < configMINIMAL_STACK_SIZE)
+                return false;
+        return true;
+    };
+
+    /**
+     * @brief Both ends of the channels are tasks of the graph, and different ones
+     */
+    constexpr bool channelsValid() const
+    {
+        for (std::size_t c = 0; c < NC; c++)
+        {
+            const std::size_t from = indexOf(channels[c].from);
+            const std::size_t to = indexOf(channels[c].to);
+            if ((from == TASKGRAPH_NOT_FOUND) || (to == TASKGRAPH_NOT_FOUND) || (from == to) || (channels[c].rate == 0))
+                return false;
+        }
+        return true;
+    };
+
+    /**
+     * @brief The notification queues fit in the uint8_t length of NTask
+     */
+    constexpr bool queuesValid() const
+    {
+        for (std::size_t i = 0; i < NT; i++)
+            if (queueLength(i) > 255)
+                return false;
+        return true;
+    };
+
+    /**
+     * @brief The tasks are on the core of their criticality, with a priority of their criticality (always true without CONFIG_WTASK_PARTITION)
+     */
+    constexpr bool partitionRespected() const
+    {
+#if CONFIG_WTASK_PARTITION
+        for (std::size_t i = 0; i < NT; i++)
+            if (!WPartition::allowed(tasks[i].core, tasks[i].priority, tasks[i].criticality))
+                return false;
+#endif
+        return true;
+    };
+
+    constexpr bool valid() const
+    {
+        return identifiersUnique() && identifiersValid() && coresValid() && coresNotOverloaded() && prioritiesValid() && stacksValid() && channelsValid() && queuesValid() && partitionRespected();
+    };
+};
+
+/**
+ * @brief Make a graph, the sizes are deduced from the lists
+ *
+ * @code{.cpp}
+ * constexpr auto robot_graph = makeTaskGraph(
+ *     {TaskSpec{.name = "sensor", .type = 1, .core = 1, .priority = 6, .stack = 4096, .load = 150},
+ *      TaskSpec{.name = "control", .type = 2, .core = 0, .priority = 5, .stack = 6144, .load = 300}},
+ *     {makeChannel<Measure_t>("sensor", "control", 200, 20)});
+ * @endcode
+ */
+template <std::size_t NT, std::size_t NC>
+constexpr TaskGraph<NT, NC> makeTaskGraph(const TaskSpec (&tasks)[NT], const ChannelSpec (&channels)[NC])
+{
+    TaskGraph<NT, NC> graph{};
+    for (std::size_t i = 0; i < NT; i++)
+        graph.tasks[i] = tasks[i];
+    for (std::size_t c = 0; c < NC; c++)
+        graph.channels[c] = channels[c];
+    return graph;
+};
+
+/**
+ * @brief Make a graph of tasks without channel
+ */
+template <std::size_t NT>
+constexpr TaskGraph<NT, 0> makeTaskGraph(const TaskSpec (&tasks)[NT])
+{
+    TaskGraph<NT, 0> graph{};
+    for (std::size_t i = 0; i < NT; i++)
+        graph.tasks[i] = tasks[i];
+    return graph;
+};
+
+/**
+ * @brief Static objects of the tasks of a graph, with their stacks, queues and ring buffers
+ *
+ * The graph is checked at compile time, then the construction only registers the tasks and creates their queues in the static buffers :
+ * nothing is allocated on the heap except the entry of the NTask list. The tasks are reached with direct pointers, without lookup.
+ * Each task class has to be constructible from a TaskConfig_t that it forwards to NTask or RTask.
+ *
+ * @code{.cpp}
+ * TaskSet<robot_graph, SensorTask, ControlTask> robot_tasks; // global object
+ * ...
+ * robot_tasks.start(); // in app_main
+ * ...
+ * // in SensorTask::run
+ * sendDataTo(robot_tasks.destination<robot_graph.channelOf("sensor", "control")>(), &measure, sizeof(measure), 0, MEASURE_READY);
+ * @endcode
+ *
+ * @tparam Graph constexpr TaskGraph with static storage
+ * @tparam Tasks classes of the tasks, in the order of the graph
+ */
+template <const auto &Graph, typename... Tasks>
+class TaskSet
+{
+private:
+    static constexpr std::size_t N = sizeof...(Tasks);
+    template <std::size_t I>
+    using task_t = std::tuple_element_t<I, std::tuple<Tasks...>>;
+
+    template <std::size_t I>
+    static constexpr bool isRTask()
+    {
+#if CONFIG_RTASK_SUPPORT
+        return std::is_base_of_v<RTask, task_t<I>>;
+#else
+        return false;
+#endif
+    };
+
+    template <std::size_t I>
+    static constexpr uint32_t ringbufferSize()
+    {
+        if constexpr (!isRTask<I>())
+            return 0;
+        else
+            return (Graph.ringbufferSize(I) > 0) ? Graph.ringbufferSize(I) : TASKGRAPH_RINGBUF_MIN;
+    };
+
+    template <std::size_t... Is>
+    static constexpr bool receiversValid(std::index_sequence<Is...>)
+    {
+        return (((Graph.ringbufferSize(Is) == 0) || isRTask<Is>()) && ...);
+    };
+
+    static_assert(N == Graph.tasks.size(), "TaskSet: one class per task of the graph");
+    static_assert((std::is_base_of_v<NTask, Tasks> && ...), "TaskSet: the tasks must be NTask");
+    static_assert(Graph.identifiersUnique(), "TaskGraph: two tasks have the same type:ID");
+    static_assert(Graph.identifiersValid(), "TaskGraph: a task uses a reserved type or ID");
+    static_assert(Graph.coresValid(), "TaskGraph: a task is not pinned to an existing core");
+    static_assert(Graph.coresNotOverloaded(), "TaskGraph: the load of a core is over TASKGRAPH_CORE_LOAD_MAX");
+    static_assert(Graph.prioritiesValid(), "TaskGraph: a priority is over configMAX_PRIORITIES");
+    static_assert(Graph.stacksValid(), "TaskGraph: a stack is under configMINIMAL_STACK_SIZE");
+    static_assert(Graph.channelsValid(), "TaskGraph: a channel has an unknown end, a loop or a null rate");
+    static_assert(Graph.queuesValid(), "TaskGraph: a notification queue is longer than 255");
+    static_assert(receiversValid(std::make_index_sequence<N>()), "TaskGraph: a task that receives a payload must be a RTask");
+    static_assert(Graph.partitionRespected(), "TaskGraph: a task is placed against the core partition (core or priority of its criticality)");
+
+    /**
+     * @brief Static buffers of a task
+     */
+    template <std::size_t I>
+    struct Storage
+    {
+        alignas(4) uint8_t queue[Graph.queueLength(I) * sizeof(Notification_t)];
+        StaticQueue_t queue_buffer;
+        alignas(4) uint8_t ringbuffer[(ringbufferSize<I>() > 0) ? ringbufferSize<I>() : 1];
+        StaticRingbuffer_t ringbuffer_buffer;
+        StaticSemaphore_t mutex_buffer;
+        alignas(16) StackType_t stack[Graph.tasks[I].stack / sizeof(StackType_t)];
+        StaticTask_t task_buffer;
+    };
+
+    template <std::size_t... Is>
+    static std::tuple<Storage<Is>...> storageOf(std::index_sequence<Is...>);
+
+    /**
+     * @brief Reserves the NTask list for the N tasks before they are constructed : one allocation per TaskSet
+     */
+    struct ListReservation
+    {
+        ListReservation() { NTask::reserveTasks(N); };
+    } reservation;
+    decltype(storageOf(std::make_index_sequence<N>())) storage; // before tasks : the buffers exist when the tasks are constructed
+    std::tuple<Tasks...> tasks;
+
+    template <std::size_t I>
+    TaskConfig_t config()
+    {
+        Storage<I> &s = std::get<I>(storage);
+        TaskConfig_t c = {};
+        c.name = Graph.tasks[I].name;
+        c.identifier.type = Graph.tasks[I].type;
+        c.identifier.ID = Graph.ID(I);
+        c.stack_size = Graph.tasks[I].stack;
+        c.priority = Graph.tasks[I].priority;
+        c.core = Graph.tasks[I].core;
+        c.criticality = Graph.tasks[I].criticality;
+        c.queue_length = static_cast<uint8_t>(Graph.queueLength(I));
+        c.ringbuffer_size = ringbufferSize<I>();
+        c.stack_buffer = s.stack;
+        c.task_buffer = &s.task_buffer;
+        c.queue_storage = s.queue;
+        c.queue_buffer = &s.queue_buffer;
+        c.ringbuffer_storage = s.ringbuffer;
+        c.ringbuffer_buffer = &s.ringbuffer_buffer;
+        c.mutex_buffer = &s.mutex_buffer;
+        return c;
+    };
+
+    template <std::size_t... Is>
+    TaskSet(std::index_sequence<Is...>) : reservation(), storage(), tasks(config<Is>()...){};
+
+    template <std::size_t... Is>
+    void startAll(std::index_sequence<Is...>)
+    {
+        (std::get<Is>(tasks).start(), ...);
+    };
+
+public:
+    TaskSet() : TaskSet(std::make_index_sequence<N>()){};
+    TaskSet(const TaskSet &) = delete;
+    TaskSet &operator=(const TaskSet &) = delete;
+
+    /**
+     * @brief Start the tasks, in the order of the graph
+     */
+    void start()
+    {
+        startAll(std::make_index_sequence<N>());
+    };
+
+    /**
+     * @brief Task of index I (see TaskGraph::indexOf)
+     */
+    template <std::size_t I>
+    task_t<I> &get()
+    {
+        static_assert(I < N, "TaskSet: unknown task");
+        return std::get<I>(tasks);
+    };
+
+    /**
+     * @brief Receiver of the channel C (see TaskGraph::channelOf), typed as its class
+     */
+    template <std::size_t C>
+    auto *destination()
+    {
+        static_assert(C < Graph.channels.size(), "TaskSet: unknown channel");
+        return &get<Graph.indexOf(Graph.channels[C].to)>();
+    };
+
+    /**
+     * @brief Payload size of the channel C, to check the sent structure against the graph
+     */
+    template <std::size_t C>
+    static constexpr uint32_t payloadSize()
+    {
+        static_assert(C < Graph.channels.size(), "TaskSet: unknown channel");
+        return Graph.channels[C].payload;
+    };
+};
+
+#endif // TASKGRAPH_HPP_
@@ -0,0 +1,249 @@
+#include "sdkconfig.h"
+#if CONFIG_WTASK_DEFERRED
+#include <atomic>
+#include <inttypes.h>
+#include <stdio.h>
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "WDeferred.hpp"
+#include "WPartition.hpp"
+#include "WTrace.hpp"
+
+#define WDEFERRED_QUEUE_MASK (CONFIG_WTASK_DEFERRED_QUEUE_LENGTH - 1)
+
+static const char *WDEFERRED_LOG_TAG = "WDEFERRED";
+
+static_assert((CONFIG_WTASK_DEFERRED_QUEUE_LENGTH & WDEFERRED_QUEUE_MASK) == 0, "the deferred queue length must be a power of 2");
+static_assert(CONFIG_WTASK_DEFERRED_QUEUE_LENGTH <= UINT16_MAX, "the queue occupancy is stored on 16 bits");
+#if CONFIG_WTASK_PARTITION
+static_assert(CONFIG_WTASK_DEFERRED_PRIORITY >= CONFIG_WTASK_PARTITION_RT_MIN_PRIORITY, "the deferred task of the real-time core needs a real-time priority");
+#endif
+
+/**
+ * @brief Work posted by an ISR
+ *
+ */
+struct WDeferredWork_t
+{
+    WDeferredHandler_t handler;
+    void *arg;
+    Notification_t notif;
+    int64_t posted_us;
+};
+
+/**
+ * @brief Queue of a core : written by the ISR of both cores (tail), read by the deferred task of the core (head)
+ * @details The indexes run freely, tail - head is the occupancy. posted, dropped and max_pending are written by the ISR
+ *          under the lock, the other statistics by the task.
+ */
+struct WDeferredQueue_t
+{
+    WDeferredWork_t works[CONFIG_WTASK_DEFERRED_QUEUE_LENGTH];
+    std::atomic<uint32_t> head;
+    std::atomic<uint32_t> tail;
+    TaskHandle_t task;
+    WDeferredStats_t stats;
+    portMUX_TYPE lock; //<! serializes the ISR posting to the queue
+};
+
+static DRAM_ATTR WDeferredQueue_t wdeferred_queues[portNUM_PROCESSORS];
+
+/**
+ * @brief Deferred task of a core : calls the handlers of the works posted on its core
+ *
+ */
+class WDeferredTask : public Task
+{
+public:
+    WDeferredTask(BaseType_t core, uint8_t priority, TaskCriticality_t criticality)
+        : Task((core == 0) ? "deferred0" : "deferred1", CONFIG_WTASK_DEFERRED_STACK_SIZE, priority)
+    {
+        setCore(core);
+        setCriticality(criticality);
+    };
+    TaskHandle_t getHandle() const { return m_handle; };
+
+private:
+    void run(void *data)
+    {
+        WDeferredQueue_t &queue = *static_cast<WDeferredQueue_t *>(data);
+        WDeferredStats_t &stats = queue.stats;
+        uint32_t head = queue.head.load(std::memory_order_relaxed);
+        while (true)
+        {
+            WTRACE_WAIT(portMAX_DELAY, ulTaskNotifyTake(pdTRUE, portMAX_DELAY));
+            uint32_t batch = 0;
+            // the tail is read again after each work: a work posted during the handlers is handled before sleeping
+            while (head != queue.tail.load(std::memory_order_acquire))
+            {
+                const WDeferredWork_t work = queue.works[head & WDEFERRED_QUEUE_MASK];
+                queue.head.store(++head, std::memory_order_release);
+                const int64_t delay = esp_timer_get_time() - work.posted_us;
+                stats.handled++;
+                stats.total_us += delay;
+                if (delay < stats.min_us)
+                    stats.min_us = delay;
+                if (delay > stats.max_us)
+                    stats.max_us = delay;
+                if (delay > CONFIG_WTASK_DEFERRED_BUDGET_US)
+                    stats.late++;
+                WTRACE(WTRACE_WORK_BEGIN, work.handler, 0);
+                work.handler(work.arg, work.notif);
+                WTRACE(WTRACE_WORK_END, work.handler, 0);
+                if ((++batch % CONFIG_WTASK_DEFERRED_BATCH) == 0)
+                    taskYIELD(); // let the tasks of the same priority run between two batches
+            }
+            stats.wakeups++;
+            if (batch > stats.max_batch)
+                stats.max_batch = (batch > UINT16_MAX) ? UINT16_MAX : batch;
+        }
+    };
+};
+
+/**
+ * @brief Start the deferred task of each core (once, before installing the ISR that post works)
+ *
+ * @return false if a task could not be created
+ */
+bool WDeferred::start()
+{
+    bool started = true;
+    for (BaseType_t core = 0; core < portNUM_PROCESSORS; core++)
+    {
+        WDeferredQueue_t &queue = wdeferred_queues[core];
+        if (queue.task != nullptr)
+            continue;
+        queue.stats = {};
+        queue.stats.min_us = INT64_MAX;
+        portMUX_INITIALIZE(&queue.lock);
+        uint8_t priority = CONFIG_WTASK_DEFERRED_PRIORITY;
+        TaskCriticality_t criticality = TASK_REAL_TIME;
+#if CONFIG_WTASK_PARTITION
+        if (core != WPartition::realTimeCore())
+        {
+            priority = CONFIG_WTASK_PARTITION_RT_MIN_PRIORITY - 1;
+            criticality = TASK_BEST_EFFORT;
+        }
+#endif
+        WDeferredTask *task = new WDeferredTask(core, priority, criticality);
+        task->start(&queue);
+        if (task->getHandle() == nullptr)
+        {
+            ESP_LOGE(WDEFERRED_LOG_TAG, "Can't start the deferred task of core %d", core);
+            delete task;
+            started = false;
+            continue;
+        }
+        queue.task = task->getHandle();
+    }
+    return started;
+};
+
+/**
+ * @brief Post a work to the deferred task of the current core: should only be used from ISR context
+ *
+ * @param handler called by the deferred task
+ * @param arg given to the handler
+ * @param value given to the handler as NOTIFICATION_FROM_ISR(value)
+ * @param [out] pxHigherPriorityTaskWoken set to pdTRUE when the deferred task has to preempt the interrupted task
+ * @return false if the deferred tasks are not started or the queue of the core is full
+ */
+bool IRAM_ATTR WDeferred::postFromIsr(WDeferredHandler_t handler, void *arg, uint16_t value, BaseType_t *pxHigherPriorityTaskWoken)
+{
+    return postFromIsrTo(xPortGetCoreID(), handler, arg, value, pxHigherPriorityTaskWoken);
+};
+
+/**
+ * @brief Post a work to the deferred task of a core: should only be used from ISR context
+ * @details The ISR of both cores can post to the same queue, the copy is done under the spinlock of the queue.
+ *          The deferred task of the other core is woken by a cross-core yield, pxHigherPriorityTaskWoken is only set
+ *          for a task of the current core.
+ *
+ * @param core core of the deferred task, tskNO_AFFINITY for the current core
+ * @param handler called by the deferred task
+ * @param arg given to the handler
+ * @param value given to the handler as NOTIFICATION_FROM_ISR(value)
+ * @param [out] pxHigherPriorityTaskWoken set to pdTRUE when the deferred task has to preempt the interrupted task
+ * @return false if the core doesn't exist, the deferred tasks are not started or the queue of the core is full
+ */
+bool IRAM_ATTR WDeferred::postFromIsrTo(BaseType_t core, WDeferredHandler_t handler, void *arg, uint16_t value, BaseType_t *pxHigherPriorityTaskWoken)
+{
+    if (core == tskNO_AFFINITY)
+        core = xPortGetCoreID();
+    else if ((core < 0) || (core >= portNUM_PROCESSORS))
+        return false;
+    WDeferredQueue_t &queue = wdeferred_queues[core];
+    if (queue.task == nullptr)
+        return false;
+    portENTER_CRITICAL_ISR(&queue.lock);
+    const uint32_t tail = queue.tail.load(std::memory_order_relaxed);
+    const uint32_t pending = tail - queue.head.load(std::memory_order_acquire);
+    if (pending >= CONFIG_WTASK_DEFERRED_QUEUE_LENGTH)
+    {
+        queue.stats.dropped++;
+        portEXIT_CRITICAL_ISR(&queue.lock);
+        return false;
+    }
+    WDeferredWork_t &work = queue.works[tail & WDEFERRED_QUEUE_MASK];
+    work.handler = handler;
+    work.arg = arg;
+    work.notif = NOTIFICATION_FROM_ISR(value);
+    work.posted_us = esp_timer_get_time();
+    queue.tail.store(tail + 1, std::memory_order_release);
+    queue.stats.posted++;
+    if (pending + 1 > queue.stats.max_pending)
+        queue.stats.max_pending = pending + 1;
+    portEXIT_CRITICAL_ISR(&queue.lock);
+    // the task re-reads the tail before sleeping, it only needs a wake up when the queue was empty
+    if (pending == 0)
+        vTaskNotifyGiveFromISR(queue.task, pxHigherPriorityTaskWoken);
+    return true;
+};
+
+/**
+ * @brief Handler forwarding the notification to a NTask (arg), from the deferred task
+ * @details The ISR only posts the work, the notification queue of the NTask is written at task level.
+ *          WDeferred::postFromIsr(WDeferred::notify, ntask, value, &woken)
+ */
+void WDeferred::notify(void *ntask, Notification_t notif)
+{
+    if (NTask::sendNotificationTo(static_cast<NTask *>(ntask), notif, 0, queueSEND_TO_BACK) != pdTRUE)
+        ESP_LOGW(WDEFERRED_LOG_TAG, "Notification queue of %s full", static_cast<NTask *>(ntask)->getName().c_str());
+};
+
+/**
+ * @brief Copy the statistics of a core
+ *
+ * @return false if the core doesn't exist or its deferred task is not started
+ */
+bool WDeferred::getStats(BaseType_t core, WDeferredStats_t &stats)
+{
+    if ((core < 0) || (core >= portNUM_PROCESSORS) || (wdeferred_queues[core].task == nullptr))
+        return false;
+    stats = wdeferred_queues[core].stats;
+    return true;
+};
+
+/**
+ * @brief Print the statistics of each core
+ *
+ */
+void WDeferred::report()
+{
+    printf(" Core |   Posted |  Dropped |  Handled |     Late | Wake ups | Max batch | Max pending | Delay us min / avg / max\n");
+    printf("------|----------|----------|----------|----------|----------|-----------|-------------|-------------------------\n");
+    for (BaseType_t core = 0; core < portNUM_PROCESSORS; core++)
+    {
+        WDeferredStats_t stats;
+        if (!getStats(core, stats))
+            continue;
+        printf(" %4d | %8" PRIu32 " | %8" PRIu32 " | %8" PRIu32 " | %8" PRIu32 " | %8" PRIu32 " | %9u | %11u | ", core, stats.posted, stats.dropped, stats.handled,
+               stats.late, stats.wakeups, stats.max_batch, stats.max_pending);
+        if (stats.handled > 0)
+            printf("%lld / %lld / %lld\n", (long long)stats.min_us, (long long)(stats.total_us / stats.handled), (long long)stats.max_us);
+        else
+            printf("-\n");
+    }
+};
+#endif
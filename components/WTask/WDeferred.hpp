@@ -0,0 +1,61 @@
+#ifndef WDEFERRED_HPP_
+#define WDEFERRED_HPP_
+
+#include "sdkconfig.h"
+#if CONFIG_WTASK_DEFERRED
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "NTask.hpp"
+
+/**
+ * @brief Handler of a deferred work, called by the deferred task of the core the work was posted to
+ *
+ * @param arg argument given to postFromIsr
+ * @param notif NOTIFICATION_FROM_ISR of the value given to postFromIsr
+ */
+typedef void (*WDeferredHandler_t)(void *arg, Notification_t notif);
+
+/**
+ * @brief Statistics of the deferred works of a core
+ *
+ */
+struct WDeferredStats_t
+{
+    uint32_t posted;      //<! works posted by the ISR
+    uint32_t dropped;     //<! works refused because the queue was full
+    uint32_t handled;     //<! works handled by the deferred task
+    uint32_t late;        //<! works handled more than CONFIG_WTASK_DEFERRED_BUDGET_US after their post
+    uint32_t wakeups;     //<! wake ups of the deferred task
+    uint16_t max_batch;   //<! most works handled in one wake up
+    uint16_t max_pending; //<! highest queue occupancy
+    int64_t min_us;       //<! ISR to handler delay
+    int64_t max_us;
+    int64_t total_us;     //<! average is total_us / handled
+};
+
+/**
+ * @brief Deferred ISR work (bottom half)
+ * @details An ISR posts a fixed size work (handler, argument, 16 bits value) into the queue of its core (postFromIsr) or
+ *          of a given core (postFromIsrTo), and the deferred task of the core calls the handler. The works of all the sources of a core share one task at
+ *          CONFIG_WTASK_DEFERRED_PRIORITY: the ISR only fills a small record and wakes the task when the queue was empty,
+ *          instead of a FreeRTOS queue send per event to one NTask per source.
+ *          The queue is lock-free between the ISR and the task. The ISR posting to the same queue (nested levels, other
+ *          core) are serialized by the spinlock of the queue during the copy. The task yields every CONFIG_WTASK_DEFERRED_BATCH works
+ *          and counts the works handled later than CONFIG_WTASK_DEFERRED_BUDGET_US.
+ *          With CONFIG_WTASK_PARTITION, the task of the real-time core is TASK_REAL_TIME, the task of the best effort core
+ *          is TASK_BEST_EFFORT just below the real-time priorities: the ISR of hard real-time sources post to
+ *          WPartition::realTimeCore() wherever they are installed.
+ */
+class WDeferred
+{
+public:
+    static bool start();
+    static bool postFromIsr(WDeferredHandler_t handler, void *arg, uint16_t value, BaseType_t *pxHigherPriorityTaskWoken);
+    static bool postFromIsrTo(BaseType_t core, WDeferredHandler_t handler, void *arg, uint16_t value, BaseType_t *pxHigherPriorityTaskWoken);
+    static void notify(void *ntask, Notification_t notif);
+    static bool getStats(BaseType_t core, WDeferredStats_t &stats);
+    static void report();
+};
+
+#endif
+#endif /*WDEFERRED_HPP_*/
@@ -0,0 +1,183 @@
+#include "sdkconfig.h"
+#if CONFIG_WTASK_PARTITION
+#include <stdio.h>
+#include <string.h>
+#include "esp_log.h"
+#include "WPartition.hpp"
+
+static const char *WPARTITION_LOG_TAG = "WPARTITION";
+
+/**
+ * @brief Started task and its run time counter at the previous sample
+ *
+ */
+struct WPartitionTask_t
+{
+    TaskHandle_t handle;
+    BaseType_t core;
+    TaskCriticality_t criticality;
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+    configRUN_TIME_COUNTER_TYPE last;
+    configRUN_TIME_COUNTER_TYPE delta; //<! run time between the last two samples
+#endif
+};
+
+static WPartitionTask_t wpartition_tasks[CONFIG_WTASK_PARTITION_MAX_TASKS];
+static uint32_t wpartition_task_count = 0;
+static portMUX_TYPE wpartition_lock = portMUX_INITIALIZER_UNLOCKED;
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+static configRUN_TIME_COUNTER_TYPE wpartition_last_time = 0;
+static configRUN_TIME_COUNTER_TYPE wpartition_last_idle[portNUM_PROCESSORS] = {};
+#endif
+
+/**
+ * @brief Place a task before its creation (called by Task::start)
+ *
+ * @param name for the error message
+ * @param [in, out] core pinned core, tskNO_AFFINITY is replaced by the core of the criticality
+ * @param priority
+ * @param criticality
+ * @return false if the placement violates the partition : the task must not be created
+ */
+bool WPartition::place(const char *name, BaseType_t &core, uint8_t priority, TaskCriticality_t criticality)
+{
+    if (core == tskNO_AFFINITY)
+        core = coreOf(criticality);
+    if (allowed(core, priority, criticality))
+        return true;
+    if (core != coreOf(criticality))
+        ESP_LOGE(WPARTITION_LOG_TAG, "%s : %s task pinned to core %d, the partition gives it core %d", name,
+                 (criticality == TASK_REAL_TIME) ? "real-time" : "best effort", core, coreOf(criticality));
+    else
+        ESP_LOGE(WPARTITION_LOG_TAG, "%s : priority %d of a %s task, the real-time priorities start at %d", name, priority,
+                 (criticality == TASK_REAL_TIME) ? "real-time" : "best effort", CONFIG_WTASK_PARTITION_RT_MIN_PRIORITY);
+    return false;
+};
+
+/**
+ * @brief Account a started task in the utilization (called by Task::start)
+ *
+ */
+void WPartition::registerTask(TaskHandle_t handle, BaseType_t core, TaskCriticality_t criticality)
+{
+    taskENTER_CRITICAL(&wpartition_lock);
+    if (wpartition_task_count < CONFIG_WTASK_PARTITION_MAX_TASKS)
+    {
+        WPartitionTask_t &task = wpartition_tasks[wpartition_task_count++];
+        task.handle = handle;
+        task.core = core;
+        task.criticality = criticality;
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+        task.last = ulTaskGetRunTimeCounter(handle);
+        task.delta = 0;
+#endif
+    }
+    taskEXIT_CRITICAL(&wpartition_lock);
+};
+
+/**
+ * @brief Forget a task before its deletion (called by Task::stop) : its handle can't be read anymore
+ *
+ */
+void WPartition::unregisterTask(TaskHandle_t handle)
+{
+    taskENTER_CRITICAL(&wpartition_lock);
+    for (uint32_t i = 0; i < wpartition_task_count; i++)
+    {
+        if (wpartition_tasks[i].handle == handle)
+        {
+            wpartition_tasks[i] = wpartition_tasks[--wpartition_task_count];
+            break;
+        }
+    }
+    taskEXIT_CRITICAL(&wpartition_lock);
+};
+
+/**
+ * @brief Utilization of each core since the previous sample, from the FreeRTOS run time counters
+ *
+ * @param [out] loads indexed by core
+ * @return false without CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS or if no time elapsed
+ */
+bool WPartition::sample(WPartitionLoad_t loads[portNUM_PROCESSORS])
+{
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+    configRUN_TIME_COUNTER_TYPE real_time[portNUM_PROCESSORS] = {};
+    configRUN_TIME_COUNTER_TYPE best_effort[portNUM_PROCESSORS] = {};
+    configRUN_TIME_COUNTER_TYPE idle[portNUM_PROCESSORS];
+    taskENTER_CRITICAL(&wpartition_lock);
+    const configRUN_TIME_COUNTER_TYPE now = (configRUN_TIME_COUNTER_TYPE)portGET_RUN_TIME_COUNTER_VALUE();
+    const configRUN_TIME_COUNTER_TYPE elapsed = now - wpartition_last_time;
+    wpartition_last_time = now;
+    for (BaseType_t core = 0; core < portNUM_PROCESSORS; core++)
+    {
+        const configRUN_TIME_COUNTER_TYPE counter = ulTaskGetRunTimeCounter(xTaskGetIdleTaskHandleForCore(core));
+        idle[core] = counter - wpartition_last_idle[core];
+        wpartition_last_idle[core] = counter;
+    }
+    for (uint32_t i = 0; i < wpartition_task_count; i++)
+    {
+        WPartitionTask_t &task = wpartition_tasks[i];
+        const configRUN_TIME_COUNTER_TYPE counter = ulTaskGetRunTimeCounter(task.handle);
+        task.delta = counter - task.last;
+        task.last = counter;
+        ((task.criticality == TASK_REAL_TIME) ? real_time : best_effort)[task.core] += task.delta;
+    }
+    taskEXIT_CRITICAL(&wpartition_lock);
+    if (elapsed == 0)
+        return false;
+    for (BaseType_t core = 0; core < portNUM_PROCESSORS; core++)
+    {
+        const uint64_t busy = (idle[core] < elapsed) ? elapsed - idle[core] : 0;
+        loads[core].busy = (uint16_t)(busy * 1000 / elapsed);
+        loads[core].real_time = (uint16_t)((uint64_t)real_time[core] * 1000 / elapsed);
+        loads[core].best_effort = (uint16_t)((uint64_t)best_effort[core] * 1000 / elapsed);
+    }
+    return true;
+#else
+    return false;
+#endif
+};
+
+/**
+ * @brief Sample and print the utilization of each core, and of each started task
+ *
+ */
+void WPartition::report()
+{
+    WPartitionLoad_t loads[portNUM_PROCESSORS];
+    if (!sample(loads))
+    {
+        ESP_LOGW(WPARTITION_LOG_TAG, "No utilization : enable CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS, and wait between 2 reports");
+        return;
+    }
+    printf(" Core | Role        |  Busy %% | Real-time %% | Best effort %%\n");
+    printf("------|-------------|---------|-------------|--------------\n");
+    for (BaseType_t core = 0; core < portNUM_PROCESSORS; core++)
+    {
+        printf(" %4d | %-11s | %5u.%u | %9u.%u | %11u.%u\n", core, (core == realTimeCore()) ? "real-time" : "best effort",
+               loads[core].busy / 10, loads[core].busy % 10, loads[core].real_time / 10, loads[core].real_time % 10,
+               loads[core].best_effort / 10, loads[core].best_effort % 10);
+    }
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+    printf(" Task             | Core | Criticality | Run time since the previous report\n");
+    printf("------------------|------|-------------|-----------------------------------\n");
+    taskENTER_CRITICAL(&wpartition_lock);
+    const uint32_t count = wpartition_task_count;
+    WPartitionTask_t tasks[CONFIG_WTASK_PARTITION_MAX_TASKS];
+    char names[CONFIG_WTASK_PARTITION_MAX_TASKS][configMAX_TASK_NAME_LEN];
+    for (uint32_t i = 0; i < count; i++)
+    {
+        tasks[i] = wpartition_tasks[i];
+        strncpy(names[i], pcTaskGetName(tasks[i].handle), configMAX_TASK_NAME_LEN - 1); // the task can be deleted after the copy
+        names[i][configMAX_TASK_NAME_LEN - 1] = '\0';
+    }
+    taskEXIT_CRITICAL(&wpartition_lock);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        printf(" %-16.16s | %4d | %-11s | %llu\n", names[i], tasks[i].core,
+               (tasks[i].criticality == TASK_REAL_TIME) ? "real-time" : "best effort", (unsigned long long)tasks[i].delta);
+    }
+#endif
+};
+#endif
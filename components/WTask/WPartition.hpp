@@ -0,0 +1,69 @@
+#ifndef WPARTITION_HPP_
+#define WPARTITION_HPP_
+
+#include "sdkconfig.h"
+#if CONFIG_WTASK_PARTITION
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "Task.hpp"
+
+static_assert(portNUM_PROCESSORS == 2, "the core partition needs 2 cores");
+static_assert((CONFIG_WTASK_PARTITION_RT_CORE == 0) || (CONFIG_WTASK_PARTITION_RT_CORE == 1), "the real-time core is 0 or 1");
+
+/**
+ * @brief Share of the time of a core since the previous sample, in per mille
+ *
+ */
+struct WPartitionLoad_t
+{
+    uint16_t busy;        //<! not in the idle task of the core (tasks and interrupts)
+    uint16_t real_time;   //<! in the started TASK_REAL_TIME tasks
+    uint16_t best_effort; //<! in the started TASK_BEST_EFFORT tasks
+};
+
+/**
+ * @brief Partition of the cores between hard real-time and best effort work
+ * @details One core (CONFIG_WTASK_PARTITION_RT_CORE) runs the TASK_REAL_TIME tasks, e.g. the control loops and the
+ *          deferred task of that core (WDeferred). The other core runs the TASK_BEST_EFFORT tasks.
+ *          The partition only places tasks : an interrupt is still served on the core that installed it, and its
+ *          deferred works go to the deferred task of that core. Install the ISR of hard real-time sources from a task
+ *          of the real-time core.
+ *          Task::start (not the constructor) places a task without core on the core of its criticality, and refuses to
+ *          start a task pinned to the other core, or whose priority doesn't match its criticality (real-time tasks at
+ *          CONFIG_WTASK_PARTITION_RT_MIN_PRIORITY or above, best effort below). A TaskSet checks the same rules at
+ *          compile time.
+ */
+class WPartition
+{
+public:
+    static constexpr BaseType_t realTimeCore() { return CONFIG_WTASK_PARTITION_RT_CORE; };
+    static constexpr BaseType_t bestEffortCore() { return 1 - CONFIG_WTASK_PARTITION_RT_CORE; };
+    static constexpr BaseType_t coreOf(TaskCriticality_t criticality)
+    {
+        return (criticality == TASK_REAL_TIME) ? realTimeCore() : bestEffortCore();
+    };
+
+    /**
+     * @brief Check a placement against the partition
+     *
+     * @param core pinned core
+     * @param priority
+     * @param criticality
+     * @return true if the task can run there
+     */
+    static constexpr bool allowed(BaseType_t core, uint8_t priority, TaskCriticality_t criticality)
+    {
+        if (core != coreOf(criticality))
+            return false;
+        return (criticality == TASK_REAL_TIME) ? (priority >= CONFIG_WTASK_PARTITION_RT_MIN_PRIORITY) : (priority < CONFIG_WTASK_PARTITION_RT_MIN_PRIORITY);
+    };
+
+    static bool place(const char *name, BaseType_t &core, uint8_t priority, TaskCriticality_t criticality);
+    static void registerTask(TaskHandle_t handle, BaseType_t core, TaskCriticality_t criticality);
+    static void unregisterTask(TaskHandle_t handle);
+    static bool sample(WPartitionLoad_t loads[portNUM_PROCESSORS]);
+    static void report();
+};
+
+#endif
+#endif /*WPARTITION_HPP_*/
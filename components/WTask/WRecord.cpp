@@ -0,0 +1,202 @@
+#include "sdkconfig.h"
+#if CONFIG_WTASK_RECORD
+#include <atomic>
+#include <stdio.h>
+#include <string.h>
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/ringbuf.h"
+#include "WRecord.h"
+#include "WPartition.hpp"
+
+#define WRECORD_WRITER_STACK_SIZE (3072)
+#define WRECORD_WRITER_POLL_TICKS (pdMS_TO_TICKS(100))
+
+static const char *WRECORD_LOG_TAG = "WRECORD";
+
+static_assert(sizeof(WRecord_FileHeader_t) == 16, "log header must stay 16 bytes");
+static_assert(sizeof(WRecord_Header_t) == 16, "record header must stay 16 bytes");
+static_assert(CONFIG_WTASK_RECORD_MAX_PAYLOAD <= UINT16_MAX, "record payload size is stored on 16 bits");
+static_assert(CONFIG_WTASK_RECORD_MAX_ISR_PAYLOAD <= CONFIG_WTASK_RECORD_MAX_PAYLOAD, "an ISR record is also a record");
+
+static RingbufHandle_t wrecord_ring = nullptr;
+static TaskHandle_t wrecord_writer = nullptr;
+static WRecord_Sink_t wrecord_sink = nullptr;
+static void *wrecord_user_data = nullptr;
+static DRAM_ATTR volatile bool wrecord_enabled = false;
+static DRAM_ATTR std::atomic<uint32_t> wrecord_dropped{0};
+
+/**
+ * @brief Write a record that is already padded to the sink (writer task only)
+ *
+ */
+static bool wrecord_output(const void *record, size_t size)
+{
+    return wrecord_sink(record, size, wrecord_user_data);
+}
+
+/**
+ * @brief Writer task : moves the records from the buffer to the sink, and inserts a WRECORD_DROP record after a loss
+ * @details It exits when the recording is stopped and the buffer is empty, or when the sink fails.
+ */
+static void wrecord_writer_task(void *arg)
+{
+    uint32_t reported = 0;
+    bool sink_ok = true;
+    while (sink_ok)
+    {
+        size_t size;
+        void *record = xRingbufferReceive(wrecord_ring, &size, WRECORD_WRITER_POLL_TICKS);
+        const uint32_t dropped = wrecord_dropped.load(std::memory_order_relaxed);
+        if (dropped != reported)
+        {
+            struct
+            {
+                WRecord_Header_t header;
+                uint32_t count;
+                uint32_t padding;
+            } drop = {{esp_timer_get_time(), sizeof(uint32_t), WRECORD_DROP, (uint8_t)xPortGetCoreID(), WRECORD_SOURCE_NONE, WRECORD_SOURCE_NONE}, dropped - reported, 0};
+            sink_ok = wrecord_output(&drop, sizeof(drop));
+            reported = dropped;
+        }
+        if (record != nullptr)
+        {
+            sink_ok = sink_ok && wrecord_output(record, size);
+            vRingbufferReturnItem(wrecord_ring, record);
+        }
+        else if (!wrecord_enabled)
+        {
+            break;
+        }
+    }
+    if (!sink_ok)
+    {
+        wrecord_enabled = false;
+        ESP_LOGE(WRECORD_LOG_TAG, "Sink failed, recording stopped");
+    }
+#if CONFIG_WTASK_PARTITION
+    WPartition::unregisterTask(xTaskGetCurrentTaskHandle());
+#endif
+    wrecord_writer = nullptr;
+    vTaskDelete(nullptr);
+}
+
+bool WRecord_Start(WRecord_Sink_t sink, void *user_data)
+{
+    if ((sink == nullptr) || (wrecord_writer != nullptr))
+        return false;
+    if (wrecord_ring == nullptr)
+        wrecord_ring = xRingbufferCreate(CONFIG_WTASK_RECORD_BUFFER_SIZE, RINGBUF_TYPE_NOSPLIT);
+    if (wrecord_ring == nullptr)
+        return false;
+    wrecord_sink = sink;
+    wrecord_user_data = user_data;
+    WRecord_FileHeader_t header = {{'W', 'R', 'E', 'C'}, WRECORD_VERSION, sizeof(WRecord_FileHeader_t), esp_timer_get_time()};
+    if (!sink(&header, sizeof(header), user_data))
+        return false;
+    BaseType_t core = tskNO_AFFINITY;
+#if CONFIG_WTASK_PARTITION
+    // the writer is best effort : it must not take cycles from the real-time core
+    if (!WPartition::place("wrecord", core, CONFIG_WTASK_RECORD_WRITER_PRIORITY, TASK_BEST_EFFORT))
+        return false;
+#endif
+    wrecord_dropped.store(0, std::memory_order_relaxed);
+    wrecord_enabled = true;
+    if (xTaskCreatePinnedToCore(wrecord_writer_task, "wrecord", WRECORD_WRITER_STACK_SIZE, nullptr, CONFIG_WTASK_RECORD_WRITER_PRIORITY, &wrecord_writer, core) != pdPASS)
+    {
+        wrecord_enabled = false;
+        wrecord_writer = nullptr;
+        return false;
+    }
+#if CONFIG_WTASK_PARTITION
+    WPartition::registerTask(wrecord_writer, core, TASK_BEST_EFFORT);
+#endif
+    return true;
+}
+
+/**
+ * @brief Stop the recording and wait for the writer task to empty the buffer
+ *
+ */
+void WRecord_Stop(void)
+{
+    wrecord_enabled = false;
+    while (wrecord_writer != nullptr)
+    {
+        vTaskDelay(WRECORD_WRITER_POLL_TICKS);
+    }
+}
+
+bool IRAM_ATTR WRecord_Enabled(void)
+{
+    return wrecord_enabled;
+}
+
+/**
+ * @brief Fill a record : header, payload and zero padding up to WRECORD_NEXT
+ *
+ */
+static void IRAM_ATTR wrecord_fill(uint8_t *record, const WRecord_Header_t &header, const void *payload)
+{
+    memcpy(record, &header, sizeof(header));
+    if (header.size > 0)
+        memcpy(record + sizeof(header), payload, header.size);
+    memset(record + sizeof(header) + header.size, 0, WRECORD_NEXT(&header) - sizeof(header) - header.size);
+}
+
+/**
+ * @brief Record a message : a task writes the record in place in the buffer, an ISR builds it on its stack
+ * @details The ring buffer can't reserve an item from an ISR, so the ISR records are limited to
+ *          CONFIG_WTASK_RECORD_MAX_ISR_PAYLOAD bytes to bound the ISR stack.
+ *
+ * @return BaseType_t pdTRUE if the writer task was woken from an ISR
+ */
+BaseType_t IRAM_ATTR WRecord_Write(uint8_t type, uint16_t source, uint16_t destination, const void *payload, size_t size)
+{
+    if (!wrecord_enabled)
+        return pdFALSE;
+    const bool from_isr = xPortInIsrContext();
+    if (size > (from_isr ? CONFIG_WTASK_RECORD_MAX_ISR_PAYLOAD : CONFIG_WTASK_RECORD_MAX_PAYLOAD))
+    {
+        wrecord_dropped.fetch_add(1, std::memory_order_relaxed);
+        return pdFALSE;
+    }
+    const WRecord_Header_t header = {esp_timer_get_time(), (uint16_t)size, type, (uint8_t)xPortGetCoreID(), source, destination};
+    const size_t total = WRECORD_NEXT(&header);
+    BaseType_t higher_priority_task_woken = pdFALSE;
+    if (from_isr)
+    {
+        union
+        {
+            WRecord_Header_t header;
+            uint8_t bytes[sizeof(WRecord_Header_t) + CONFIG_WTASK_RECORD_MAX_ISR_PAYLOAD + WRECORD_ALIGNMENT];
+        } record;
+        wrecord_fill(record.bytes, header, payload);
+        if (xRingbufferSendFromISR(wrecord_ring, record.bytes, total, &higher_priority_task_woken) != pdTRUE)
+            wrecord_dropped.fetch_add(1, std::memory_order_relaxed);
+        return higher_priority_task_woken;
+    }
+    void *record;
+    if (xRingbufferSendAcquire(wrecord_ring, &record, total, 0) != pdTRUE)
+    {
+        wrecord_dropped.fetch_add(1, std::memory_order_relaxed);
+        return pdFALSE;
+    }
+    wrecord_fill(static_cast<uint8_t *>(record), header, payload);
+    xRingbufferSendComplete(wrecord_ring, record);
+    return pdFALSE;
+}
+
+uint32_t WRecord_GetDropped(void)
+{
+    return wrecord_dropped.load(std::memory_order_relaxed);
+}
+
+bool WRecord_FileSink(const void *data, size_t size, void *user_data)
+{
+    return fwrite(data, 1, size, (FILE *)user_data) == size;
+}
+#endif
@@ -0,0 +1,155 @@
+#ifndef WRECORD_H_
+#define WRECORD_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define WRECORD_MAGIC "WREC"
+#define WRECORD_VERSION (1)
+#define WRECORD_ALIGNMENT (8) //<! every record starts on a multiple of 8 bytes from the start of the log
+
+/**
+ * @brief Source of the records that are not sent by a NTask (a plain Task or app_main)
+ *
+ */
+#define WRECORD_SOURCE_NONE (0xffff)
+
+/**
+ * @brief Type of the recorded messages
+ *
+ */
+typedef enum
+{
+    WRECORD_ULTRASOUND = 1, //<! payload: Ultrasound_Measurement_t, source: echo pin of the sensor
+    WRECORD_NOTIF,          //<! payload: Notification_t, destination: receiving NTask
+    WRECORD_NOTIF_FRONT,    //<! same as WRECORD_NOTIF, sent to the front of the queue
+    WRECORD_DATA,           //<! payload: the bytes sent to the ring buffer of the receiving RTask
+    WRECORD_DROP,           //<! payload: uint32_t number of records lost before this one (recording buffer full)
+} WRecord_Type_t;
+
+/**
+ * @brief Header of a log (16 bytes), followed by the records
+ *
+ */
+typedef struct
+{
+    char magic[4];         //<! WRECORD_MAGIC
+    uint16_t version;      //<! WRECORD_VERSION
+    uint16_t header_size;  //<! sizeof(WRecord_FileHeader_t), first record offset
+    int64_t start_us;      //<! esp_timer_get_time at the start of the recording
+} WRecord_FileHeader_t;
+
+/**
+ * @brief Header of a record (16 bytes), followed by its payload and padded to WRECORD_ALIGNMENT
+ * @details The records are self delimiting : a log can be read while it is written, and a truncated last record is
+ *          simply ignored. The next record is at WRECORD_NEXT(header) bytes.
+ *          The records are in the order of their copy in the buffer, not of their timestamps : an ISR preempting a
+ *          sender, or the other core, can insert a record between the timestamp and the copy of the sender, so the
+ *          timestamps can go backwards by the duration of a send.
+ */
+typedef struct
+{
+    int64_t timestamp_us;  //<! esp_timer_get_time at the sending
+    uint16_t size;         //<! payload size in bytes
+    uint8_t type;          //<! WRecord_Type_t
+    uint8_t core;          //<! core of the sender
+    uint16_t source;       //<! w_id of the sending NTask, NTASK_TYPE_NOTIF_ISR_CONTX from ISR, or WRECORD_SOURCE_NONE
+    uint16_t destination;  //<! w_id of the receiving NTask
+} WRecord_Header_t;
+
+#define WRECORD_NEXT(header) ((sizeof(WRecord_Header_t) + (header)->size + WRECORD_ALIGNMENT - 1) & ~(size_t)(WRECORD_ALIGNMENT - 1))
+
+/**
+ * @brief Output of the recorder, called by its writer task with the log bytes in order (e.g. fwrite to a file of the SD card)
+ *
+ * @return false to stop the recording (e.g. the storage is full)
+ */
+typedef bool (*WRecord_Sink_t)(const void *data, size_t size, void *user_data);
+
+/**
+ * @brief Start a recording : the log header is written to the sink, then the records as they come
+ * @details The writer task is a best effort task: with CONFIG_WTASK_PARTITION it runs on the best effort core and
+ *          CONFIG_WTASK_RECORD_WRITER_PRIORITY has to be below the real-time priorities.
+ *
+ * @param sink output of the log
+ * @param user_data argument of the sink
+ * @return true if the recording started
+ */
+bool WRecord_Start(WRecord_Sink_t sink, void *user_data);
+
+/**
+ * @brief Stop the recording : the records already buffered are written before returning
+ *
+ */
+void WRecord_Stop(void);
+
+/**
+ * @brief Is a recording started (the WRECORD macros test it before evaluating their arguments)
+ *
+ */
+bool WRecord_Enabled(void);
+
+/**
+ * @brief Record a message (from task or ISR, any core) : never blocks, the record is lost if the buffer is full
+ * @details From an ISR, the writer task may be woken : the caller yields at the end of its ISR (see WRECORD_FROM_ISR)
+ *
+ * @param type WRecord_Type_t
+ * @param source
+ * @param destination
+ * @param payload
+ * @param size up to CONFIG_WTASK_RECORD_MAX_PAYLOAD bytes, CONFIG_WTASK_RECORD_MAX_ISR_PAYLOAD from an ISR
+ */
+BaseType_t WRecord_Write(uint8_t type, uint16_t source, uint16_t destination, const void *payload, size_t size);
+
+/**
+ * @brief Number of records lost since the start of the recording (buffer full or payload too big)
+ *
+ */
+uint32_t WRecord_GetDropped(void);
+
+/**
+ * @brief Sink writing to a FILE * given as user_data
+ *
+ */
+bool WRecord_FileSink(const void *data, size_t size, void *user_data);
+
+#if CONFIG_WTASK_RECORD
+#define WRECORD(type, source, destination, payload, size)                            \
+    do                                                                               \
+    {                                                                                \
+        if (WRecord_Enabled())                                                       \
+            (void)WRecord_Write((type), (source), (destination), (payload), (size)); \
+    } while (0)
+/**
+ * @brief Record from an ISR : *woken is set if the writer task was woken, the caller yields at the end of its ISR
+ */
+#define WRECORD_FROM_ISR(woken, type, source, destination, payload, size)                                      \
+    do                                                                                                         \
+    {                                                                                                          \
+        if (WRecord_Enabled() && WRecord_Write((type), (source), (destination), (payload), (size)) && ((woken) != NULL)) \
+            *(woken) = pdTRUE;                                                                                 \
+    } while (0)
+#else
+#define WRECORD(type, source, destination, payload, size) \
+    do                                                    \
+    {                                                     \
+    } while (0)
+#define WRECORD_FROM_ISR(woken, type, source, destination, payload, size) \
+    do                                                                    \
+    {                                                                     \
+    } while (0)
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /*WRECORD_H_*/
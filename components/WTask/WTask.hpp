@@ -4,18 +4,27 @@
 
 #if (CONFIG_WORKQUEUE_SUPPORT)
 #include "Task.hpp"
+#include "PeriodicTask.hpp"
 #include "NTask.hpp"
 #include "RTask.hpp"
 #include "WorkQueue.hpp"
+#include "TaskGraph.hpp"
 #elif (CONFIG_RTASK_SUPPORT)
 #include "Task.hpp"
+#include "PeriodicTask.hpp"
 #include "NTask.hpp"
 #include "RTask.hpp"
+#include "TaskGraph.hpp"
 #elif (CONFIG_NTASK_SUPPORT)
 #include "Task.hpp"
+#include "PeriodicTask.hpp"
 #include "NTask.hpp"
+#include "TaskGraph.hpp"
 #elif (CONFIG_TASK_SUPPORT)
 #include "Task.hpp"
+#include "PeriodicTask.hpp"
 #endif
+#include "WPartition.hpp"
+#include "WDeferred.hpp"
 
 #endif //WTASK_HPP_
\ No newline at end of file
@@ -0,0 +1,108 @@
+#include "sdkconfig.h"
+#if CONFIG_WTASK_TRACE
+#include <atomic>
+#include <string.h>
+#include <stdio.h>
+#include "esp_attr.h"
+#include "esp_timer.h"
+#include "freertos/task.h"
+#include "WTrace.hpp"
+
+#define WTRACE_NAME_LENGTH (16)
+
+static_assert((CONFIG_WTASK_TRACE_RING_SIZE & (CONFIG_WTASK_TRACE_RING_SIZE - 1)) == 0, "trace ring size must be a power of 2");
+
+static DRAM_ATTR WTraceRecord_t wtrace_ring[CONFIG_WTASK_TRACE_RING_SIZE];
+static DRAM_ATTR std::atomic<uint32_t> wtrace_head{0};
+static DRAM_ATTR volatile bool wtrace_enabled = true;
+
+static struct
+{
+    uint32_t handle;
+    char name[WTRACE_NAME_LENGTH];
+} wtrace_tasks[CONFIG_WTASK_TRACE_MAX_TASKS];
+static std::atomic<uint32_t> wtrace_task_count{0};
+
+/**
+ * @brief Record an event : safe from tasks and ISR of both cores
+ * @details A slot is reserved with an atomic increment, so concurrent writers never share a slot.
+ *          The ring is only consistent while recording is stopped, that is why dump() stops it.
+ *
+ * @param type event type
+ * @param arg first argument
+ * @param extra second argument
+ */
+void IRAM_ATTR WTrace::record(WTraceEvent_t type, uint32_t arg, uint32_t extra)
+{
+    if (!wtrace_enabled)
+        return;
+    WTraceRecord_t &rec = wtrace_ring[wtrace_head.fetch_add(1, std::memory_order_relaxed) & (CONFIG_WTASK_TRACE_RING_SIZE - 1)];
+    rec.timestamp_us = (uint32_t)esp_timer_get_time();
+    rec.task = xPortInIsrContext() ? 0 : (uint32_t)(uintptr_t)xTaskGetCurrentTaskHandle();
+    rec.arg = arg;
+    rec.extra = extra;
+    rec.type = type;
+    rec.core = xPortGetCoreID();
+    rec.reserved = 0;
+};
+
+/**
+ * @brief Associate a name to a task handle for the dump (called by Task::runTask)
+ *
+ * @param handle task handle
+ * @param name task name (copied)
+ */
+void WTrace::registerTask(TaskHandle_t handle, const char *name)
+{
+    const uint32_t index = wtrace_task_count.fetch_add(1, std::memory_order_relaxed);
+    if (index >= CONFIG_WTASK_TRACE_MAX_TASKS)
+        return;
+    wtrace_tasks[index].handle = (uint32_t)(uintptr_t)handle;
+    strncpy(wtrace_tasks[index].name, name, WTRACE_NAME_LENGTH - 1);
+};
+
+void WTrace::start()
+{
+    wtrace_enabled = true;
+};
+
+void WTrace::stop()
+{
+    wtrace_enabled = false;
+};
+
+/**
+ * @brief Drop all the records (task names are kept)
+ *
+ */
+void WTrace::clear()
+{
+    wtrace_head.store(0, std::memory_order_relaxed);
+};
+
+/**
+ * @brief Stop the recording and print the ring from the oldest record, one line per record
+ * @details Format : "WTRACE T <handle> <name>" for tasks and "WTRACE E <ts> <task> <type> <core> <arg> <extra>" for events.
+ *          The recording has to be restarted with start().
+ */
+void WTrace::dump()
+{
+    stop();
+    vTaskDelay(1); // let a writer preempted in the middle of a record finish it
+    const uint32_t head = wtrace_head.load(std::memory_order_relaxed);
+    const uint32_t first = (head > CONFIG_WTASK_TRACE_RING_SIZE) ? head - CONFIG_WTASK_TRACE_RING_SIZE : 0;
+    const uint32_t tasks = wtrace_task_count.load(std::memory_order_relaxed);
+    printf("WTRACE BEGIN %lu\n", (unsigned long)(head - first));
+    for (uint32_t i = 0; (i < tasks) && (i < CONFIG_WTASK_TRACE_MAX_TASKS); i++)
+    {
+        printf("WTRACE T %08lx %s\n", (unsigned long)wtrace_tasks[i].handle, wtrace_tasks[i].name);
+    }
+    for (uint32_t i = first; i != head; i++)
+    {
+        const WTraceRecord_t &rec = wtrace_ring[i & (CONFIG_WTASK_TRACE_RING_SIZE - 1)];
+        printf("WTRACE E %08lx %08lx %u %u %08lx %08lx\n", (unsigned long)rec.timestamp_us, (unsigned long)rec.task, rec.type, rec.core,
+               (unsigned long)rec.arg, (unsigned long)rec.extra);
+    }
+    printf("WTRACE END\n");
+};
+#endif
@@ -0,0 +1,85 @@
+#ifndef WTRACE_HPP_
+#define WTRACE_HPP_
+
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+/**
+ * @brief Type of the traced events
+ *
+ */
+enum WTraceEvent_t : uint8_t
+{
+    WTRACE_TASK_BEGIN = 1, //<! activation begins : Task::run entered or a blocking wait returned
+    WTRACE_TASK_END,       //<! activation ends : blocking wait entered or Task::run returned
+    WTRACE_NOTIF_SEND,     //<! arg: notification, extra: destination task handle
+    WTRACE_NOTIF_RECV,     //<! arg: notification
+    WTRACE_DATA_SEND,      //<! arg: size, extra: destination task handle
+    WTRACE_WORK_BEGIN,     //<! arg: work function
+    WTRACE_WORK_END,       //<! arg: work function
+};
+
+/**
+ * @brief Event as stored in the trace ring (20 bytes)
+ *
+ */
+struct WTraceRecord_t
+{
+    uint32_t timestamp_us; //<! low 32 bits of esp_timer_get_time
+    uint32_t task;         //<! handle of the running task, 0 in ISR context
+    uint32_t arg;
+    uint32_t extra;
+    uint8_t type;
+    uint8_t core;
+    uint16_t reserved;
+};
+
+/**
+ * @brief Flight recorder of the WTask events (task run, notifications, data and works)
+ * @details The records are written in a static ring from tasks and ISR of both cores, the oldest ones are overwritten.
+ *          dump() prints the ring with the task names, tools/wtrace2json.py converts the output to a Chrome trace JSON
+ *          that opens in chrome://tracing or ui.perfetto.dev.
+ */
+class WTrace
+{
+public:
+    static void start();
+    static void stop();
+    static void clear();
+    static void dump();
+    static void registerTask(TaskHandle_t handle, const char *name);
+    static void record(WTraceEvent_t type, uint32_t arg, uint32_t extra);
+};
+
+#if CONFIG_WTASK_TRACE
+#define WTRACE(type, arg, extra) WTrace::record((type), (uint32_t)(uintptr_t)(arg), (uint32_t)(uintptr_t)(extra))
+#define WTRACE_REGISTER_TASK(handle, name) WTrace::registerTask((handle), (name))
+// blocking call of a task : ends its activation before the wait and begins the next one after (nothing when polling)
+#define WTRACE_WAIT(ticks, statement)          \
+    do                                         \
+    {                                          \
+        const bool wtrace_wait = (ticks) != 0; \
+        if (wtrace_wait)                       \
+            WTRACE(WTRACE_TASK_END, 0, 0);     \
+        statement;                             \
+        if (wtrace_wait)                       \
+            WTRACE(WTRACE_TASK_BEGIN, 0, 0);   \
+    } while (0)
+#else
+#define WTRACE(type, arg, extra) \
+    do                           \
+    {                            \
+    } while (0)
+#define WTRACE_REGISTER_TASK(handle, name) \
+    do                                     \
+    {                                      \
+    } while (0)
+#define WTRACE_WAIT(ticks, statement) \
+    do                                \
+    {                                 \
+        statement;                    \
+    } while (0)
+#endif
+
+#endif /*WTRACE_HPP_*/
@@ -1,6 +1,7 @@
 #include <string.h>
 #include "WorkQueue.hpp"
 #include "esp_log.h"
+#include "WTrace.hpp"
 
 #define NOTIFICATION_WORK_IN_QUEUE (0x01)
 
@@ -8,7 +9,7 @@
 
 static const char *WORKQ_LOG_TAG = "WORKQ";
 
-WorkQueue::WorkQueue(uint16_t stackSize, uint8_t priority, uint8_t workQueueLength, uint8_t coreID) : RTask(NTASK_TYPE_NOTIF_WORK_QUEU, "workQueue", stackSize, priority, 0, workQueueLength, (sizeof(WorkItem) + 8) * workQueueLength){};
+WorkQueue::WorkQueue(uint16_t stackSize, uint8_t priority, uint8_t workQueueLength, uint8_t coreID) : RTask(NTASK_TYPE_NOTIF_WORK_QUEU, "workQueue", stackSize, priority, coreID, workQueueLength, (sizeof(WorkItem) + 8) * workQueueLength){};
 /*
 WorkQueue::~WorkQueue(){
     vQueueDelete(workQueue);
@@ -38,7 +39,9 @@ void WorkQueue::run(void *args)
                 returnData(ret_data);
 
                 // launching work here
+                WTRACE(WTRACE_WORK_BEGIN, item.work_function, 0);
                 ret_data = (item.work_function)(item.work_args, &size);
+                WTRACE(WTRACE_WORK_END, item.work_function, size);
 
                 // work done : returning data if there is data
                 if ((size>0)&&(ret_data !=nullptr))
@@ -51,7 +54,7 @@ void WorkQueue::run(void *args)
                     sendNotificationTo(item.returning_task, item.notif_value, portMAX_DELAY);
                 }
             }else{
-                ESP_LOGE(WORKQ_LOG_TAG,"%X : Invalide size of received WorkItem from %X:%X : %db instead of %db",getID(), notif.Identifier.type, notif.Identifier.ID,size,sizeof(WorkItem));
+                ESP_LOGE(WORKQ_LOG_TAG,"%X : Invalide size of received WorkItem from %X:%X : %ub instead of %ub",getID(), notif.Identifier.type, notif.Identifier.ID,(unsigned)size,(unsigned)sizeof(WorkItem));
             }
         }
         else
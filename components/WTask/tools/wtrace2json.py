@@ -0,0 +1,90 @@
+#!/usr/bin/env python3
+"""Convert a WTrace::dump() capture (serial monitor log) to a Chrome trace JSON.
+
+The output opens in chrome://tracing or https://ui.perfetto.dev.
+Usage: wtrace2json.py monitor.log > trace.json
+"""
+import json
+import sys
+
+TASK_BEGIN, TASK_END, NOTIF_SEND, NOTIF_RECV, DATA_SEND, WORK_BEGIN, WORK_END = range(1, 8)
+
+
+def parse(lines):
+    names = {}
+    events = []
+    for line in lines:
+        index = line.find("WTRACE ")
+        if index < 0:
+            continue
+        fields = line[index:].split()
+        if fields[1] == "BEGIN":
+            names, events = {}, []  # keep the last dump of the capture
+        elif fields[1] == "T" and len(fields) >= 3:
+            names[int(fields[2], 16)] = " ".join(fields[3:]) or fields[2]
+        elif fields[1] == "E" and len(fields) == 8:
+            ts, task, etype, core, arg, extra = fields[2:]
+            events.append((int(ts, 16), int(task, 16), int(etype), int(core), int(arg, 16), int(extra, 16)))
+    return names, events
+
+
+def convert(names, events):
+    out = []
+    threads = {}
+    pending = {}  # (destination, notification) -> flow ids, in sending order
+    flow_id = 0
+    active = set()  # tasks inside an activation (between a wake up and their next wait)
+    last_ts = None
+    offset = 0
+
+    def tid(task, core):
+        key = task if task else "isr%d" % core
+        if key not in threads:
+            threads[key] = len(threads) + 1
+            name = names.get(task, "task %08x" % task) if task else "ISR core %d" % core
+            out.append({"ph": "M", "name": "thread_name", "pid": 0, "tid": threads[key], "args": {"name": name}})
+        return threads[key]
+
+    for ts, task, etype, core, arg, extra in events:
+        if last_ts is not None and ts + offset < last_ts - (1 << 31):
+            offset += 1 << 32  # 32 bits timestamp wrapped
+        ts += offset
+        last_ts = ts
+        base = {"pid": 0, "tid": tid(task, core), "ts": ts, "args": {"core": core}}
+        if etype == TASK_BEGIN:
+            active.add(task)
+            out.append(dict(base, ph="B", name="active"))
+        elif etype == TASK_END:
+            if task in active:  # the ring may start in the middle of an activation
+                active.discard(task)
+                out.append(dict(base, ph="E", name="active"))
+        elif etype in (WORK_BEGIN, WORK_END):
+            out.append(dict(base, ph="B" if etype == WORK_BEGIN else "E", name="work %08x" % arg))
+        elif etype == NOTIF_SEND:
+            flow_id += 1
+            pending.setdefault((extra, arg), []).append(flow_id)
+            dest = names.get(extra, "%08x" % extra)
+            out.append(dict(base, ph="i", s="t", name="notify %s" % dest, args={"core": core, "notification": "%08x" % arg}))
+            out.append(dict(base, ph="s", id=flow_id, cat="notif", name="notification"))
+        elif etype == NOTIF_RECV:
+            out.append(dict(base, ph="i", s="t", name="receive", args={"core": core, "notification": "%08x" % arg}))
+            flows = pending.get((task, arg))
+            if flows:
+                out.append(dict(base, ph="f", bp="e", id=flows.pop(0), cat="notif", name="notification"))
+        elif etype == DATA_SEND:
+            dest = names.get(extra, "%08x" % extra)
+            out.append(dict(base, ph="i", s="t", name="data %s" % dest, args={"core": core, "size": arg}))
+    return {"traceEvents": out, "displayTimeUnit": "ms"}
+
+
+def main():
+    if len(sys.argv) > 1:
+        with open(sys.argv[1], errors="replace") as f:
+            names, events = parse(f)
+    else:
+        names, events = parse(sys.stdin)
+    json.dump(convert(names, events), sys.stdout)
+
+
+if __name__ == "__main__":
+    main()
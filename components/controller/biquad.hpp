@@ -0,0 +1,58 @@
+/**
+ * @file biquad.hpp
+ * @brief Second order IIR section based on FixedPoint
+ * @version 0.1
+ *
+ */
+#ifndef BIQUAD_HPP_
+#define BIQUAD_HPP_
+#include "fixedpoint.hpp"
+
+/**
+ * @brief Biquad filter / controller in transposed direct form II
+ * @details y = b0*x + s1 ; s1 = b1*x - a1*y + s2 ; s2 = b2*x - a2*y, coefficients are normalized so that a0 = 1
+ * @tparam Value_t FixedPoint format of input, output and states
+ * @tparam Coef_t FixedPoint format of the coefficients : at least 1 integer bit because |a1| can be close to 2
+ */
+template <FixedPointType Value_t, FixedPointType Coef_t>
+class Biquad
+{
+    static_assert(Coef_t::Ipart() >= 1, "Coef_t needs at least 1 integer bit to hold a1 (|a1| < 2 for stable sections)");
+    static_assert(decltype(Coef_t() * Value_t())::Fpart() >= Value_t::Fpart(), "Coef_t has less fractional bits than Value_t : the coefficients would truncate the states");
+
+public:
+    struct Coefs
+    {
+        Coef_t b0, b1, b2; //< numerator
+        Coef_t a1, a2;     //< denominator (a0 = 1)
+    };
+
+    constexpr explicit Biquad(const Coefs &coefs) : c(coefs) {}
+
+    /**
+     * @brief Filter one sample : to be called once per sampling period
+     *
+     * @param x input sample
+     * @return Value_t output sample
+     */
+    constexpr Value_t step(const Value_t &x)
+    {
+        const Value_t y(Value_t(c.b0 * x) + s1);
+        s1 = Value_t(c.b1 * x) - Value_t(c.a1 * y) + s2;
+        s2 = Value_t(c.b2 * x) - Value_t(c.a2 * y);
+        return y;
+    }
+
+    constexpr void reset()
+    {
+        s1 = Value_t(0);
+        s2 = Value_t(0);
+    }
+
+private:
+    Coefs c;
+    Value_t s1 = Value_t(0);
+    Value_t s2 = Value_t(0);
+};
+
+#endif /*BIQUAD_HPP_*/
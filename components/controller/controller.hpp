@@ -0,0 +1,8 @@
+#ifndef CONTROLLER_HPP_
+#define CONTROLLER_HPP_
+
+#include "pid.hpp"
+#include "biquad.hpp"
+#include "statespace.hpp"
+
+#endif // CONTROLLER_HPP_
@@ -0,0 +1,119 @@
+/**
+ * @file pid.hpp
+ * @brief Discrete PID controller based on FixedPoint
+ * @version 0.1
+ *
+ */
+#ifndef PID_HPP_
+#define PID_HPP_
+#include "fixedpoint.hpp"
+
+/**
+ * @brief Discrete PID controller with anti-windup, filtered derivative and feed-forward
+ * @details The derivative is computed on the measurement (not on the error) to avoid kicks on setpoint change,
+ *          and filtered with a first order low pass filter. The integrator is frozen when the output is saturated
+ *          and the error pushes further into the saturation (conditional integration anti-windup).
+ * @tparam Value_t FixedPoint format of setpoint, measurement, output and internal states
+ * @tparam Coef_t FixedPoint format of the discrete gains
+ */
+template <FixedPointType Value_t, FixedPointType Coef_t>
+class Pid
+{
+    using Product_t = decltype(Coef_t() * Value_t());
+    static_assert(Product_t::Ipart() >= Value_t::Ipart(), "Coef_t * Value_t loses integer bits of Value_t : reduce the integer part of Coef_t or Value_t");
+    static_assert(Product_t::Fpart() >= Value_t::Fpart(), "Coef_t has less fractional bits than Value_t : the gains would truncate the output");
+
+public:
+    /**
+     * @brief Discrete gains of the controller
+     */
+    struct Config
+    {
+        Coef_t kp;       //< Proportional gain
+        Coef_t ki_ts;    //< Integral gain multiplied by the sampling period
+        Coef_t kd_ts;    //< Derivative gain divided by the sampling period
+        Coef_t d_alpha;  //< Derivative filter coefficient : Ts / (Tf + Ts), 1 means no filter
+        Coef_t kff;      //< Feed-forward gain
+        Value_t out_min; //< Lower saturation of the output
+        Value_t out_max; //< Upper saturation of the output
+    };
+
+    /**
+     * @brief Compute the discrete gains from the continuous ones : meant to be evaluated at compile time
+     *
+     * @param kp proportional gain
+     * @param ki integral gain (1/s)
+     * @param kd derivative gain (s)
+     * @param ts sampling period (s)
+     * @param tf time constant of the derivative filter (s)
+     * @param kff feed-forward gain
+     * @param out_min lower saturation of the output
+     * @param out_max upper saturation of the output
+     * @return constexpr Config
+     */
+    static constexpr Config discretize(double kp, double ki, double kd, double ts, double tf, double kff, double out_min, double out_max)
+    {
+        return Config{Coef_t(kp), Coef_t(ki * ts), Coef_t(kd / ts), Coef_t(ts / (tf + ts)), Coef_t(kff), Value_t(out_min), Value_t(out_max)};
+    }
+
+    constexpr explicit Pid(const Config &config) : cfg(config) {}
+
+    /**
+     * @brief Compute the next output of the controller : to be called once per sampling period
+     *
+     * @param setpoint
+     * @param measure
+     * @param feedforward value added to the output after multiplication by kff
+     * @return Value_t saturated output
+     */
+    constexpr Value_t step(const Value_t &setpoint, const Value_t &measure, const Value_t &feedforward = Value_t(0))
+    {
+        const Value_t error(setpoint - measure);
+        const Value_t p(cfg.kp * error);
+        Value_t i(integral + Value_t(cfg.ki_ts * error));
+        const Value_t d_raw(cfg.kd_ts * Value_t(previous_measure - measure));
+        derivative += Value_t(cfg.d_alpha * Value_t(d_raw - derivative));
+        previous_measure = measure;
+
+        Value_t out(p + i + derivative + Value_t(cfg.kff * feedforward));
+        if (out > cfg.out_max)
+        {
+            out = cfg.out_max;
+            if (error > Value_t(0))
+                i = integral; // do not wind up further
+        }
+        else if (out < cfg.out_min)
+        {
+            out = cfg.out_min;
+            if (error < Value_t(0))
+                i = integral; // do not wind down further
+        }
+        integral = i;
+        return out;
+    }
+
+    /**
+     * @brief Reset the internal states (bumpless restart around measure)
+     *
+     * @param measure current measurement
+     * @param integral_value initial value of the integral term
+     */
+    constexpr void reset(const Value_t &measure = Value_t(0), const Value_t &integral_value = Value_t(0))
+    {
+        integral = integral_value;
+        derivative = Value_t(0);
+        previous_measure = measure;
+    }
+
+    constexpr void setConfig(const Config &config) { cfg = config; }
+    constexpr const Config &getConfig() const { return cfg; }
+    constexpr Value_t getIntegral() const { return integral; }
+
+private:
+    Config cfg;
+    Value_t integral = Value_t(0);
+    Value_t derivative = Value_t(0);
+    Value_t previous_measure = Value_t(0);
+};
+
+#endif /*PID_HPP_*/
@@ -0,0 +1,85 @@
+/**
+ * @file statespace.hpp
+ * @brief Small discrete state-space controller based on FixedPoint
+ * @version 0.1
+ *
+ */
+#ifndef STATESPACE_HPP_
+#define STATESPACE_HPP_
+#include <cstddef>
+#include "fixedpoint.hpp"
+#include "miscellaneous.hpp"
+
+/**
+ * @brief Discrete state-space system : x[k+1] = A.x[k] + B.u[k] ; y[k] = C.x[k] + D.u[k]
+ * @details Sizes are known at compile time so every matrix product is fully unrolled.
+ *          The raw products of a row are accumulated in an int64_t with the fractional bits of Coef_t and Value_t,
+ *          and the sum is rescaled to Value_t once per row.
+ * @tparam NX number of states
+ * @tparam NU number of inputs
+ * @tparam NY number of outputs
+ * @tparam Value_t FixedPoint format of inputs, outputs and states
+ * @tparam Coef_t FixedPoint format of the matrices coefficients
+ */
+template <std::size_t NX, std::size_t NU, std::size_t NY, FixedPointType Value_t, FixedPointType Coef_t>
+class StateSpace
+{
+    static_assert((NX >= 1) && (NU >= 1) && (NY >= 1), "StateSpace dimensions must be strictly positive");
+    using Acc_t = decltype(Coef_t() * Value_t());
+    static_assert(Acc_t::Ipart() >= Value_t::Ipart(), "Coef_t * Value_t loses integer bits of Value_t : reduce the integer part of Coef_t or Value_t");
+    static_assert(Acc_t::Fpart() >= Value_t::Fpart(), "Coef_t has less fractional bits than Value_t : the coefficients would truncate the states");
+    static_assert((sizeof(typename Coef_t::storage_t) <= 4) && (sizeof(typename Value_t::storage_t) <= 4), "StateSpace accumulates in int64_t : use int16_t or int32_t storage");
+    static_assert((Coef_t::Ipart() + Coef_t::Fpart()) + (Value_t::Ipart() + Value_t::Fpart()) + misc::log2(NX + NU) + 1 < 63, "The sum of a row can overflow the int64_t accumulator");
+
+public:
+    struct Matrices
+    {
+        Coef_t A[NX][NX];
+        Coef_t B[NX][NU];
+        Coef_t C[NY][NX];
+        Coef_t D[NY][NU];
+    };
+
+    constexpr explicit StateSpace(const Matrices &matrices) : mat(matrices) {}
+
+    /**
+     * @brief Compute the outputs and update the states : to be called once per sampling period
+     *
+     * @param u inputs
+     * @param y outputs
+     */
+    constexpr void step(const Value_t (&u)[NU], Value_t (&y)[NY])
+    {
+        misc::unroll<NY>([&](size_t r)
+                         { y[r] = row(mat.C[r], x, mat.D[r], u); });
+        Value_t next[NX];
+        misc::unroll<NX>([&](size_t r)
+                         { next[r] = row(mat.A[r], x, mat.B[r], u); });
+        misc::unroll<NX>([&](size_t r)
+                         { x[r] = next[r]; });
+    }
+
+    constexpr void reset()
+    {
+        misc::unroll<NX>([&](size_t r)
+                         { x[r] = Value_t(0); });
+    }
+
+    constexpr const Value_t (&getState() const)[NX] { return x; }
+
+private:
+    Matrices mat;
+    Value_t x[NX] = {};
+
+    static constexpr Value_t row(const Coef_t (&m)[NX], const Value_t (&v)[NX], const Coef_t (&n)[NU], const Value_t (&w)[NU])
+    {
+        int64_t acc = 0;
+        misc::unroll<NX>([&](size_t i)
+                         { acc += static_cast<int64_t>(m[i].getM()) * v[i].getM(); });
+        misc::unroll<NU>([&](size_t i)
+                         { acc += static_cast<int64_t>(n[i].getM()) * w[i].getM(); });
+        return Value_t(static_cast<typename Value_t::raw_t>(acc >> Coef_t::Fpart())); // single rescale of the row
+    }
+};
+
+#endif /*STATESPACE_HPP_*/
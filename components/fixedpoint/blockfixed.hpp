@@ -0,0 +1,147 @@
+/**
+ * @file blockfixed.hpp
+ * @brief Block floating point arrays : integer mantissas sharing one exponent
+ * @version 1
+ *
+ */
+#ifndef BLOCK_FIXED_HPP_
+#define BLOCK_FIXED_HPP_
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include "fixedpoint.hpp"
+
+/**
+ * @brief Array of N values stored as mantissa[i] * 2^exponent, with one exponent for the whole block
+ * @details The exponent follows the dynamic range of each frame, so a frame of small values keeps all its
+ *          significant bits and a frame of large values does not clip. The headroom of the block is found with the
+ *          count of redundant sign bits (__builtin_clrsb, NSA instruction on Xtensa), so normalization is one pass
+ *          to find the largest magnitude and one pass to shift. Mantissas are contiguous and 16 bytes aligned.
+ * @tparam N number of values
+ * @tparam M mantissa type : int16_t (half the memory of int32_t samples) or int32_t
+ */
+template <std::size_t N, typename M = int16_t>
+class BlockFixed
+{
+    static_assert(std::is_same_v<M, int16_t> || std::is_same_v<M, int32_t>, "BlockFixed mantissa must be int16_t or int32_t");
+    static_assert(N >= 1, "BlockFixed size must be strictly positive");
+    static constexpr int mbits = 8 * sizeof(M); // bits of the mantissa, sign included
+
+public:
+    constexpr BlockFixed() = default;
+
+    static constexpr std::size_t size() { return N; }
+    constexpr int getExponent() const { return exponent; }
+    constexpr M *data() { return mantissa; }
+    constexpr const M *data() const { return mantissa; }
+    constexpr M getMantissa(std::size_t i) const { return mantissa[i]; }
+
+    /**
+     * @brief Load raw integer samples, value[i] = samples[i] * 2^exp, and choose the exponent of the block
+     *
+     * @param samples integer samples (e.g. ADC or capture counts)
+     * @param exp exponent of the samples (-E for samples with E fractional bits)
+     */
+    template <typename S>
+        requires std::signed_integral<S>
+    void load(const S (&samples)[N], int exp = 0)
+    {
+        int64_t acc = 0;
+        for (std::size_t i = 0; i < N; ++i)
+            acc |= static_cast<int64_t>(samples[i]) ^ (static_cast<int64_t>(samples[i]) >> 63); // magnitude bits of every sample
+        const int shift = significantBits(acc) - mbits;                                         // > 0 : samples do not fit, < 0 : headroom
+        if (shift > 0)
+        {
+            for (std::size_t i = 0; i < N; ++i)
+                mantissa[i] = static_cast<M>(static_cast<int64_t>(samples[i]) >> shift);
+        }
+        else
+        {
+            for (std::size_t i = 0; i < N; ++i)
+                mantissa[i] = static_cast<M>(static_cast<int64_t>(samples[i]) << -shift);
+        }
+        exponent = exp + shift;
+    }
+
+    /**
+     * @brief Load FixedPoint values and choose the exponent of the block
+     */
+    template <int I, int E, typename T>
+    void load(const FixedPoint<I, E, T> (&values)[N])
+    {
+        T raw[N];
+        for (std::size_t i = 0; i < N; ++i)
+            raw[i] = values[i].getM();
+        load(raw, -E);
+    }
+
+    /**
+     * @brief Shift the mantissas so that the largest one uses all the bits : to be called after in place modifications
+     */
+    void normalize()
+    {
+        int32_t acc = 0;
+        for (std::size_t i = 0; i < N; ++i)
+            acc |= static_cast<int32_t>(mantissa[i]) ^ (static_cast<int32_t>(mantissa[i]) >> 31);
+        if (acc == 0)
+            return;
+        const int headroom = mbits - significantBits(acc);
+        if (headroom == 0)
+            return;
+        for (std::size_t i = 0; i < N; ++i)
+            mantissa[i] = static_cast<M>(static_cast<int32_t>(mantissa[i]) << headroom);
+        exponent -= headroom;
+    }
+
+    /**
+     * @brief Get one value in a FixedPoint format (truncated toward minus infinity if the format has less fractional bits)
+     */
+    template <FixedPointType Out_t>
+    constexpr Out_t get(std::size_t i) const
+    {
+        const int shift = exponent + Out_t::Fpart();
+        const int64_t m = mantissa[i];
+        const int64_t r = (shift >= 0) ? (m << shift) : (m >> -shift);
+        return Out_t(static_cast<typename Out_t::raw_t>(static_cast<typename Out_t::storage_t>(r)));
+    }
+
+    /**
+     * @brief Convert the whole block to FixedPoint values
+     */
+    template <int I, int E, typename T>
+    void store(FixedPoint<I, E, T> (&values)[N]) const
+    {
+        for (std::size_t i = 0; i < N; ++i)
+            values[i] = get<FixedPoint<I, E, T>>(i);
+    }
+
+    /**
+     * @brief Multiply every value by a FixedPoint gain, the block is normalized afterwards
+     */
+    template <int I, int E, typename T>
+    void scale(const FixedPoint<I, E, T> &gain)
+    {
+        using W = std::conditional_t<(mbits + I + E) < 32, int32_t, int64_t>;
+        int64_t acc = 0;
+        W prod[N];
+        for (std::size_t i = 0; i < N; ++i)
+        {
+            prod[i] = static_cast<W>(mantissa[i]) * gain.getM();
+            acc |= static_cast<int64_t>(prod[i]) ^ (static_cast<int64_t>(prod[i]) >> 63);
+        }
+        const int shift = significantBits(acc) - mbits;
+        for (std::size_t i = 0; i < N; ++i)
+            mantissa[i] = static_cast<M>((shift > 0) ? (prod[i] >> shift) : (prod[i] << -shift));
+        exponent += shift - E;
+    }
+
+private:
+    alignas(16) M mantissa[N] = {};
+    int exponent = 0;
+
+    // number of significant bits, sign bit included
+    static constexpr int significantBits(int64_t v) { return 64 - __builtin_clrsbll(v); }
+    static constexpr int significantBits(int32_t v) { return 32 - __builtin_clrsb(v); }
+};
+
+#endif /*BLOCK_FIXED_HPP_*/
@@ -14,6 +14,8 @@
 #include <type_traits>
 #include <concepts>
 #include <cmath>
+#include <cstdint>
+#include <limits>
 #include "miscellaneous.hpp"
 
 class FixedPointBase
@@ -21,28 +23,118 @@ class FixedPointBase
 };
 
 /**
- * @brief Class to handle fixe point basic arithmetic based on int32_t type
+ * @brief Traits of the signed integer types that can be used as FixedPoint storage
+ * @details bits is the number of value bits (sign bit excluded), wide_t is the type used
+ *          for the intermediate results of product and division when they can overflow the storage.
+ *          There is no 128 bits integer on the target, so int64_t storage is its own wide type
+ *          and the operators split their operands instead.
+ * @tparam T int16_t, int32_t or int64_t
+ */
+template <typename T>
+struct FixedPointStorage
+{
+    static_assert(std::is_same_v<T, int16_t> || std::is_same_v<T, int32_t> || std::is_same_v<T, int64_t>, "FixedPoint storage must be int16_t, int32_t or int64_t");
+    static constexpr int bits = std::numeric_limits<T>::digits;
+    using raw_t = std::make_unsigned_t<T>;
+    using wide_t = std::conditional_t<std::is_same_v<T, int16_t>, int32_t, int64_t>;
+};
+
+namespace fixedpoint_detail
+{
+    /**
+     * @brief (a * b) / 2^F truncated toward zero, with a 128 bits product built from 32 bits limbs
+     * @details Only used for int64_t storage when the product can overflow, as there is no 128 bits type on the target
+     */
+    inline constexpr int64_t mul_shift64(int64_t a, int64_t b, int F)
+    {
+        const bool neg = (a < 0) != (b < 0);
+        const uint64_t ua = (a < 0) ? -static_cast<uint64_t>(a) : static_cast<uint64_t>(a);
+        const uint64_t ub = (b < 0) ? -static_cast<uint64_t>(b) : static_cast<uint64_t>(b);
+        const uint64_t a_lo = ua & 0xFFFFFFFFu, a_hi = ua >> 32;
+        const uint64_t b_lo = ub & 0xFFFFFFFFu, b_hi = ub >> 32;
+        const uint64_t lo_lo = a_lo * b_lo;
+        const uint64_t mid1 = a_hi * b_lo + (lo_lo >> 32);
+        const uint64_t mid2 = a_lo * b_hi + (mid1 & 0xFFFFFFFFu);
+        const uint64_t hi = a_hi * b_hi + (mid1 >> 32) + (mid2 >> 32);
+        const uint64_t lo = (mid2 << 32) | (lo_lo & 0xFFFFFFFFu);
+        const uint64_t res = (F == 0) ? lo : ((lo >> F) | (hi << (64 - F)));
+        return neg ? -static_cast<int64_t>(res) : static_cast<int64_t>(res);
+    }
+
+    /**
+     * @brief (a * 2^F) / b truncated toward zero, as a long division of the remainder so nothing can overflow
+     * @details Only used for int64_t storage when the scaled numerator can overflow. The remainder is below b, so it can
+     *          be shifted by the leading zeros of b at each step : one 64 bits division per clz(b) bits of the quotient,
+     *          and one bit per step only when b uses the 64 bits
+     */
+    inline constexpr int64_t div_shift64(int64_t a, int64_t b, int F)
+    {
+        const bool neg = (a < 0) != (b < 0);
+        const uint64_t ua = (a < 0) ? -static_cast<uint64_t>(a) : static_cast<uint64_t>(a);
+        const uint64_t ub = (b < 0) ? -static_cast<uint64_t>(b) : static_cast<uint64_t>(b);
+        const int chunk = __builtin_clzll(ub);
+        uint64_t q = ua / ub;
+        uint64_t r = ua % ub;
+        while (F > 0)
+        {
+            if (chunk == 0)
+            {
+                const bool carry = (r >> 63) != 0;
+                r <<= 1;
+                q <<= 1;
+                if (carry || (r >= ub))
+                {
+                    r -= ub;
+                    q |= 1;
+                }
+                --F;
+                continue;
+            }
+            const int k = (chunk < F) ? chunk : F;
+            r <<= k;
+            q = (q << k) | (r / ub);
+            r %= ub;
+            F -= k;
+        }
+        return neg ? -static_cast<int64_t>(q) : static_cast<int64_t>(q);
+    }
+};
+
+/**
+ * @brief Storage type of the result of an operation between two FixedPoint of storage T and U : the widest one
+ */
+template <typename T, typename U>
+using FixedPointPromote_t = std::conditional_t<(sizeof(T) >= sizeof(U)), T, U>;
+
+/**
+ * @brief Class to handle fixe point basic arithmetic based on a signed integer type (int32_t by default)
  * the integer part argment is used for multiplication and division optimisation
- * @details Naturally, the sum of the template parameters should not exceed the number of bit of the signed int32_t type, aka 31
+ * @details Naturally, the sum of the template parameters should not exceed the number of value bits of the storage type,
+ *          aka 15 for int16_t, 31 for int32_t and 63 for int64_t
  * @todo As division is using truncation instead of rounding, it could be worth it to add a few extra code to avoid that
  * @tparam I is the number of bits ahead the point, so it is equivalent to the integer part of the number
  *         It is mostly used as an hint for multiplication and division optimization
  * @tparam E is the number of bits behind the point, so if E==0, it,s like integer operation
+ * @tparam T is the storage type : int16_t, int32_t or int64_t
  */
-template <int I, int E>
+template <int I, int E, typename T = int32_t>
 class FixedPoint : FixedPointBase
 {
 public:
+    static constexpr int bits = FixedPointStorage<T>::bits; // number of value bits of the storage
     // constraint on E
-    static_assert((E >= 0) & (E < 31)); // E should be between 0 and 30 because bit 31 is sign bit
-    static_assert((I >= 0) & (I < 31));
-    static_assert((I + E) < 31);
+    static_assert((E >= 0) & (E < bits)); // E should be between 0 and bits-1 because last bit is sign bit
+    static_assert((I >= 0) & (I < bits));
+    static_assert((I + E) < bits);
 
     // typedef FixedPoint FixedPoint<I,E>;
     using self = FixedPoint;
-    static constexpr int32_t factor = (1 << E);
+    using storage_t = T;
+    using raw_t = typename FixedPointStorage<T>::raw_t;
+    using wide_t = typename FixedPointStorage<T>::wide_t;
+    static constexpr T factor = (T(1) << E);
 
-    static constexpr self MAX_VAL() { return self(uint32_t(INT32_MAX)); } // if I = 5, E  = 1, MAX_VAL = (2-1) = 1 bit
+    static constexpr self MAX_VAL() { return self(raw_t(std::numeric_limits<T>::max())); } // if I = 5, E  = 1, MAX_VAL = (2-1) = 1 bit
 
     static constexpr self MIN_VAL() { return -MAX_VAL(); }
 
@@ -54,7 +146,7 @@ public:
     constexpr FixedPoint() = default; // default constructor M is set to 0
 
     // direct value constructor
-    explicit constexpr FixedPoint(uint32_t d) : m(d) {}
+    explicit constexpr FixedPoint(raw_t d) : m(static_cast<T>(d)) {}
 
     // default copy constructor
     constexpr FixedPoint(const self &d) = default;
@@ -67,96 +159,110 @@ public:
      * @bug In the case where the new object has a lower number of fractionnal part bits, add proper rounding and not truncation
      * @tparam J number of bits of the integer part of the parameter
      * @tparam F number of bits of the fractional part of the parameter
+     * @tparam U storage type of the parameter
      * @param d
      */
-    template <int J, int F>
-    constexpr FixedPoint(const FixedPoint<J, F> &d)
+    template <int J, int F, typename U>
+    constexpr FixedPoint(const FixedPoint<J, F, U> &d)
     {
+        using P = FixedPointPromote_t<T, U>;
         if constexpr (E == F)
         {
-            m = d.getM();
+            m = static_cast<T>(d.getM());
         }
         else if constexpr (E > F)
         {
-            m = (d.getM()) * (1 << (E - F));
+            m = static_cast<T>(static_cast<P>(d.getM()) * (P(1) << (E - F)));
         }
         else // E<F
         {
             // FIXME add rounding stuff here ( because it's truncated for now)
             // https://www.embeddedrelated.com/showarticle/1015.php
-            m = (d.getM()) / (1 << (F - E));
+            m = static_cast<T>(d.getM() / (U(1) << (F - E)));
         }
     }
 
     template <typename U>
         requires((std::floating_point<U> || std::signed_integral<U>) && std::convertible_to<U, int32_t> && !std::derived_from<U, FixedPointBase>)
-    constexpr FixedPoint(const U &d) : m(static_cast<int32_t>(d * factor)){};
+    constexpr FixedPoint(const U &d) : m(static_cast<T>(d * factor)){};
     // constructor from integral type
     // template <typename U>
     //    requires ((!std::derived_from<U, FixedPointBase>) && ((std::signed_integral<U>) || (std::floating_point<U>)))
 
     // operation on self
-    template <int J, int F>
-    constexpr self &operator+=(const FixedPoint<J, F> &x)
+    template <int J, int F, typename U>
+    constexpr self &operator+=(const FixedPoint<J, F, U> &x)
     {
+        using P = FixedPointPromote_t<T, U>;
         if constexpr (E == F)
         {
-            m += x.getM();
+            m = static_cast<T>(m + x.getM());
         }
         else if constexpr (E > F)
         {
-            m += (x.getM() * (1 << (E - F)));
+            m = static_cast<T>(m + (static_cast<P>(x.getM()) * (P(1) << (E - F))));
         }
         else
         {
-            m += (x.getM() / (1 << (F - E)));
+            m = static_cast<T>(m + (x.getM() / (U(1) << (F - E))));
         }
         return *this;
     }
-    template <int J, int F>
-    constexpr self &operator-=(const FixedPoint<J, F> &x)
+    template <int J, int F, typename U>
+    constexpr self &operator-=(const FixedPoint<J, F, U> &x)
     {
+        using P = FixedPointPromote_t<T, U>;
         if constexpr (E == F)
         {
-            m -= x.getM();
+            m = static_cast<T>(m - x.getM());
         }
         else if constexpr (E > F)
         {
-            m -= (x.getM() * (1 << (E - F)));
+            m = static_cast<T>(m - (static_cast<P>(x.getM()) * (P(1) << (E - F))));
         }
         else
         {
-            m -= (x.getM() / (1 << (F - E)));
+            m = static_cast<T>(m - (x.getM() / (U(1) << (F - E))));
         }
         return *this;
     }
-    template <int J, int F>
-    constexpr self &operator*=(const FixedPoint<J, F> &x)
+    template <int J, int F, typename U>
+    constexpr self &operator*=(const FixedPoint<J, F, U> &x)
     {
-        if constexpr (((I + E) + (J + F)) < 31) // optimisation in the case that the product can fit directly in an int32
+        using P = FixedPointPromote_t<T, U>;
+        if constexpr (((I + E) + (J + F)) < FixedPointStorage<P>::bits) // optimisation in the case that the product can fit directly in the storage
+        {
+            m = static_cast<T>((static_cast<P>(m) * x.getM()) / x.factor);
+        }
+        else if constexpr (!std::is_same_v<P, int64_t>)
         {
-            m *= x.getM();
-            m /= x.factor;
+            using W = typename FixedPointStorage<P>::wide_t;
+            W res = static_cast<W>(m) * x.getM(); // using the wide type is costly, but it is the general case
+            m = static_cast<T>(res / x.factor);
         }
         else
         {
-            int64_t res = (int64_t)(m)*x.getM(); // using int64_t is costly, but it is the general case
-            m = (int32_t)(res / x.factor);
+            m = static_cast<T>(fixedpoint_detail::mul_shift64(m, x.getM(), F)); // no 128 bits type on the target
         }
         return *this;
     }
-    template <int J, int F>
-    constexpr self &operator/=(const FixedPoint<J, F> &x)
+    template <int J, int F, typename U>
+    constexpr self &operator/=(const FixedPoint<J, F, U> &x)
     {
-        if constexpr (((I + E) + F < 31)) // optimisation if the product with the factor does not overflow
+        using P = FixedPointPromote_t<T, U>;
+        if constexpr (((I + E) + F) < FixedPointStorage<P>::bits) // optimisation if the product with the factor does not overflow
         {
-            m *= x.factor; // thanks to the condition, this will not overflow
-            m /= x.getM();
+            m = static_cast<T>((static_cast<P>(m) * x.factor) / x.getM()); // thanks to the condition, this will not overflow
+        }
+        else if constexpr (!std::is_same_v<P, int64_t>)
+        {
+            using W = typename FixedPointStorage<P>::wide_t;
+            W res = static_cast<W>(m) * x.factor; // using the wide type is costly, but it is the general case
+            m = static_cast<T>(res / x.getM());
         }
         else
         {
-            int64_t res = (int64_t)(m)*x.factor; // using int64_t is costly, but it is the general case
-            m = (int32_t)(res / x.getM());
+            m = static_cast<T>(fixedpoint_detail::div_shift64(m, x.getM(), F)); // no 128 bits type on the target
         }
         return *this;
     }
@@ -165,28 +271,28 @@ public:
         requires((std::floating_point<U> || std::signed_integral<U>) && std::convertible_to<U, int32_t> && !std::derived_from<U, FixedPointBase>)
     constexpr self &operator+=(const U &x)
     {
-        m += static_cast<int32_t>(x * factor);
+        m = static_cast<T>(m + x * factor);
         return *this;
     }
     template <typename U>
         requires((std::floating_point<U> || std::signed_integral<U>) && std::convertible_to<U, int32_t> && !std::derived_from<U, FixedPointBase>)
     constexpr self &operator-=(const U &x)
     {
-        m -= static_cast<int32_t>(x * factor);
+        m = static_cast<T>(m - x * factor);
         return *this;
     }
     template <typename U>
         requires((std::floating_point<U> || std::signed_integral<U>) && std::convertible_to<U, int32_t> && !std::derived_from<U, FixedPointBase>)
     constexpr self &operator*=(const U &x)
     {
-        m = static_cast<int32_t>(x * m);
+        m = static_cast<T>(x * m);
         return *this;
     }
     template <typename U>
         requires((std::floating_point<U> || std::signed_integral<U>) && std::convertible_to<U, int32_t> && !std::derived_from<U, FixedPointBase>)
     constexpr self &operator/=(const U &x)
     {
-        m = static_cast<int32_t>(m / x);
+        m = static_cast<T>(m / x);
         return *this;
     }
 
@@ -206,7 +312,7 @@ public:
         requires((std::floating_point<U> || std::signed_integral<U>) && std::convertible_to<U, int32_t> && !std::derived_from<U, FixedPointBase>)
     friend constexpr self operator*(const U &x, const self &y)
     {
-        return self(x) *= y;
+        return self(y) *= x; // scales the mantissa : x does not have to fit the format
     }
     template <typename U>
         requires((std::floating_point<U> || std::signed_integral<U>) && std::convertible_to<U, int32_t> && !std::derived_from<U, FixedPointBase>)
@@ -231,7 +337,7 @@ public:
         requires((std::floating_point<U> || std::signed_integral<U>) && std::convertible_to<U, int32_t> && !std::derived_from<U, FixedPointBase>)
     friend constexpr self operator*(const self &x, const U &y)
     {
-        return self(y) *= x;
+        return self(x) *= y; // scales the mantissa : y does not have to fit the format
     }
     template <typename U>
         requires((std::floating_point<U> || std::signed_integral<U>) && std::convertible_to<U, int32_t> && !std::derived_from<U, FixedPointBase>)
@@ -243,7 +349,7 @@ public:
     constexpr self operator-() const
     {
         // direct assignation constructor
-        return self(static_cast<uint32_t>((-this->m)));
+        return self(static_cast<raw_t>((-this->m)));
     }
 
     template <typename U>
@@ -257,7 +363,7 @@ public:
         requires((std::floating_point<U> || std::signed_integral<U>) && std::convertible_to<U, int32_t> && !std::derived_from<U, FixedPointBase>)
     constexpr self &operator=(const U &x)
     {
-        m = static_cast<int32_t>(x * factor);
+        m = static_cast<T>(x * factor);
         return *this;
     }
 
@@ -286,20 +392,18 @@ public:
      */
     friend constexpr self pow(const self &x, uint32_t n)
     {
-        int64_t res = static_cast<uint64_t>(x.getM());
-        int64_t prod = x.factor; // equivalent to 1 in base E
+        wide_t res = x.getM();
+        wide_t prod = x.factor; // equivalent to 1 in base E
         while (n > 0)
         {
             if ((n & 1) == 1)
             {
-                prod *= res;      // save product if it appear in binary form of n
-                prod /= x.factor; // scale the result
+                prod = mul_scale(prod, res); // save product if it appear in binary form of n
             }
-            n >>= 1;         // devide n by 2
-            res *= res;      // square value
-            res /= x.factor; // scale value to E point size
+            n >>= 1;                  // devide n by 2
+            res = mul_scale(res, res); // square value
         }
-        return self(static_cast<uint32_t>(prod));
+        return self(static_cast<raw_t>(prod));
     }
     /**
      * @brief Exponentiation function for fixed point number : this function use double calculus,
@@ -311,8 +415,8 @@ public:
      * @param exp is the exponent
      * @return auto
      */
-    template <int J, int F>
-    friend auto pow(const self &x, const FixedPoint<J, F> &exp)
+    template <int J, int F, typename U>
+    friend auto pow(const self &x, const FixedPoint<J, F, U> &exp)
     {
         return self(pow(double(x), double(exp)));
     }
@@ -350,7 +454,8 @@ public:
         {
             return (decltype(result))(-E - 1);
         }
-        int32_t m = x.getM();
+        static_assert((2 * E + 2) < 64, "log2 squares the normalized mantissa, E is too large");
+        T m = x.getM();
         while (m < x.factor)
         {
             m <<= 1;
@@ -361,13 +466,13 @@ public:
             m >>= 1;
             result += 1;
         }
-        auto z = m;
+        wide_t z = m;
         auto b = result.factor >> 1;
 
         for (size_t i = 0; i < E; i++)
         {
             z = z * z >> E;
-            if (z >= 2U << E)
+            if (z >= (wide_t(2) << E))
             {
                 z >>= 1;
                 result += FixedPoint<misc::log2(I) + 1, (31 - 1) - (misc::log2(I) + 1)>(static_cast<uint32_t>(b));
@@ -436,18 +541,18 @@ public:
         return r + (x.getM() > 0) * (1 - (r * x.factor == x.getM()));
     }
     // comparison operators
-    template <int J, int F = E>
-    friend constexpr bool operator==(const self &x, const FixedPoint<J, F> &y) { return x.m == y.getM(); }
-    template <int J, int F = E>
-    friend constexpr bool operator!=(const self &x, const FixedPoint<J, F> &y) { return !(x == y); }
-    template <int J, int F = E>
-    friend constexpr bool operator<(const self &x, const FixedPoint<J, F> &y) { return x.m < y.getM(); }
-    template <int J, int F = E>
-    friend constexpr bool operator>(const self &x, const FixedPoint<J, F> &y) { return y < x; }
-    template <int J, int F = E>
-    friend constexpr bool operator>=(const self &x, const FixedPoint<J, F> &y) { return !(x < y); }
-    template <int J, int F = E>
-    friend constexpr bool operator<=(const self &x, const FixedPoint<J, F> &y) { return !(x > y); }
+    template <int J, int F = E, typename U = T>
+    friend constexpr bool operator==(const self &x, const FixedPoint<J, F, U> &y) { return x.m == y.getM(); }
+    template <int J, int F = E, typename U = T>
+    friend constexpr bool operator!=(const self &x, const FixedPoint<J, F, U> &y) { return !(x == y); }
+    template <int J, int F = E, typename U = T>
+    friend constexpr bool operator<(const self &x, const FixedPoint<J, F, U> &y) { return x.m < y.getM(); }
+    template <int J, int F = E, typename U = T>
+    friend constexpr bool operator>(const self &x, const FixedPoint<J, F, U> &y) { return y < x; }
+    template <int J, int F = E, typename U = T>
+    friend constexpr bool operator>=(const self &x, const FixedPoint<J, F, U> &y) { return !(x < y); }
+    template <int J, int F = E, typename U = T>
+    friend constexpr bool operator<=(const self &x, const FixedPoint<J, F, U> &y) { return !(x > y); }
 
     // comparison operators with arithmetic types (side 1)
     template <typename U>
@@ -527,71 +632,80 @@ public:
 
     // cross-fixedpoint operations
     // all validated
-    template <int J, int F>
-    friend constexpr auto operator+(const self &x, const FixedPoint<J, F> &y)
+    // the storage of the result is the widest storage of the operands
+    template <int J, int F, typename U>
+    friend constexpr auto operator+(const self &x, const FixedPoint<J, F, U> &y)
     {
+        using P = FixedPointPromote_t<T, U>;
+        constexpr int B = FixedPointStorage<P>::bits;
         if constexpr ((I >= J) && (E >= F))
         {
-            return FixedPoint<std::min<int>(I, 30 - F), F>(x) += y;
+            return FixedPoint<std::min<int>(I, B - 1 - F), F, P>(x) += y;
         }
         else if constexpr ((I < J) && (E >= F))
         {
-            return FixedPoint<J, F>(x) += y;
+            return FixedPoint<J, F, P>(x) += y;
         }
         else if constexpr ((I >= J) && (E < F))
         {
-            return self(y) += x;
+            return FixedPoint<I, E, P>(y) += x;
         }
         else // if constexpr ((I < J) && (E < F))
         {
-            return FixedPoint<std::min<int>(J, 30 - E), E>(y) += x;
+            return FixedPoint<std::min<int>(J, B - 1 - E), E, P>(y) += x;
         }
     }
-    template <int J, int F>
-    friend constexpr auto operator-(const self &x, const FixedPoint<J, F> &y)
+    template <int J, int F, typename U>
+    friend constexpr auto operator-(const self &x, const FixedPoint<J, F, U> &y)
     {
+        using P = FixedPointPromote_t<T, U>;
+        constexpr int B = FixedPointStorage<P>::bits;
         if constexpr ((I >= J) && (E >= F))
         {
-            return FixedPoint<std::min<int>(I, 30 - F), F>(x) -= y;
+            return FixedPoint<std::min<int>(I, B - 1 - F), F, P>(x) -= y;
         }
         else if constexpr ((I < J) && (E >= F))
         {
-            return FixedPoint<J, F>(x) -= y;
+            return FixedPoint<J, F, P>(x) -= y;
         }
         else if constexpr ((I >= J) && (E < F))
         {
-            return self(x) -= y;
+            return FixedPoint<I, E, P>(x) -= y;
         }
         else // if constexpr ((I < J) && (E < F))
         {
-            return FixedPoint<std::min<int>(J, 30 - E), E>(x) -= y;
+            return FixedPoint<std::min<int>(J, B - 1 - E), E, P>(x) -= y;
         }
     }
-    template <int J, int F>
-    friend constexpr auto operator*(const self &x, const FixedPoint<J, F> &y)
+    template <int J, int F, typename U>
+    friend constexpr auto operator*(const self &x, const FixedPoint<J, F, U> &y)
     {
+        using P = FixedPointPromote_t<T, U>;
+        constexpr int B = FixedPointStorage<P>::bits;
         // X has more decimale than Y :
         // product is difficult to predict but we can't expect more accuracy thant the less accurate of the 2 numbers
         if constexpr (E > F)
-        {                                                                                 // we need to keep track of I and J to do the product, and then return with the appropriate integer part
-            return FixedPoint<std::min<int>(I + J, 30 - F), F>(FixedPoint<J, F>(y) *= x); // copy constructor of y
+        {                                                                                              // we need to keep track of I and J to do the product, and then return with the appropriate integer part
+            return FixedPoint<std::min<int>(I + J, B - 1 - F), F, P>(FixedPoint<J, F, P>(y) *= x); // copy constructor of y
         }
         else
-        {                                                                     // we need to keep track of I and J to do the product, and then return with the approcpirate integer part
-            return FixedPoint<std::min<int>(I + J, 30 - E), E>(self(x) *= y); // copy constructor on Y and product with x
+        {                                                                                              // we need to keep track of I and J to do the product, and then return with the approcpirate integer part
+            return FixedPoint<std::min<int>(I + J, B - 1 - E), E, P>(FixedPoint<I, E, P>(x) *= y); // copy constructor on Y and product with x
         }
     }
     // for division, the size of the integer part can not be predicted, because it may be smaller than I, or larger depending on the value of the denominator
-    template <int J, int F>
-    friend constexpr auto operator/(const self &x, const FixedPoint<J, F> &y)
+    template <int J, int F, typename U>
+    friend constexpr auto operator/(const self &x, const FixedPoint<J, F, U> &y)
     { // validated, may be unstable depending on what is divided...
+        using P = FixedPointPromote_t<T, U>;
+        constexpr int B = FixedPointStorage<P>::bits;
         if constexpr (E > F)
         {
-            return FixedPoint<std::min<int>(I, 30 - F), F>(self(x) /= y); // cast x to F at the end to keep maximum precision
+            return FixedPoint<std::min<int>(I, B - 1 - F), F, P>(FixedPoint<I, E, P>(x) /= y); // cast x to F at the end to keep maximum precision
         }
         else
         {
-            return self(x) /= y; // cast y to E (not possible to simpli avoid 2nd constructor call as division is not commutative)
+            return FixedPoint<I, E, P>(x) /= y; // cast y to E (not possible to simpli avoid 2nd constructor call as division is not commutative)
         }
     }
 
@@ -621,9 +735,43 @@ public:
     //}
 
 private:
-    int32_t m;
+    /**
+     * @brief (a * b) / factor in the wide type, as operator*= does : int64_t storage is its own wide type, so its product
+     *        goes through the 128 bits limb product
+     */
+    static constexpr wide_t mul_scale(wide_t a, wide_t b)
+    {
+        if constexpr (std::is_same_v<T, int64_t>)
+        {
+            return fixedpoint_detail::mul_shift64(a, b, E);
+        }
+        else
+        {
+            return (a * b) / factor;
+        }
+    }
+
+    T m;
+};
+
+/**
+ * @brief Concept satisfied by any FixedPoint instantiation : used to check Q-formats at compile time in other components
+ */
+template <typename T>
+concept FixedPointType = std::is_base_of_v<FixedPointBase, T> && requires {
+    typename T::storage_t;
+    { T::Ipart() } -> std::convertible_to<int>;
+    { T::Fpart() } -> std::convertible_to<int>;
 };
 
+/**
+ * @brief Aliases for the non default storage types
+ */
+template <int I, int E>
+using FixedPoint16 = FixedPoint<I, E, int16_t>;
+template <int I, int E>
+using FixedPoint64 = FixedPoint<I, E, int64_t>;
+
 // test code here
 /*
 FixedReal x(0);
@@ -0,0 +1,147 @@
+/**
+ * @file fixedpoint_expr.hpp
+ * @brief Expression templates to evaluate chains of FixedPoint operations with a single rescale
+ * @version 1
+ *
+ */
+#ifndef FIXED_POINT_EXPR_HPP_
+#define FIXED_POINT_EXPR_HPP_
+#include <algorithm>
+#include <concepts>
+#include <cstdint>
+#include <type_traits>
+#include "fixedpoint.hpp"
+
+/**
+ * @brief Base class of the expression nodes
+ * @details Each node knows at compilation time the exact format of its result : ibits integer bits and fbits fractional bits.
+ *          Products add the formats, sums align on the largest fractional part and take one more integer bit,
+ *          so nothing is truncated inside the expression. The intermediate width (int32_t or int64_t) is chosen
+ *          once for the whole tree, and the result is rescaled once when it is converted to a FixedPoint.
+ */
+class FixedExprBase
+{
+};
+
+template <typename X>
+concept FixedExprType = std::is_base_of_v<FixedExprBase, X>;
+
+template <int I, int E, typename T>
+struct FixedExprLeaf : FixedExprBase
+{
+    static constexpr int ibits = I;
+    static constexpr int fbits = E;
+    FixedPoint<I, E, T> v;
+    constexpr explicit FixedExprLeaf(const FixedPoint<I, E, T> &x) : v(x) {}
+    template <typename W>
+    constexpr W eval() const { return static_cast<W>(v.getM()); }
+};
+
+template <FixedExprType A, FixedExprType B>
+struct FixedExprMul : FixedExprBase
+{
+    static constexpr int ibits = A::ibits + B::ibits;
+    static constexpr int fbits = A::fbits + B::fbits;
+    A a;
+    B b;
+    constexpr FixedExprMul(const A &x, const B &y) : a(x), b(y) {}
+    template <typename W>
+    constexpr W eval() const { return a.template eval<W>() * b.template eval<W>(); }
+};
+
+template <FixedExprType A, FixedExprType B, bool Sub>
+struct FixedExprAdd : FixedExprBase
+{
+    static constexpr int ibits = std::max(A::ibits, B::ibits) + 1;
+    static constexpr int fbits = std::max(A::fbits, B::fbits);
+    A a;
+    B b;
+    constexpr FixedExprAdd(const A &x, const B &y) : a(x), b(y) {}
+    template <typename W>
+    constexpr W eval() const
+    {
+        const W x = a.template eval<W>() * (W(1) << (fbits - A::fbits)); // alignment is exact : only left shifts
+        const W y = b.template eval<W>() * (W(1) << (fbits - B::fbits));
+        if constexpr (Sub)
+            return x - y;
+        else
+            return x + y;
+    }
+};
+
+template <FixedExprType A>
+struct FixedExprNeg : FixedExprBase
+{
+    static constexpr int ibits = A::ibits;
+    static constexpr int fbits = A::fbits;
+    A a;
+    constexpr explicit FixedExprNeg(const A &x) : a(x) {}
+    template <typename W>
+    constexpr W eval() const { return -a.template eval<W>(); }
+};
+
+/**
+ * @brief Wrap a FixedPoint into an expression : operations on the result build an expression tree instead of temporaries
+ *
+ * @code{.cpp}
+ * auto u = fx_eval<FixedPoint<8, 16>>(fx(kp) * e + fx(ki) * i - offset);
+ * @endcode
+ * An expression is not a FixedPoint : it is converted with fx_eval, which picks the output format
+ */
+template <int I, int E, typename T>
+constexpr FixedExprLeaf<I, E, T> fx(const FixedPoint<I, E, T> &x) { return FixedExprLeaf<I, E, T>(x); }
+
+template <FixedExprType X>
+constexpr const X &fx(const X &x) { return x; }
+
+/**
+ * @brief Evaluate an expression into a FixedPoint format, with a single rescale at the end
+ * @details The intermediate is int32_t when the whole tree fits in 31 bits, int64_t otherwise
+ *
+ * @tparam Out_t FixedPoint format of the result
+ * @param x expression
+ * @return constexpr Out_t
+ */
+template <FixedPointType Out_t, FixedExprType X>
+constexpr Out_t fx_eval(const X &x)
+{
+    static_assert((X::ibits + X::fbits) < 63, "expression needs more than 63 bits : convert a sub expression to a FixedPoint first");
+    using W = std::conditional_t<((X::ibits + X::fbits) < 31), int32_t, int64_t>;
+    constexpr int E = Out_t::Fpart();
+    W r = x.template eval<W>();
+    if constexpr (X::fbits > E)
+        r /= (W(1) << (X::fbits - E)); // truncation, same as the FixedPoint operators
+    else if constexpr (X::fbits < E)
+        r *= (W(1) << (E - X::fbits));
+    return Out_t(static_cast<typename Out_t::raw_t>(static_cast<typename Out_t::storage_t>(r)));
+}
+
+// operators : at least one operand is an expression, the other one may be a FixedPoint
+template <typename X, typename Y>
+concept FixedExprOperands = (FixedExprType<X> || FixedExprType<Y>) && (FixedExprType<X> || FixedPointType<X>) && (FixedExprType<Y> || FixedPointType<Y>);
+
+template <typename X, typename Y>
+    requires FixedExprOperands<X, Y>
+constexpr auto operator*(const X &x, const Y &y)
+{
+    return FixedExprMul<std::decay_t<decltype(fx(x))>, std::decay_t<decltype(fx(y))>>(fx(x), fx(y));
+}
+template <typename X, typename Y>
+    requires FixedExprOperands<X, Y>
+constexpr auto operator+(const X &x, const Y &y)
+{
+    return FixedExprAdd<std::decay_t<decltype(fx(x))>, std::decay_t<decltype(fx(y))>, false>(fx(x), fx(y));
+}
+template <typename X, typename Y>
+    requires FixedExprOperands<X, Y>
+constexpr auto operator-(const X &x, const Y &y)
+{
+    return FixedExprAdd<std::decay_t<decltype(fx(x))>, std::decay_t<decltype(fx(y))>, true>(fx(x), fx(y));
+}
+template <FixedExprType X>
+constexpr auto operator-(const X &x)
+{
+    return FixedExprNeg<X>(x);
+}
+
+#endif /*FIXED_POINT_EXPR_HPP_*/
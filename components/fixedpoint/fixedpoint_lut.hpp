@@ -0,0 +1,214 @@
+/**
+ * @file fixedpoint_lut.hpp
+ * @brief Compile time lookup tables with fixed point interpolation
+ * @version 1
+ *
+ */
+#ifndef FIXED_POINT_LUT_HPP_
+#define FIXED_POINT_LUT_HPP_
+#include "sdkconfig.h"
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <esp_attr.h>
+#include "fixedpoint.hpp"
+
+/**
+ * @brief Placement of the tables : flash (rodata, default) or internal DRAM (faster, no cache miss)
+ */
+#if CONFIG_FIXEDPOINT_LUT_IN_DRAM
+#define FIXEDPOINT_LUT_ATTR DRAM_ATTR
+#else
+#define FIXEDPOINT_LUT_ATTR
+#endif
+
+enum class LutInterpolation
+{
+    Linear,   //< error <= h^2/8 * max|f''|
+    Quadratic //< error <= h^3/(9*sqrt(3)) * max|f'''|
+};
+
+/**
+ * @brief Lookup table of Fn sampled on N+1 points over [A, B], evaluated with interpolation in fixed point
+ * @details The table is computed at compilation time in double and stored as mantissas of Out_t.
+ *          The evaluation does one multiplication to get the index and the fraction, then one (linear)
+ *          or two (quadratic) multiply-shift for the interpolation : no division and no double.
+ *          Inputs outside [A, B] are clamped to the bounds.
+ * @note Fn must be a captureless lambda taking and returning double, and it must be usable in constant expression
+ *       (GCC evaluates the <cmath> functions at compilation time).
+ * @tparam Fn function to tabulate
+ * @tparam A lower bound of the input range
+ * @tparam B upper bound of the input range
+ * @tparam N number of intervals
+ * @tparam Out_t FixedPoint format of the output
+ * @tparam Interp interpolation order
+ */
+template <auto Fn, double A, double B, std::size_t N, FixedPointType Out_t, LutInterpolation Interp = LutInterpolation::Linear>
+class FixedPointLut
+{
+    static_assert(A < B, "Lut range must not be empty");
+    static_assert(N >= 2, "Lut needs at least 2 intervals");
+    using M_t = typename Out_t::storage_t;
+    static constexpr int FRAC = 16; // number of bits of the interpolation fraction
+
+    static constexpr M_t round_mantissa(double v)
+    {
+        const double s = v * static_cast<double>(Out_t::factor);
+        return static_cast<M_t>((s < 0) ? (s - 0.5) : (s + 0.5));
+    }
+    static constexpr std::array<M_t, N + 1> make_table()
+    {
+        std::array<M_t, N + 1> t{};
+        for (std::size_t i = 0; i <= N; ++i)
+        {
+            t[i] = round_mantissa(Fn(A + (B - A) * static_cast<double>(i) / static_cast<double>(N)));
+        }
+        return t;
+    }
+    // number of fractional bits of the index scale N/(B-A), so that it fits in 31 bits
+    static constexpr int scale_bits()
+    {
+        int b = 0;
+        for (double s = static_cast<double>(N) / (B - A); s >= 1.0; s /= 2)
+            ++b;
+        return 30 - b;
+    }
+
+public:
+    static constexpr double step = (B - A) / static_cast<double>(N);
+    FIXEDPOINT_LUT_ATTR static constexpr std::array<M_t, N + 1> table = make_table();
+
+    /**
+     * @brief Evaluate the function
+     *
+     * @tparam I integer part of the input
+     * @tparam E fractional part of the input
+     * @tparam T storage of the input
+     * @param x input
+     * @return constexpr Out_t
+     */
+    template <int I, int E, typename T>
+    static constexpr Out_t eval(const FixedPoint<I, E, T> &x)
+    {
+        static_assert((I + E) < 31, "Lut input must fit in 31 bits, convert it first");
+        constexpr int S = scale_bits();
+        constexpr int P = E + S; // fractional bits of the position in the table
+        static_assert(P < 62, "Lut input has too many fractional bits for the index computation");
+        constexpr int64_t a_m = static_cast<int64_t>(A * static_cast<double>(int64_t(1) << E) + ((A < 0) ? -0.5 : 0.5));
+        constexpr int64_t scale_q = static_cast<int64_t>(static_cast<double>(N) / (B - A) * static_cast<double>(int64_t(1) << S) + 0.5);
+        constexpr int64_t t_max = static_cast<int64_t>(N) << P;
+
+        int64_t t = (static_cast<int64_t>(x.getM()) - a_m) * scale_q; // position in the table
+        if (t <= 0)
+            return Out_t(static_cast<typename Out_t::raw_t>(table[0]));
+        if (t >= t_max)
+            return Out_t(static_cast<typename Out_t::raw_t>(table[N]));
+
+        std::size_t idx = static_cast<std::size_t>(t >> P);
+        if constexpr (Interp == LutInterpolation::Quadratic)
+        {
+            idx = (idx > N - 2) ? N - 2 : idx; // last interval uses the 3 last points
+        }
+        const int64_t rem = t - (static_cast<int64_t>(idx) << P);
+        const int64_t f = (P >= FRAC) ? (rem >> (P - FRAC)) : (rem << (FRAC - P)); // fraction in Q16, in [0,2) for the quadratic case
+        const int64_t y0 = table[idx];
+        const int64_t d1 = table[idx + 1] - y0;
+        int64_t y = y0 + ((f * d1) >> FRAC);
+        if constexpr (Interp == LutInterpolation::Quadratic)
+        {
+            // Newton forward form : y0 + f.d1 + f(f-1)/2.d2
+            const int64_t d2 = static_cast<int64_t>(table[idx + 2]) - 2 * static_cast<int64_t>(table[idx + 1]) + y0;
+            const int64_t c2 = (f * (f - (int64_t(1) << FRAC))) >> (FRAC + 1);
+            y += (c2 * d2) >> FRAC;
+        }
+        return Out_t(static_cast<typename Out_t::raw_t>(static_cast<M_t>(y)));
+    }
+
+    template <int I, int E, typename T>
+    constexpr Out_t operator()(const FixedPoint<I, E, T> &x) const { return eval(x); }
+
+    /**
+     * @brief Maximum absolute error against Fn, measured at compilation time on a grid of the input format
+     * @details Usable in a static_assert to check the accuracy of a table
+     * @tparam In_t FixedPoint format of the input
+     * @param samples number of samples over [A, B]
+     * @return constexpr double
+     */
+    template <FixedPointType In_t>
+    static constexpr double max_error(std::size_t samples = 4 * N)
+    {
+        double err = 0;
+        for (std::size_t i = 0; i <= samples; ++i)
+        {
+            const In_t x(A + (B - A) * static_cast<double>(i) / static_cast<double>(samples));
+            const double e = static_cast<double>(eval(x)) - Fn(static_cast<double>(x));
+            err = (e < 0) ? ((-e > err) ? -e : err) : ((e > err) ? e : err);
+        }
+        return err;
+    }
+};
+
+/**
+ * @brief Smallest power of 2 number of intervals so that the interpolation error of Fn over [A, B] is below MaxError
+ * @details The derivative bound is estimated with finite differences on 1024 points at compilation time,
+ *          with a margin of 2 because finite differences underestimate steep derivatives at the bounds.
+ *          The output quantization (half a LSB of the output format) is not included in the bound.
+ *
+ * @return constexpr std::size_t
+ */
+template <auto Fn, double A, double B, double MaxError, LutInterpolation Interp = LutInterpolation::Linear>
+constexpr std::size_t lut_size_for_error()
+{
+    constexpr int K = 1024;
+    const double h0 = (B - A) / K;
+    double dmax = 0;
+    for (int k = 0; k + 3 <= K; ++k)
+    {
+        const double x = A + k * h0;
+        double d = (Interp == LutInterpolation::Linear)
+                       ? (Fn(x) - 2 * Fn(x + h0) + Fn(x + 2 * h0)) / (h0 * h0)
+                       : (Fn(x + 3 * h0) - 3 * Fn(x + 2 * h0) + 3 * Fn(x + h0) - Fn(x)) / (h0 * h0 * h0);
+        d = (d < 0) ? -d : d;
+        dmax = (d > dmax) ? d : dmax;
+    }
+    dmax *= 2;
+    std::size_t n = 2;
+    for (; n < 65536; n *= 2)
+    {
+        const double h = (B - A) / static_cast<double>(n);
+        const double bound = (Interp == LutInterpolation::Linear) ? (dmax * h * h / 8) : (dmax * h * h * h / 15.588457268119896); // 9*sqrt(3)
+        if (bound <= MaxError)
+            break;
+    }
+    return n;
+}
+
+/**
+ * @brief Lookup table sized from the requested interpolation error
+ */
+template <auto Fn, double A, double B, double MaxError, FixedPointType Out_t, LutInterpolation Interp = LutInterpolation::Linear>
+using FixedPointLutFor = FixedPointLut<Fn, A, B, lut_size_for_error<Fn, A, B, MaxError, Interp>(), Out_t, Interp>;
+
+/**
+ * @brief Usual functions to tabulate
+ */
+namespace lut_function
+{
+    inline constexpr auto exp = [](double x) { return std::exp(x); };
+    inline constexpr auto exp2 = [](double x) { return std::exp2(x); };
+    inline constexpr auto log = [](double x) { return std::log(x); };
+    inline constexpr auto log2 = [](double x) { return std::log2(x); };
+    inline constexpr auto tanh = [](double x) { return std::tanh(x); };
+    inline constexpr auto sigmoid = [](double x) { return 1.0 / (1.0 + std::exp(-x)); };
+};
+
+template <FixedPointType Out_t, double A, double B, double MaxError = 1e-3, LutInterpolation Interp = LutInterpolation::Quadratic>
+using ExpLut = FixedPointLutFor<lut_function::exp, A, B, MaxError, Out_t, Interp>;
+template <FixedPointType Out_t, double A, double B, double MaxError = 1e-3, LutInterpolation Interp = LutInterpolation::Quadratic>
+using LogLut = FixedPointLutFor<lut_function::log, A, B, MaxError, Out_t, Interp>;
+template <FixedPointType Out_t, double A = -4.0, double B = 4.0, double MaxError = 1e-3, LutInterpolation Interp = LutInterpolation::Quadratic>
+using TanhLut = FixedPointLutFor<lut_function::tanh, A, B, MaxError, Out_t, Interp>;
+template <FixedPointType Out_t, double A = -8.0, double B = 8.0, double MaxError = 1e-3, LutInterpolation Interp = LutInterpolation::Quadratic>
+using SigmoidLut = FixedPointLutFor<lut_function::sigmoid, A, B, MaxError, Out_t, Interp>;
+
+#endif /*FIXED_POINT_LUT_HPP_*/
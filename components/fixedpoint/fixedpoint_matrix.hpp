@@ -0,0 +1,336 @@
+/**
+ * @file fixedpoint_matrix.hpp
+ * @brief Small vectors and matrices of FixedPoint with compile time sizes
+ * @version 1
+ *
+ */
+#ifndef FIXED_POINT_MATRIX_HPP_
+#define FIXED_POINT_MATRIX_HPP_
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+#include "fixedpoint.hpp"
+#include "miscellaneous.hpp"
+
+/**
+ * @brief Vector of N FixedPoint : aggregate, so it can be brace initialized
+ * @details Every loop is fully unrolled with misc::unroll. The format of a product follows the cross-template
+ *          operator* of FixedPoint, and sums of products are accumulated in that format.
+ * @tparam N size
+ * @tparam T FixedPoint format of the elements
+ */
+template <std::size_t N, FixedPointType T>
+struct FixedVec
+{
+    static_assert(N >= 1, "FixedVec size must be strictly positive");
+    using value_type = T;
+    T v[N];
+
+    static constexpr std::size_t size() { return N; }
+    constexpr T &operator[](std::size_t i) { return v[i]; }
+    constexpr const T &operator[](std::size_t i) const { return v[i]; }
+
+    static constexpr FixedVec zero()
+    {
+        FixedVec r;
+        misc::unroll<N>([&](size_t i)
+                        { r.v[i] = T(0); });
+        return r;
+    }
+
+    template <FixedPointType U>
+    constexpr FixedVec &operator+=(const FixedVec<N, U> &x)
+    {
+        misc::unroll<N>([&](size_t i)
+                        { v[i] += x.v[i]; });
+        return *this;
+    }
+    template <FixedPointType U>
+    constexpr FixedVec &operator-=(const FixedVec<N, U> &x)
+    {
+        misc::unroll<N>([&](size_t i)
+                        { v[i] -= x.v[i]; });
+        return *this;
+    }
+    friend constexpr FixedVec operator+(FixedVec x, const FixedVec &y) { return x += y; }
+    friend constexpr FixedVec operator-(FixedVec x, const FixedVec &y) { return x -= y; }
+
+    /**
+     * @brief Product with a scalar : the format of the result is the format of T * U
+     */
+    template <FixedPointType U>
+    friend constexpr auto operator*(const U &s, const FixedVec &x)
+    {
+        FixedVec<N, decltype(U() * T())> r;
+        misc::unroll<N>([&](size_t i)
+                        { r.v[i] = s * x.v[i]; });
+        return r;
+    }
+
+    /**
+     * @brief Dot product, accumulated in the format of T * U
+     */
+    template <FixedPointType U>
+    friend constexpr auto dot(const FixedVec &x, const FixedVec<N, U> &y)
+    {
+        decltype(T() * U()) acc(0);
+        misc::unroll<N>([&](size_t i)
+                        { acc += x.v[i] * y.v[i]; });
+        return acc;
+    }
+};
+
+/**
+ * @brief Matrix of R x C FixedPoint, row major : aggregate, so it can be brace initialized
+ * @details Every loop is fully unrolled with misc::unroll. The format of a product follows the cross-template
+ *          operator* of FixedPoint, and sums of products are accumulated in that format.
+ * @tparam R number of rows
+ * @tparam C number of columns
+ * @tparam T FixedPoint format of the elements
+ */
+template <std::size_t R, std::size_t C, FixedPointType T>
+struct FixedMat
+{
+    static_assert((R >= 1) && (C >= 1), "FixedMat sizes must be strictly positive");
+    using value_type = T;
+    T m[R][C];
+
+    static constexpr std::size_t rows() { return R; }
+    static constexpr std::size_t cols() { return C; }
+    constexpr T *operator[](std::size_t r) { return m[r]; }
+    constexpr const T *operator[](std::size_t r) const { return m[r]; }
+
+    static constexpr FixedMat zero()
+    {
+        FixedMat r;
+        misc::unroll<R * C>([&](size_t i)
+                            { r.m[i / C][i % C] = T(0); });
+        return r;
+    }
+    static constexpr FixedMat identity()
+    {
+        static_assert(R == C, "identity is only defined for square matrices");
+        FixedMat r;
+        misc::unroll<R * C>([&](size_t i)
+                            { r.m[i / C][i % C] = T((i / C) == (i % C) ? 1 : 0); });
+        return r;
+    }
+
+    template <FixedPointType U>
+    constexpr FixedMat &operator+=(const FixedMat<R, C, U> &x)
+    {
+        misc::unroll<R * C>([&](size_t i)
+                            { m[i / C][i % C] += x.m[i / C][i % C]; });
+        return *this;
+    }
+    template <FixedPointType U>
+    constexpr FixedMat &operator-=(const FixedMat<R, C, U> &x)
+    {
+        misc::unroll<R * C>([&](size_t i)
+                            { m[i / C][i % C] -= x.m[i / C][i % C]; });
+        return *this;
+    }
+    friend constexpr FixedMat operator+(FixedMat x, const FixedMat &y) { return x += y; }
+    friend constexpr FixedMat operator-(FixedMat x, const FixedMat &y) { return x -= y; }
+
+    friend constexpr FixedMat<C, R, T> transpose(const FixedMat &x)
+    {
+        FixedMat<C, R, T> r;
+        misc::unroll<R * C>([&](size_t i)
+                            { r.m[i % C][i / C] = x.m[i / C][i % C]; });
+        return r;
+    }
+
+    /**
+     * @brief Product with a scalar : the format of the result is the format of U * T
+     */
+    template <FixedPointType U>
+    friend constexpr auto operator*(const U &s, const FixedMat &x)
+    {
+        FixedMat<R, C, decltype(U() * T())> r;
+        misc::unroll<R * C>([&](size_t i)
+                            { r.m[i / C][i % C] = s * x.m[i / C][i % C]; });
+        return r;
+    }
+
+    /**
+     * @brief Matrix product, accumulated in the format of T * U
+     */
+    template <std::size_t K, FixedPointType U>
+    friend constexpr auto operator*(const FixedMat &x, const FixedMat<C, K, U> &y)
+    {
+        using P = decltype(T() * U());
+        FixedMat<R, K, P> r;
+        misc::unroll<R * K>([&](size_t i)
+                            {
+                                P acc(0);
+                                misc::unroll<C>([&](size_t j)
+                                                { acc += x.m[i / K][j] * y.m[j][i % K]; });
+                                r.m[i / K][i % K] = acc; });
+        return r;
+    }
+
+    /**
+     * @brief Matrix-vector product, accumulated in the format of T * U
+     */
+    template <FixedPointType U>
+    friend constexpr auto operator*(const FixedMat &x, const FixedVec<C, U> &y)
+    {
+        using P = decltype(T() * U());
+        FixedVec<R, P> r;
+        misc::unroll<R>([&](size_t i)
+                        {
+                            P acc(0);
+                            misc::unroll<C>([&](size_t j)
+                                            { acc += x.m[i][j] * y.v[j]; });
+                            r.v[i] = acc; });
+        return r;
+    }
+};
+
+/**
+ * @brief Convert every element of a vector to another FixedPoint format
+ */
+template <FixedPointType U, std::size_t N, FixedPointType T>
+constexpr FixedVec<N, U> vector_cast(const FixedVec<N, T> &x)
+{
+    FixedVec<N, U> r;
+    misc::unroll<N>([&](size_t i)
+                    { r.v[i] = U(x.v[i]); });
+    return r;
+}
+
+/**
+ * @brief Convert every element of a matrix to another FixedPoint format
+ */
+template <FixedPointType U, std::size_t R, std::size_t C, FixedPointType T>
+constexpr FixedMat<R, C, U> matrix_cast(const FixedMat<R, C, T> &x)
+{
+    FixedMat<R, C, U> r;
+    misc::unroll<R * C>([&](size_t i)
+                        { r.m[i / C][i % C] = U(x.m[i / C][i % C]); });
+    return r;
+}
+
+namespace fixedpoint_detail
+{
+    /**
+     * @brief (num * 2^S) / den truncated toward zero, num having at most NumBits value bits
+     * @details Plain int64_t division when the scaled numerator fits, bit serial division (div_shift64) otherwise
+     */
+    template <int NumBits, int S>
+    constexpr int64_t scaled_div(int64_t num, int64_t den)
+    {
+        if constexpr ((NumBits + S) < 63)
+        {
+            return (num * (int64_t(1) << S)) / den;
+        }
+        else
+        {
+            return div_shift64(num, den, S);
+        }
+    }
+
+    /**
+     * @brief Checks of the element format of the inverse : the determinant and the cofactors are computed on the raw
+     *        mantissas in int64_t, without intermediate truncation to the element format
+     */
+    template <FixedPointType T>
+    constexpr void check_inverse_format()
+    {
+        static_assert(sizeof(typename T::storage_t) <= 4, "inverse computes in int64_t : use int16_t or int32_t storage");
+    }
+};
+
+/**
+ * @brief Inverse of a 1x1 matrix, for generic code working on small matrices
+ *
+ * @param x matrix to inverse
+ * @param out inverse
+ * @return false if the matrix is singular (out is left unchanged)
+ */
+template <FixedPointType T, FixedPointType U>
+constexpr bool inverse(const FixedMat<1, 1, T> &x, FixedMat<1, 1, U> &out)
+{
+    fixedpoint_detail::check_inverse_format<T>();
+    if (x.m[0][0].getM() == 0)
+        return false;
+    constexpr int E = T::Fpart();
+    out.m[0][0] = U(static_cast<typename U::raw_t>(fixedpoint_detail::scaled_div<1, E + U::Fpart()>(1, x.m[0][0].getM())));
+    return true;
+}
+
+/**
+ * @brief Inverse of a 2x2 matrix : the range of the inverse can not be predicted, so its format is chosen by the caller
+ * @details The determinant is computed exactly on the raw mantissas (int64_t with 2E fractional bits), and each element
+ *          of the inverse is a single division truncated toward zero into U (one truncation, none before it), so a small
+ *          but non zero determinant is not lost
+ *
+ * @param x matrix to inverse
+ * @param out inverse
+ * @return false if the matrix is singular (out is left unchanged)
+ */
+template <FixedPointType T, FixedPointType U>
+constexpr bool inverse(const FixedMat<2, 2, T> &x, FixedMat<2, 2, U> &out)
+{
+    fixedpoint_detail::check_inverse_format<T>();
+    constexpr int E = T::Fpart();
+    constexpr int B = T::Ipart() + E; // value bits of an element
+    const int64_t det = static_cast<int64_t>(x.m[0][0].getM()) * x.m[1][1].getM() - static_cast<int64_t>(x.m[0][1].getM()) * x.m[1][0].getM();
+    if (det == 0)
+        return false;
+    // element / det = m * 2^E / det, in U : m * 2^(E + F) / det
+    const auto element = [&](int64_t m)
+    { return U(static_cast<typename U::raw_t>(fixedpoint_detail::scaled_div<B, E + U::Fpart()>(m, det))); };
+    out.m[0][0] = element(x.m[1][1].getM());
+    out.m[0][1] = element(-static_cast<int64_t>(x.m[0][1].getM()));
+    out.m[1][0] = element(-static_cast<int64_t>(x.m[1][0].getM()));
+    out.m[1][1] = element(x.m[0][0].getM());
+    return true;
+}
+
+/**
+ * @brief Inverse of a 3x3 matrix by cofactors : the range of the inverse can not be predicted, so its format is chosen by the caller
+ * @details The cofactors are computed exactly on the raw mantissas (int64_t with 2E fractional bits), the determinant
+ *          with 3E fractional bits when it fits int64_t (exact, e.g. for FixedPoint<4, 16>) and otherwise with as many
+ *          as fit, but at least 2E. Each element of the inverse is a single division truncated toward zero into U
+ *
+ * @param x matrix to inverse
+ * @param out inverse
+ * @return false if the matrix is singular (out is left unchanged)
+ */
+template <FixedPointType T, FixedPointType U>
+constexpr bool inverse(const FixedMat<3, 3, T> &x, FixedMat<3, 3, U> &out)
+{
+    fixedpoint_detail::check_inverse_format<T>();
+    constexpr int E = T::Fpart();
+    constexpr int B = T::Ipart() + E; // value bits of an element
+    static_assert((3 * T::Ipart() + 2 * E + 2) < 63, "the determinant of a 3x3 matrix of T does not fit int64_t with 2E fractional bits");
+    int64_t cof[3][3];
+    misc::unroll<9>([&](size_t i)
+                    {
+                        const size_t r = i / 3, c = i % 3;
+                        const size_t r1 = (r + 1) % 3, r2 = (r + 2) % 3, c1 = (c + 1) % 3, c2 = (c + 2) % 3;
+                        cof[r][c] = static_cast<int64_t>(x.m[r1][c1].getM()) * x.m[r2][c2].getM() - static_cast<int64_t>(x.m[r1][c2].getM()) * x.m[r2][c1].getM(); });
+    constexpr int D = std::max(0, 3 * B + 2 - 62); // bits dropped from the 3E fractional bits of the exact determinant
+    int64_t det = 0;
+    misc::unroll<3>([&](size_t j)
+                    { det += fixedpoint_detail::mul_shift64(x.m[0][j].getM(), cof[0][j], D); });
+    if (det == 0)
+        return false;
+    // cofactor (2E fractional bits) / det (3E - D fractional bits), in U : cof * 2^(E - D + F) / det
+    misc::unroll<9>([&](size_t i)
+                    { out.m[i / 3][i % 3] = U(static_cast<typename U::raw_t>(fixedpoint_detail::scaled_div<2 * B + 1, E - D + U::Fpart()>(cof[i % 3][i / 3], det))); }); // adjugate is the transposed cofactor matrix
+    return true;
+}
+
+/**
+ * @brief 2D rotation matrix from the cosine and the sine of the angle (e.g. from a lookup table)
+ */
+template <FixedPointType T>
+constexpr FixedMat<2, 2, T> rotation2d(const T &c, const T &s)
+{
+    return FixedMat<2, 2, T>{{{c, -s}, {s, c}}};
+}
+
+#endif /*FIXED_POINT_MATRIX_HPP_*/
@@ -41,9 +41,9 @@ public:
     using self = FixedPoint;
     static constexpr int32_t factor = (1 << E);
 
-    static constexpr self &MAX_VAL() { return self(1 << (I + E) + 1); } // if I = 5, E  = 1, MAX_VAL = (2-1) = 1 bit
+    static constexpr self MAX_VAL() { return self(uint32_t(INT32_MAX)); } // if I = 5, E  = 1, MAX_VAL = (2-1) = 1 bit
 
-    static constexpr self &MIN_VAL() { return -MAX_VAL(); }
+    static constexpr self MIN_VAL() { return -MAX_VAL(); }
 
     // template accessor to get template parameter value
     static constexpr int Ipart() { return I; }
@@ -0,0 +1,55 @@
+/**
+ * @file complementary.hpp
+ * @brief Complementary filter based on FixedPoint
+ * @version 0.1
+ *
+ */
+#ifndef COMPLEMENTARY_HPP_
+#define COMPLEMENTARY_HPP_
+#include "fixedpoint.hpp"
+
+/**
+ * @brief Complementary filter : fuses a rate (e.g. gyroscope, wheel odometry) with an absolute measurement (e.g. accelerometer angle, range)
+ * @details estimate = alpha.(estimate + rate.dt) + (1 - alpha).absolute
+ * @tparam Value_t FixedPoint format of the estimate, the rate and the absolute measurement
+ * @tparam Coef_t FixedPoint format of alpha and dt
+ */
+template <FixedPointType Value_t, FixedPointType Coef_t>
+class ComplementaryFilter
+{
+    static_assert(decltype(Coef_t() * Value_t())::Fpart() >= Value_t::Fpart(), "Coef_t has less fractional bits than Value_t : the coefficients would truncate the estimate");
+
+public:
+    /**
+     * @brief Construct a new Complementary Filter
+     *
+     * @param alpha weight of the integrated rate, in [0, 1]
+     * @param dt sampling period, in the time unit of the rate
+     */
+    constexpr ComplementaryFilter(const Coef_t &alpha, const Coef_t &dt) : a(alpha), one_minus_a(Coef_t(1) - alpha), ts(dt) {}
+
+    /**
+     * @brief Fuse one sample : to be called once per sampling period
+     *
+     * @param rate derivative of the estimated value
+     * @param absolute absolute measurement of the estimated value
+     * @return Value_t estimate
+     */
+    constexpr Value_t step(const Value_t &rate, const Value_t &absolute)
+    {
+        const Value_t integrated(estimate + Value_t(ts * rate));
+        estimate = Value_t(a * integrated) + Value_t(one_minus_a * absolute);
+        return estimate;
+    }
+
+    constexpr void reset(const Value_t &value = Value_t(0)) { estimate = value; }
+    constexpr Value_t getEstimate() const { return estimate; }
+
+private:
+    Coef_t a;
+    Coef_t one_minus_a;
+    Coef_t ts;
+    Value_t estimate = Value_t(0);
+};
+
+#endif /*COMPLEMENTARY_HPP_*/
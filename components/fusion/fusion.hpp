@@ -0,0 +1,8 @@
+#ifndef FUSION_HPP_
+#define FUSION_HPP_
+
+#include "kalman.hpp"
+#include "complementary.hpp"
+#include "range_filter.hpp"
+
+#endif // FUSION_HPP_
@@ -0,0 +1,101 @@
+/**
+ * @file kalman.hpp
+ * @brief Linear Kalman filter based on FixedPoint
+ * @version 0.1
+ *
+ */
+#ifndef KALMAN_HPP_
+#define KALMAN_HPP_
+#include <cstddef>
+#include "fixedpoint.hpp"
+#include "fixedpoint_matrix.hpp"
+
+/**
+ * @brief Linear Kalman filter with compile time dimensions
+ * @details x[k+1] = F.x[k] + B.u[k] + w (cov Q) ; z[k] = H.x[k] + v (cov R)
+ *          Every matrix is a member, predict and update do not allocate and every loop is unrolled,
+ *          so both can be called from a PeriodicTask step. Products are rescaled to Value_t after each matrix product.
+ * @tparam NX number of states
+ * @tparam NZ number of measurements (at most 3, the innovation covariance is inverted by cofactors)
+ * @tparam NU number of inputs
+ * @tparam Value_t FixedPoint format of states, covariances and measurements
+ * @tparam Coef_t FixedPoint format of the model matrices F, B and H
+ */
+template <std::size_t NX, std::size_t NZ, std::size_t NU, FixedPointType Value_t, FixedPointType Coef_t>
+class LinearKalman
+{
+    static_assert(NZ <= 3, "the innovation covariance is only inverted up to 3x3");
+    static_assert(decltype(Coef_t() * Value_t())::Fpart() >= Value_t::Fpart(), "Coef_t has less fractional bits than Value_t : the model would truncate the states");
+
+public:
+    using State = FixedVec<NX, Value_t>;
+    using Covariance = FixedMat<NX, NX, Value_t>;
+    using Measurement = FixedVec<NZ, Value_t>;
+    using Input = FixedVec<NU, Value_t>;
+
+    struct Model
+    {
+        FixedMat<NX, NX, Coef_t> F;    //< State transition
+        FixedMat<NX, NU, Coef_t> B;    //< Input model
+        FixedMat<NZ, NX, Coef_t> H;    //< Measurement model
+        Covariance Q;                  //< Process noise covariance
+        FixedMat<NZ, NZ, Value_t> R;   //< Measurement noise covariance
+    };
+
+    constexpr LinearKalman(const Model &model, const State &x0, const Covariance &P0) : mdl(model), x(x0), P(P0) {}
+
+    /**
+     * @brief Prediction step without input
+     */
+    constexpr void predict()
+    {
+        x = vector_cast<Value_t>(mdl.F * x);
+        P = matrix_cast<Value_t>(matrix_cast<Value_t>(mdl.F * P) * transpose(mdl.F)) + mdl.Q;
+    }
+
+    /**
+     * @brief Prediction step with input
+     *
+     * @param u input
+     */
+    constexpr void predict(const Input &u)
+    {
+        x = vector_cast<Value_t>(mdl.F * x) + vector_cast<Value_t>(mdl.B * u);
+        P = matrix_cast<Value_t>(matrix_cast<Value_t>(mdl.F * P) * transpose(mdl.F)) + mdl.Q;
+    }
+
+    /**
+     * @brief Correction step
+     *
+     * @param z measurement
+     * @return false if the innovation covariance is singular (state is left unchanged)
+     */
+    constexpr bool update(const Measurement &z)
+    {
+        const Measurement y = z - vector_cast<Value_t>(mdl.H * x);                                   // innovation
+        const FixedMat<NX, NZ, Value_t> PHt = matrix_cast<Value_t>(P * transpose(mdl.H));            // P.H^T
+        const FixedMat<NZ, NZ, Value_t> S = matrix_cast<Value_t>(mdl.H * PHt) + mdl.R;               // innovation covariance
+        FixedMat<NZ, NZ, Value_t> Sinv;
+        if (!inverse(S, Sinv))
+            return false;
+        const FixedMat<NX, NZ, Value_t> K = matrix_cast<Value_t>(PHt * Sinv);                        // gain
+        x += vector_cast<Value_t>(K * y);
+        P -= matrix_cast<Value_t>(K * matrix_cast<Value_t>(mdl.H * P));
+        return true;
+    }
+
+    constexpr const State &getState() const { return x; }
+    constexpr const Covariance &getCovariance() const { return P; }
+    constexpr void reset(const State &x0, const Covariance &P0)
+    {
+        x = x0;
+        P = P0;
+    }
+
+private:
+    Model mdl;
+    State x;
+    Covariance P;
+};
+
+#endif /*KALMAN_HPP_*/
@@ -0,0 +1,102 @@
+/**
+ * @file range_filter.hpp
+ * @brief Range and closing velocity filter for ultrasound measurements, based on FixedPoint
+ * @version 0.1
+ *
+ */
+#ifndef RANGE_FILTER_HPP_
+#define RANGE_FILTER_HPP_
+#include <cstdint>
+#include "fixedpoint.hpp"
+#include "ultrasound.h"
+
+/**
+ * @brief Alpha-beta filter (steady state constant velocity Kalman filter) on ultrasound ranges
+ * @details The sampling period is taken from the timestamps of the measurements, so it can be used with an
+ *          adaptive measurement period. Invalid distances and measurements that are not newer than the last one are
+ *          rejected, and the filter restarts from the measurement after a gap longer than max_gap_us.
+ * @tparam Value_t FixedPoint format of distance (mm) and velocity (mm/s)
+ * @tparam Coef_t FixedPoint format of alpha and beta
+ */
+template <FixedPointType Value_t = FixedPoint<16, 12>, FixedPointType Coef_t = FixedPoint<1, 16>>
+class RangeFilter
+{
+    using Dt_t = FixedPoint<4, 20>; // period in seconds, up to 16 s
+    static_assert(Value_t::Ipart() >= 13, "Value_t must hold distances up to 4 m in mm");
+
+public:
+    /**
+     * @brief Construct a new Range Filter
+     *
+     * @param alpha correction gain of the distance, in [0, 1]
+     * @param beta correction gain of the velocity, in [0, 2]
+     * @param max_gap_us maximum time between 2 measurements before restarting the filter
+     */
+    constexpr RangeFilter(const Coef_t &alpha, const Coef_t &beta, int64_t max_gap_us = 500000) : a(alpha), b(beta), max_gap(max_gap_us) {}
+
+    /**
+     * @brief Fuse a new measurement
+     *
+     * @param measure ultrasound measurement
+     * @return false if the measurement was rejected
+     */
+    constexpr bool update(const Ultrasound_Measurement_t &measure)
+    {
+        if ((measure.distance_mm < 0) || (measure.distance_mm == INT32_MAX))
+            return false;
+        const int64_t dt_us = measure.timestamp_us - last_timestamp_us;
+        if (initialized && (dt_us <= 0))
+            return false;
+        if (!initialized || (dt_us > max_gap))
+        {
+            distance = Value_t(measure.distance_mm);
+            velocity = Value_t(0);
+            last_timestamp_us = measure.timestamp_us;
+            initialized = true;
+            return true;
+        }
+        const Dt_t dt = toSeconds(dt_us);
+        const Value_t predicted(distance + Value_t(velocity * dt));
+        const Value_t residual(Value_t(measure.distance_mm) - predicted);
+        distance = predicted + Value_t(a * residual);
+        velocity += Value_t(Value_t(b * residual) / dt);
+        last_timestamp_us = measure.timestamp_us;
+        return true;
+    }
+
+    /**
+     * @brief Extrapolate the distance at a given time, e.g. the current time of the consumer
+     *
+     * @param timestamp_us time of the extrapolation
+     * @return Value_t distance in mm
+     */
+    constexpr Value_t predictDistanceMm(int64_t timestamp_us) const
+    {
+        const int64_t dt_us = timestamp_us - last_timestamp_us;
+        if (dt_us <= 0)
+            return distance;
+        return distance + Value_t(velocity * toSeconds(dt_us));
+    }
+
+    constexpr Value_t getDistanceMm() const { return distance; }
+    constexpr Value_t getVelocityMmPerS() const { return velocity; } // negative when closing
+    constexpr int64_t getTimestampUs() const { return last_timestamp_us; }
+    constexpr bool isInitialized() const { return initialized; }
+    constexpr void reset() { initialized = false; }
+
+private:
+    Coef_t a;
+    Coef_t b;
+    int64_t max_gap;
+    Value_t distance = Value_t(0);
+    Value_t velocity = Value_t(0);
+    int64_t last_timestamp_us = 0;
+    bool initialized = false;
+
+    static constexpr Dt_t toSeconds(int64_t dt_us)
+    {
+        return Dt_t(static_cast<typename Dt_t::raw_t>((dt_us << Dt_t::Fpart()) / 1000000));
+    }
+};
+
+#endif /*RANGE_FILTER_HPP_*/
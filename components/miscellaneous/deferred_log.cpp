@@ -0,0 +1,168 @@
+#include "sdkconfig.h"
+#include <atomic>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <esp_attr.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#if CONFIG_WTASK_PARTITION
+#include "WPartition.hpp"
+#endif
+
+#include "deferred_log.hpp"
+#include "miscellaneous.hpp"
+
+static_assert((CONFIG_MISC_DEFERRED_LOG_RING_SIZE & (CONFIG_MISC_DEFERRED_LOG_RING_SIZE - 1)) == 0, "Deferred log ring size must be a power of 2");
+
+namespace
+{
+	constexpr uint32_t ring_mask = CONFIG_MISC_DEFERRED_LOG_RING_SIZE - 1;
+
+	/**
+	 * @brief One ring per core : writers are the tasks and ISR of the core (CAS on head), the reader is the drain task
+	 *
+	 */
+	struct DeferredLogRing
+	{
+		std::atomic<uint32_t> head{0};
+		std::atomic<uint32_t> tail{0};
+		misc::DeferredLogRecord records[CONFIG_MISC_DEFERRED_LOG_RING_SIZE];
+	};
+
+	DRAM_ATTR DeferredLogRing rings[portNUM_PROCESSORS];
+	std::atomic<uint32_t> dropped{0};
+
+	const char level_letter[] = {'N', 'E', 'W', 'I', 'D', 'V'};
+
+	void print_record(const misc::DeferredLogRecord &record, int core)
+	{
+		const char letter = (record.level < sizeof(level_letter)) ? level_letter[record.level] : '?';
+		printf("%c (%u@%d) %s: ", letter, (unsigned)record.ccount, core, record.tag);
+		if (record.nargs == misc::DeferredLogRecord::hex_dump)
+		{
+			const uint8_t *bytes = record.bytes;
+			for (int i = 0; i < record.len; ++i)
+				printf("%s%02x", ((i & 7) == 0) ? "  " : " ", bytes[i]);
+			printf("%*s  |", (int)((misc::DeferredLogRecord::hex_dump_bytes - record.len) * 3 + ((record.len <= 8) ? 1 : 0)), "");
+			for (int i = 0; i < record.len; ++i)
+				putchar(isprint(bytes[i]) ? bytes[i] : '.');
+			printf("|\n");
+			return;
+		}
+		// Extra arguments are ignored by printf, every argument is a register sized word
+		printf(record.format, record.args[0], record.args[1], record.args[2], record.args[3]);
+		putchar('\n');
+	}
+};
+
+namespace misc
+{
+	bool IRAM_ATTR deferred_log_push(const DeferredLogRecord &record)
+	{
+		DeferredLogRing &ring = rings[xPortGetCoreID()];
+		uint32_t head = ring.head.load(std::memory_order_relaxed);
+		do
+		{
+			if (head - ring.tail.load(std::memory_order_acquire) >= CONFIG_MISC_DEFERRED_LOG_RING_SIZE)
+			{
+				dropped.fetch_add(1, std::memory_order_relaxed);
+				return false;
+			}
+		} while (!ring.head.compare_exchange_weak(head, head + 1, std::memory_order_acq_rel)); // an ISR of the same core can take the slot first
+		DeferredLogRecord &slot = ring.records[head & ring_mask];
+		slot.tag = record.tag;
+		slot.format = record.format;
+		slot.ccount = record.ccount;
+		slot.level = record.level;
+		slot.nargs = record.nargs;
+		slot.len = record.len;
+		memcpy(slot.args, record.args, sizeof(slot.args));
+		std::atomic_thread_fence(std::memory_order_release);
+		slot.seq = head + 1; // publish
+		return true;
+	};
+
+	size_t deferred_log_drain()
+	{
+		size_t count = 0;
+		for (int core = 0; core < portNUM_PROCESSORS; ++core)
+		{
+			DeferredLogRing &ring = rings[core];
+			uint32_t tail = ring.tail.load(std::memory_order_relaxed);
+			while (tail != ring.head.load(std::memory_order_acquire))
+			{
+				const DeferredLogRecord &slot = ring.records[tail & ring_mask];
+				if (slot.seq != tail + 1)
+					break; // reserved but not complete yet
+				std::atomic_thread_fence(std::memory_order_acquire);
+				print_record(slot, core);
+				ring.tail.store(++tail, std::memory_order_release);
+				++count;
+			}
+		}
+		return count;
+	};
+
+	BaseType_t deferred_log_start_drain(UBaseType_t priority, uint32_t period_ms)
+	{
+		static uint32_t period;
+		period = period_ms;
+		BaseType_t core = tskNO_AFFINITY;
+#if CONFIG_WTASK_PARTITION
+		// printing blocks on the UART, it must not delay the real-time tasks
+		if (!WPartition::place("LogDrain", core, priority, TASK_BEST_EFFORT))
+			return pdFAIL;
+#endif
+		TaskHandle_t handle = nullptr;
+		const BaseType_t created = xTaskCreatePinnedToCore([](void *arg)
+														   {
+															   const TickType_t delay = pdMS_TO_TICKS(*static_cast<uint32_t *>(arg));
+															   for (;;)
+															   {
+																   deferred_log_drain();
+																   vTaskDelay((delay > 0) ? delay : 1);
+															   } },
+														   "LogDrain", 3072, &period, priority, &handle, core);
+#if CONFIG_WTASK_PARTITION
+		if (created == pdPASS)
+			WPartition::registerTask(handle, core, TASK_BEST_EFFORT);
+#endif
+		return created;
+	};
+
+	uint32_t deferred_log_dropped()
+	{
+		return dropped.load(std::memory_order_relaxed);
+	};
+
+	void IRAM_ATTR deferred_log_hex(esp_log_level_t level, const char *tag, const char *buffer, uint16_t buff_len)
+	{
+		DeferredLogRecord record;
+		record.tag = tag;
+		record.format = nullptr;
+		record.level = level;
+		record.nargs = DeferredLogRecord::hex_dump;
+		while (buff_len > 0)
+		{
+			record.ccount = xthal_get_ccount();
+			record.len = (buff_len > DeferredLogRecord::hex_dump_bytes) ? DeferredLogRecord::hex_dump_bytes : buff_len;
+			memcpy(record.bytes, buffer, record.len);
+			deferred_log_push(record);
+			buffer += record.len;
+			buff_len -= record.len;
+		}
+	};
+
+	uint32_t deferred_log_benchmark(uint32_t iterations)
+	{
+		static const char *TAG = "LOG_BENCH";
+		uint32_t cycles = misc::tick_measure([iterations]()
+											 {
+												 for (uint32_t i = 0; i < iterations; ++i)
+													 deferred_log(ESP_LOG_INFO, TAG, "benchmark %u %u", i, iterations); });
+		const uint32_t per_call = (iterations > 0) ? cycles / iterations : 0;
+		ESP_LOGI(TAG, "Deferred log: %u cycles per call (%u calls, %u dropped)", (unsigned)per_call, (unsigned)iterations, (unsigned)deferred_log_dropped());
+		return per_call;
+	};
+};
@@ -0,0 +1,118 @@
+/**
+ * @file deferred_log.hpp
+ * @brief Deferred logging : ISR safe log calls only store a binary record, formatting and printing is done later by a drain task
+ * @version 0.1
+ *
+ */
+#ifndef DEFERRED_LOG_HPP__
+#define DEFERRED_LOG_HPP__
+#include "sdkconfig.h"
+#include <xtensa/hal.h>
+#include <esp_log.h>
+#include <freertos/FreeRTOS.h>
+#include <cstdint>
+#include <cstddef>
+#include <type_traits>
+
+#ifndef CONFIG_MISC_DEFERRED_LOG_RING_SIZE
+#define CONFIG_MISC_DEFERRED_LOG_RING_SIZE 64
+#endif
+#ifndef CONFIG_MISC_DEFERRED_LOG_DRAIN_PERIOD_MS
+#define CONFIG_MISC_DEFERRED_LOG_DRAIN_PERIOD_MS 50
+#endif
+
+namespace misc
+{
+	/**
+	 * @brief Binary log record : strings are not copied, tag and format are the addresses of literals (they act as IDs)
+	 *
+	 */
+	struct DeferredLogRecord
+	{
+		static constexpr size_t max_args = 4;
+		static constexpr uint8_t hex_dump = 0xff; ///< nargs value of a hexdump line, bytes hold the raw data
+		static constexpr size_t hex_dump_bytes = 16;
+		const char *tag;
+		const char *format;
+		uint32_t ccount;		///< cycle counter of the core at the log call
+		volatile uint32_t seq;	///< index + 1 once the record is complete
+		uint8_t level;			///< esp_log_level_t
+		uint8_t nargs;			///< number of arguments or hex_dump
+		uint8_t len;			///< number of bytes of a hex_dump line
+		union
+		{
+			uintptr_t args[max_args];	  ///< raw arguments (32 bits words on the target)
+			uint8_t bytes[hex_dump_bytes]; ///< raw bytes of a hex_dump line
+		};
+	};
+
+	/**
+	 * @brief Push a record in the ring of the current core (ISR safe, lock free)
+	 *
+	 * @param record record to copy
+	 * @return true if stored, false if the ring is full (the record is counted as dropped)
+	 */
+	bool deferred_log_push(const DeferredLogRecord &record);
+
+	/**
+	 * @brief Format and print all complete records of all cores (task context only)
+	 *
+	 * @return size_t number of printed records
+	 */
+	size_t deferred_log_drain();
+
+	/**
+	 * @brief Start a low priority task that drains the rings periodically
+	 * @details With CONFIG_WTASK_PARTITION the task is a best effort task of the best effort core.
+	 *
+	 * @param priority task priority, below CONFIG_WTASK_PARTITION_RT_MIN_PRIORITY with the partition
+	 * @param period_ms drain period
+	 * @return BaseType_t pdPASS on success
+	 */
+	BaseType_t deferred_log_start_drain(UBaseType_t priority = 1, uint32_t period_ms = CONFIG_MISC_DEFERRED_LOG_DRAIN_PERIOD_MS);
+
+	/**
+	 * @brief Number of records dropped because a ring was full
+	 *
+	 */
+	uint32_t deferred_log_dropped();
+
+	/**
+	 * @brief Measure the average cost of a deferred log call
+	 *
+	 * @param iterations number of calls (should fit in the ring, the records are printed by the drain like any other)
+	 * @return uint32_t cycles per call
+	 */
+	uint32_t deferred_log_benchmark(uint32_t iterations = 32);
+
+	/**
+	 * @brief Store a log call : arguments are kept as raw words and formatted by the drain task
+	 * @warning Strings given as arguments must outlive the drain (literals or static buffers), floating point
+	 * 			arguments are not supported
+	 */
+	template <typename... Args>
+	inline void deferred_log(esp_log_level_t level, const char *tag, const char *format, Args... args)
+	{
+		static_assert(sizeof...(Args) <= DeferredLogRecord::max_args, "Too many arguments for a deferred log");
+		static_assert(((std::is_integral_v<Args> || std::is_enum_v<Args> || std::is_pointer_v<Args>)&&...), "Deferred log arguments must be integral or pointer types");
+		static_assert(((sizeof(Args) <= sizeof(uintptr_t)) && ...), "Deferred log arguments must fit in a register");
+		DeferredLogRecord record;
+		record.ccount = xthal_get_ccount();
+		record.tag = tag;
+		record.format = format;
+		record.level = level;
+		record.nargs = sizeof...(Args);
+		record.len = 0;
+		size_t i = 0;
+		((record.args[i++] = (uintptr_t)(args)), ...);
+		deferred_log_push(record);
+	};
+
+	/**
+	 * @brief Store a buffer dump as raw hexdump lines (16 bytes per record)
+	 *
+	 */
+	void deferred_log_hex(esp_log_level_t level, const char *tag, const char *buffer, uint16_t buff_len);
+};
+
+#endif /*DEFERRED_LOG_HPP__*/
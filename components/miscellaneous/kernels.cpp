@@ -0,0 +1,212 @@
+#include "sdkconfig.h"
+#include <cstdio>
+#include <esp_log.h>
+#include <esp_heap_caps.h>
+
+#include "kernels.hpp"
+
+#define KERNELS_BENCH_MAX_SIZE 1024
+#define PIE_ALIGN 16
+#define PIE_BLOCK 8 // int16 per 128 bits register
+#if CONFIG_MISC_KERNELS_PIE
+#define DOT_Q_NAME "dot_q PIE"
+#else
+#define DOT_Q_NAME "dot_q"
+#endif
+
+static const char *KERNELS_TAG = "KERNELS";
+
+namespace
+{
+	inline int32_t saturate_shift(int64_t acc, uint8_t shift)
+	{
+		acc >>= shift;
+		return (acc > INT32_MAX) ? INT32_MAX : ((acc < INT32_MIN) ? INT32_MIN : static_cast<int32_t>(acc));
+	};
+
+#if CONFIG_MISC_KERNELS_PIE
+	/**
+	 * @brief PIE dot product of n int16 (n multiple of 8, both pointers 16 bytes aligned)
+	 *
+	 */
+	inline OPTIMIZE_SPEED_O3 int32_t dot_q_pie(const int16_t *x, const int16_t *y, std::size_t n, uint8_t shift)
+	{
+		int32_t result;
+		uint32_t sar = shift;
+		__asm__ volatile("ee.zero.accx");
+		for (std::size_t i = 0; i < n; i += PIE_BLOCK)
+		{
+			__asm__ volatile(
+				"ee.vld.128.ip q0, %0, 16\n"
+				"ee.vld.128.ip q1, %1, 16\n"
+				"ee.vmulas.s16.accx q0, q1\n"
+				: "+r"(x), "+r"(y)
+				:
+				: "memory");
+		}
+		__asm__ volatile("ee.srs.accx %0, %1, 0" : "=r"(result) : "r"(sar));
+		return result;
+	};
+#endif
+};
+
+namespace misc
+{
+	int32_t dot_q(std::span<const int16_t> x, std::span<const int16_t> y, uint8_t shift)
+	{
+#if CONFIG_MISC_KERNELS_PIE
+		const std::size_t n = std::min(x.size(), y.size());
+		if ((n > 0) && ((n % PIE_BLOCK) == 0) && ((reinterpret_cast<uintptr_t>(x.data()) % PIE_ALIGN) == 0) && ((reinterpret_cast<uintptr_t>(y.data()) % PIE_ALIGN) == 0))
+			return dot_q_pie(x.data(), y.data(), n, shift);
+#endif
+		return saturate_shift(dot<MISC_KERNEL_UNROLL, int64_t>(x, y), shift);
+	};
+
+	/**
+	 * @brief One case of the dot_q self check : count products a * b, then zeros up to size
+	 *
+	 */
+	struct DotQCase
+	{
+		int16_t a;
+		int16_t b;
+		uint16_t count;
+		uint8_t shift;
+		const char *what;
+	};
+
+	/**
+	 * @brief Check dot_q against floor(x . y / 2^shift) saturated to int32, on cases where floor, rounding and truncation
+	 * 		  toward zero differ, and on saturated results (the buffers are aligned and the size is a multiple of 8, so the
+	 * 		  PIE path is used when enabled)
+	 *
+	 * @return bool true if all cases match
+	 */
+	static bool dot_q_self_check(int16_t *c, int16_t *d)
+	{
+		static const DotQCase cases[] = {
+			{-5, 1, 4, 4, "-20 >> 4 = -2"},
+			{5, 1, 4, 4, "20 >> 4 = 1"},
+			{-3, 2, 4, 4, "-24 >> 4 = -2"},
+			{-1, 1, 1, 15, "-1 >> 15 = -1"},
+			{-32768, -32768, 16, 0, "saturated max"},
+			{-32768, 32767, 16, 0, "saturated min"},
+			{-32768, 32767, 64, 15, "64 * -32768 * 32767 >> 15"},
+		};
+		static const std::size_t size = 64;
+		bool ok = true;
+		for (const DotQCase &test : cases)
+		{
+			int64_t reference = 0;
+			for (std::size_t i = 0; i < size; ++i)
+			{
+				c[i] = (i < test.count) ? test.a : 0;
+				d[i] = (i < test.count) ? test.b : 0;
+				reference += static_cast<int64_t>(c[i]) * d[i];
+			}
+			const int32_t result = dot_q(std::span<const int16_t>(c, size), std::span<const int16_t>(d, size), test.shift);
+			const int32_t expected = saturate_shift(reference, test.shift);
+			if (result != expected)
+			{
+				printf(" %-10s | %s : %d instead of %d MISMATCH\n", DOT_Q_NAME, test.what, (int)result, (int)expected);
+				ok = false;
+			}
+		}
+		printf(" %-10s | floor shift and saturation on %u cases : %s\n", DOT_Q_NAME, (unsigned)(sizeof(cases) / sizeof(cases[0])), ok ? "ok" : "MISMATCH");
+		return ok;
+	};
+
+	/**
+	 * @brief Measure a kernel for the unroll factors 1, 2, 4 and 8 and print one line of the table
+	 *
+	 * @param name kernel name
+	 * @param size number of elements
+	 * @param kernel kernel(std::integral_constant<std::size_t, U>) runs the kernel with unroll factor U and returns its result
+	 * @return bool true if all the unroll factors give the same result
+	 */
+	template <typename Kernel>
+	static bool bench_line(const char *name, std::size_t size, Kernel kernel)
+	{
+		decltype(kernel(std::integral_constant<std::size_t, 1>())) results[4];
+		uint32_t cycles[4];
+		cycles[0] = tick_measure([&]()
+								 { results[0] = kernel(std::integral_constant<std::size_t, 1>()); });
+		cycles[1] = tick_measure([&]()
+								 { results[1] = kernel(std::integral_constant<std::size_t, 2>()); });
+		cycles[2] = tick_measure([&]()
+								 { results[2] = kernel(std::integral_constant<std::size_t, 4>()); });
+		cycles[3] = tick_measure([&]()
+								 { results[3] = kernel(std::integral_constant<std::size_t, 8>()); });
+		const bool ok = (results[0] == results[1]) && (results[0] == results[2]) && (results[0] == results[3]);
+		printf(" %-10s | %5u | %7u | %7u | %7u | %7u | %s\n", name, (unsigned)size, (unsigned)cycles[0], (unsigned)cycles[1],
+			   (unsigned)cycles[2], (unsigned)cycles[3], ok ? "ok" : "MISMATCH");
+		return ok;
+	};
+
+	bool kernels_benchmark()
+	{
+		static const std::size_t sizes[] = {16, 64, 256, KERNELS_BENCH_MAX_SIZE};
+		int32_t *a = static_cast<int32_t *>(heap_caps_aligned_alloc(PIE_ALIGN, KERNELS_BENCH_MAX_SIZE * sizeof(int32_t), MALLOC_CAP_INTERNAL));
+		int32_t *b = static_cast<int32_t *>(heap_caps_aligned_alloc(PIE_ALIGN, KERNELS_BENCH_MAX_SIZE * sizeof(int32_t), MALLOC_CAP_INTERNAL));
+		int16_t *c = static_cast<int16_t *>(heap_caps_aligned_alloc(PIE_ALIGN, KERNELS_BENCH_MAX_SIZE * sizeof(int16_t), MALLOC_CAP_INTERNAL));
+		int16_t *d = static_cast<int16_t *>(heap_caps_aligned_alloc(PIE_ALIGN, KERNELS_BENCH_MAX_SIZE * sizeof(int16_t), MALLOC_CAP_INTERNAL));
+		if ((a == nullptr) || (b == nullptr) || (c == nullptr) || (d == nullptr))
+		{
+			ESP_LOGE(KERNELS_TAG, "Not enough memory for the benchmark");
+			heap_caps_free(a);
+			heap_caps_free(b);
+			heap_caps_free(c);
+			heap_caps_free(d);
+			return false;
+		}
+		uint32_t seed = 0x12345678;
+		for (std::size_t i = 0; i < KERNELS_BENCH_MAX_SIZE; ++i)
+		{
+			seed = seed * 1664525 + 1013904223; // LCG
+			a[i] = static_cast<int32_t>(seed >> 8) - (1 << 23);
+		}
+		bool ok = dot_q_self_check(c, d); // before the random inputs, it overwrites the int16 buffers
+		for (std::size_t i = 0; i < KERNELS_BENCH_MAX_SIZE; ++i)
+		{
+			seed = seed * 1664525 + 1013904223;
+			c[i] = static_cast<int16_t>(seed >> 16);
+			d[i] = static_cast<int16_t>(seed);
+		}
+
+		printf(" kernel     |  size |    U=1  |    U=2  |    U=4  |    U=8  | (cycles)\n");
+		printf("------------|-------|---------|---------|---------|---------|---------\n");
+		for (std::size_t size : sizes)
+		{
+			std::span<const int32_t> x(a, size);
+			std::span<int32_t> out(b, size);
+			ok &= bench_line("sum", size, [&](auto u)
+							 { return sum<decltype(u)::value, int64_t>(x); });
+			ok &= bench_line("dot", size, [&](auto u)
+							 { return dot<decltype(u)::value, int64_t>(x, x); });
+			ok &= bench_line("min_index", size, [&](auto u)
+							 { return min_index<decltype(u)::value>(x).index; });
+			ok &= bench_line("max_index", size, [&](auto u)
+							 { return max_index<decltype(u)::value>(x).index; });
+			ok &= bench_line("clamp", size, [&](auto u)
+							 { clamp<decltype(u)::value>(x, out, -1000, 1000); return sum<1, int64_t>(out); });
+			ok &= bench_line("prefix_sum", size, [&](auto u)
+							 { return prefix_sum<decltype(u)::value>(x, out); });
+
+			std::span<const int16_t> xq(c, size), yq(d, size);
+			int64_t reference = 0;
+			for (std::size_t i = 0; i < size; ++i)
+				reference += static_cast<int64_t>(c[i]) * d[i];
+			int32_t result = 0;
+			const uint32_t cycles = tick_measure([&]()
+												 { result = dot_q(xq, yq, 15); });
+			const bool dot_q_ok = (result == saturate_shift(reference, 15));
+			ok &= dot_q_ok;
+			printf(" %-10s | %5u | %7u | %s\n", DOT_Q_NAME, (unsigned)size, (unsigned)cycles, dot_q_ok ? "ok" : "MISMATCH");
+		}
+		heap_caps_free(a);
+		heap_caps_free(b);
+		heap_caps_free(c);
+		heap_caps_free(d);
+		return ok;
+	};
+};
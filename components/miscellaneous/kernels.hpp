@@ -0,0 +1,248 @@
+/**
+ * @file kernels.hpp
+ * @brief Numeric kernels over spans : sum, dot, min/max with index, clamp and prefix sum
+ * @details Each kernel takes the unroll factor U as first template parameter : U independent accumulators break the
+ * 			dependency chain of the loop (the in-order Xtensa pipeline gains from it) and the plain loops stay auto-vectorizable
+ * 			for the host build. The int16 dot product also has a PIE path on ESP32-S3 (see dot_q).
+ * @version 0.1
+ *
+ */
+#ifndef KERNELS_HPP__
+#define KERNELS_HPP__
+#include "sdkconfig.h"
+#include <cstdint>
+#include <cstddef>
+#include <span>
+#include <algorithm>
+#include <type_traits>
+
+#include "miscellaneous.hpp"
+
+#define MISC_KERNEL_UNROLL 4 ///< default unroll factor of the kernels
+
+namespace misc
+{
+	namespace
+	{
+		template <typename Acc, typename T>
+		using _kernel_acc_t = std::conditional_t<std::is_void_v<Acc>, std::remove_cv_t<T>, Acc>;
+	};
+
+	/**
+	 * @brief Value and index of an element
+	 *
+	 * @tparam T
+	 */
+	template <typename T>
+	struct IndexedValue
+	{
+		T value;
+		std::size_t index; ///< size of the span if the span is empty
+	};
+
+	/**
+	 * @brief Sum of the elements
+	 *
+	 * @tparam U unroll factor (number of accumulators)
+	 * @tparam Acc accumulator type (element type by default)
+	 * @param x elements
+	 * @return accumulator
+	 */
+	template <std::size_t U = MISC_KERNEL_UNROLL, typename Acc = void, typename T, std::size_t E>
+	inline OPTIMIZE_SPEED_O3 _kernel_acc_t<Acc, T> sum(std::span<T, E> x)
+	{
+		using acc_t = _kernel_acc_t<Acc, T>;
+		const T *__restrict p = x.data();
+		const std::size_t n = x.size();
+		acc_t acc[U] = {};
+		std::size_t i = 0;
+		for (; i + U <= n; i += U)
+			unroll<U>([&](std::size_t j)
+					  { acc[j] += static_cast<acc_t>(p[i + j]); });
+		for (; i < n; ++i)
+			acc[0] += static_cast<acc_t>(p[i]);
+		unroll<U>([&](std::size_t j)
+				  { if (j > 0) acc[0] += acc[j]; });
+		return acc[0];
+	};
+
+	/**
+	 * @brief Dot product, on the common length of the two spans
+	 *
+	 * @tparam U unroll factor (number of accumulators)
+	 * @tparam Acc accumulator type (element type by default, take a wider type for integers)
+	 * @param x
+	 * @param y
+	 * @return accumulator
+	 */
+	template <std::size_t U = MISC_KERNEL_UNROLL, typename Acc = void, typename T, std::size_t E1, std::size_t E2>
+	inline OPTIMIZE_SPEED_O3 _kernel_acc_t<Acc, T> dot(std::span<T, E1> x, std::span<T, E2> y)
+	{
+		using acc_t = _kernel_acc_t<Acc, T>;
+		const T *__restrict px = x.data();
+		const T *__restrict py = y.data();
+		const std::size_t n = std::min(x.size(), y.size());
+		acc_t acc[U] = {};
+		std::size_t i = 0;
+		for (; i + U <= n; i += U)
+			unroll<U>([&](std::size_t j)
+					  { acc[j] += static_cast<acc_t>(px[i + j]) * static_cast<acc_t>(py[i + j]); });
+		for (; i < n; ++i)
+			acc[0] += static_cast<acc_t>(px[i]) * static_cast<acc_t>(py[i]);
+		unroll<U>([&](std::size_t j)
+				  { if (j > 0) acc[0] += acc[j]; });
+		return acc[0];
+	};
+
+	/**
+	 * @brief First element that is not "better" than any other (shared by min_index and max_index)
+	 *
+	 * @tparam U unroll factor (number of lanes)
+	 * @param x elements
+	 * @param better better(a, b) is true if a has to replace b
+	 * @return IndexedValue lowest index on ties
+	 */
+	template <std::size_t U, typename T, std::size_t E, typename cmp_function>
+	inline OPTIMIZE_SPEED_O3 IndexedValue<std::remove_cv_t<T>> generalized_cmp_index(std::span<T, E> x, cmp_function better)
+	{
+		using value_t = std::remove_cv_t<T>;
+		const std::size_t n = x.size();
+		if (n == 0)
+			return {value_t(), 0};
+		const T *__restrict p = x.data();
+		value_t best[U];
+		std::size_t index[U];
+		unroll<U>([&](std::size_t j)
+				  { best[j] = p[0]; index[j] = 0; });
+		std::size_t i = 0;
+		for (; i + U <= n; i += U)
+			unroll<U>([&](std::size_t j)
+					  {
+						  if (better(p[i + j], best[j]))
+						  {
+							  best[j] = p[i + j];
+							  index[j] = i + j;
+						  } });
+		for (; i < n; ++i)
+			if (better(p[i], best[0]))
+			{
+				best[0] = p[i];
+				index[0] = i;
+			}
+		IndexedValue<value_t> result{best[0], index[0]};
+		unroll<U>([&](std::size_t j)
+				  {
+					  if ((j > 0) && (better(best[j], result.value) || (!better(result.value, best[j]) && (index[j] < result.index))))
+						  result = {best[j], index[j]}; });
+		return result;
+	};
+
+	/**
+	 * @brief Minimum and its index (first one on ties)
+	 *
+	 * @tparam U unroll factor
+	 * @param x elements
+	 * @return IndexedValue
+	 */
+	template <std::size_t U = MISC_KERNEL_UNROLL, typename T, std::size_t E>
+	inline IndexedValue<std::remove_cv_t<T>> min_index(std::span<T, E> x)
+	{
+		return generalized_cmp_index<U>(x, misc::_default_cmp_less<std::remove_cv_t<T>, std::remove_cv_t<T>>);
+	};
+
+	/**
+	 * @brief Maximum and its index (first one on ties)
+	 *
+	 * @tparam U unroll factor
+	 * @param x elements
+	 * @return IndexedValue
+	 */
+	template <std::size_t U = MISC_KERNEL_UNROLL, typename T, std::size_t E>
+	inline IndexedValue<std::remove_cv_t<T>> max_index(std::span<T, E> x)
+	{
+		return generalized_cmp_index<U>(x, misc::_default_cmp_grtr<std::remove_cv_t<T>, std::remove_cv_t<T>>);
+	};
+
+	/**
+	 * @brief Clamp the elements in [min, max], on the common length of the two spans (in and out can be the same span)
+	 * 		  If (min > max) -> undefined behaviour
+	 *
+	 * @tparam U unroll factor
+	 * @param in elements
+	 * @param out clamped elements
+	 * @param min minimum bound
+	 * @param max maximum bound
+	 */
+	template <std::size_t U = MISC_KERNEL_UNROLL, typename T, std::size_t E1, typename V, std::size_t E2>
+	inline OPTIMIZE_SPEED_O3 void clamp(std::span<T, E1> in, std::span<V, E2> out, const V min, const V max)
+	{
+		static_assert(std::is_same_v<std::remove_cv_t<T>, V>, "in and out must have the same element type");
+		const std::size_t n = std::min(in.size(), out.size());
+		const T *p = in.data();
+		V *q = out.data();
+		std::size_t i = 0;
+		// min/max instead of misc::range : branchless, so the loop stays vectorizable
+		for (; i + U <= n; i += U)
+			unroll<U>([&](std::size_t j)
+					  { q[i + j] = std::min(std::max(static_cast<V>(p[i + j]), min), max); });
+		for (; i < n; ++i)
+			q[i] = std::min(std::max(static_cast<V>(p[i]), min), max);
+	};
+
+	/**
+	 * @brief Inclusive prefix sum, on the common length of the two spans (in and out can be the same span)
+	 *
+	 * @tparam U unroll factor
+	 * @param in elements
+	 * @param out out[i] = in[0] + ... + in[i]
+	 * @return V total sum
+	 */
+	template <std::size_t U = MISC_KERNEL_UNROLL, typename T, std::size_t E1, typename V, std::size_t E2>
+	inline OPTIMIZE_SPEED_O3 V prefix_sum(std::span<T, E1> in, std::span<V, E2> out)
+	{
+		const std::size_t n = std::min(in.size(), out.size());
+		const T *p = in.data();
+		V *q = out.data();
+		V running = V(0);
+		std::size_t i = 0;
+		for (; i + U <= n; i += U)
+		{
+			// the block is loaded before being written back, so in place scans are fine
+			V block[U];
+			unroll<U>([&](std::size_t j)
+					  { block[j] = static_cast<V>(p[i + j]); });
+			unroll<U>([&](std::size_t j)
+					  { running += block[j]; q[i + j] = running; });
+		}
+		for (; i < n; ++i)
+		{
+			running += static_cast<V>(p[i]);
+			q[i] = running;
+		}
+		return running;
+	};
+
+	/**
+	 * @brief Fixed point dot product of int16 : saturate((x . y) >> shift) on int32
+	 * @details The shift is arithmetic on both paths : the result is rounded toward minus infinity (-20 >> 4 is -2), then
+	 * 			saturated to int32. With CONFIG_MISC_KERNELS_PIE on ESP32-S3, the products go through the 128 bits PIE unit when both spans are 16 bytes
+	 * 			aligned and the length is a multiple of 8, they are accumulated on 40 bits (exact while |x . y| < 2^39).
+	 * 			The PIE path uses the coprocessor, so it must not be called from an ISR.
+	 *
+	 * @param x
+	 * @param y
+	 * @param shift right shift of the result (15 for Q15 inputs)
+	 * @return int32_t
+	 */
+	int32_t dot_q(std::span<const int16_t> x, std::span<const int16_t> y, uint8_t shift);
+
+	/**
+	 * @brief Print a table of the cycles of each kernel for several sizes and unroll factors, and check the results against the
+	 * 		  non unrolled version, and dot_q against the exact floor shift (negative and saturated cases)
+	 *
+	 * @return bool true if all results match
+	 */
+	bool kernels_benchmark();
+};
+
+#endif /*KERNELS_HPP__*/
@@ -14,6 +14,10 @@
 #include <xtensa/hal.h>
 #include <esp_log.h>
 
+#if CONFIG_MISC_DEFERRED_LOG
+#include "deferred_log.hpp"
+#endif
+
 #include <functional>
 #include <utility>
 #include <iterator>
@@ -450,22 +454,22 @@ namespace misc
 				unroll<N>([&](size_t i)
 						  { fn(it[i]); });
 		for (; it < end; ++it)
-			fn(*begin);
+			fn(*it);
 		return it;
 	};
 #else
 	template <std::size_t N, typename RandomIt, typename UnaryFunction>
 	inline OPTIMIZE_SPEED_O3 RandomIt unroll_for_each(RandomIt begin, RandomIt end, UnaryFunction fn)
 	{
-		static_assert(std::is_same_v<std::iterator_traits<RandomIt>::iterator_category, std::random_access_iterator_tag>); // check that RandomIt is a random access iterator
-		static_assert(std::is_invocable_v<UnaryFunction, RandomIt>);
+		static_assert(std::is_same_v<typename std::iterator_traits<RandomIt>::iterator_category, std::random_access_iterator_tag>); // check that RandomIt is a random access iterator
+		static_assert(std::is_invocable_v<UnaryFunction, decltype(*begin)>);
 		RandomIt &it = begin;
 		if constexpr (N > 1)
 			for (; it + N <= end; it += N)
 				unroll<N>([&](size_t i)
 						  { fn(it[i]); });
 		for (; it < end; ++it)
-			fn(*begin);
+			fn(*it);
 		return it;
 	};
 #endif
@@ -552,19 +556,21 @@ namespace misc
 	//	return begin;
 	//}
 	//#endif
+	/**
+	 * @brief Measure the number of cycles of a function
+	 * @details The cycle counter wraps around, the unsigned difference is right as long as the function lasts less than 2^32 cycles
+	 *
+	 * @param fnct function to measure
+	 * @return uint32_t number of cycles
+	 */
 	template <typename Function>
-	inline FORCE_INLINE auto tick_measure(Function fnct)
+	inline FORCE_INLINE uint32_t tick_measure(Function fnct)
 	{
 		static_assert((std::is_invocable_v<Function>)&&(std::is_same_v<std::invoke_result_t<Function>, void>));
-		volatile auto counter_begin = xthal_get_ccount();
+		volatile uint32_t counter_begin = xthal_get_ccount();
 		fnct(); // actual function to launch
-		volatile auto counter_end = xthal_get_ccount();
-		auto temp = counter_end - counter_begin;
-		if (unlikely(counter_end < counter_begin))
-		{
-			temp = UINT32_MAX - temp;
-		}
-		return temp;
+		volatile uint32_t counter_end = xthal_get_ccount();
+		return counter_end - counter_begin;
 	};
 };
 
@@ -591,6 +597,16 @@ void esp_log_buffer_hexdump(const char *tag, const char *buffer, uint16_t buff_l
  * @param buff_len length in byte
  * @param log_level level to print to the console
  */
+#if CONFIG_MISC_DEFERRED_LOG
+#define ESP_LOG_BUFFER_HEX_SAFE(tag, buffer, buff_len, log_level)     \
+	do                                                                \
+	{                                                                 \
+		if (_ESP_LOG_EARLY_ENABLED(log_level))                        \
+		{                                                             \
+			misc::deferred_log_hex(log_level, tag, buffer, buff_len); \
+		}                                                             \
+	} while (0)
+#else // !CONFIG_MISC_DEFERRED_LOG
 #define ESP_LOG_BUFFER_HEX_SAFE(tag, buffer, buff_len, log_level) \
 	do                                                            \
 	{                                                             \
@@ -599,6 +615,7 @@ void esp_log_buffer_hexdump(const char *tag, const char *buffer, uint16_t buff_l
 			esp_log_buffer_hexdump(tag, buffer, buff_len);        \
 		}                                                         \
 	} while (0)
+#endif // !CONFIG_MISC_DEFERRED_LOG
 
 #if defined(__cplusplus) && (__cplusplus > 201703L)
 #define ESP_LOGE_SAFE(tag, format, ...) ESP_DRAM_LOG_IMPL_SAFE(tag, format, ESP_LOG_ERROR, E __VA_OPT__(, ) __VA_ARGS__)
@@ -617,7 +634,28 @@ void esp_log_buffer_hexdump(const char *tag, const char *buffer, uint16_t buff_l
 /** @cond */
 #define _ESP_LOG_DRAM_LOG_FORMAT_SAFE(letter, format) LOG_FORMAT_ISR_SAFE(format)
 
+#if CONFIG_MISC_DEFERRED_LOG
+// Only a binary record is stored, the drain task formats it (see deferred_log.hpp)
 #if defined(__cplusplus) && (__cplusplus > 201703L)
+#define ESP_DRAM_LOG_IMPL_SAFE(tag, format, log_level, log_tag_letter, ...)        \
+	do                                                                             \
+	{                                                                              \
+		if (_ESP_LOG_EARLY_ENABLED(log_level))                                     \
+		{                                                                          \
+			misc::deferred_log(log_level, tag, format __VA_OPT__(, ) __VA_ARGS__); \
+		}                                                                          \
+	} while (0)
+#else // !(defined(__cplusplus) && (__cplusplus >  201703L))
+#define ESP_DRAM_LOG_IMPL_SAFE(tag, format, log_level, log_tag_letter, ...) \
+	do                                                                      \
+	{                                                                       \
+		if (_ESP_LOG_EARLY_ENABLED(log_level))                              \
+		{                                                                   \
+			misc::deferred_log(log_level, tag, format, ##__VA_ARGS__);      \
+		}                                                                   \
+	} while (0)
+#endif // !(defined(__cplusplus) && (__cplusplus >  201703L))
+#elif defined(__cplusplus) && (__cplusplus > 201703L)
 #define ESP_DRAM_LOG_IMPL_SAFE(tag, format, log_level, log_tag_letter, ...)                                        \
 	do                                                                                                             \
 	{                                                                                                              \
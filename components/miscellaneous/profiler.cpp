@@ -0,0 +1,167 @@
+#include "sdkconfig.h"
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <esp_attr.h>
+#include <esp_log.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#if CONFIG_WTASK_PARTITION
+#include "WPartition.hpp"
+#endif
+
+#include "profiler.hpp"
+
+namespace
+{
+	static const char *TAG = "PROFILER";
+
+	DRAM_ATTR misc::ProfileStats stats_table[portNUM_PROCESSORS][CONFIG_MISC_PROFILER_MAX_ZONES];
+	std::atomic<const char *> zone_names[CONFIG_MISC_PROFILER_MAX_ZONES]; ///< nullptr until the zone is published
+	std::atomic<uint16_t> zone_count{0};								   ///< reserved zones
+	std::atomic<uint32_t> overflow{0};
+};
+
+namespace misc
+{
+	ProfileZoneId IRAM_ATTR profiler_register(const char *name)
+	{
+		uint16_t id = zone_count.load(std::memory_order_relaxed);
+		do
+		{
+			if (id >= CONFIG_MISC_PROFILER_MAX_ZONES)
+			{
+				overflow.fetch_add(1, std::memory_order_relaxed); // reported by profiler_dump, no log from an ISR
+				return profile_zone_invalid;
+			}
+		} while (!zone_count.compare_exchange_weak(id, id + 1, std::memory_order_relaxed));
+		for (int core = 0; core < portNUM_PROCESSORS; ++core)
+			stats_table[core][id].min = UINT32_MAX;
+		zone_names[id].store(name, std::memory_order_release); // publish
+		return id;
+	};
+
+	ProfileZoneId IRAM_ATTR ProfileZone::first_use(ProfileZoneId current)
+	{
+		if ((current != profile_zone_unregistered) ||
+			!zone_id.compare_exchange_strong(current, profile_zone_registering, std::memory_order_acquire))
+			return profile_zone_invalid; // registered by another caller, or refused
+		const ProfileZoneId id = profiler_register(name);
+		zone_id.store(id, std::memory_order_release);
+		return id;
+	};
+
+	void IRAM_ATTR profiler_record(ProfileZoneId id, int core, uint32_t cycles)
+	{
+		if (id >= CONFIG_MISC_PROFILER_MAX_ZONES)
+			return;
+		const int current = xPortGetCoreID();
+		if (core != current)
+		{
+			// cycle counters of the cores are not synchronized, counted in the table of the current core : one writer per table
+			++stats_table[current][id].migrated;
+			return;
+		}
+		ProfileStats &stats = stats_table[core][id];
+		++stats.count;
+		stats.total += cycles;
+		if (cycles < stats.min)
+			stats.min = cycles;
+		if (cycles > stats.max)
+			stats.max = cycles;
+		const int bin = (cycles < 32) ? 0 : 31 - __builtin_clz(cycles) - 4;
+		++stats.histogram[(bin < MISC_PROFILER_HISTOGRAM_BINS) ? bin : MISC_PROFILER_HISTOGRAM_BINS - 1];
+	};
+
+	bool profiler_get(ProfileZoneId id, int core, ProfileStats &stats)
+	{
+		if ((id >= CONFIG_MISC_PROFILER_MAX_ZONES) || (nullptr == zone_names[id].load(std::memory_order_acquire)) || (core < 0) ||
+			(core >= portNUM_PROCESSORS))
+			return false;
+		stats = stats_table[core][id]; // may mix two measures, fine for statistics
+		return true;
+	};
+
+	const char *profiler_name(ProfileZoneId id)
+	{
+		return (id < CONFIG_MISC_PROFILER_MAX_ZONES) ? zone_names[id].load(std::memory_order_acquire) : nullptr;
+	};
+
+	size_t profiler_zone_count()
+	{
+		return zone_count.load(std::memory_order_acquire);
+	};
+
+	uint32_t profiler_overflow()
+	{
+		return overflow.load(std::memory_order_relaxed);
+	};
+
+	void profiler_reset()
+	{
+		const uint16_t count = zone_count.load(std::memory_order_acquire);
+		for (int core = 0; core < portNUM_PROCESSORS; ++core)
+			for (uint16_t id = 0; id < count; ++id)
+			{
+				memset(&stats_table[core][id], 0, sizeof(ProfileStats));
+				stats_table[core][id].min = UINT32_MAX;
+			}
+	};
+
+	void profiler_dump()
+	{
+		const uint16_t count = zone_count.load(std::memory_order_acquire);
+		for (uint16_t id = 0; id < count; ++id)
+			for (int core = 0; core < portNUM_PROCESSORS; ++core)
+			{
+				ProfileStats stats;
+				if (!profiler_get(id, core, stats) || ((stats.count == 0) && (stats.migrated == 0)))
+					continue;
+				if (stats.count == 0)
+				{
+					ESP_LOGI(TAG, "%s@%d: n=0 migrated=%u", profiler_name(id), core, (unsigned)stats.migrated);
+					continue;
+				}
+				ESP_LOGI(TAG, "%s@%d: n=%u min=%u max=%u mean=%u migrated=%u", profiler_name(id), core, (unsigned)stats.count, (unsigned)stats.min,
+						 (unsigned)stats.max, (unsigned)(stats.total / stats.count), (unsigned)stats.migrated);
+				// non-empty bins as "lowest cycles:count", the first bin also holds the shorter scopes
+				char bins[MISC_PROFILER_HISTOGRAM_BINS * 20];
+				size_t used = 0;
+				for (int bin = 0; (bin < MISC_PROFILER_HISTOGRAM_BINS) && (used < sizeof(bins)); ++bin)
+					if (stats.histogram[bin] > 0)
+						used += snprintf(bins + used, sizeof(bins) - used, " %s%u:%u", (bin == 0) ? "<" : ">=",
+										 (unsigned)(1u << (bin + ((bin == 0) ? 5 : 4))), (unsigned)stats.histogram[bin]);
+				ESP_LOGI(TAG, "%s@%d: cycles%s", profiler_name(id), core, bins);
+			}
+		if (overflow.load(std::memory_order_relaxed) > 0)
+			ESP_LOGE(TAG, "Too many zones, %u registrations refused (CONFIG_MISC_PROFILER_MAX_ZONES =%u)", (unsigned)overflow.load(std::memory_order_relaxed),
+					 (unsigned)CONFIG_MISC_PROFILER_MAX_ZONES);
+	};
+
+	BaseType_t profiler_start_dump(uint32_t period_ms, UBaseType_t priority)
+	{
+		static uint32_t period;
+		period = period_ms;
+		BaseType_t core = tskNO_AFFINITY;
+#if CONFIG_WTASK_PARTITION
+		// the dump formats every zone : never on the real-time core
+		if (!WPartition::place("ProfDump", core, priority, TASK_BEST_EFFORT))
+			return pdFAIL;
+#endif
+		TaskHandle_t handle = nullptr;
+		const BaseType_t created = xTaskCreatePinnedToCore([](void *arg)
+														   {
+															   const TickType_t delay = pdMS_TO_TICKS(*static_cast<uint32_t *>(arg));
+															   for (;;)
+															   {
+																   vTaskDelay((delay > 0) ? delay : 1);
+																   profiler_dump();
+															   } },
+														   "ProfDump", 3072, &period, priority, &handle, core);
+#if CONFIG_WTASK_PARTITION
+		if (created == pdPASS)
+			WPartition::registerTask(handle, core, TASK_BEST_EFFORT);
+#endif
+		return created;
+	};
+};
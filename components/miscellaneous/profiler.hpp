@@ -0,0 +1,177 @@
+/**
+ * @file profiler.hpp
+ * @brief Cycle accurate scoped profiler : named zones, RAII scope guards and per core statistics
+ * @version 0.1
+ *
+ */
+#ifndef PROFILER_HPP__
+#define PROFILER_HPP__
+#include "sdkconfig.h"
+#include <xtensa/hal.h>
+#include <freertos/FreeRTOS.h>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+#ifndef CONFIG_MISC_PROFILER_MAX_ZONES
+#define CONFIG_MISC_PROFILER_MAX_ZONES 32
+#endif
+#define MISC_PROFILER_HISTOGRAM_BINS 16 ///< Bin i counts durations in [2^(i+4), 2^(i+5)) cycles, first and last bins are open
+
+namespace misc
+{
+	using ProfileZoneId = uint16_t;
+	static constexpr ProfileZoneId profile_zone_invalid = UINT16_MAX;
+	static constexpr ProfileZoneId profile_zone_unregistered = UINT16_MAX - 1;
+	static constexpr ProfileZoneId profile_zone_registering = UINT16_MAX - 2;
+
+	/**
+	 * @brief Statistics of a zone on one core (cycles)
+	 *
+	 */
+	struct ProfileStats
+	{
+		uint32_t count;
+		uint32_t min;
+		uint32_t max;
+		uint64_t total; ///< mean is total / count
+		uint32_t migrated; ///< scopes started on another core that ended on this one (not measured)
+		uint32_t histogram[MISC_PROFILER_HISTOGRAM_BINS];
+	};
+
+	/**
+	 * @brief Register a zone (the name must be a literal)
+	 * @details Lock free and ISR safe : the slot is reserved, then its name is published, the readers skip the slots
+	 * 			reserved but not published yet. A full table is counted by profiler_overflow, not logged.
+	 *
+	 * @return ProfileZoneId profile_zone_invalid if the table is full
+	 */
+	ProfileZoneId profiler_register(const char *name);
+
+	/**
+	 * @brief Zone registered on first use : constant initialized, so a function-local static has no guard and can be
+	 * 			used from an ISR
+	 *
+	 */
+	class ProfileZone
+	{
+	private:
+		const char *name;
+		std::atomic<ProfileZoneId> zone_id;
+
+	public:
+		constexpr explicit ProfileZone(const char *zone_name) : name(zone_name), zone_id(profile_zone_unregistered) {};
+
+		/**
+		 * @brief Id of the zone, registered by the first caller (the concurrent first callers get profile_zone_invalid
+		 * 		  and are not measured)
+		 *
+		 */
+		inline __attribute__((always_inline)) ProfileZoneId id()
+		{
+			const ProfileZoneId current = zone_id.load(std::memory_order_acquire);
+			return (current < profile_zone_registering) ? current : first_use(current);
+		};
+
+	private:
+		ProfileZoneId first_use(ProfileZoneId current);
+	};
+
+	/**
+	 * @brief Record a measure of a zone on the current core
+	 * @details Lock free : each core has its own table, a zone should not be used by a task and an ISR of the same core
+	 *
+	 */
+	void profiler_record(ProfileZoneId id, int core, uint32_t cycles);
+
+	/**
+	 * @brief Copy the statistics of a zone on a core
+	 *
+	 * @return false if the zone does not exist
+	 */
+	bool profiler_get(ProfileZoneId id, int core, ProfileStats &stats);
+
+	/**
+	 * @brief Name of a zone
+	 *
+	 */
+	const char *profiler_name(ProfileZoneId id);
+
+	/**
+	 * @brief Number of reserved zones (a zone being registered has no name yet)
+	 *
+	 */
+	size_t profiler_zone_count();
+
+	/**
+	 * @brief Number of registrations refused because the table was full
+	 *
+	 */
+	uint32_t profiler_overflow();
+
+	/**
+	 * @brief Reset the statistics of all zones
+	 *
+	 */
+	void profiler_reset();
+
+	/**
+	 * @brief Print the statistics of all zones
+	 *
+	 */
+	void profiler_dump();
+
+	/**
+	 * @brief Start a task that prints the statistics periodically
+	 * @details With CONFIG_WTASK_PARTITION the task runs on the best effort core.
+	 *
+	 * @param period_ms dump period
+	 * @param priority task priority, below CONFIG_WTASK_PARTITION_RT_MIN_PRIORITY with the partition
+	 * @return BaseType_t pdPASS on success
+	 */
+	BaseType_t profiler_start_dump(uint32_t period_ms = 10000, UBaseType_t priority = 1);
+
+	/**
+	 * @brief RAII guard measuring the cycles between its construction and its destruction
+	 *
+	 */
+	class ProfileScope
+	{
+	private:
+		uint32_t begin;
+		ProfileZoneId id;
+		int core;
+
+	public:
+		inline __attribute__((always_inline)) explicit ProfileScope(ProfileZoneId zone) : id(zone), core(xPortGetCoreID())
+		{
+			begin = xthal_get_ccount();
+		};
+		inline __attribute__((always_inline)) ~ProfileScope()
+		{
+			const uint32_t cycles = xthal_get_ccount() - begin; // unsigned difference handles the wrap around
+			profiler_record(id, core, cycles);
+		};
+		ProfileScope(const ProfileScope &) = delete;
+		ProfileScope &operator=(const ProfileScope &) = delete;
+	};
+};
+
+#define MISC_PROFILE_CONCAT_(a, b) a##b
+#define MISC_PROFILE_CONCAT(a, b) MISC_PROFILE_CONCAT_(a, b)
+
+#if CONFIG_MISC_PROFILER
+/**
+ * @brief Profile the rest of the current scope as a named zone (the zone is registered on first use, ISR safe)
+ */
+#define MISC_PROFILE_ZONE(name)                                                                            \
+	static constinit misc::ProfileZone MISC_PROFILE_CONCAT(misc_profile_zone_, __LINE__){name};            \
+	misc::ProfileScope MISC_PROFILE_CONCAT(misc_profile_scope_, __LINE__)(MISC_PROFILE_CONCAT(misc_profile_zone_, __LINE__).id())
+#else
+#define MISC_PROFILE_ZONE(name) \
+	do                          \
+	{                           \
+	} while (0)
+#endif
+
+#endif /*PROFILER_HPP__*/
@@ -2,12 +2,16 @@
 #include "freertos/FreeRTOS.h"
 #include "semaphore.h"
 #include "driver/gpio.h"
+#include "ultrasound_gpio.h"
 #include "esp_log.h"
 #include "esp_timer.h"
+#include "esp_cpu.h"
+#include "WRecord.h"
 #include <stdio.h>
 #include <string.h>
 
-#define VELOCITY_SOUND_MM_PER_MS 343u //< 343 mm per milliseconds (sound velocity)
+#define ULTRASOUND_HISTORY_MASK (ULTRASOUND_HISTORY_LENGTH - 1u)
+_Static_assert((ULTRASOUND_HISTORY_LENGTH & ULTRASOUND_HISTORY_MASK) == 0, "ULTRASOUND_HISTORY_LENGTH must be a power of 2");
 
 /**
  * @brief Ultrasound sensor state machine
@@ -33,15 +37,39 @@ typedef struct Ultrasound_t
     gpio_num_t gpio_trig_pin;                 //< GPIO Trigger pin number
     gpio_num_t gpio_echo_pin;                 //< GPIO Echo pin number
     esp_timer_handle_t timer;                 // Timer handle
-    uint64_t measurement_period_us;           //< Measurement period us
+    volatile uint32_t measurement_period_us;  //< Measurement period us (single word, can be changed while running)
     uint64_t trig_signal_duration_us;         //< Trigger signal duration
     int64_t time_trig_start;                  //< Time of trig rising edge
     int64_t time_trig_end;                    //< Time of trig falling edge
     int64_t time_echo_start;                  //< Time of echo rising edge
     int64_t time_echo_end;                    //< Time of echo falling edge
-    uint8_t error_count;                      //< Measure failed counter
+    Ultrasound_Diagnostics_t diagnostics;     //< Counters : single writer each (see ultrasound_outcome for the window and health)
+    uint32_t success_window_count;            //< Number of outcomes in success_window (up to ULTRASOUND_SUCCESS_WINDOW)
+    portMUX_TYPE outcome_lock;                //< Serializes the outcomes of the echo ISR and of the esp_timer task
+    uint8_t degraded_success_percent;         //< Health threshold (0 disables)
+    Ultrasound_HealthCallback_t health_callback; //< Health change callback
+    const Ultrasound_CaptureHal_t *capture;   //< Capture backend (NULL for GPIO ISR)
+    void *capture_ctx;                        //< Capture backend context
+    uint32_t capture_resolution_hz;           //< Capture backend tick frequency (1 MHz for GPIO ISR)
+    volatile uint32_t sound_coef;             //< Echo ticks to mm (see Ultrasound_SoundCoef)
+    uint64_t width_coef;                      //< Echo ticks to us (<< 32)
     Ultrasound_Measurement_t last_measure;    //< Last updated measurement
+    Ultrasound_Sample_t history[ULTRASOUND_HISTORY_LENGTH]; //< History ring (single writer)
+    volatile uint32_t history_head;           //< Number of samples ever written
+    int32_t median_fifo[ULTRASOUND_MEDIAN_WINDOW_MAX];   //< Last accepted distances, arrival order
+    int32_t median_sorted[ULTRASOUND_MEDIAN_WINDOW_MAX]; //< Last accepted distances, sorted
+    uint8_t median_window;                    //< Median window size
+    uint8_t median_count;                     //< Number of distances in the window
+    uint8_t median_oldest;                    //< Index of the oldest distance in median_fifo
+    uint8_t spike_count;                      //< Consecutive rejected spikes
+    uint32_t spike_threshold_mm;              //< Spike threshold (0 disables)
+    bool adaptive;                            //< Adaptive period enabled
+    uint32_t ring_down_us;                    //< Minimum time between echo end and next trigger
+    uint32_t min_period_us;                   //< Minimum adaptive period
+    volatile uint32_t speed_mm_s;             //< Robot speed toward obstacles
+    volatile uint32_t adaptive_period_us;     //< Current adaptive period
     volatile Ultrasound_StateMachine_t state; // Current state machine state
+    portMUX_TYPE state_lock;                  //< Serializes the moves out of INIT (Ultrasound_Stop) with the timer starts
     Ultrasound_Callback_t callback;           //< Onread callback function (called from ISR)
     void *user_data;                          //< User context
 } Ultrasound_struct_t;
@@ -49,6 +77,13 @@ typedef struct Ultrasound_t
 static const char *LOG_TAG = "ULTRA";
 static void ultrasound_gpio_isr_echo(void *args);
 static void ultrasound_periodic_job(void *args);
+static void ultrasound_capture_done(void *ctx, uint32_t pulse_ticks);
+static bool ultrasound_record(Ultrasound_Handle_t handle, int64_t timestamp_us, int32_t distance_mm, uint32_t width_us, BaseType_t *woken);
+static void ultrasound_outcome(Ultrasound_Handle_t handle, bool success);
+static void ultrasound_schedule_next(Ultrasound_Handle_t handle);
+static bool ultrasound_advance(Ultrasound_Handle_t handle, Ultrasound_StateMachine_t state, int64_t delay_us);
+
+#define ULTRASOUND_KEEP_TIMER (-1) // ultrasound_advance without timer start
 
 Ultrasound_Handle_t Ultrasound_Init(const Ultrasound_Init_t *ultrasound_init)
 {
@@ -62,24 +97,24 @@ Ultrasound_Handle_t Ultrasound_Init(const Ultrasound_Init_t *ultrasound_init)
     memset(handle, 0, sizeof(Ultrasound_struct_t)); // Sanity
     handle->callback = ultrasound_init->onRead;
     handle->user_data = ultrasound_init->user_data;
+    handle->median_window = ultrasound_init->median_window;
+    if (handle->median_window > ULTRASOUND_MEDIAN_WINDOW_MAX)
+    {
+        ESP_LOGW(LOG_TAG, "Median window clamped to %u", ULTRASOUND_MEDIAN_WINDOW_MAX);
+        handle->median_window = ULTRASOUND_MEDIAN_WINDOW_MAX;
+    }
+    else if (0 == handle->median_window)
+    {
+        handle->median_window = 1;
+    }
+    handle->spike_threshold_mm = ultrasound_init->spike_threshold_mm;
+    handle->health_callback = ultrasound_init->onHealthChange;
+    portMUX_INITIALIZE(&handle->outcome_lock);
+    portMUX_INITIALIZE(&handle->state_lock);
+    handle->degraded_success_percent = ultrasound_init->degraded_success_percent;
     // GPIO initialisation
     handle->gpio_echo_pin = ultrasound_init->gpio_echo_pin;
     handle->gpio_trig_pin = ultrasound_init->gpio_trig_pin;
-    gpio_config_t gpio_echo = (gpio_config_t){
-        .mode = GPIO_MODE_INPUT,
-        .intr_type = GPIO_INTR_DISABLE, // Disabled during initialization
-        .pin_bit_mask = 1ULL << (handle->gpio_echo_pin),
-        .pull_down_en = GPIO_PULLDOWN_DISABLE,
-        .pull_up_en = GPIO_PULLUP_DISABLE,
-    };
-
-    err = gpio_config(&gpio_echo);
-    if (ESP_OK != err)
-    {
-        ESP_LOGE(LOG_TAG, "Failed to init Echo GPIO (err =%u)", err);
-        vPortFree(handle);
-        return NULL;
-    }
     gpio_config_t gpio_trig = (gpio_config_t){
         .mode = GPIO_MODE_OUTPUT,
         .intr_type = GPIO_INTR_DISABLE,
@@ -95,30 +130,87 @@ Ultrasound_Handle_t Ultrasound_Init(const Ultrasound_Init_t *ultrasound_init)
         return NULL;
     }
 
-    // Interruption initialisation
-    gpio_intr_disable(handle->gpio_echo_pin); // Disable interrupt for now
-    err = gpio_install_isr_service(ESP_INTR_FLAG_LEVEL1);
-    if (ESP_ERR_INVALID_STATE == err)
+    switch (ultrasound_init->backend)
     {
-        ESP_LOGW(LOG_TAG, "GPIO ISR service already installed");
+    case ULTRASOUND_BACKEND_MCPWM_CAPTURE:
+        handle->capture = &Ultrasound_CaptureHal_Mcpwm;
+        break;
+    case ULTRASOUND_BACKEND_CUSTOM:
+        handle->capture = ultrasound_init->capture_hal;
+        if (NULL == handle->capture)
+        {
+            ESP_LOGE(LOG_TAG, "Custom backend without capture HAL");
+            vPortFree(handle);
+            return NULL;
+        }
+        break;
+    default:
+        handle->capture = NULL;
+        break;
     }
-    else if (ESP_OK != err)
+    if (NULL != handle->capture)
     {
-        ESP_LOGE(LOG_TAG, "Failed to init GPIO ISR service (err =%u)", err);
-        vPortFree(handle);
-        return NULL;
+        // Echo edges are latched by the capture peripheral, only the finished pulse is delivered
+        err = handle->capture->init(&handle->capture_ctx, handle->gpio_echo_pin, ultrasound_capture_done, handle);
+        if (ESP_OK != err)
+        {
+            ESP_LOGE(LOG_TAG, "Failed to init capture backend (err =%u)", err);
+            vPortFree(handle);
+            return NULL;
+        }
+        handle->capture->disarm(handle->capture_ctx);
+        handle->capture_resolution_hz = handle->capture->get_resolution_hz(handle->capture_ctx);
     }
-    err = gpio_isr_handler_add(ultrasound_init->gpio_echo_pin, ultrasound_gpio_isr_echo, handle);
-    if (ESP_OK != err)
+    else
     {
-        ESP_LOGE(LOG_TAG, "Failed to add callback to GPIO ISR service (err =%u)", err);
-        // TODO add interrupt uninstall
-        vPortFree(handle);
-        return NULL;
+        handle->capture_resolution_hz = 1000000; // esp_timer_get_time
+        gpio_config_t gpio_echo = (gpio_config_t){
+            .mode = GPIO_MODE_INPUT,
+            .intr_type = GPIO_INTR_DISABLE, // Disabled during initialization
+            .pin_bit_mask = 1ULL << (handle->gpio_echo_pin),
+            .pull_down_en = GPIO_PULLDOWN_DISABLE,
+            .pull_up_en = GPIO_PULLUP_DISABLE,
+        };
+
+        err = gpio_config(&gpio_echo);
+        if (ESP_OK != err)
+        {
+            ESP_LOGE(LOG_TAG, "Failed to init Echo GPIO (err =%u)", err);
+            vPortFree(handle);
+            return NULL;
+        }
+
+        // Interruption initialisation
+        ultrasound_gpio_echo_init(handle->gpio_echo_pin); // Disable interrupt for now
+        err = gpio_install_isr_service(ESP_INTR_FLAG_LEVEL1);
+        if (ESP_ERR_INVALID_STATE == err)
+        {
+            ESP_LOGW(LOG_TAG, "GPIO ISR service already installed");
+        }
+        else if (ESP_OK != err)
+        {
+            ESP_LOGE(LOG_TAG, "Failed to init GPIO ISR service (err =%u)", err);
+            vPortFree(handle);
+            return NULL;
+        }
+        err = gpio_isr_handler_add(ultrasound_init->gpio_echo_pin, ultrasound_gpio_isr_echo, handle);
+        if (ESP_OK != err)
+        {
+            ESP_LOGE(LOG_TAG, "Failed to add callback to GPIO ISR service (err =%u)", err);
+            // TODO add interrupt uninstall
+            vPortFree(handle);
+            return NULL;
+        }
     }
+    handle->sound_coef = Ultrasound_SoundCoef(ULTRASOUND_SOUND_SPEED_DEFAULT, handle->capture_resolution_hz);
+    handle->width_coef = (1000000ULL << 32) / handle->capture_resolution_hz;
     // Timer initialisation
     handle->measurement_period_us = ultrasound_init->measurement_period_ms * 1000;
     handle->trig_signal_duration_us = ultrasound_init->trig_signal_duration_us;
+    handle->adaptive = ultrasound_init->adaptive_period;
+    handle->ring_down_us = (0 != ultrasound_init->ring_down_us) ? ultrasound_init->ring_down_us : ULTRASOUND_RING_DOWN_DEFAULT_US;
+    handle->min_period_us = ultrasound_init->min_period_ms * 1000;
+    handle->adaptive_period_us = handle->measurement_period_us;
     err = esp_timer_init();
     if (ESP_ERR_INVALID_STATE == err)
     {
@@ -158,11 +250,450 @@ Ultrasound_Error_t Ultrasound_Start(Ultrasound_Handle_t handle)
     return ESP_OK;
 }
 
+Ultrasound_Error_t Ultrasound_Stop(Ultrasound_Handle_t handle)
+{
+    // echo first, then INIT : an ISR or a timer job running meanwhile on the other core can't re-arm the timer after INIT
+    if (NULL != handle->capture)
+    {
+        handle->capture->disarm(handle->capture_ctx);
+    }
+    else
+    {
+        ultrasound_gpio_echo_disable(handle->gpio_echo_pin);
+    }
+    portENTER_CRITICAL(&handle->state_lock);
+    handle->state = ULTRASOUND_STATE_INIT;
+    portEXIT_CRITICAL(&handle->state_lock);
+    esp_timer_stop(handle->timer);
+    ultrasound_gpio_set_level(handle->gpio_trig_pin, 0);
+    return ESP_OK;
+}
+
+Ultrasound_Error_t Ultrasound_Deinit(Ultrasound_Handle_t handle)
+{
+    Ultrasound_Stop(handle);
+    esp_timer_delete(handle->timer);
+    if (NULL != handle->capture)
+    {
+        handle->capture->deinit(handle->capture_ctx);
+    }
+    else
+    {
+        gpio_isr_handler_remove(handle->gpio_echo_pin);
+    }
+    heap_caps_free(handle);
+    return ESP_OK;
+}
+
+/**
+ * @brief Average cycles of a statement over iterations
+ */
+#define ULTRASOUND_BENCH(cycles, iterations, statement)              \
+    do                                                               \
+    {                                                                \
+        uint32_t begin = esp_cpu_get_cycle_count();                  \
+        for (uint32_t i = 0; i < (iterations); ++i)                  \
+        {                                                            \
+            statement;                                               \
+        }                                                            \
+        cycles = (esp_cpu_get_cycle_count() - begin) / (iterations); \
+    } while (0)
+
+Ultrasound_Error_t Ultrasound_GpioBenchmark(Ultrasound_Handle_t handle, uint32_t iterations)
+{
+    uint32_t idf_trig, idf_echo;
+    if ((ULTRASOUND_STATE_INIT != handle->state) || (0 == iterations))
+    {
+        return (0 == iterations) ? ESP_ERR_INVALID_ARG : ESP_ERR_INVALID_STATE;
+    }
+    ULTRASOUND_BENCH(idf_trig, iterations, gpio_set_level(handle->gpio_trig_pin, i & 1));
+    ULTRASOUND_BENCH(idf_echo, iterations, gpio_set_intr_type(handle->gpio_echo_pin, (i & 1) ? GPIO_INTR_NEGEDGE : GPIO_INTR_POSEDGE));
+#if CONFIG_ULTRASOUND_DIRECT_REGISTERS
+    uint32_t reg_trig, reg_echo;
+    ULTRASOUND_BENCH(reg_trig, iterations, ultrasound_gpio_set_level(handle->gpio_trig_pin, i & 1));
+    ULTRASOUND_BENCH(reg_echo, iterations, ultrasound_gpio_echo_edge(handle->gpio_echo_pin, (i & 1) ? GPIO_INTR_NEGEDGE : GPIO_INTR_POSEDGE));
+    ESP_LOGI(LOG_TAG, "Trigger edge: IDF %u cycles, registers %u cycles", (unsigned)idf_trig, (unsigned)reg_trig);
+    ESP_LOGI(LOG_TAG, "Echo edge:    IDF %u cycles, registers %u cycles", (unsigned)idf_echo, (unsigned)reg_echo);
+#else
+    ESP_LOGI(LOG_TAG, "Trigger edge: IDF %u cycles (registers disabled)", (unsigned)idf_trig);
+    ESP_LOGI(LOG_TAG, "Echo edge:    IDF %u cycles (registers disabled)", (unsigned)idf_echo);
+#endif
+    ultrasound_gpio_set_level(handle->gpio_trig_pin, 0);
+    if (NULL == handle->capture)
+    {
+        ultrasound_gpio_echo_disable(handle->gpio_echo_pin);
+    }
+    else
+    {
+        gpio_set_intr_type(handle->gpio_echo_pin, GPIO_INTR_DISABLE); // The pin is routed to the capture, no GPIO interrupt
+    }
+    return ESP_OK;
+}
+
 Ultrasound_Measurement_t Ultrasound_GetDistance(const Ultrasound_Handle_t handle)
 {
     return handle->last_measure;
 }
 
+int64_t Ultrasound_GetEchoEndTime(const Ultrasound_Handle_t handle)
+{
+    return handle->time_echo_end;
+}
+
+Ultrasound_Error_t Ultrasound_SetPeriodMs(Ultrasound_Handle_t handle, uint32_t measurement_period_ms)
+{
+    if ((measurement_period_ms > (UINT32_MAX / 1000)) || ((uint64_t)measurement_period_ms * 1000 <= handle->trig_signal_duration_us))
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    handle->measurement_period_us = measurement_period_ms * 1000; // Applied from the next trigger
+    return ESP_OK;
+}
+
+Ultrasound_Error_t Ultrasound_GetDiagnostics(const Ultrasound_Handle_t handle, Ultrasound_Diagnostics_t *diagnostics)
+{
+    const Ultrasound_Diagnostics_t *d = &handle->diagnostics;
+    diagnostics->trigger_count = __atomic_load_n(&d->trigger_count, __ATOMIC_RELAXED);
+    diagnostics->success_count = __atomic_load_n(&d->success_count, __ATOMIC_RELAXED);
+    for (uint32_t i = 0; i < ULTRASOUND_FAULT_MAX; ++i)
+    {
+        diagnostics->fault_count[i] = __atomic_load_n(&d->fault_count[i], __ATOMIC_RELAXED);
+    }
+    diagnostics->success_window = __atomic_load_n(&d->success_window, __ATOMIC_RELAXED);
+    diagnostics->success_percent = __atomic_load_n(&d->success_percent, __ATOMIC_RELAXED);
+    diagnostics->health = __atomic_load_n(&d->health, __ATOMIC_RELAXED);
+    for (uint32_t i = 0; i < ULTRASOUND_ECHO_HISTOGRAM_BINS; ++i)
+    {
+        diagnostics->echo_width_histogram[i] = __atomic_load_n(&d->echo_width_histogram[i], __ATOMIC_RELAXED);
+    }
+    return ESP_OK;
+}
+
+Ultrasound_Error_t Ultrasound_SetSoundSpeed(Ultrasound_Handle_t handle, Ultrasound_SoundSpeed_t speed)
+{
+    if (speed <= 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    handle->sound_coef = Ultrasound_SoundCoef(speed, handle->capture_resolution_hz); // Single word, read by the ISR
+    return ESP_OK;
+}
+
+Ultrasound_Error_t Ultrasound_SetAirConditions(Ultrasound_Handle_t handle, Ultrasound_Temperature_t temperature, uint8_t humidity_percent)
+{
+    return Ultrasound_SetSoundSpeed(handle, Ultrasound_SoundSpeedFromAir(temperature, humidity_percent));
+}
+
+Ultrasound_Error_t Ultrasound_SetSpeed(Ultrasound_Handle_t handle, uint32_t speed_mm_s)
+{
+    if (!handle->adaptive)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    handle->speed_mm_s = speed_mm_s; // Applied from the next echo
+    return ESP_OK;
+}
+
+uint32_t Ultrasound_GetPeriodUs(const Ultrasound_Handle_t handle)
+{
+    return handle->adaptive ? handle->adaptive_period_us : handle->measurement_period_us;
+}
+
+Ultrasound_Error_t Ultrasound_GetLastSample(const Ultrasound_Handle_t handle, Ultrasound_Sample_t *sample)
+{
+    uint32_t head, check = __atomic_load_n(&handle->history_head, __ATOMIC_ACQUIRE);
+    do
+    {
+        head = check;
+        if (0 == head)
+        {
+            return ESP_ERR_NOT_FOUND;
+        }
+        *sample = handle->history[(head - 1) & ULTRASOUND_HISTORY_MASK];
+        __atomic_thread_fence(__ATOMIC_ACQUIRE); // The copy is done before the re-check of the head
+    } while (head != (check = __atomic_load_n(&handle->history_head, __ATOMIC_ACQUIRE))); // Retry if overwritten during copy
+    return ESP_OK;
+}
+
+size_t Ultrasound_GetHistory(const Ultrasound_Handle_t handle, int64_t from_us, int64_t to_us, Ultrasound_Sample_t *samples, size_t max_samples)
+{
+    size_t count;
+    uint32_t newest;
+    uint32_t head, check = __atomic_load_n(&handle->history_head, __ATOMIC_ACQUIRE);
+    do
+    {
+        head = check;
+        // Walk back from the newest sample, the writer only touches the slot at head
+        count = 0;
+        newest = head;
+        uint32_t available = (head < ULTRASOUND_HISTORY_LENGTH - 1) ? head : ULTRASOUND_HISTORY_LENGTH - 1;
+        for (uint32_t i = 1; i <= available; ++i)
+        {
+            int64_t timestamp_us = handle->history[(head - i) & ULTRASOUND_HISTORY_MASK].timestamp_us;
+            if (timestamp_us < from_us)
+            {
+                break;
+            }
+            if (timestamp_us > to_us)
+            {
+                newest = head - i;
+                continue;
+            }
+            if (count == max_samples)
+            {
+                break;
+            }
+            ++count;
+        }
+        for (size_t i = 0; i < count; ++i)
+        {
+            samples[i] = handle->history[(newest - count + i) & ULTRASOUND_HISTORY_MASK];
+        }
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while (head != (check = __atomic_load_n(&handle->history_head, __ATOMIC_ACQUIRE)));
+    return count;
+}
+
+Ultrasound_Error_t Ultrasound_GetVelocity(const Ultrasound_Handle_t handle, Ultrasound_Velocity_t *velocity)
+{
+    Ultrasound_Sample_t newest = {0}, oldest = {0};
+    uint32_t found;
+    uint32_t head, check = __atomic_load_n(&handle->history_head, __ATOMIC_ACQUIRE);
+    do
+    {
+        head = check;
+        found = 0;
+        uint32_t available = (head < ULTRASOUND_HISTORY_LENGTH - 1) ? head : ULTRASOUND_HISTORY_LENGTH - 1;
+        for (uint32_t i = 1; (i <= available) && (found <= ULTRASOUND_VELOCITY_SPAN); ++i)
+        {
+            const Ultrasound_Sample_t *sample = &handle->history[(head - i) & ULTRASOUND_HISTORY_MASK];
+            if (sample->flags & ULTRASOUND_SAMPLE_SPIKE)
+            {
+                continue;
+            }
+            if (0 == found)
+            {
+                newest = *sample;
+            }
+            oldest = *sample;
+            ++found;
+        }
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while (head != (check = __atomic_load_n(&handle->history_head, __ATOMIC_ACQUIRE)));
+    int64_t dt_us = newest.timestamp_us - oldest.timestamp_us;
+    if ((found < 2) || (dt_us <= 0))
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+    int64_t v = ((int64_t)(oldest.median_mm - newest.median_mm) * (1000000LL << 16)) / dt_us;
+    const int64_t v_max = (1LL << 30) - 1; // Range of FixedPoint<14, 16>
+    *velocity = (v > v_max) ? v_max : (v < -v_max) ? -v_max : (Ultrasound_Velocity_t)v;
+    return ESP_OK;
+}
+
+/**
+ * @brief Median of the window, the oldest distance is replaced in the sorted copy (O(window), window is bounded)
+ *
+ */
+static int32_t ultrasound_median_push(Ultrasound_Handle_t handle, int32_t distance_mm)
+{
+    uint8_t n = handle->median_count;
+    if (n == handle->median_window)
+    {
+        // Remove the oldest distance from the sorted window
+        int32_t old = handle->median_fifo[handle->median_oldest];
+        uint8_t i = 0;
+        while (handle->median_sorted[i] != old)
+        {
+            ++i;
+        }
+        for (; i + 1 < n; ++i)
+        {
+            handle->median_sorted[i] = handle->median_sorted[i + 1];
+        }
+        --n;
+    }
+    handle->median_fifo[handle->median_oldest] = distance_mm;
+    handle->median_oldest = (handle->median_oldest + 1 == handle->median_window) ? 0 : handle->median_oldest + 1;
+    uint8_t i = n;
+    while ((i > 0) && (handle->median_sorted[i - 1] > distance_mm))
+    {
+        handle->median_sorted[i] = handle->median_sorted[i - 1];
+        --i;
+    }
+    handle->median_sorted[i] = distance_mm;
+    handle->median_count = n + 1;
+    return handle->median_sorted[handle->median_count / 2];
+}
+
+/**
+ * @brief Record the outcome of a measurement in the rolling success rate and check the health
+ * @details The counters have a single writer each : trigger_count, NO_ECHO and ECHO_NOT_ENDED are written by the esp_timer
+ *          task, success_count, SPIKE and the histogram by the echo ISR. The outcomes come from both contexts, which may run
+ *          on different cores (e.g. a timeout racing a late echo), so success_window, success_window_count, success_percent
+ *          and health are updated under outcome_lock. Readers still use plain atomic loads, without the lock.
+ *          The health callback is called after the lock is released.
+ *
+ */
+static void ultrasound_outcome(Ultrasound_Handle_t handle, bool success)
+{
+    Ultrasound_Diagnostics_t *d = &handle->diagnostics;
+    bool changed = false;
+    Ultrasound_Health_t health;
+    portENTER_CRITICAL_SAFE(&handle->outcome_lock);
+    const uint32_t window = (d->success_window << 1) | (success ? 1u : 0u);
+    __atomic_store_n(&d->success_window, window, __ATOMIC_RELAXED);
+    if (handle->success_window_count < ULTRASOUND_SUCCESS_WINDOW)
+    {
+        ++handle->success_window_count;
+    }
+    const uint32_t valid_mask = (handle->success_window_count >= 32) ? UINT32_MAX : (1u << handle->success_window_count) - 1;
+    const uint8_t percent = (__builtin_popcount(window & valid_mask) * 100u) / handle->success_window_count;
+    __atomic_store_n(&d->success_percent, percent, __ATOMIC_RELAXED);
+    health = d->health;
+    if ((0 != handle->degraded_success_percent) && (handle->success_window_count >= ULTRASOUND_SUCCESS_WINDOW))
+    {
+        if ((ULTRASOUND_HEALTH_OK == health) && (percent < handle->degraded_success_percent))
+        {
+            health = ULTRASOUND_HEALTH_DEGRADED;
+            changed = true;
+        }
+        else if ((ULTRASOUND_HEALTH_DEGRADED == health) && (percent >= handle->degraded_success_percent + ULTRASOUND_HEALTH_HYSTERESIS_PERCENT))
+        {
+            health = ULTRASOUND_HEALTH_OK;
+            changed = true;
+        }
+        if (changed)
+        {
+            __atomic_store_n(&d->health, health, __ATOMIC_RELAXED);
+        }
+    }
+    portEXIT_CRITICAL_SAFE(&handle->outcome_lock);
+    if (changed && (NULL != handle->health_callback))
+    {
+        handle->health_callback(handle, health, handle->user_data);
+    }
+}
+
+/**
+ * @brief Count a failed measurement
+ *
+ */
+static void ultrasound_fault(Ultrasound_Handle_t handle, Ultrasound_Fault_t fault)
+{
+    __atomic_store_n(&handle->diagnostics.fault_count[fault], handle->diagnostics.fault_count[fault] + 1, __ATOMIC_RELAXED);
+    ultrasound_outcome(handle, false);
+}
+
+/**
+ * @brief Store a measurement in the history (called from ISR context, single writer)
+ *
+ * @param woken set if the recorder task was woken, the ISR yields when it ends
+ * @return true if the measurement was accepted (not a spike)
+ */
+static bool ultrasound_record(Ultrasound_Handle_t handle, int64_t timestamp_us, int32_t distance_mm, uint32_t width_us, BaseType_t *woken)
+{
+#if CONFIG_WTASK_RECORD
+    const Ultrasound_Measurement_t measure = {.timestamp_us = timestamp_us, .distance_mm = distance_mm};
+    WRECORD_FROM_ISR(woken, WRECORD_ULTRASOUND, handle->gpio_echo_pin, WRECORD_SOURCE_NONE, &measure, sizeof(measure));
+#else
+    (void)woken;
+#endif
+    const uint32_t bin = (width_us < 2) ? 0 : (31 - __builtin_clz(width_us));
+    uint32_t *histogram = &handle->diagnostics.echo_width_histogram[(bin < ULTRASOUND_ECHO_HISTOGRAM_BINS) ? bin : ULTRASOUND_ECHO_HISTOGRAM_BINS - 1];
+    __atomic_store_n(histogram, *histogram + 1, __ATOMIC_RELAXED);
+    uint32_t head = handle->history_head;
+    __atomic_thread_fence(__ATOMIC_RELEASE); // A reader that sees the slot overwritten sees the previous head store
+    Ultrasound_Sample_t *sample = &handle->history[head & ULTRASOUND_HISTORY_MASK];
+    const int32_t median_mm = (head > 0) ? handle->history[(head - 1) & ULTRASOUND_HISTORY_MASK].median_mm : distance_mm;
+    const int32_t deviation = (distance_mm > median_mm) ? distance_mm - median_mm : median_mm - distance_mm;
+    sample->timestamp_us = timestamp_us;
+    sample->distance_mm = distance_mm;
+    if ((0 != handle->spike_threshold_mm) && (head > 0) && ((uint32_t)deviation > handle->spike_threshold_mm) &&
+        (handle->spike_count < ULTRASOUND_SPIKE_MAX_CONSECUTIVE))
+    {
+        ++handle->spike_count;
+        sample->median_mm = median_mm;
+        sample->flags = ULTRASOUND_SAMPLE_SPIKE;
+        __atomic_store_n(&handle->history_head, head + 1, __ATOMIC_RELEASE);
+        ultrasound_fault(handle, ULTRASOUND_FAULT_SPIKE);
+        return false;
+    }
+    if (handle->spike_count >= ULTRASOUND_SPIKE_MAX_CONSECUTIVE)
+    {
+        // Persistent deviation is a step change, restart the median on the new distance
+        handle->median_count = 0;
+        handle->median_oldest = 0;
+    }
+    handle->spike_count = 0;
+    sample->median_mm = ultrasound_median_push(handle, distance_mm);
+    sample->flags = 0;
+    __atomic_store_n(&handle->history_head, head + 1, __ATOMIC_RELEASE);
+    handle->last_measure.timestamp_us = timestamp_us;
+    handle->last_measure.distance_mm = distance_mm;
+    __atomic_store_n(&handle->diagnostics.success_count, handle->diagnostics.success_count + 1, __ATOMIC_RELAXED);
+    ultrasound_outcome(handle, true);
+    return true;
+}
+
+/**
+ * @brief Move to the next state, and start the timer unless delay_us is ULTRASOUND_KEEP_TIMER
+ * @details Called by the echo ISR and the esp_timer task. The check of INIT, the move and the timer start are done under
+ *          state_lock : once Ultrasound_Stop has set INIT, nothing re-arms the timer of a stopped sensor.
+ *
+ * @return false if the sensor is stopped (nothing done)
+ */
+static bool ultrasound_advance(Ultrasound_Handle_t handle, Ultrasound_StateMachine_t state, int64_t delay_us)
+{
+    portENTER_CRITICAL_SAFE(&handle->state_lock);
+    const bool running = (ULTRASOUND_STATE_INIT != handle->state);
+    if (running)
+    {
+        handle->state = state;
+        if (ULTRASOUND_KEEP_TIMER != delay_us)
+        {
+            esp_timer_stop(handle->timer); // Cancel the echo timeout
+            esp_timer_start_once(handle->timer, delay_us);
+        }
+    }
+    portEXIT_CRITICAL_SAFE(&handle->state_lock);
+    return running;
+}
+
+/**
+ * @brief Leave the echo for the next trigger (called from ISR context when the echo ended)
+ * @details Adaptive period: compute the period from the last distance and the speed, and trigger again as soon as
+ *          possible. Otherwise the echo timeout triggers at the fixed period.
+ *
+ */
+static void ultrasound_schedule_next(Ultrasound_Handle_t handle)
+{
+    if (!handle->adaptive)
+    {
+        ultrasound_advance(handle, ULTRASOUND_STATE_WAIT_TRIG_START, ULTRASOUND_KEEP_TIMER);
+        return;
+    }
+    uint32_t period_us = handle->measurement_period_us;
+    const uint32_t speed_mm_s = handle->speed_mm_s;
+    const int32_t distance_mm = handle->last_measure.distance_mm;
+    if ((0 != speed_mm_s) && (distance_mm >= 0) && (distance_mm < (int32_t)(UINT32_MAX / (1000000u / ULTRASOUND_ADAPTIVE_SAMPLES_TO_OBSTACLE))))
+    {
+        const uint32_t time_to_obstacle_us = (uint32_t)distance_mm * (1000000u / ULTRASOUND_ADAPTIVE_SAMPLES_TO_OBSTACLE) / speed_mm_s;
+        if (time_to_obstacle_us < period_us)
+        {
+            period_us = (time_to_obstacle_us > handle->min_period_us) ? time_to_obstacle_us : handle->min_period_us;
+        }
+    }
+    handle->adaptive_period_us = period_us;
+    const int64_t now = esp_timer_get_time();
+    int64_t delay_us = handle->time_trig_start + period_us - now;
+    if (delay_us < handle->ring_down_us)
+    {
+        delay_us = handle->ring_down_us;
+    }
+    ultrasound_advance(handle, ULTRASOUND_STATE_WAIT_TRIG_START, delay_us);
+}
+
 static void ultrasound_periodic_job(void *args)
 {
     Ultrasound_Handle_t handle = (Ultrasound_Handle_t)args;
@@ -173,28 +704,51 @@ static void ultrasound_periodic_job(void *args)
     switch (handle->state)
     {
     case ULTRASOUND_STATE_WAIT_TRIG_START:
-        gpio_intr_disable(handle->gpio_echo_pin);
-        gpio_set_level(handle->gpio_trig_pin, 1);
+        if (NULL != handle->capture)
+        {
+            handle->capture->disarm(handle->capture_ctx);
+        }
+        else
+        {
+            ultrasound_gpio_echo_disable(handle->gpio_echo_pin);
+        }
+        ultrasound_gpio_set_level(handle->gpio_trig_pin, 1);
         handle->time_trig_start = esp_timer_get_time();
-        esp_timer_start_once(handle->timer, handle->trig_signal_duration_us);
-        handle->state = ULTRASOUND_STATE_WAIT_TRIG_END;
+        if (!ultrasound_advance(handle, ULTRASOUND_STATE_WAIT_TRIG_END, handle->trig_signal_duration_us))
+        {
+            ultrasound_gpio_set_level(handle->gpio_trig_pin, 0); // stopped meanwhile
+            break;
+        }
+        __atomic_store_n(&handle->diagnostics.trigger_count, handle->diagnostics.trigger_count + 1, __ATOMIC_RELAXED);
         break;
     case ULTRASOUND_STATE_WAIT_TRIG_END:
-        gpio_set_level(handle->gpio_trig_pin, 0);
-        esp_timer_start_once(handle->timer, handle->measurement_period_us - handle->trig_signal_duration_us);
-        handle->state = ULTRASOUND_STATE_WAIT_ECHO_START;
-        gpio_set_intr_type(handle->gpio_echo_pin, GPIO_INTR_POSEDGE);
-        gpio_intr_enable(handle->gpio_echo_pin);
+        ultrasound_gpio_set_level(handle->gpio_trig_pin, 0);
+        if (!ultrasound_advance(handle, ULTRASOUND_STATE_WAIT_ECHO_START, handle->measurement_period_us - handle->trig_signal_duration_us))
+        {
+            break;
+        }
+        if (NULL != handle->capture)
+        {
+            handle->capture->arm(handle->capture_ctx);
+        }
+        else
+        {
+            ultrasound_gpio_echo_enable(handle->gpio_echo_pin, GPIO_INTR_POSEDGE);
+        }
         break;
     case ULTRASOUND_STATE_WAIT_ECHO_START:
-        handle->state = ULTRASOUND_STATE_WAIT_TRIG_START;
-        ++handle->error_count;
-        ultrasound_periodic_job(args); // Call itself to restart measurement
+        if (ultrasound_advance(handle, ULTRASOUND_STATE_WAIT_TRIG_START, ULTRASOUND_KEEP_TIMER))
+        {
+            ultrasound_fault(handle, ULTRASOUND_FAULT_NO_ECHO);
+            ultrasound_periodic_job(args); // Call itself to restart measurement
+        }
         break;
     case ULTRASOUND_STATE_WAIT_ECHO_END:
-        handle->state = ULTRASOUND_STATE_WAIT_TRIG_START;
-        ++handle->error_count;
-        ultrasound_periodic_job(args); // Call itself to restart measurement
+        if (ultrasound_advance(handle, ULTRASOUND_STATE_WAIT_TRIG_START, ULTRASOUND_KEEP_TIMER))
+        {
+            ultrasound_fault(handle, ULTRASOUND_FAULT_ECHO_NOT_ENDED);
+            ultrasound_periodic_job(args); // Call itself to restart measurement
+        }
         break;
     default:
         break;
@@ -204,6 +758,7 @@ static void ultrasound_periodic_job(void *args)
 static void ultrasound_gpio_isr_echo(void *args)
 {
     Ultrasound_Handle_t handle = (Ultrasound_Handle_t)args;
+    BaseType_t woken = pdFALSE;
     if (NULL == args)
     {
         return;
@@ -212,22 +767,50 @@ static void ultrasound_gpio_isr_echo(void *args)
     {
     case ULTRASOUND_STATE_WAIT_ECHO_START:
         handle->time_echo_start = esp_timer_get_time();
-        handle->state = ULTRASOUND_STATE_WAIT_ECHO_END;
-        gpio_set_intr_type(handle->gpio_echo_pin, GPIO_INTR_NEGEDGE);
+        if (ultrasound_advance(handle, ULTRASOUND_STATE_WAIT_ECHO_END, ULTRASOUND_KEEP_TIMER))
+        {
+            ultrasound_gpio_echo_edge(handle->gpio_echo_pin, GPIO_INTR_NEGEDGE);
+        }
         break;
     case ULTRASOUND_STATE_WAIT_ECHO_END:
         handle->time_echo_end = esp_timer_get_time();
         // Compute distance
         int64_t duration = (handle->time_echo_end - handle->time_echo_start);
-        handle->last_measure.timestamp_us = handle->time_trig_start;
-        handle->last_measure.distance_mm = (duration * VELOCITY_SOUND_MM_PER_MS) / (1000 * 2);
-        gpio_intr_disable(handle->gpio_echo_pin);
-        if (NULL != handle->callback)
+        ultrasound_gpio_echo_disable(handle->gpio_echo_pin);
+        if (ultrasound_record(handle, handle->time_trig_start, Ultrasound_SoundDistanceMm(duration, handle->sound_coef), duration, &woken) && (NULL != handle->callback))
         {
             handle->callback(handle, handle->user_data);
         }
-        handle->state = ULTRASOUND_STATE_WAIT_TRIG_START;
+        ultrasound_schedule_next(handle);
+        break;
     default:
         break;
     }
-}
\ No newline at end of file
+    if (woken)
+    {
+        portYIELD_FROM_ISR();
+    }
+}
+
+static void ultrasound_capture_done(void *ctx, uint32_t pulse_ticks)
+{
+    Ultrasound_Handle_t handle = (Ultrasound_Handle_t)ctx;
+    if (NULL == ctx || ULTRASOUND_STATE_WAIT_ECHO_START != handle->state)
+    {
+        return;
+    }
+    handle->time_echo_end = esp_timer_get_time(); // Only used to measure delivery latency, the distance comes from the capture
+    // Distance from capture ticks, keeps the sub-microsecond resolution of the capture timer
+    int32_t distance_mm = Ultrasound_SoundDistanceMm(pulse_ticks, handle->sound_coef);
+    uint32_t width_us = (pulse_ticks * handle->width_coef) >> 32;
+    BaseType_t woken = pdFALSE;
+    if (ultrasound_record(handle, handle->time_trig_start, distance_mm, width_us, &woken) && (NULL != handle->callback))
+    {
+        handle->callback(handle, handle->user_data);
+    }
+    ultrasound_schedule_next(handle);
+    if (woken)
+    {
+        portYIELD_FROM_ISR();
+    }
+}
@@ -0,0 +1,140 @@
+#include "ultrasound.hpp"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char *TAG = "ULTRA_CPP";
+
+/**
+ * @brief Construct a new ultrasound object: the C driver callback is redirected to the task delivery
+ *
+ * @param ultrasound_config configuration of the C driver, onRead and onHealthChange are still called with user_data
+ */
+ultrasound::ultrasound(const Ultrasound_Init_t &ultrasound_config) : callback(ultrasound_config.onRead), health_callback(ultrasound_config.onHealthChange), user_data(ultrasound_config.user_data)
+{
+    Ultrasound_Init_t config = ultrasound_config;
+    config.onRead = onReadIsr;
+    config.onHealthChange = (health_callback != nullptr) ? onHealthChange : nullptr;
+    config.user_data = this;
+    handle = Ultrasound_Init(&config);
+    if (handle == nullptr)
+        ESP_LOGE(TAG, "Failed to create ultrasound driver");
+}
+
+/**
+ * @brief Destroy the ultrasound object, the C driver is released
+ * @details With deferRead, the driver is stopped first and the works already posted are handled before the release :
+ *          they call back into this object and read the driver.
+ */
+ultrasound::~ultrasound()
+{
+    if (handle == nullptr)
+        return;
+#if CONFIG_WTASK_DEFERRED
+    Ultrasound_Stop(handle);
+    while (deferred_pending.load(std::memory_order_acquire) != 0)
+        vTaskDelay(1);
+#endif
+    Ultrasound_Deinit(handle);
+}
+
+/**
+ * @brief Get closing velocity (positive when the obstacle gets closer)
+ *
+ * @param velocity output velocity in mm/s
+ * @return Ultrasound_Error_t ESP_ERR_NOT_FOUND if not enough samples
+ */
+Ultrasound_Error_t ultrasound::getVelocity(Velocity_t &velocity) const
+{
+    Ultrasound_Velocity_t raw;
+    Ultrasound_Error_t err = Ultrasound_GetVelocity(handle, &raw);
+    if (err == ESP_OK)
+        velocity = Velocity_t(Velocity_t::raw_t(raw));
+    return err;
+}
+
+/**
+ * @brief Measure the latency from the echo falling edge to now, to be called by the consumer when it wakes up
+ * @details Statistics are not protected, so only one consumer should record latencies
+ *
+ * @param echo_end_us time of the echo falling edge (UltrasoundDelivery::echo_end_us or getEchoEndTime())
+ * @return int64_t latency in us
+ */
+int64_t ultrasound::recordWakeLatency(int64_t echo_end_us)
+{
+    const int64_t latency = esp_timer_get_time() - echo_end_us;
+    ++wake_latency.count;
+    wake_latency.total_us += latency;
+    if (latency < wake_latency.min_us)
+        wake_latency.min_us = latency;
+    if (latency > wake_latency.max_us)
+        wake_latency.max_us = latency;
+    return latency;
+}
+
+/**
+ * @brief Callback of the C driver (ISR context): deliver the sample to the consumer task
+ *
+ */
+void IRAM_ATTR ultrasound::onReadIsr(Ultrasound_Handle_t handle, void *user_data)
+{
+    ultrasound *self = static_cast<ultrasound *>(user_data);
+    BaseType_t higher_priority_task_woken = pdFALSE;
+#if (CONFIG_RTASK_SUPPORT)
+    RTask *rtask_dest = self->rtask_dest;
+    if (rtask_dest != nullptr)
+    {
+        UltrasoundDelivery delivery;
+        Ultrasound_GetLastSample(handle, &delivery.sample);
+        delivery.echo_end_us = Ultrasound_GetEchoEndTime(handle);
+        RTask::sendDataFromIsrTo(rtask_dest, &delivery, sizeof(delivery), self->rtask_notif_value, &higher_priority_task_woken);
+    }
+#endif
+    NTask *ntask_dest = self->ntask_dest;
+    if (ntask_dest != nullptr)
+    {
+        const int32_t distance_mm = Ultrasound_GetDistance(handle).distance_mm;
+        const uint16_t notif_value = (distance_mm < 0) ? 0 : (distance_mm > UINT16_MAX) ? UINT16_MAX : distance_mm;
+        NTask::sendNotificationFromIsrTo(ntask_dest, notif_value, &higher_priority_task_woken);
+    }
+    if (self->callback != nullptr)
+    {
+#if CONFIG_WTASK_DEFERRED
+        bool deferred = false;
+        if (self->deferred_read)
+        {
+            self->deferred_pending.fetch_add(1, std::memory_order_relaxed); // before the post : the task can run first on the other core
+            deferred = WDeferred::postFromIsrTo(self->deferred_core, onReadDeferred, self, 0, &higher_priority_task_woken);
+            if (!deferred)
+                self->deferred_pending.fetch_sub(1, std::memory_order_relaxed);
+        }
+        if (!deferred)
+#endif
+            self->callback(handle, self->user_data);
+    }
+    if (higher_priority_task_woken == pdTRUE)
+        portYIELD_FROM_ISR();
+}
+
+#if CONFIG_WTASK_DEFERRED
+/**
+ * @brief onRead callback in the deferred task (deferRead)
+ *
+ */
+void ultrasound::onReadDeferred(void *arg, Notification_t notif)
+{
+    ultrasound *self = static_cast<ultrasound *>(arg);
+    self->callback(self->handle, self->user_data);
+    self->deferred_pending.fetch_sub(1, std::memory_order_release); // last access : the destructor can go on
+}
+#endif
+
+/**
+ * @brief Health callback of the C driver: forward to the user callback with the user context
+ *
+ */
+void ultrasound::onHealthChange(Ultrasound_Handle_t handle, Ultrasound_Health_t health, void *user_data)
+{
+    ultrasound *self = static_cast<ultrasound *>(user_data);
+    self->health_callback(handle, health, self->user_data);
+}
@@ -1,10 +1,26 @@
 #ifndef ULTRASOUND_LIB__
 #define ULTRASOUND_LIB__
+#include <stdbool.h>
+#include <stddef.h>
 #include "driver/gpio.h"
+#include "ultrasound_hal.h"
+#include "ultrasound_sound.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
+#ifndef ULTRASOUND_HISTORY_LENGTH
+#define ULTRASOUND_HISTORY_LENGTH 32u //< Number of samples kept per sensor (power of 2)
+#endif
+#define ULTRASOUND_MEDIAN_WINDOW_MAX 9u //< Maximum median filter window
+#define ULTRASOUND_SPIKE_MAX_CONSECUTIVE 3u //< Consecutive spikes before accepting a step change
+#define ULTRASOUND_VELOCITY_SPAN 4u //< Number of samples between the 2 medians of the velocity estimate
+#define ULTRASOUND_RING_DOWN_DEFAULT_US 5000u //< Default time between echo end and next trigger (adaptive period)
+#define ULTRASOUND_ADAPTIVE_SAMPLES_TO_OBSTACLE 8u //< Samples wanted before reaching the obstacle (adaptive period)
+#define ULTRASOUND_ECHO_HISTOGRAM_BINS 16u //< Bin i counts echo widths in [2^i, 2^(i+1)) us
+#define ULTRASOUND_SUCCESS_WINDOW 32u //< Number of measurements of the rolling success rate
+#define ULTRASOUND_HEALTH_HYSTERESIS_PERCENT 10u //< Recovery needs degraded_success_percent + hysteresis
+
 /**
  * @brief Handle definition: Ultrasound_t is a private type
  *
@@ -19,6 +35,34 @@ typedef struct Ultrasound_t *Ultrasound_Handle_t;
 typedef void (*Ultrasound_Callback_t)(Ultrasound_Handle_t handle,
                                       void *user_data);
 
+/**
+ * @brief Echo measurement backend
+ *
+ */
+typedef enum {
+  ULTRASOUND_BACKEND_GPIO_ISR = 0, //< Edges timestamped in the GPIO ISR (default)
+  ULTRASOUND_BACKEND_MCPWM_CAPTURE, //< Edges latched by the MCPWM capture unit
+  ULTRASOUND_BACKEND_CUSTOM,        //< Edges latched by capture_hal (e.g. mock)
+} Ultrasound_Backend_t;
+
+/**
+ * @brief Sensor health
+ *
+ */
+typedef enum {
+  ULTRASOUND_HEALTH_OK = 0,   //< Rolling success rate above the threshold
+  ULTRASOUND_HEALTH_DEGRADED, //< Rolling success rate below the threshold
+} Ultrasound_Health_t;
+
+/**
+ * @brief Ultrasound health change callback (called from ISR or esp_timer task
+ * context)
+ *
+ */
+typedef void (*Ultrasound_HealthCallback_t)(Ultrasound_Handle_t handle,
+                                            Ultrasound_Health_t health,
+                                            void *user_data);
+
 /**
  * @brief Ultrasound init structure
  *
@@ -33,6 +77,22 @@ typedef struct {
       measurement_period_ms; //< Period of measurement in ms (at least 60 ms)
   uint32_t trig_signal_duration_us; //< Trig signal duration (should be 10us,
                                     //50us should be fine)
+  uint8_t median_window; //< Median filter window (odd, up to 9, 0 or 1 disables)
+  uint32_t spike_threshold_mm; //< Reject samples further than this from the median
+                               //(0 disables)
+  bool adaptive_period; //< Trigger again as soon as the echo ended, the period
+                        //follows distance and speed (measurement_period_ms is
+                        //the maximum)
+  uint32_t min_period_ms; //< Minimum period in adaptive mode
+  uint32_t ring_down_us;  //< Minimum time between echo end and next trigger in
+                          //adaptive mode (0 for default)
+  Ultrasound_HealthCallback_t onHealthChange; //< Called when the sensor health
+                                              //changes (can be NULL)
+  uint8_t degraded_success_percent; //< Degraded below this rolling success
+                                    //rate (0 disables health monitoring)
+  Ultrasound_Backend_t backend;     //< Echo measurement backend
+  const Ultrasound_CaptureHal_t
+      *capture_hal; //< Capture backend (only for ULTRASOUND_BACKEND_CUSTOM)
 } Ultrasound_Init_t;
 
 typedef uint32_t Ultrasound_Error_t;
@@ -42,6 +102,60 @@ typedef struct {
   int32_t distance_mm;
 } Ultrasound_Measurement_t;
 
+/**
+ * @brief Failure kinds
+ *
+ */
+typedef enum {
+  ULTRASOUND_FAULT_NO_ECHO = 0,     //< No echo rising edge before the timeout
+                                    //(any missing edge with a capture backend)
+  ULTRASOUND_FAULT_ECHO_NOT_ENDED, //< Echo started but did not end before the
+                                    //timeout
+  ULTRASOUND_FAULT_SPIKE,           //< Echo rejected as spike
+  ULTRASOUND_FAULT_MAX,
+} Ultrasound_Fault_t;
+
+/**
+ * @brief Diagnostics counters (32 bits, wrap around)
+ *
+ */
+typedef struct {
+  uint32_t trigger_count;                      //< Number of triggers
+  uint32_t success_count;                      //< Number of accepted samples
+  uint32_t fault_count[ULTRASOUND_FAULT_MAX];  //< Number of failures by kind
+  uint32_t success_window;                     //< Outcome of the last measurements
+                                               //(bit 0 is the last, 1 is success)
+  uint8_t success_percent;                     //< Rolling success rate over
+                                               //ULTRASOUND_SUCCESS_WINDOW measurements
+  Ultrasound_Health_t health;                  //< Current health
+  uint32_t echo_width_histogram[ULTRASOUND_ECHO_HISTOGRAM_BINS]; //< Echo widths
+} Ultrasound_Diagnostics_t;
+
+/**
+ * @brief Sample flags
+ *
+ */
+typedef enum {
+  ULTRASOUND_SAMPLE_SPIKE = 1u << 0, //< Rejected as spike, not used in median
+} Ultrasound_SampleFlags_t;
+
+/**
+ * @brief Sample of the history ring
+ *
+ */
+typedef struct {
+  int64_t timestamp_us; //< Time of trigger
+  int32_t distance_mm;  //< Measured distance
+  int32_t median_mm;    //< Median of the last accepted distances
+  uint32_t flags;       //< Ultrasound_SampleFlags_t
+} Ultrasound_Sample_t;
+
+/**
+ * @brief Velocity in mm/s, same layout as the raw value of FixedPoint<14, 16>
+ *
+ */
+typedef int32_t Ultrasound_Velocity_t;
+
 /**
  * @brief Create Ultrasound instance
  *
@@ -58,6 +172,22 @@ Ultrasound_Handle_t Ultrasound_Init(const Ultrasound_Init_t *ultrasound_init);
  */
 Ultrasound_Error_t Ultrasound_Start(Ultrasound_Handle_t handle);
 
+/**
+ * @brief Stop automatic measurement
+ *
+ * @param handle Ultrasound handle
+ * @return Ultrasound_Error_t
+ */
+Ultrasound_Error_t Ultrasound_Stop(Ultrasound_Handle_t handle);
+
+/**
+ * @brief Stop measurement and release the instance
+ *
+ * @param handle Ultrasound handle
+ * @return Ultrasound_Error_t
+ */
+Ultrasound_Error_t Ultrasound_Deinit(Ultrasound_Handle_t handle);
+
 /**
  * @brief Get last measured distance
  *
@@ -68,14 +198,130 @@ Ultrasound_Measurement_t
 Ultrasound_GetDistance(const Ultrasound_Handle_t handle);
 
 /**
- * @brief Change ultrasound sensor period measurement
+ * @brief Get diagnostics counters (lock free: each counter is read atomically,
+ * but counters may be from different measurements)
  *
  * @param handle Ultrasound Handle
- * @param measurement_period_ms New Period
+ * @param diagnostics Output counters
  * @return Ultrasound_Error_t
  */
+Ultrasound_Error_t
+Ultrasound_GetDiagnostics(const Ultrasound_Handle_t handle,
+                          Ultrasound_Diagnostics_t *diagnostics);
+
+/**
+ * @brief Set the speed of sound used for the distance (applied from the next
+ * echo)
+ *
+ * @param handle Ultrasound Handle
+ * @param speed FixedPoint<10, 16> raw value in m/s
+ * @return Ultrasound_Error_t ESP_ERR_INVALID_ARG if not positive
+ */
+Ultrasound_Error_t Ultrasound_SetSoundSpeed(Ultrasound_Handle_t handle,
+                                            Ultrasound_SoundSpeed_t speed);
+
+/**
+ * @brief Set the speed of sound from the air temperature and humidity (e.g.
+ * from a temperature sensor task)
+ *
+ * @param handle Ultrasound Handle
+ * @param temperature FixedPoint<7, 8> raw value in °C
+ * @param humidity_percent Relative humidity (0 to 100)
+ * @return Ultrasound_Error_t
+ */
+Ultrasound_Error_t Ultrasound_SetAirConditions(Ultrasound_Handle_t handle,
+                                               Ultrasound_Temperature_t temperature,
+                                               uint8_t humidity_percent);
+
+/**
+ * @brief Set the speed of the robot toward the obstacles (adaptive period
+ * only): the period is shortened so that ULTRASOUND_ADAPTIVE_SAMPLES_TO_OBSTACLE
+ * samples are taken before reaching the last measured distance
+ *
+ * @param handle Ultrasound Handle
+ * @param speed_mm_s Speed in mm/s (0 for the maximum period)
+ * @return Ultrasound_Error_t ESP_ERR_INVALID_STATE if not in adaptive mode
+ */
+Ultrasound_Error_t Ultrasound_SetSpeed(Ultrasound_Handle_t handle,
+                                       uint32_t speed_mm_s);
+
+/**
+ * @brief Get the current measurement period (changes with distance and speed
+ * in adaptive mode)
+ *
+ * @param handle Ultrasound Handle
+ * @return uint32_t period in us
+ */
+uint32_t Ultrasound_GetPeriodUs(const Ultrasound_Handle_t handle);
+
+/**
+ * @brief Get the time of the last echo falling edge (time of the capture
+ * interrupt with a capture backend), to measure delivery latency
+ *
+ * @param handle Ultrasound Handle
+ * @return int64_t time in us (esp_timer_get_time)
+ */
+int64_t Ultrasound_GetEchoEndTime(const Ultrasound_Handle_t handle);
+
+/**
+ * @brief Get the last sample of the history (with filtered distance)
+ *
+ * @param handle Ultrasound Handle
+ * @param sample Output sample
+ * @return Ultrasound_Error_t ESP_ERR_NOT_FOUND if no sample yet
+ */
+Ultrasound_Error_t Ultrasound_GetLastSample(const Ultrasound_Handle_t handle,
+                                            Ultrasound_Sample_t *sample);
+
+/**
+ * @brief Copy the samples of the history within a timestamp range (lock free,
+ * can be called from any task)
+ *
+ * @param handle Ultrasound Handle
+ * @param from_us Oldest timestamp (included)
+ * @param to_us Newest timestamp (included)
+ * @param samples Output buffer, oldest sample first
+ * @param max_samples Size of the output buffer
+ * @return size_t Number of copied samples
+ */
+size_t Ultrasound_GetHistory(const Ultrasound_Handle_t handle, int64_t from_us,
+                             int64_t to_us, Ultrasound_Sample_t *samples,
+                             size_t max_samples);
+
+/**
+ * @brief Get closing velocity from the median distances (positive when the
+ * obstacle gets closer)
+ *
+ * @param handle Ultrasound Handle
+ * @param velocity Output velocity, FixedPoint<14, 16> raw value in mm/s
+ * @return Ultrasound_Error_t ESP_ERR_NOT_FOUND if not enough samples
+ */
+Ultrasound_Error_t Ultrasound_GetVelocity(const Ultrasound_Handle_t handle,
+                                          Ultrasound_Velocity_t *velocity);
+
+/**
+ * @brief Change ultrasound sensor period measurement
+ *
+ * @param handle Ultrasound Handle
+ * @param measurement_period_ms New Period (applied from the next trigger)
+ * @return Ultrasound_Error_t ESP_ERR_INVALID_ARG if shorter than the trigger
+ */
 Ultrasound_Error_t Ultrasound_SetPeriodMs(Ultrasound_Handle_t handle,
                                           uint32_t measurement_period_ms);
+
+/**
+ * @brief Print the cycles of the trigger and echo GPIO accesses, IDF driver
+ * against the register accessors generated from the SVD
+ * @warning Toggles the trigger pin: only call it while the measurement is
+ * stopped
+ *
+ * @param handle Ultrasound Handle
+ * @param iterations Number of accesses averaged per line
+ * @return Ultrasound_Error_t ESP_ERR_INVALID_STATE if the measurement is
+ * running
+ */
+Ultrasound_Error_t Ultrasound_GpioBenchmark(Ultrasound_Handle_t handle,
+                                            uint32_t iterations);
 #ifdef __cplusplus
 }
 #endif
@@ -1,100 +1,151 @@
-#ifndef ULTRASOUND_LIB__
-#define ULTRASOUND_LIB__
-#include <tuple>
-#include <time.h>
-#include <functional>
-#include "driver/gpio.h"
+#ifndef ULTRASOUND_HPP_
+#define ULTRASOUND_HPP_
+#include <atomic>
+#include <cstdint>
+#include <span>
+#include "ultrasound.h"
+#include "WTask.hpp"
+#include "fixedpoint.hpp"
+
 /**
- * @brief Handle definition: Ultrasound_t is a private type
+ * @brief Item sent to a RTask in task delivery mode
  *
  */
-struct Ultrasound_t;
-typedef struct Ultrasound_t *Ultrasound_Handle_t;
+struct UltrasoundDelivery
+{
+    Ultrasound_Sample_t sample; //< Delivered sample
+    int64_t echo_end_us;        //< Time of the echo falling edge, to measure the wake latency
+};
 
 /**
- * @brief Ultrasound successful measurement callback
+ * @brief Latency between the echo falling edge and the consumer handling the sample
  *
  */
-typedef void (*Ultrasound_Callback_t)(Ultrasound_Handle_t handle, void *user_data);
+struct UltrasoundWakeLatency
+{
+    uint32_t count = 0;        //< Number of measured deliveries
+    int64_t min_us = INT64_MAX; //< Minimum latency
+    int64_t max_us = 0;         //< Maximum latency
+    int64_t total_us = 0;       //< Sum of latencies (average is total_us / count)
+};
 
 /**
- * @brief Ultrasound init structure
- *
+ * @brief C++ driver of an ultrasound sensor, based on the C driver
+ * @details Samples can be delivered from the ISR to a NTask (notification value is the distance in mm) or to a RTask
+ *          (UltrasoundDelivery item and a notification), so the consumer blocks on its queue instead of polling.
+ *          The onRead callback of the configuration is called from ISR context, or from a deferred task with deferRead
+ *          (CONFIG_WTASK_DEFERRED).
  */
-typedef struct
+class ultrasound
 {
-    gpio_num_t gpio_trig_pin;         //< Trigger pin number
-    gpio_num_t gpio_echo_pin;         //< Echo pin number
-    Ultrasound_Callback_t onRead;     //< Callback function when read value got updated (called from ISR context)
-    void *user_data;                  //< User data for callback argument
-    uint32_t measurement_period_ms;   //< Period of measurement in ms (at least 60 ms)
-    uint32_t trig_signal_duration_us; //< Trig signal duration (should be 10us, 50us should be fine)
-} Ultrasound_Init_t;
+public:
+    using Velocity_t = FixedPoint<14, 16>; // mm/s, layout of Ultrasound_Velocity_t
 
-typedef uint32_t Ultrasound_Error_t;
+private:
+    Ultrasound_Handle_t handle;
+    Ultrasound_Callback_t callback; //< User callback (called from ISR)
+    Ultrasound_HealthCallback_t health_callback; //< User health callback
+    void *user_data;                //< User context
+    NTask *ntask_dest = nullptr;    //< Destination of notification delivery
+#if (CONFIG_RTASK_SUPPORT)
+    RTask *rtask_dest = nullptr; //< Destination of data delivery
+    uint16_t rtask_notif_value = 0;
+#endif
+    UltrasoundWakeLatency wake_latency; //< Updated by the consumer
+#if CONFIG_WTASK_DEFERRED
+    bool deferred_read = false;                       //< onRead called by the deferred task
+    BaseType_t deferred_core = defaultDeferredCore(); //< core of the deferred task
+    std::atomic<uint32_t> deferred_pending{0};        //< works posted and not handled yet, they point to this object
+    static void onReadDeferred(void *arg, Notification_t notif);
+    static constexpr BaseType_t defaultDeferredCore()
+    {
+#if CONFIG_WTASK_PARTITION
+        return WPartition::realTimeCore();
+#else
+        return tskNO_AFFINITY;
+#endif
+    };
+#endif
 
-typedef struct
-{
-    int64_t timestamp_us;
-    int32_t distance_mm;
-} Ultrasound_Measurement_t;
+    static void onReadIsr(Ultrasound_Handle_t handle, void *user_data);
+    static void onHealthChange(Ultrasound_Handle_t handle, Ultrasound_Health_t health, void *user_data);
 
-class ultrasound
-{
-private:
-    gpio_num_t gpio_trig_pin;                 //< GPIO Trigger pin number
-    gpio_num_t gpio_echo_pin;                 //< GPIO Echo pin number
-    esp_timer_handle_t timer;                 // Timer handle
-    uint64_t measurement_period_us;           //< Measurement period us
-    uint64_t trig_signal_duration_us;         //< Trigger signal duration
-    int64_t time_trig_start;                  //< Time of trig rising edge
-    int64_t time_trig_end;                    //< Time of trig falling edge
-    int64_t time_echo_start;                  //< Time of echo rising edge
-    int64_t time_echo_end;                    //< Time of echo falling edge
-    uint8_t error_count;                      //< Measure failed counter
-    Ultrasound_Measurement_t last_measure;    //< Last updated measurement
-    volatile Ultrasound_StateMachine_t state; // Current state machine state
-    Ultrasound_Callback_t callback;           //< Onread callback function (called from ISR)
-    void *user_data;                          //< User context
 public:
-    ultrasound(const Ultrasound_Init_t &ultrasound_config);
+    explicit ultrasound(const Ultrasound_Init_t &ultrasound_config);
     ~ultrasound();
-    Ultrasound_Error_t start(void);
-    Ultrasound_Error_t Ultrasound_SetPeriodMs(uint32_t ultrasound_period_ms);
-    std::pair<time_t, int32_t> getDistance(void);
-};
+    ultrasound(const ultrasound &) = delete;
+    ultrasound &operator=(const ultrasound &) = delete;
 
-/**
- * @brief Create Ultrasound instance
- *
- * @param ultrasound_init Initialisation structure
- * @return Ultrasound_Handle_t NULL if initialization failed
- */
-Ultrasound_Handle_t Ultrasound_Init(const Ultrasound_Init_t *ultrasound_init);
-
-/**
- * @brief Start automatic measurement
- *
- * @param handle Ultrasound handle
- * @return Ultrasound_Error_t
- */
-Ultrasound_Error_t Ultrasound_Start(Ultrasound_Handle_t handle);
+    /**
+     * @brief Check if the C driver was created
+     */
+    bool isValid() const { return handle != nullptr; };
+    Ultrasound_Error_t start(void) { return Ultrasound_Start(handle); };
+    Ultrasound_Error_t stop(void) { return Ultrasound_Stop(handle); };
+    Ultrasound_Error_t setPeriodMs(uint32_t ultrasound_period_ms) { return Ultrasound_SetPeriodMs(handle, ultrasound_period_ms); };
+    Ultrasound_Measurement_t getDistance(void) const { return Ultrasound_GetDistance(handle); };
+    Ultrasound_Error_t getLastSample(Ultrasound_Sample_t &sample) const { return Ultrasound_GetLastSample(handle, &sample); };
+    size_t getHistory(int64_t from_us, int64_t to_us, std::span<Ultrasound_Sample_t> samples) const
+    {
+        return Ultrasound_GetHistory(handle, from_us, to_us, samples.data(), samples.size());
+    };
+    Ultrasound_Error_t getVelocity(Velocity_t &velocity) const;
+    int64_t getEchoEndTime(void) const { return Ultrasound_GetEchoEndTime(handle); };
+    Ultrasound_Error_t getDiagnostics(Ultrasound_Diagnostics_t &diagnostics) const { return Ultrasound_GetDiagnostics(handle, &diagnostics); };
+    using SoundSpeed_t = FixedPoint<10, 16>; // m/s, layout of Ultrasound_SoundSpeed_t
+    using Temperature_t = FixedPoint<7, 8>;  // °C, layout of Ultrasound_Temperature_t
+    Ultrasound_Error_t setSoundSpeed(const SoundSpeed_t &speed) { return Ultrasound_SetSoundSpeed(handle, speed.getM()); };
+    Ultrasound_Error_t setAirConditions(const Temperature_t &temperature, uint8_t humidity_percent)
+    {
+        return Ultrasound_SetAirConditions(handle, temperature.getM(), humidity_percent);
+    };
+    Ultrasound_Error_t setSpeed(uint32_t speed_mm_s) { return Ultrasound_SetSpeed(handle, speed_mm_s); };
+    uint32_t getPeriodUs(void) const { return Ultrasound_GetPeriodUs(handle); };
 
-/**
- * @brief Get last measured distance
- *
- * @param handle Ultrasound Handle
- * @return float
- */
-Ultrasound_Measurement_t Ultrasound_GetDistance(const Ultrasound_Handle_t handle);
+    /**
+     * @brief Deliver each sample to a NTask, from the ISR, with the distance in mm as notification value
+     *
+     * @param dest destination (nullptr to stop the delivery)
+     */
+    void deliverTo(NTask *dest) { ntask_dest = dest; };
+#if (CONFIG_RTASK_SUPPORT)
+    /**
+     * @brief Deliver each sample to a RTask, from the ISR, as an UltrasoundDelivery item followed by a notification
+     *
+     * @param dest destination (nullptr to stop the delivery)
+     * @param notif_value value of the notification sent with each item
+     */
+    void deliverTo(RTask *dest, uint16_t notif_value)
+    {
+        rtask_notif_value = notif_value;
+        rtask_dest = dest;
+    };
+#endif
+#if CONFIG_WTASK_DEFERRED
+    /**
+     * @brief Call the onRead callback from a deferred task instead of the ISR (WDeferred::start first)
+     * @details The callback reads the last sample when it runs, a newer sample can replace the one that posted it.
+     *          The callback is called from the ISR when the deferred queue is full.
+     *          By default the callback runs on the real-time core with CONFIG_WTASK_PARTITION, whatever the core of the
+     *          ISR, and on the core of the ISR without the partition.
+     *
+     *          The destructor waits for the pending works : the object must not be destroyed from its own callback.
+     *
+     * @param deferred true for the deferred task, false for the ISR
+     * @param core core of the deferred task, tskNO_AFFINITY for the core of the ISR
+     */
+    void deferRead(bool deferred, BaseType_t core = defaultDeferredCore())
+    {
+        deferred_core = core;
+        deferred_read = deferred;
+    };
+#endif
 
-/**
- * @brief Change ultrasound sensor period measurement
- *
- * @param handle Ultrasound Handle
- * @param measurement_period_ms New Period
- * @return Ultrasound_Error_t
- */
-Ultrasound_Error_t Ultrasound_SetPeriodMs(Ultrasound_Handle_t handle, uint32_t measurement_period_ms);
+    int64_t recordWakeLatency(int64_t echo_end_us);
+    /**
+     * @brief Latency statistics, updated by recordWakeLatency
+     */
+    const UltrasoundWakeLatency &getWakeLatency(void) const { return wake_latency; };
+};
 
-#endif /*ULTRASOUND_LIB__*/
\ No newline at end of file
+#endif /*ULTRASOUND_HPP_*/
@@ -0,0 +1,496 @@
+#include "ultrasound_array.h"
+#include "freertos/FreeRTOS.h"
+#include "driver/gpio.h"
+#include "ultrasound_gpio.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <string.h>
+
+/**
+ * @brief Ultrasound array state machine (one for the whole array)
+ *
+ */
+typedef enum
+{
+    ULTRASOUND_ARRAY_STATE_INIT = 0,     // Init state
+    ULTRASOUND_ARRAY_STATE_SLOT_START,   // Idle state : next timer event starts a slot
+    ULTRASOUND_ARRAY_STATE_TRIG_END,     // Waiting for timer to terminate trigger period
+    ULTRASOUND_ARRAY_STATE_LISTEN,       // Waiting for echoes of the slot
+} UltrasoundArray_StateMachine_t;
+
+/**
+ * @brief Echo state of one channel
+ *
+ */
+typedef enum
+{
+    ULTRASOUND_CHANNEL_IDLE = 0,         // Not fired in this slot
+    ULTRASOUND_CHANNEL_WAIT_ECHO_START,  // Waiting for echo back (raising edge)
+    ULTRASOUND_CHANNEL_WAIT_ECHO_END,    // Waiting for echo back (falling edge)
+    ULTRASOUND_CHANNEL_DONE,             // Echo measured
+} UltrasoundArray_ChannelState_t;
+
+/**
+ * @brief Entry of the ISR dispatch table
+ *
+ */
+typedef struct
+{
+    struct UltrasoundArray_t *array;                //< Owner
+    uint8_t index;                                  //< Channel number
+    gpio_num_t gpio_trig_pin;                       //< GPIO Trigger pin number
+    gpio_num_t gpio_echo_pin;                       //< GPIO Echo pin number
+    int64_t time_echo_start;                        //< Time of echo rising edge
+    volatile UltrasoundArray_ChannelState_t state;  //< Echo state
+    Ultrasound_Diagnostics_t diagnostics;           //< Counters : the histogram is written by the ISR, the others by the esp_timer task
+    uint32_t success_window_count;                  //< Number of outcomes in success_window (up to ULTRASOUND_SUCCESS_WINDOW)
+} UltrasoundArray_Channel_t;
+
+/**
+ * @brief Private UltrasoundArray structure
+ *
+ */
+typedef struct UltrasoundArray_t
+{
+    UltrasoundArray_Channel_t channel[ULTRASOUND_ARRAY_MAX_CHANNELS]; //< ISR dispatch table
+    uint8_t channel_count;                                           //< Number of sensors
+    uint32_t slot_mask[ULTRASOUND_ARRAY_MAX_CHANNELS];               //< Channels fired in each slot
+    uint8_t slot_count;                                              //< Number of slots per scan
+    uint8_t slot;                                                    //< Current slot
+    esp_timer_handle_t timer;                                        //< Single timer of the array
+    uint64_t slot_period_us;                                         //< Listening window of a slot
+    uint64_t trig_signal_duration_us;                                //< Trigger signal duration
+    int64_t time_trig_start;                                         //< Time of trig rising edge of the current slot
+    volatile uint32_t sound_coef;                                    //< Echo us to mm (see Ultrasound_SoundCoef)
+    volatile UltrasoundArray_StateMachine_t state;                   //< Current state machine state
+    UltrasoundArray_Frame_t frame;                                   //< Scan being built
+    UltrasoundArray_Frame_t last_frame;                              //< Last complete scan
+    UltrasoundArray_Stats_t stats;                                   //< Scan statistics
+    portMUX_TYPE lock;                                               //< Protects the channel states, frame, last_frame and stats
+    UltrasoundArray_Callback_t callback;                             //< Complete scan callback
+    UltrasoundArray_EchoSource_t echo_source;                        //< Simulated echo source (NULL on hardware)
+    void *user_data;                                                 //< User context
+} UltrasoundArray_struct_t;
+
+static const char *LOG_TAG = "ULTRA_ARRAY";
+static void ultrasound_array_gpio_isr_echo(void *args);
+static void ultrasound_array_periodic_job(void *args);
+
+/**
+ * @brief Build the channel mask of each slot from the schedule
+ */
+static bool ultrasound_array_build_schedule(UltrasoundArray_Handle_t handle, const UltrasoundArray_Init_t *init)
+{
+    switch (init->schedule)
+    {
+    case ULTRASOUND_SCHEDULE_ROUND_ROBIN:
+        handle->slot_count = handle->channel_count;
+        for (uint8_t c = 0; c < handle->channel_count; ++c)
+        {
+            handle->slot_mask[c] = 1u << c;
+        }
+        return true;
+    case ULTRASOUND_SCHEDULE_INTERLEAVED:
+        if ((init->group_count == 0) || (init->group_count > handle->channel_count))
+        {
+            return false;
+        }
+        handle->slot_count = init->group_count;
+        for (uint8_t c = 0; c < handle->channel_count; ++c)
+        {
+            handle->slot_mask[c % init->group_count] |= 1u << c;
+        }
+        return true;
+    case ULTRASOUND_SCHEDULE_ALL_AT_ONCE:
+        handle->slot_count = 1;
+        handle->slot_mask[0] = (1u << handle->channel_count) - 1u;
+        return true;
+    default:
+        return false;
+    }
+}
+
+UltrasoundArray_Handle_t UltrasoundArray_Init(const UltrasoundArray_Init_t *init)
+{
+    esp_err_t err = ESP_OK;
+    if ((NULL == init) || (init->channel_count == 0) || (init->channel_count > ULTRASOUND_ARRAY_MAX_CHANNELS) ||
+        (init->slot_period_us <= init->trig_signal_duration_us))
+    {
+        ESP_LOGE(LOG_TAG, "Invalid Ultrasound array configuration");
+        return NULL;
+    }
+    UltrasoundArray_Handle_t handle = (UltrasoundArray_Handle_t)heap_caps_calloc(1, sizeof(UltrasoundArray_struct_t), MALLOC_CAP_DEFAULT);
+    if (NULL == handle)
+    {
+        ESP_LOGE(LOG_TAG, "Failed to init Ultrasound array");
+        return NULL;
+    }
+    handle->channel_count = init->channel_count;
+    handle->callback = init->onScan;
+    handle->user_data = init->user_data;
+    handle->echo_source = init->echo_source;
+    handle->slot_period_us = init->slot_period_us;
+    handle->trig_signal_duration_us = init->trig_signal_duration_us;
+    handle->sound_coef = Ultrasound_SoundCoef(ULTRASOUND_SOUND_SPEED_DEFAULT, 1000000);
+    portMUX_INITIALIZE(&handle->lock);
+    if (!ultrasound_array_build_schedule(handle, init))
+    {
+        ESP_LOGE(LOG_TAG, "Invalid schedule (schedule =%u, groups =%u)", init->schedule, init->group_count);
+        heap_caps_free(handle);
+        return NULL;
+    }
+
+    uint64_t trig_mask = 0;
+    uint64_t echo_mask = 0;
+    for (uint8_t c = 0; c < handle->channel_count; ++c)
+    {
+        handle->channel[c].array = handle;
+        handle->channel[c].index = c;
+        handle->channel[c].gpio_trig_pin = init->gpio_trig_pins[c];
+        handle->channel[c].gpio_echo_pin = init->gpio_echo_pins[c];
+        trig_mask |= 1ULL << init->gpio_trig_pins[c];
+        echo_mask |= 1ULL << init->gpio_echo_pins[c];
+    }
+
+    // GPIO initialisation (skipped with a simulated echo source)
+    if (NULL == handle->echo_source)
+    {
+        gpio_config_t gpio_echo = (gpio_config_t){
+            .mode = GPIO_MODE_INPUT,
+            .intr_type = GPIO_INTR_DISABLE, // Disabled during initialization
+            .pin_bit_mask = echo_mask,
+            .pull_down_en = GPIO_PULLDOWN_DISABLE,
+            .pull_up_en = GPIO_PULLUP_DISABLE,
+        };
+        err = gpio_config(&gpio_echo);
+        if (ESP_OK != err)
+        {
+            ESP_LOGE(LOG_TAG, "Failed to init Echo GPIO (err =%u)", err);
+            heap_caps_free(handle);
+            return NULL;
+        }
+        gpio_config_t gpio_trig = (gpio_config_t){
+            .mode = GPIO_MODE_OUTPUT,
+            .intr_type = GPIO_INTR_DISABLE,
+            .pin_bit_mask = trig_mask,
+            .pull_down_en = GPIO_PULLDOWN_DISABLE,
+            .pull_up_en = GPIO_PULLUP_DISABLE,
+        };
+        err = gpio_config(&gpio_trig);
+        if (ESP_OK != err)
+        {
+            ESP_LOGE(LOG_TAG, "Failed to init Trig GPIO (err =%u)", err);
+            heap_caps_free(handle);
+            return NULL;
+        }
+
+        // Interruption initialisation : every echo pin dispatches to the same ISR with its table entry
+        err = gpio_install_isr_service(ESP_INTR_FLAG_LEVEL1);
+        if (ESP_ERR_INVALID_STATE == err)
+        {
+            ESP_LOGW(LOG_TAG, "GPIO ISR service already installed");
+        }
+        else if (ESP_OK != err)
+        {
+            ESP_LOGE(LOG_TAG, "Failed to init GPIO ISR service (err =%u)", err);
+            heap_caps_free(handle);
+            return NULL;
+        }
+        for (uint8_t c = 0; c < handle->channel_count; ++c)
+        {
+            ultrasound_gpio_echo_init(handle->channel[c].gpio_echo_pin);
+            err = gpio_isr_handler_add(handle->channel[c].gpio_echo_pin, ultrasound_array_gpio_isr_echo, &handle->channel[c]);
+            if (ESP_OK != err)
+            {
+                ESP_LOGE(LOG_TAG, "Failed to add callback to GPIO ISR service (err =%u)", err);
+                while (c > 0)
+                {
+                    gpio_isr_handler_remove(handle->channel[--c].gpio_echo_pin);
+                }
+                heap_caps_free(handle);
+                return NULL;
+            }
+        }
+    }
+
+    // Timer initialisation : one timer for the whole array
+    err = esp_timer_init();
+    if (ESP_ERR_INVALID_STATE == err)
+    {
+        ESP_LOGW(LOG_TAG, "ESP Timer service already installed");
+    }
+    else if (ESP_OK != err)
+    {
+        ESP_LOGE(LOG_TAG, "Failed to init ESP timer service (err =%u)", err);
+        heap_caps_free(handle);
+        return NULL;
+    }
+    esp_timer_create_args_t timer_create = {
+        .name = "UltraSoundArray",
+        .skip_unhandled_events = true,
+        .dispatch_method = ESP_TIMER_TASK,
+        .callback = ultrasound_array_periodic_job,
+        .arg = handle,
+    };
+    err = esp_timer_create(&timer_create, &handle->timer);
+    if (ESP_OK != err)
+    {
+        ESP_LOGE(LOG_TAG, "Failed to create timer (err =%u)", err);
+        heap_caps_free(handle);
+        return NULL;
+    }
+    return handle;
+}
+
+Ultrasound_Error_t UltrasoundArray_Start(UltrasoundArray_Handle_t handle)
+{
+    handle->slot = 0;
+    memset(&handle->frame, 0, sizeof(handle->frame));
+    handle->state = ULTRASOUND_ARRAY_STATE_SLOT_START;
+    esp_timer_start_once(handle->timer, 50); // Immediate start
+    return ESP_OK;
+}
+
+Ultrasound_Error_t UltrasoundArray_GetFrame(const UltrasoundArray_Handle_t handle, UltrasoundArray_Frame_t *frame)
+{
+    Ultrasound_Error_t err = ESP_OK;
+    taskENTER_CRITICAL(&handle->lock);
+    if (0 == handle->stats.scan_count)
+    {
+        err = ESP_ERR_INVALID_STATE;
+    }
+    else
+    {
+        *frame = handle->last_frame;
+    }
+    taskEXIT_CRITICAL(&handle->lock);
+    return err;
+}
+
+Ultrasound_Error_t UltrasoundArray_SetSoundSpeed(UltrasoundArray_Handle_t handle, Ultrasound_SoundSpeed_t speed)
+{
+    if (speed <= 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    handle->sound_coef = Ultrasound_SoundCoef(speed, 1000000); // Single word, read by the ISR
+    return ESP_OK;
+}
+
+Ultrasound_Error_t UltrasoundArray_GetDiagnostics(const UltrasoundArray_Handle_t handle, uint8_t channel, Ultrasound_Diagnostics_t *diagnostics)
+{
+    if (channel >= handle->channel_count)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    const Ultrasound_Diagnostics_t *d = &handle->channel[channel].diagnostics;
+    diagnostics->trigger_count = __atomic_load_n(&d->trigger_count, __ATOMIC_RELAXED);
+    diagnostics->success_count = __atomic_load_n(&d->success_count, __ATOMIC_RELAXED);
+    for (uint32_t i = 0; i < ULTRASOUND_FAULT_MAX; ++i)
+    {
+        diagnostics->fault_count[i] = __atomic_load_n(&d->fault_count[i], __ATOMIC_RELAXED);
+    }
+    diagnostics->success_window = __atomic_load_n(&d->success_window, __ATOMIC_RELAXED);
+    diagnostics->success_percent = __atomic_load_n(&d->success_percent, __ATOMIC_RELAXED);
+    diagnostics->health = ULTRASOUND_HEALTH_OK; // Not monitored by the array
+    for (uint32_t i = 0; i < ULTRASOUND_ECHO_HISTOGRAM_BINS; ++i)
+    {
+        diagnostics->echo_width_histogram[i] = __atomic_load_n(&d->echo_width_histogram[i], __ATOMIC_RELAXED);
+    }
+    return ESP_OK;
+}
+
+UltrasoundArray_Stats_t UltrasoundArray_GetStats(const UltrasoundArray_Handle_t handle)
+{
+    taskENTER_CRITICAL(&handle->lock);
+    UltrasoundArray_Stats_t stats = handle->stats;
+    taskEXIT_CRITICAL(&handle->lock);
+    return stats;
+}
+
+/**
+ * @brief Record a measured echo of a channel (from ISR or simulated echo source), with handle->lock held
+ */
+static inline void ultrasound_array_record(UltrasoundArray_Handle_t handle, uint8_t c, int64_t duration_us)
+{
+    const uint32_t width_us = (uint32_t)duration_us;
+    const uint32_t bin = (width_us < 2) ? 0 : (31 - __builtin_clz(width_us));
+    uint32_t *histogram = &handle->channel[c].diagnostics.echo_width_histogram[(bin < ULTRASOUND_ECHO_HISTOGRAM_BINS) ? bin : ULTRASOUND_ECHO_HISTOGRAM_BINS - 1];
+    __atomic_store_n(histogram, *histogram + 1, __ATOMIC_RELAXED);
+    handle->frame.channel[c].timestamp_us = handle->time_trig_start;
+    handle->frame.channel[c].distance_mm = Ultrasound_SoundDistanceMm(duration_us, handle->sound_coef);
+    handle->frame.valid_mask |= 1u << c;
+    handle->channel[c].state = ULTRASOUND_CHANNEL_DONE;
+}
+
+/**
+ * @brief Count the outcome of a fired channel (esp_timer task only : single writer of every counter but the histogram)
+ */
+static void ultrasound_array_outcome(UltrasoundArray_Channel_t *channel)
+{
+    Ultrasound_Diagnostics_t *d = &channel->diagnostics;
+    const bool success = (ULTRASOUND_CHANNEL_DONE == channel->state);
+    __atomic_store_n(&d->trigger_count, d->trigger_count + 1, __ATOMIC_RELAXED);
+    if (success)
+    {
+        __atomic_store_n(&d->success_count, d->success_count + 1, __ATOMIC_RELAXED);
+    }
+    else
+    {
+        const Ultrasound_Fault_t fault = (ULTRASOUND_CHANNEL_WAIT_ECHO_END == channel->state) ? ULTRASOUND_FAULT_ECHO_NOT_ENDED : ULTRASOUND_FAULT_NO_ECHO;
+        __atomic_store_n(&d->fault_count[fault], d->fault_count[fault] + 1, __ATOMIC_RELAXED);
+    }
+    const uint32_t window = (d->success_window << 1) | (success ? 1u : 0u);
+    __atomic_store_n(&d->success_window, window, __ATOMIC_RELAXED);
+    if (channel->success_window_count < ULTRASOUND_SUCCESS_WINDOW)
+    {
+        ++channel->success_window_count;
+    }
+    const uint32_t valid_mask = (channel->success_window_count >= 32) ? UINT32_MAX : (1u << channel->success_window_count) - 1;
+    const uint8_t percent = (__builtin_popcount(window & valid_mask) * 100u) / channel->success_window_count;
+    __atomic_store_n(&d->success_percent, percent, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Close the current slot : channels without echo are marked invalid, and the scan is published after the last slot
+ * @details The channels are closed under handle->lock : an echo ISR of another core either records before (DONE) or sees
+ *          the channel IDLE, it never marks a closed slot valid.
+ */
+static void ultrasound_array_end_slot(UltrasoundArray_Handle_t handle)
+{
+    const uint32_t mask = handle->slot_mask[handle->slot];
+    uint32_t missed = 0;
+    taskENTER_CRITICAL(&handle->lock);
+    for (uint8_t c = 0; c < handle->channel_count; ++c)
+    {
+        if (mask & (1u << c))
+        {
+            if (NULL == handle->echo_source)
+            {
+                ultrasound_gpio_echo_disable(handle->channel[c].gpio_echo_pin);
+            }
+            ultrasound_array_outcome(&handle->channel[c]);
+            if (ULTRASOUND_CHANNEL_DONE != handle->channel[c].state)
+            {
+                handle->frame.channel[c].timestamp_us = handle->time_trig_start;
+                handle->frame.channel[c].distance_mm = INT32_MAX;
+                ++missed;
+            }
+            handle->channel[c].state = ULTRASOUND_CHANNEL_IDLE;
+        }
+    }
+    handle->stats.missed_echo_count += missed;
+    taskEXIT_CRITICAL(&handle->lock);
+
+    if (++handle->slot < handle->slot_count)
+    {
+        return;
+    }
+    // scan complete
+    handle->slot = 0;
+    handle->frame.scan_end_us = esp_timer_get_time();
+    taskENTER_CRITICAL(&handle->lock);
+    handle->frame.scan_index = handle->stats.scan_count;
+    handle->last_frame = handle->frame;
+    handle->stats.last_scan_duration_us = handle->frame.scan_end_us - handle->frame.scan_start_us;
+    ++handle->stats.scan_count;
+    taskEXIT_CRITICAL(&handle->lock);
+    if (NULL != handle->callback)
+    {
+        handle->callback(handle, &handle->last_frame, handle->user_data);
+    }
+    handle->frame.valid_mask = 0;
+}
+
+static void ultrasound_array_periodic_job(void *args)
+{
+    UltrasoundArray_Handle_t handle = (UltrasoundArray_Handle_t)args;
+    if (NULL == args)
+    {
+        return;
+    }
+    const uint32_t mask = handle->slot_mask[handle->slot];
+    switch (handle->state)
+    {
+    case ULTRASOUND_ARRAY_STATE_SLOT_START:
+        if (NULL == handle->echo_source)
+        {
+            for (uint8_t c = 0; c < handle->channel_count; ++c)
+            {
+                if (mask & (1u << c))
+                {
+                    ultrasound_gpio_echo_disable(handle->channel[c].gpio_echo_pin);
+                    ultrasound_gpio_set_level(handle->channel[c].gpio_trig_pin, 1);
+                }
+            }
+        }
+        handle->time_trig_start = esp_timer_get_time();
+        if (0 == handle->slot)
+        {
+            handle->frame.scan_start_us = handle->time_trig_start;
+        }
+        esp_timer_start_once(handle->timer, handle->trig_signal_duration_us);
+        handle->state = ULTRASOUND_ARRAY_STATE_TRIG_END;
+        break;
+    case ULTRASOUND_ARRAY_STATE_TRIG_END:
+        esp_timer_start_once(handle->timer, handle->slot_period_us - handle->trig_signal_duration_us);
+        handle->state = ULTRASOUND_ARRAY_STATE_LISTEN;
+        for (uint8_t c = 0; c < handle->channel_count; ++c)
+        {
+            if (!(mask & (1u << c)))
+            {
+                continue;
+            }
+            handle->channel[c].state = ULTRASOUND_CHANNEL_WAIT_ECHO_START;
+            if (NULL == handle->echo_source)
+            {
+                ultrasound_gpio_set_level(handle->channel[c].gpio_trig_pin, 0);
+                ultrasound_gpio_echo_enable(handle->channel[c].gpio_echo_pin, GPIO_INTR_POSEDGE);
+            }
+            else
+            {
+                int32_t duration = handle->echo_source(c, handle->time_trig_start, handle->user_data);
+                if (duration >= 0)
+                {
+                    taskENTER_CRITICAL(&handle->lock);
+                    ultrasound_array_record(handle, c, duration);
+                    taskEXIT_CRITICAL(&handle->lock);
+                }
+            }
+        }
+        break;
+    case ULTRASOUND_ARRAY_STATE_LISTEN:
+        ultrasound_array_end_slot(handle);
+        handle->state = ULTRASOUND_ARRAY_STATE_SLOT_START;
+        ultrasound_array_periodic_job(args); // Call itself to start next slot
+        break;
+    default:
+        break;
+    }
+}
+
+static void ultrasound_array_gpio_isr_echo(void *args)
+{
+    UltrasoundArray_Channel_t *channel = (UltrasoundArray_Channel_t *)args;
+    if (NULL == args)
+    {
+        return;
+    }
+    portENTER_CRITICAL_ISR(&channel->array->lock); // The esp_timer task may be closing the slot on the other core
+    switch (channel->state)
+    {
+    case ULTRASOUND_CHANNEL_WAIT_ECHO_START:
+        channel->time_echo_start = esp_timer_get_time();
+        channel->state = ULTRASOUND_CHANNEL_WAIT_ECHO_END;
+        ultrasound_gpio_echo_edge(channel->gpio_echo_pin, GPIO_INTR_NEGEDGE);
+        break;
+    case ULTRASOUND_CHANNEL_WAIT_ECHO_END:
+        ultrasound_gpio_echo_disable(channel->gpio_echo_pin);
+        ultrasound_array_record(channel->array, channel->index, esp_timer_get_time() - channel->time_echo_start);
+        break;
+    default:
+        break;
+    }
+    portEXIT_CRITICAL_ISR(&channel->array->lock);
+}
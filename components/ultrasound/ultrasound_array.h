@@ -0,0 +1,149 @@
+#ifndef ULTRASOUND_ARRAY_LIB__
+#define ULTRASOUND_ARRAY_LIB__
+#include <stdint.h>
+#include "driver/gpio.h"
+#include "ultrasound.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ULTRASOUND_ARRAY_MAX_CHANNELS 8 //< Maximum number of sensors driven by one array
+
+/**
+ * @brief Handle definition: UltrasoundArray_t is a private type
+ *
+ */
+struct UltrasoundArray_t;
+typedef struct UltrasoundArray_t *UltrasoundArray_Handle_t;
+
+/**
+ * @brief Firing schedule of the sensors
+ *
+ */
+typedef enum {
+  ULTRASOUND_SCHEDULE_ROUND_ROBIN = 0, //< One sensor per slot : no cross-talk, N slots per scan
+  ULTRASOUND_SCHEDULE_INTERLEAVED,     //< Channel c fires in slot c % group_count : non adjacent sensors share a slot
+  ULTRASOUND_SCHEDULE_ALL_AT_ONCE,     //< All sensors fire in the same slot : sensors must not see each other
+} UltrasoundArray_Schedule_t;
+
+/**
+ * @brief One complete scan of the array
+ *
+ */
+typedef struct {
+  Ultrasound_Measurement_t channel[ULTRASOUND_ARRAY_MAX_CHANNELS]; //< distance_mm is INT32_MAX if no echo
+  uint32_t valid_mask;      //< Bit c is set if channel c got an echo during this scan
+  uint32_t scan_index;      //< Number of the scan since start
+  int64_t scan_start_us;    //< Time of the first trigger of the scan
+  int64_t scan_end_us;      //< Time the scan was completed
+} UltrasoundArray_Frame_t;
+
+/**
+ * @brief Complete scan callback (called from the esp_timer task)
+ *
+ */
+typedef void (*UltrasoundArray_Callback_t)(UltrasoundArray_Handle_t handle,
+                                           const UltrasoundArray_Frame_t *frame,
+                                           void *user_data);
+
+/**
+ * @brief Simulated echo source : returns the echo duration in us of a channel, or a negative value for no echo.
+ * When set, the GPIO are not used, which allows to run the scheduling logic without sensors.
+ *
+ */
+typedef int32_t (*UltrasoundArray_EchoSource_t)(uint8_t channel,
+                                                int64_t trig_time_us,
+                                                void *user_data);
+
+/**
+ * @brief Ultrasound array init structure
+ *
+ */
+typedef struct {
+  uint8_t channel_count;                                  //< Number of sensors (at most ULTRASOUND_ARRAY_MAX_CHANNELS)
+  gpio_num_t gpio_trig_pins[ULTRASOUND_ARRAY_MAX_CHANNELS]; //< Trigger pin of each sensor
+  gpio_num_t gpio_echo_pins[ULTRASOUND_ARRAY_MAX_CHANNELS]; //< Echo pin of each sensor
+  UltrasoundArray_Schedule_t schedule; //< Firing schedule
+  uint8_t group_count;                 //< Number of slots of the interleaved schedule (e.g. 2 : even then odd channels)
+  uint32_t slot_period_us;             //< Listening window of a slot (at least 25000 us for 4 m)
+  uint32_t trig_signal_duration_us;    //< Trig signal duration (should be 10us, 50us should be fine)
+  UltrasoundArray_Callback_t onScan;   //< Called when a scan is complete
+  void *user_data;                     //< User data for callback argument
+  UltrasoundArray_EchoSource_t echo_source; //< NULL on hardware, simulated echo source otherwise
+} UltrasoundArray_Init_t;
+
+/**
+ * @brief Scan statistics
+ *
+ */
+typedef struct {
+  uint32_t scan_count;            //< Number of completed scans
+  int64_t last_scan_duration_us;  //< Duration of the last scan
+  uint32_t missed_echo_count;     //< Number of slots a channel did not get an echo
+} UltrasoundArray_Stats_t;
+
+/**
+ * @brief Create Ultrasound array instance : one timer and one ISR dispatch table for all sensors
+ *
+ * @param init Initialisation structure
+ * @return UltrasoundArray_Handle_t NULL if initialization failed
+ */
+UltrasoundArray_Handle_t UltrasoundArray_Init(const UltrasoundArray_Init_t *init);
+
+/**
+ * @brief Start automatic scanning
+ *
+ * @param handle Ultrasound array handle
+ * @return Ultrasound_Error_t
+ */
+Ultrasound_Error_t UltrasoundArray_Start(UltrasoundArray_Handle_t handle);
+
+/**
+ * @brief Get the last complete scan
+ *
+ * @param handle Ultrasound array handle
+ * @param frame copy of the last complete scan
+ * @return Ultrasound_Error_t ESP_ERR_INVALID_STATE if no scan was completed yet
+ */
+Ultrasound_Error_t UltrasoundArray_GetFrame(const UltrasoundArray_Handle_t handle,
+                                            UltrasoundArray_Frame_t *frame);
+
+/**
+ * @brief Set the speed of sound used for the distances of all channels
+ * (applied from the next echo), see Ultrasound_SoundSpeedFromAir
+ *
+ * @param handle Ultrasound array handle
+ * @param speed FixedPoint<10, 16> raw value in m/s
+ * @return Ultrasound_Error_t ESP_ERR_INVALID_ARG if not positive
+ */
+Ultrasound_Error_t UltrasoundArray_SetSoundSpeed(UltrasoundArray_Handle_t handle,
+                                                 Ultrasound_SoundSpeed_t speed);
+
+/**
+ * @brief Get the diagnostics counters of one sensor (lock free: each counter is
+ * read atomically, but counters may be from different scans). The outcome of a
+ * channel is decided when its slot closes : NO_ECHO or ECHO_NOT_ENDED, the array
+ * does not reject spikes nor monitor the health (always ULTRASOUND_HEALTH_OK)
+ *
+ * @param handle Ultrasound array handle
+ * @param channel Sensor number
+ * @param diagnostics Output counters
+ * @return Ultrasound_Error_t ESP_ERR_INVALID_ARG if channel is out of range
+ */
+Ultrasound_Error_t UltrasoundArray_GetDiagnostics(const UltrasoundArray_Handle_t handle,
+                                                  uint8_t channel,
+                                                  Ultrasound_Diagnostics_t *diagnostics);
+
+/**
+ * @brief Get scan statistics (scan rate is 1e6 / last_scan_duration_us)
+ *
+ * @param handle Ultrasound array handle
+ * @return UltrasoundArray_Stats_t
+ */
+UltrasoundArray_Stats_t UltrasoundArray_GetStats(const UltrasoundArray_Handle_t handle);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /*ULTRASOUND_ARRAY_LIB__*/
@@ -0,0 +1,210 @@
+#include "ultrasound_hal.h"
+#include "freertos/FreeRTOS.h"
+#include "driver/mcpwm_cap.h"
+#include "esp_attr.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "soc/soc_caps.h"
+
+/**
+ * @brief Capture timer of a MCPWM group, shared by the channels of the group
+ * @details A group has a single capture timer (SOC_MCPWM_CAPTURE_TIMERS_PER_GROUP) and SOC_MCPWM_CAPTURE_CHANNELS_PER_TIMER
+ *          channels, so the sensors fill group 0 then group 1 : ULTRASOUND_MCPWM_MAX_SENSORS sensors at most (6 on ESP32-S3).
+ *          The table is only used by init and deinit, which run in task context and not concurrently.
+ */
+typedef struct
+{
+    mcpwm_cap_timer_handle_t timer; //< Capture timer of the group (NULL if not created)
+    uint32_t resolution_hz;         //< Tick frequency of the timer
+    uint8_t users;                  //< Capture channels on the timer
+} Ultrasound_McpwmGroup_t;
+
+static Ultrasound_McpwmGroup_t s_groups[SOC_MCPWM_GROUPS];
+
+/**
+ * @brief Private MCPWM capture backend structure
+ *
+ */
+typedef struct
+{
+    Ultrasound_McpwmGroup_t *group;   //< Group of the capture timer (free running, shared)
+    mcpwm_cap_channel_handle_t chan;  //< Capture channel on the echo pin
+    uint32_t rising_value;            //< Latched value of the rising edge
+    volatile bool armed;              //< Deliver the next complete pulse
+    volatile bool rising_seen;        //< Rising edge latched since armed
+    Ultrasound_CaptureDone_t done;    //< Driver callback
+    void *ctx;                        //< Driver context
+} Ultrasound_Mcpwm_t;
+
+static const char *LOG_TAG = "ULTRA_MCPWM";
+
+/**
+ * @brief Capture event of one edge
+ * @details Both edges raise a capture interrupt, so a pulse costs 2 ISRs as with the GPIO backend : the gain is that the edges
+ *          are latched by hardware, so the ISR latency and the jitter of the other ISRs do not change the measured width.
+ *          The rising edge ISR only stores the latched value, the pulse is delivered by the falling edge ISR.
+ */
+static bool IRAM_ATTR ultrasound_mcpwm_on_capture(mcpwm_cap_channel_handle_t chan, const mcpwm_capture_event_data_t *edata, void *user_data)
+{
+    Ultrasound_Mcpwm_t *backend = (Ultrasound_Mcpwm_t *)user_data;
+    if (!backend->armed)
+    {
+        return false;
+    }
+    if (MCPWM_CAP_EDGE_POS == edata->cap_edge)
+    {
+        backend->rising_value = edata->cap_value;
+        backend->rising_seen = true;
+    }
+    else if (backend->rising_seen)
+    {
+        backend->armed = false;
+        backend->rising_seen = false;
+        backend->done(backend->ctx, edata->cap_value - backend->rising_value); // unsigned difference handles timer wrap
+    }
+    return false;
+}
+
+/**
+ * @brief Release a channel of a group : the capture timer is deleted with its last channel
+ */
+static void ultrasound_mcpwm_group_release(Ultrasound_McpwmGroup_t *group)
+{
+    if ((0 == group->users) || (0 == --group->users))
+    {
+        mcpwm_capture_timer_stop(group->timer);
+        mcpwm_capture_timer_disable(group->timer);
+        mcpwm_del_capture_timer(group->timer);
+        group->timer = NULL;
+    }
+}
+
+/**
+ * @brief Create the capture timer of a group if needed
+ */
+static esp_err_t ultrasound_mcpwm_group_acquire(int group_id)
+{
+    Ultrasound_McpwmGroup_t *group = &s_groups[group_id];
+    if (NULL != group->timer)
+    {
+        return ESP_OK;
+    }
+    mcpwm_capture_timer_config_t timer_config = {
+        .group_id = group_id,
+        .clk_src = MCPWM_CAPTURE_CLK_SRC_DEFAULT,
+    };
+    esp_err_t err = mcpwm_new_capture_timer(&timer_config, &group->timer);
+    if (ESP_OK != err)
+    {
+        group->timer = NULL;
+        return err;
+    }
+    err = mcpwm_capture_timer_enable(group->timer);
+    if (ESP_OK == err)
+        err = mcpwm_capture_timer_start(group->timer);
+    if (ESP_OK == err)
+        err = mcpwm_capture_timer_get_resolution(group->timer, &group->resolution_hz);
+    if (ESP_OK != err)
+    {
+        ultrasound_mcpwm_group_release(group);
+    }
+    return err;
+}
+
+static esp_err_t ultrasound_mcpwm_init(void **out, gpio_num_t gpio_echo_pin, Ultrasound_CaptureDone_t done, void *ctx)
+{
+    esp_err_t err = ESP_ERR_NOT_FOUND;
+    Ultrasound_Mcpwm_t *backend = (Ultrasound_Mcpwm_t *)heap_caps_calloc(1, sizeof(Ultrasound_Mcpwm_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (NULL == backend)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+    backend->done = done;
+    backend->ctx = ctx;
+
+    mcpwm_capture_channel_config_t chan_config = {
+        .gpio_num = gpio_echo_pin,
+        .prescale = 1,
+        .flags.pos_edge = true,
+        .flags.neg_edge = true,
+        .flags.pull_up = false,
+    };
+    // First group with a free capture channel
+    for (int g = 0; (g < SOC_MCPWM_GROUPS) && (NULL == backend->group); ++g)
+    {
+        if (ESP_OK != ultrasound_mcpwm_group_acquire(g))
+        {
+            continue; // Capture timer of the group used outside of this driver
+        }
+        err = mcpwm_new_capture_channel(s_groups[g].timer, &chan_config, &backend->chan);
+        if (ESP_OK == err)
+        {
+            backend->group = &s_groups[g];
+            ++backend->group->users;
+        }
+        else if (0 == s_groups[g].users)
+        {
+            ultrasound_mcpwm_group_release(&s_groups[g]);
+        }
+    }
+    if (NULL == backend->group)
+    {
+        ESP_LOGE(LOG_TAG, "No free capture channel, at most %u sensors (err =%u)", ULTRASOUND_MCPWM_MAX_SENSORS, err);
+        heap_caps_free(backend);
+        return err;
+    }
+    mcpwm_capture_event_callbacks_t callbacks = {
+        .on_cap = ultrasound_mcpwm_on_capture,
+    };
+    err = mcpwm_capture_channel_register_event_callbacks(backend->chan, &callbacks, backend);
+    if (ESP_OK == err)
+        err = mcpwm_capture_channel_enable(backend->chan);
+    if (ESP_OK != err)
+    {
+        ESP_LOGE(LOG_TAG, "Failed to start capture (err =%u)", err);
+        mcpwm_del_capture_channel(backend->chan);
+        ultrasound_mcpwm_group_release(backend->group);
+        heap_caps_free(backend);
+        return err;
+    }
+    *out = backend;
+    return ESP_OK;
+}
+
+static esp_err_t ultrasound_mcpwm_arm(void *args)
+{
+    Ultrasound_Mcpwm_t *backend = (Ultrasound_Mcpwm_t *)args;
+    backend->rising_seen = false;
+    backend->armed = true;
+    return ESP_OK;
+}
+
+static esp_err_t ultrasound_mcpwm_disarm(void *args)
+{
+    Ultrasound_Mcpwm_t *backend = (Ultrasound_Mcpwm_t *)args;
+    backend->armed = false;
+    return ESP_OK;
+}
+
+static esp_err_t ultrasound_mcpwm_deinit(void *args)
+{
+    Ultrasound_Mcpwm_t *backend = (Ultrasound_Mcpwm_t *)args;
+    mcpwm_capture_channel_disable(backend->chan);
+    mcpwm_del_capture_channel(backend->chan);
+    ultrasound_mcpwm_group_release(backend->group);
+    heap_caps_free(backend);
+    return ESP_OK;
+}
+
+static uint32_t ultrasound_mcpwm_get_resolution_hz(void *args)
+{
+    return ((Ultrasound_Mcpwm_t *)args)->group->resolution_hz;
+}
+
+const Ultrasound_CaptureHal_t Ultrasound_CaptureHal_Mcpwm = {
+    .init = ultrasound_mcpwm_init,
+    .arm = ultrasound_mcpwm_arm,
+    .disarm = ultrasound_mcpwm_disarm,
+    .deinit = ultrasound_mcpwm_deinit,
+    .get_resolution_hz = ultrasound_mcpwm_get_resolution_hz,
+};
@@ -0,0 +1,80 @@
+/**
+ * @file ultrasound_gpio.h
+ * @brief Private GPIO accesses of the trigger/echo hot paths
+ * @details With CONFIG_ULTRASOUND_DIRECT_REGISTERS, the accesses go through the register accessors generated from
+ *          esp32s3.svd (tools/svd2regs.py, run by the component CMakeLists): a trigger edge is a single store to
+ *          OUT_W1TS/OUT_W1TC and the echo interrupt is switched with the INT_TYPE field of the pin (0 disables it),
+ *          INT_ENA being set once at init. Otherwise the IDF GPIO driver is used.
+ *          The echo pin register is modified without lock: it must only be used by this driver.
+ */
+#ifndef ULTRASOUND_GPIO_H_
+#define ULTRASOUND_GPIO_H_
+
+#include "sdkconfig.h"
+#include "driver/gpio.h"
+
+#if CONFIG_ULTRASOUND_DIRECT_REGISTERS
+#include "esp32s3_gpio_regs.h"
+
+static inline __attribute__((always_inline)) void ultrasound_gpio_set_level(gpio_num_t pin, uint32_t level)
+{
+    const uint32_t mask = 1u << (pin & 31);
+    if (pin < 32)
+    {
+        level ? svd_gpio_out_w1ts_write(mask) : svd_gpio_out_w1tc_write(mask);
+    }
+    else
+    {
+        level ? svd_gpio_out1_w1ts_write(mask) : svd_gpio_out1_w1tc_write(mask);
+    }
+}
+
+static inline __attribute__((always_inline)) void ultrasound_gpio_echo_init(gpio_num_t pin)
+{
+    gpio_intr_enable(pin); // INT_ENA routes the pin to the core of the GPIO ISR service
+    svd_gpio_pin_int_type_set(pin, GPIO_INTR_DISABLE);
+}
+
+static inline __attribute__((always_inline)) void ultrasound_gpio_echo_enable(gpio_num_t pin, gpio_int_type_t type)
+{
+    svd_gpio_pin_int_type_set(pin, type);
+}
+
+static inline __attribute__((always_inline)) void ultrasound_gpio_echo_edge(gpio_num_t pin, gpio_int_type_t type)
+{
+    svd_gpio_pin_int_type_set(pin, type);
+}
+
+static inline __attribute__((always_inline)) void ultrasound_gpio_echo_disable(gpio_num_t pin)
+{
+    svd_gpio_pin_int_type_set(pin, GPIO_INTR_DISABLE);
+}
+#else
+static inline void ultrasound_gpio_set_level(gpio_num_t pin, uint32_t level)
+{
+    gpio_set_level(pin, level);
+}
+
+static inline void ultrasound_gpio_echo_init(gpio_num_t pin)
+{
+    gpio_intr_disable(pin);
+}
+
+static inline void ultrasound_gpio_echo_enable(gpio_num_t pin, gpio_int_type_t type)
+{
+    gpio_set_intr_type(pin, type);
+    gpio_intr_enable(pin);
+}
+
+static inline void ultrasound_gpio_echo_edge(gpio_num_t pin, gpio_int_type_t type)
+{
+    gpio_set_intr_type(pin, type);
+}
+
+static inline void ultrasound_gpio_echo_disable(gpio_num_t pin)
+{
+    gpio_intr_disable(pin);
+}
+#endif
+
+#endif /*ULTRASOUND_GPIO_H_*/
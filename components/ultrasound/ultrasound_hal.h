@@ -0,0 +1,52 @@
+#ifndef ULTRASOUND_HAL_LIB__
+#define ULTRASOUND_HAL_LIB__
+#include <stdint.h>
+#include "esp_err.h"
+#include "driver/gpio.h"
+#include "soc/soc_caps.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Called by the capture backend when a complete echo pulse was latched (called from ISR context)
+ *
+ * @param ctx driver context given at init
+ * @param pulse_ticks width of the echo pulse in ticks of the backend
+ */
+typedef void (*Ultrasound_CaptureDone_t)(void *ctx, uint32_t pulse_ticks);
+
+/**
+ * @brief Echo capture backend : edges are latched by a peripheral, and only the finished pulse is delivered to the driver.
+ * A custom implementation can be given through Ultrasound_Init_t (e.g. a mock for host tests)
+ *
+ */
+typedef struct {
+  esp_err_t (*init)(void **backend, gpio_num_t gpio_echo_pin,
+                    Ultrasound_CaptureDone_t done, void *ctx); //< Create the backend on the echo pin
+  esp_err_t (*arm)(void *backend);    //< Deliver the next complete pulse
+  esp_err_t (*disarm)(void *backend); //< Ignore edges (e.g. during the trigger)
+  esp_err_t (*deinit)(void *backend); //< Release the peripheral
+  uint32_t (*get_resolution_hz)(void *backend); //< Tick frequency of pulse_ticks
+} Ultrasound_CaptureHal_t;
+
+/**
+ * @brief Maximum number of sensors of the MCPWM capture backend : one capture channel per sensor, on the capture timer of
+ * each MCPWM group (2 groups of 3 channels on ESP32-S3)
+ *
+ */
+#define ULTRASOUND_MCPWM_MAX_SENSORS (SOC_MCPWM_GROUPS * SOC_MCPWM_CAPTURE_CHANNELS_PER_TIMER)
+
+/**
+ * @brief Backend based on the MCPWM capture unit : edges are timestamped by hardware, so ISR latency does not change the measure.
+ * Both edges still raise an interrupt (the pulse is delivered by the falling one), and Ultrasound_Init fails for the
+ * sensors beyond ULTRASOUND_MCPWM_MAX_SENSORS
+ *
+ */
+extern const Ultrasound_CaptureHal_t Ultrasound_CaptureHal_Mcpwm;
+
+#ifdef __cplusplus
+}
+#endif
+#endif /*ULTRASOUND_HAL_LIB__*/
@@ -0,0 +1,69 @@
+#ifndef ULTRASOUND_SOUND_LIB__
+#define ULTRASOUND_SOUND_LIB__
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Speed of sound in m/s, same layout as the raw value of FixedPoint<10, 16>
+ *
+ */
+typedef int32_t Ultrasound_SoundSpeed_t;
+
+/**
+ * @brief Temperature in °C, same layout as the raw value of FixedPoint<7, 8>
+ *
+ */
+typedef int32_t Ultrasound_Temperature_t;
+
+#define ULTRASOUND_SOUND_SPEED_DEFAULT ((Ultrasound_SoundSpeed_t)343 << 16) //< 343 m/s (20 °C, dry air)
+#define ULTRASOUND_SOUND_COEF_SHIFT 32 //< distance_mm = (echo_ticks * coef) >> ULTRASOUND_SOUND_COEF_SHIFT
+
+/**
+ * @brief Speed of sound in air: c = 331.3 * sqrt(1 + T / 273.15) + 0.0124 * RH (m/s)
+ * @details The square root is replaced by its 2nd order expansion 331.3 + 0.6064 * T - 0.000555 * T^2,
+ *          within 0.05% from -10 °C to 50 °C
+ *
+ * @param temperature air temperature (FixedPoint<7, 8> raw value, °C)
+ * @param humidity_percent relative humidity (0 to 100)
+ * @return Ultrasound_SoundSpeed_t speed of sound (FixedPoint<10, 16> raw value, m/s)
+ */
+static inline Ultrasound_SoundSpeed_t Ultrasound_SoundSpeedFromAir(Ultrasound_Temperature_t temperature, uint8_t humidity_percent)
+{
+    return 21712077                                                  // 331.3 * 2^16
+           + ((39743 * (int64_t)temperature) >> 8)                   // 0.6064 * 2^16, temperature has 8 fractional bits
+           - ((36 * (int64_t)temperature * temperature) >> 16)       // 0.000555 * 2^16
+           + 813 * (int32_t)humidity_percent;                        // 0.0124 * 2^16
+}
+
+/**
+ * @brief Coefficient converting an echo width in ticks into a distance, so the ISR only does one multiply-shift
+ * @details coef = c * 1000 / 2 / resolution_hz * 2^32 (half of the round trip, in mm)
+ *
+ * @param speed speed of sound (FixedPoint<10, 16> raw value, m/s)
+ * @param resolution_hz tick frequency of the echo width (1000000 for us)
+ * @return uint32_t coefficient for Ultrasound_SoundDistanceMm
+ */
+static inline uint32_t Ultrasound_SoundCoef(Ultrasound_SoundSpeed_t speed, uint32_t resolution_hz)
+{
+    return (uint32_t)((((uint64_t)speed * 500u) << (ULTRASOUND_SOUND_COEF_SHIFT - 16)) / resolution_hz);
+}
+
+/**
+ * @brief Distance of an echo (ISR safe, no division)
+ *
+ * @param echo_ticks echo width in ticks
+ * @param coef coefficient from Ultrasound_SoundCoef
+ * @return int32_t distance in mm
+ */
+static inline int32_t Ultrasound_SoundDistanceMm(uint32_t echo_ticks, uint32_t coef)
+{
+    return (int32_t)(((uint64_t)echo_ticks * coef) >> ULTRASOUND_SOUND_COEF_SHIFT);
+}
+
+#ifdef __cplusplus
+}
+#endif
+#endif /*ULTRASOUND_SOUND_LIB__*/
@@ -0,0 +1,52 @@
+/**
+ * @file bench.hpp
+ * @brief Timing of the host benchmarks of sim/bench : best of 5 runs of the steady clock, in host nanoseconds
+ */
+#ifndef WSIM_BENCH_HPP_
+#define WSIM_BENCH_HPP_
+
+#include <algorithm>
+#include <chrono>
+
+namespace wsim_bench
+{
+	/**
+	 * @brief Host time of fn(), in ns
+	 *
+	 */
+	template <typename Fn>
+	inline double elapsed_ns(Fn fn)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		fn();
+		const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+		return elapsed.count();
+	}
+
+	/**
+	 * @brief Smallest result of 5 runs of run(), which returns a time : filters the noise of the host (interrupts, other
+	 *        processes, frequency changes), which only adds time
+	 *
+	 */
+	template <typename Run>
+	inline double best_of_5(Run run)
+	{
+		double best = run();
+		for (int i = 1; i < 5; ++i)
+			best = std::min(best, run());
+		return best;
+	}
+
+	/**
+	 * @brief Best of 5 runs of fn(), in ns per unit of work, for units units done by each call of fn()
+	 *
+	 */
+	template <typename Fn>
+	inline double ns_per(double units, Fn fn)
+	{
+		return best_of_5([&]()
+						 { return elapsed_ns(fn) / units; });
+	}
+};
+
+#endif /*WSIM_BENCH_HPP_*/
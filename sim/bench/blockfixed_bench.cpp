@@ -0,0 +1,66 @@
+/**
+ * @file blockfixed_bench.cpp
+ * @brief Host time of the BlockFixed operations per sample, against the same operations on an array of FixedPoint
+ *
+ * usage: blockfixed_bench [iterations]
+ *        the numbers are host nanoseconds per sample : they rank the operations on the host only, no cycle count of the target is measured
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include "blockfixed.hpp"
+#include "bench.hpp"
+
+static constexpr std::size_t N = 256;
+
+template <typename Op>
+static double ns_per_sample(int iterations, Op op)
+{
+    return wsim_bench::ns_per(double(iterations) * N, [&]()
+                              {
+        for (int it = 0; it < iterations; ++it)
+            op(); });
+}
+
+template <typename M>
+static void bench(const char *name, const int32_t (&samples)[N], int iterations)
+{
+    static BlockFixed<N, M> block;
+    static FixedPoint<8, 16> out[N];
+    volatile int32_t sink = 0;
+    const FixedPoint<2, 12> gain(0.75);
+    const double load = ns_per_sample(iterations, [&]()
+                                      { block.load(samples, -16); sink = sink + block.getExponent(); });
+    const double scale = ns_per_sample(iterations, [&]()
+                                       { block.scale(gain); sink = sink + block.getExponent(); block.load(samples, -16); });
+    const double normalize = ns_per_sample(iterations, [&]()
+                                           { block.data()[0] = static_cast<M>(block.data()[0] / 2); block.normalize(); sink = sink + block.getExponent(); });
+    const double store = ns_per_sample(iterations, [&]()
+                                       { block.store(out); sink = sink + out[N - 1].getM(); });
+    printf("| %-26s | %5.2f | %5.2f | %5.2f | %5.2f | %6zu |\n", name, load, scale - load, normalize, store, sizeof(block));
+}
+
+int main(int argc, char **argv)
+{
+    const int iterations = (argc > 1) ? atoi(argv[1]) : 20000;
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<int32_t> dist(-(1 << 20), 1 << 20);
+    static int32_t samples[N];
+    for (auto &s : samples)
+        s = dist(rng);
+
+    printf("| %-26s | %5s | %5s | %5s | %5s | %6s |\n", "ns per sample", "load", "scale", "norm", "store", "bytes");
+    bench<int16_t>("BlockFixed<256, int16_t>", samples, iterations);
+    bench<int32_t>("BlockFixed<256, int32_t>", samples, iterations);
+
+    // the same frame as an array of FixedPoint : conversion from the samples and product by the gain
+    static FixedPoint<8, 16> values[N];
+    volatile int32_t sink = 0;
+    const FixedPoint<2, 12> gain(0.75);
+    const double load = ns_per_sample(iterations, [&]()
+                                      { for (std::size_t i = 0; i < N; ++i) values[i] = FixedPoint<8, 16>(static_cast<FixedPoint<8, 16>::raw_t>(samples[i])); sink = sink + values[N - 1].getM(); });
+    const double scale = ns_per_sample(iterations, [&]()
+                                       { for (std::size_t i = 0; i < N; ++i) values[i] = FixedPoint<8, 16>(values[i] * gain); sink = sink + values[N - 1].getM(); });
+    printf("| %-26s | %5.2f | %5.2f | %5s | %5s | %6zu |\n", "FixedPoint<8, 16>[256]", load, scale, "-", "-", sizeof(values));
+    return 0;
+}
@@ -0,0 +1,172 @@
+/**
+ * @file controller_bench.cpp
+ * @brief Host time of one step of the controllers (Pid, Biquad, StateSpace) in FixedPoint<10, 16> / FixedPoint<4, 16>
+ *        against the same controllers in float
+ *
+ * usage: controller_bench [steps]
+ *        the numbers are host nanoseconds, with a FPU : on the target float uses the single precision FPU of the core
+ */
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include "controller.hpp"
+#include "bench.hpp"
+
+using Value_t = FixedPoint<10, 16>;
+using Coef_t = FixedPoint<4, 16>;
+
+template <typename Step>
+static double ns_per_step(int steps, Step step)
+{
+    return wsim_bench::ns_per(steps, [&]()
+                              {
+        for (int k = 0; k < steps; ++k)
+            step(k); });
+}
+
+/**
+ * @brief Float Pid with the structure of Pid (derivative on measurement, conditional integration)
+ */
+struct FloatPid
+{
+    float kp, ki_ts, kd_ts, d_alpha, kff, out_min, out_max;
+    float integral = 0, derivative = 0, previous_measure = 0;
+
+    float step(float setpoint, float measure, float feedforward)
+    {
+        const float error = setpoint - measure;
+        float i = integral + ki_ts * error;
+        derivative += d_alpha * (kd_ts * (previous_measure - measure) - derivative);
+        previous_measure = measure;
+        float out = kp * error + i + derivative + kff * feedforward;
+        if (out > out_max)
+        {
+            out = out_max;
+            if (error > 0)
+                i = integral;
+        }
+        else if (out < out_min)
+        {
+            out = out_min;
+            if (error < 0)
+                i = integral;
+        }
+        integral = i;
+        return out;
+    }
+};
+
+/**
+ * @brief Float Biquad, transposed direct form II as Biquad
+ */
+struct FloatBiquad
+{
+    float b0, b1, b2, a1, a2;
+    float s1 = 0, s2 = 0;
+
+    float step(float x)
+    {
+        const float y = b0 * x + s1;
+        s1 = b1 * x - a1 * y + s2;
+        s2 = b2 * x - a2 * y;
+        return y;
+    }
+};
+
+/**
+ * @brief Float StateSpace with NY = NU, same loops as StateSpace
+ */
+template <size_t NX, size_t NU>
+struct FloatStateSpace
+{
+    float A[NX][NX], B[NX][NU], C[NU][NX], D[NU][NU];
+    float x[NX] = {};
+
+    void step(const float (&u)[NU], float (&y)[NU])
+    {
+        misc::unroll<NU>([&](size_t r)
+                         { y[r] = row(C[r], D[r], u); });
+        float next[NX];
+        misc::unroll<NX>([&](size_t r)
+                         { next[r] = row(A[r], B[r], u); });
+        misc::unroll<NX>([&](size_t r)
+                         { x[r] = next[r]; });
+    }
+
+    float row(const float (&m)[NX], const float (&n)[NU], const float (&u)[NU]) const
+    {
+        float acc = 0;
+        misc::unroll<NX>([&](size_t i)
+                         { acc += m[i] * x[i]; });
+        misc::unroll<NU>([&](size_t i)
+                         { acc += n[i] * u[i]; });
+        return acc;
+    }
+};
+
+template <size_t NX, size_t NU>
+static void statespace(const char *name, int steps)
+{
+    volatile double coef = 0.9 / NX; // dense matrices unknown to the compiler
+    typename StateSpace<NX, NU, NU, Value_t, Coef_t>::Matrices m;
+    for (size_t r = 0; r < NX; ++r)
+    {
+        for (size_t c = 0; c < NX; ++c)
+            m.A[r][c] = Coef_t(coef);
+        for (size_t c = 0; c < NU; ++c)
+            m.B[r][c] = Coef_t(coef);
+    }
+    for (size_t r = 0; r < NU; ++r)
+    {
+        for (size_t c = 0; c < NX; ++c)
+            m.C[r][c] = Coef_t(coef);
+        for (size_t c = 0; c < NU; ++c)
+            m.D[r][c] = Coef_t(coef);
+    }
+    StateSpace<NX, NU, NU, Value_t, Coef_t> ss(m);
+    FloatStateSpace<NX, NU> fss;
+    std::fill(&fss.A[0][0], &fss.A[0][0] + NX * NX, float(coef));
+    std::fill(&fss.B[0][0], &fss.B[0][0] + NX * NU, float(coef));
+    std::fill(&fss.C[0][0], &fss.C[0][0] + NU * NX, float(coef));
+    std::fill(&fss.D[0][0], &fss.D[0][0] + NU * NU, float(coef));
+    volatile int32_t sink = 0;
+    volatile float sinkf = 0;
+    printf("| %-20s | %8.2f | %8.2f |\n", name, ns_per_step(steps, [&](int k)
+                                                               {
+                                                                   Value_t u[NU], y[NU];
+                                                                   std::fill(u, u + NU, Value_t(k & 63));
+                                                                   ss.step(u, y);
+                                                                   sink = y[0].getM(); }),
+           ns_per_step(steps, [&](int k)
+                       {
+                           float u[NU], y[NU];
+                           std::fill(u, u + NU, float(k & 63));
+                           fss.step(u, y);
+                           sinkf = y[0]; }));
+}
+
+int main(int argc, char **argv)
+{
+    const int steps = (argc > 1) ? atoi(argv[1]) : 1000000;
+    volatile double one = 1.0; // gains unknown to the compiler
+    const auto gains = Pid<Value_t, Coef_t>::discretize(2.0 * one, 5.0 * one, 0.1 * one, 0.01, 0.02, 1.0 * one, -100, 100);
+    Pid<Value_t, Coef_t> pid(gains);
+    Biquad<Value_t, Coef_t> biquad({Coef_t(0.0675 * one), Coef_t(0.135 * one), Coef_t(0.0675 * one), Coef_t(-1.143 * one), Coef_t(0.4128 * one)});
+    FloatPid fpid{float(gains.kp), float(gains.ki_ts), float(gains.kd_ts), float(gains.d_alpha), float(gains.kff), -100, 100};
+    FloatBiquad fbiquad{float(0.0675 * one), float(0.135 * one), float(0.0675 * one), float(-1.143 * one), float(0.4128 * one)};
+    volatile int32_t sink = 0;
+    volatile float sinkf = 0;
+    printf("| %-20s | %8s | %8s |\n", "controller", "fixed ns", "float ns");
+    printf("| %-20s | %8.2f | %8.2f |\n", "Pid", ns_per_step(steps, [&](int k)
+                                                              { sink = pid.step(Value_t(10), Value_t(k & 15), Value_t(1)).getM(); }),
+           ns_per_step(steps, [&](int k)
+                       { sinkf = fpid.step(10, float(k & 15), 1); }));
+    printf("| %-20s | %8.2f | %8.2f |\n", "Biquad", ns_per_step(steps, [&](int k)
+                                                                 { sink = biquad.step(Value_t(k & 63)).getM(); }),
+           ns_per_step(steps, [&](int k)
+                       { sinkf = fbiquad.step(float(k & 63)); }));
+    statespace<2, 1>("StateSpace<2, 1, 1>", steps);
+    statespace<4, 2>("StateSpace<4, 2, 2>", steps);
+    statespace<6, 3>("StateSpace<6, 3, 3>", steps);
+    return 0;
+}
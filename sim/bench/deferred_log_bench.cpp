@@ -0,0 +1,79 @@
+/**
+ * @file deferred_log_bench.cpp
+ * @brief Host time of a deferred log call and of a deferred hexdump (one record per 16 bytes), the rings are drained to
+ *        /dev/null between the timed batches
+ *
+ * usage: deferred_log_bench [batches]
+ *        the numbers are host nanoseconds : they compare the calls, the cycles on the target are measured with
+ *        misc::deferred_log_benchmark
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+#include "deferred_log.hpp"
+#include "bench.hpp"
+
+static constexpr uint32_t batch = CONFIG_MISC_DEFERRED_LOG_RING_SIZE / 4; // records per batch, the ring never fills
+static const char *TAG = "BENCH";
+
+/**
+ * @brief Print the pending records to /dev/null
+ */
+static void drain_silently()
+{
+    fflush(stdout);
+    const int out = dup(STDOUT_FILENO);
+    const int null = open("/dev/null", O_WRONLY);
+    dup2(null, STDOUT_FILENO);
+    misc::deferred_log_drain();
+    fflush(stdout);
+    dup2(out, STDOUT_FILENO);
+    close(null);
+    close(out);
+}
+
+/**
+ * @brief Best of 5 runs of call(i), in ns per call, for calls that store records records each
+ */
+template <typename Call>
+static double ns_per_call(int batches, uint32_t records, Call call)
+{
+    const uint32_t calls = batch / records;
+    return wsim_bench::best_of_5([&]()
+                                 {
+        double ns = 0;
+        for (int b = 0; b < batches; ++b)
+        {
+            ns += wsim_bench::elapsed_ns([&]()
+                                         {
+                for (uint32_t i = 0; i < calls; ++i)
+                    call(i); });
+            drain_silently(); // not timed
+        }
+        return ns / (double(batches) * calls); });
+}
+
+int main(int argc, char **argv)
+{
+    const int batches = (argc > 1) ? atoi(argv[1]) : 2000;
+    char buffer[64];
+    for (size_t i = 0; i < sizeof(buffer); ++i)
+        buffer[i] = char(i);
+
+    const double log0 = ns_per_call(batches, 1, [](uint32_t)
+                                    { misc::deferred_log(ESP_LOG_INFO, TAG, "tick"); });
+    const double log4 = ns_per_call(batches, 1, [](uint32_t i)
+                                    { misc::deferred_log(ESP_LOG_INFO, TAG, "echo %u %u %u %u", i, i + 1, i + 2, i + 3); });
+    const double hex16 = ns_per_call(batches, 1, [&](uint32_t)
+                                     { misc::deferred_log_hex(ESP_LOG_INFO, TAG, buffer, 16); });
+    const double hex64 = ns_per_call(batches, 4, [&](uint32_t)
+                                     { misc::deferred_log_hex(ESP_LOG_INFO, TAG, buffer, 64); });
+    printf("| %-25s | %6s | %10s |\n", "call (ns)", "call", "per record");
+    printf("| %-25s | %6.1f | %10.1f |\n", "deferred_log, 0 argument", log0, log0);
+    printf("| %-25s | %6.1f | %10.1f |\n", "deferred_log, 4 arguments", log4, log4);
+    printf("| %-25s | %6.1f | %10.1f |\n", "deferred_log_hex, 16 B", hex16, hex16);
+    printf("| %-25s | %6.1f | %10.1f |\n", "deferred_log_hex, 64 B", hex64, hex64 / 4);
+    printf("dropped records: %u\n", (unsigned)misc::deferred_log_dropped());
+    return 0;
+}
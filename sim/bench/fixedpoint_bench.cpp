@@ -0,0 +1,67 @@
+/**
+ * @file fixedpoint_bench.cpp
+ * @brief Host throughput of the FixedPoint operators for each storage, on the fast path (the product fits the storage)
+ *        and on the wide path (wide intermediate, or 128 bits limbs for int64_t)
+ *
+ * usage: fixedpoint_bench [iterations]
+ *        the numbers are host nanoseconds : they rank the paths on the host only, no cycle count of the target is measured
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include "fixedpoint.hpp"
+#include "bench.hpp"
+
+static constexpr size_t N = 4096;
+
+template <typename Fp, typename Op>
+static double ns_per_op(const std::vector<Fp> &a, const std::vector<Fp> &b, int iterations, Op op)
+{
+    volatile typename Fp::storage_t sink = 0;
+    return wsim_bench::ns_per(double(iterations) * N, [&]()
+                              {
+        for (int it = 0; it < iterations; ++it)
+        {
+            typename Fp::storage_t acc = 0;
+            for (size_t i = 0; i < N; ++i)
+                acc ^= op(a[i], b[i]).getM();
+            sink = sink ^ acc;
+        } });
+}
+
+template <typename Fp>
+static void bench(const char *name, int iterations)
+{
+    std::mt19937 rng(1);
+    const double range = double(Fp::MAX_VAL()) / 4;
+    std::uniform_real_distribution<double> dist(-range, range);
+    std::vector<Fp> a(N), b(N);
+    for (size_t i = 0; i < N; ++i)
+    {
+        a[i] = Fp(dist(rng));
+        b[i] = Fp(dist(rng));
+        if (b[i].getM() == 0)
+            b[i] = Fp(1);
+    }
+    const double add = ns_per_op(a, b, iterations, [](const Fp &x, const Fp &y)
+                                 { return x + y; });
+    const double mul = ns_per_op(a, b, iterations, [](const Fp &x, const Fp &y)
+                                 { return x * y; });
+    const double div = ns_per_op(a, b, iterations, [](const Fp &x, const Fp &y)
+                                 { return x / y; });
+    printf("| %-24s | %6zu | %6.2f | %6.2f | %6.2f |\n", name, sizeof(Fp), add, mul, div);
+}
+
+int main(int argc, char **argv)
+{
+    const int iterations = (argc > 1) ? atoi(argv[1]) : 200;
+    printf("| %-24s | %6s | %6s | %6s | %6s |\n", "format", "sizeof", "+ ns", "* ns", "/ ns");
+    bench<FixedPoint16<3, 4>>("FixedPoint16<3, 4>", iterations);
+    bench<FixedPoint16<4, 10>>("FixedPoint16<4, 10>", iterations);
+    bench<FixedPoint<7, 8>>("FixedPoint<7, 8>", iterations);
+    bench<FixedPoint<10, 16>>("FixedPoint<10, 16>", iterations);
+    bench<FixedPoint64<15, 16>>("FixedPoint64<15, 16>", iterations);
+    bench<FixedPoint64<20, 40>>("FixedPoint64<20, 40>", iterations);
+    return 0;
+}
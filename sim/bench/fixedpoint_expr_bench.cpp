@@ -0,0 +1,71 @@
+/**
+ * @file fixedpoint_expr_bench.cpp
+ * @brief Host time of chained FixedPoint operations written with the operators (one rescale per operation) and fused with
+ *        fixedpoint_expr.hpp (one rescale at the end)
+ *
+ * usage: fixedpoint_expr_bench [iterations]
+ *        the numbers are host nanoseconds : they rank the two forms on the host only, no cycle count of the target is measured
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include "fixedpoint_expr.hpp"
+#include "bench.hpp"
+
+static constexpr size_t N = 4096;
+
+template <typename Op>
+static double ns_per_op(int iterations, Op op)
+{
+    volatile int32_t sink = 0;
+    return wsim_bench::ns_per(double(iterations) * N, [&]()
+                              {
+        for (int it = 0; it < iterations; ++it)
+        {
+            int32_t acc = 0;
+            for (size_t i = 0; i < N; ++i)
+                acc ^= op(i);
+            sink = sink ^ acc;
+        } });
+}
+
+int main(int argc, char **argv)
+{
+    const int iterations = (argc > 1) ? atoi(argv[1]) : 200;
+    using Fp = FixedPoint<4, 16>;
+    using Out = FixedPoint<8, 16>;
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<double> dist(-3.0, 3.0);
+    std::vector<Fp> a(N), b(N), c(N), d(N), e(N);
+    std::vector<FixedPoint16<3, 8>> h(N);
+    for (size_t i = 0; i < N; ++i)
+    {
+        a[i] = Fp(dist(rng));
+        b[i] = Fp(dist(rng));
+        c[i] = Fp(dist(rng));
+        d[i] = Fp(dist(rng));
+        e[i] = Fp(dist(rng));
+        h[i] = FixedPoint16<3, 8>(dist(rng));
+    }
+
+    printf("| %-28s | %9s | %8s |\n", "expression", "operators", "fused");
+    const double pid_plain = ns_per_op(iterations, [&](size_t i)
+                                       { return Out(a[i] * b[i] + c[i] * d[i] - e[i]).getM(); });
+    const double pid_fused = ns_per_op(iterations, [&](size_t i)
+                                       { return fx_eval<Out>(fx(a[i]) * b[i] + fx(c[i]) * d[i] - e[i]).getM(); });
+    printf("| %-28s | %9.2f | %8.2f |\n", "a*b + c*d - e", pid_plain, pid_fused);
+
+    const double dot_plain = ns_per_op(iterations, [&](size_t i)
+                                       { return Out(a[i] * b[i] + c[i] * d[i] + e[i] * a[i] + b[i] * c[i]).getM(); });
+    const double dot_fused = ns_per_op(iterations, [&](size_t i)
+                                       { return fx_eval<Out>(fx(a[i]) * b[i] + fx(c[i]) * d[i] + fx(e[i]) * a[i] + fx(b[i]) * c[i]).getM(); });
+    printf("| %-28s | %9.2f | %8.2f |\n", "a*b + c*d + e*a + b*c", dot_plain, dot_fused);
+
+    const double mix_plain = ns_per_op(iterations, [&](size_t i)
+                                       { return Out(h[i] * a[i] - h[i] * b[i]).getM(); });
+    const double mix_fused = ns_per_op(iterations, [&](size_t i)
+                                       { return fx_eval<Out>(fx(h[i]) * a[i] - fx(h[i]) * b[i]).getM(); });
+    printf("| %-28s | %9.2f | %8.2f |\n", "h*a - h*b (16 bits h)", mix_plain, mix_fused);
+    return 0;
+}
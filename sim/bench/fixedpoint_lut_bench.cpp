@@ -0,0 +1,59 @@
+/**
+ * @file fixedpoint_lut_bench.cpp
+ * @brief Host time of a FixedPointLut evaluation against <cmath> in float and double, and against the double based
+ *        pow(x, FixedPoint) of fixedpoint.hpp
+ *
+ * usage: fixedpoint_lut_bench [iterations]
+ *        the numbers are host nanoseconds : without a FPU for double, the gap is larger on the target
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "fixedpoint_lut.hpp"
+#include "bench.hpp"
+
+using In_t = FixedPoint<4, 16>;
+using Out_t = FixedPoint<8, 20>;
+static constexpr size_t N = 4096;
+
+template <typename Fn>
+static double ns_per_eval(int iterations, Fn fn)
+{
+    return wsim_bench::ns_per(double(iterations) * N, [&]()
+                              {
+        for (int it = 0; it < iterations; ++it)
+            for (size_t i = 0; i < N; ++i)
+                fn(i); });
+}
+
+int main(int argc, char **argv)
+{
+    const int iterations = (argc > 1) ? atoi(argv[1]) : 200;
+    std::vector<In_t> x(N);
+    std::vector<float> xf(N);
+    std::vector<double> xd(N);
+    for (size_t i = 0; i < N; ++i)
+    {
+        x[i] = In_t(-4.0 + 8.0 * double(i) / N);
+        xf[i] = float(x[i]);
+        xd[i] = double(x[i]);
+    }
+    volatile int32_t sink = 0;
+    volatile float sinkf = 0;
+    volatile double sinkd = 0;
+    using ExpLinear = ExpLut<Out_t, -4.0, 4.0, 1e-3, LutInterpolation::Linear>;
+    using ExpQuadratic = ExpLut<Out_t, -4.0, 4.0, 1e-3>;
+    const FixedPoint<4, 16> e(2.718281828459045);
+    printf("| %-28s | %6s |\n", "exp(x), x in [-4, 4]", "ns");
+    printf("| %-28s | %6.2f |\n", "ExpLut linear", ns_per_eval(iterations, [&](size_t i)
+                                                                { sink = ExpLinear::eval(x[i]).getM(); }));
+    printf("| %-28s | %6.2f |\n", "ExpLut quadratic", ns_per_eval(iterations, [&](size_t i)
+                                                                   { sink = ExpQuadratic::eval(x[i]).getM(); }));
+    printf("| %-28s | %6.2f |\n", "std::exp(float)", ns_per_eval(iterations, [&](size_t i)
+                                                                  { sinkf = std::exp(xf[i]); }));
+    printf("| %-28s | %6.2f |\n", "std::exp(double)", ns_per_eval(iterations, [&](size_t i)
+                                                                   { sinkd = std::exp(xd[i]); }));
+    printf("| %-28s | %6.2f |\n", "pow(e, FixedPoint) (double)", ns_per_eval(iterations, [&](size_t i)
+                                                                              { sink = pow(e, x[i]).getM(); }));
+    return 0;
+}
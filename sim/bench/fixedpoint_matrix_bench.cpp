@@ -0,0 +1,105 @@
+/**
+ * @file fixedpoint_matrix_bench.cpp
+ * @brief Host time of the FixedMat operations in FixedPoint<4, 16> against the same loops in float
+ *
+ * usage: fixedpoint_matrix_bench [iterations]
+ *        the numbers are host nanoseconds, with a FPU : on the target float uses the single precision FPU of the core
+ */
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include "fixedpoint_matrix.hpp"
+#include "bench.hpp"
+
+using T = FixedPoint<4, 16>;
+using Inv_t = FixedPoint<12, 16>;
+static constexpr size_t N = 256;
+
+template <typename Fn>
+static double ns_per_op(int iterations, Fn fn)
+{
+    return wsim_bench::ns_per(double(iterations) * N, [&]()
+                              {
+        for (int it = 0; it < iterations; ++it)
+            for (size_t i = 0; i < N; ++i)
+                fn(i); });
+}
+
+struct Mat3f
+{
+    float m[3][3];
+};
+
+static Mat3f mul(const Mat3f &a, const Mat3f &b)
+{
+    Mat3f r;
+    for (size_t i = 0; i < 3; ++i)
+        for (size_t k = 0; k < 3; ++k)
+            r.m[i][k] = a.m[i][0] * b.m[0][k] + a.m[i][1] * b.m[1][k] + a.m[i][2] * b.m[2][k];
+    return r;
+}
+
+static bool inv(const Mat3f &a, Mat3f &r)
+{
+    float cof[3][3];
+    for (size_t i = 0; i < 9; ++i)
+    {
+        const size_t row = i / 3, c = i % 3, r1 = (row + 1) % 3, r2 = (row + 2) % 3, c1 = (c + 1) % 3, c2 = (c + 2) % 3;
+        cof[row][c] = a.m[r1][c1] * a.m[r2][c2] - a.m[r1][c2] * a.m[r2][c1];
+    }
+    const float det = a.m[0][0] * cof[0][0] + a.m[0][1] * cof[0][1] + a.m[0][2] * cof[0][2];
+    if (det == 0)
+        return false;
+    for (size_t i = 0; i < 9; ++i)
+        r.m[i / 3][i % 3] = cof[i % 3][i / 3] / det;
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    const int iterations = (argc > 1) ? atoi(argv[1]) : 2000;
+    std::mt19937 rng(5);
+    std::uniform_real_distribution<double> dist(-4.0, 4.0);
+    std::vector<FixedMat<3, 3, T>> a(N);
+    std::vector<Mat3f> af(N);
+    std::vector<FixedVec<3, T>> v(N);
+    std::vector<std::array<float, 3>> vf(N);
+    for (size_t n = 0; n < N; ++n)
+    {
+        for (size_t i = 0; i < 9; ++i)
+        {
+            a[n].m[i / 3][i % 3] = T(dist(rng));
+            af[n].m[i / 3][i % 3] = float(a[n].m[i / 3][i % 3]);
+        }
+        for (size_t i = 0; i < 3; ++i)
+        {
+            v[n].v[i] = T(dist(rng));
+            vf[n][i] = float(v[n].v[i]);
+        }
+    }
+    volatile int32_t sink = 0;
+    volatile float sinkf = 0;
+    printf("| %-16s | %8s | %8s |\n", "3x3", "fixed ns", "float ns");
+    printf("| %-16s | %8.2f | %8.2f |\n", "product",
+           ns_per_op(iterations, [&](size_t i)
+                     { const auto r = a[i] * a[(i + 1) % N]; sink = r.m[0][0].getM() ^ r.m[1][1].getM() ^ r.m[2][2].getM() ^ r.m[0][2].getM(); }),
+           ns_per_op(iterations, [&](size_t i)
+                     { const Mat3f r = mul(af[i], af[(i + 1) % N]); sinkf = r.m[0][0] + r.m[1][1] + r.m[2][2] + r.m[0][2]; }));
+    printf("| %-16s | %8.2f | %8.2f |\n", "matrix-vector",
+           ns_per_op(iterations, [&](size_t i)
+                     { const auto r = a[i] * v[i]; sink = r.v[0].getM() ^ r.v[1].getM() ^ r.v[2].getM(); }),
+           ns_per_op(iterations, [&](size_t i)
+                     {
+                         float r[3];
+                         for (size_t j = 0; j < 3; ++j)
+                             r[j] = af[i].m[j][0] * vf[i][0] + af[i].m[j][1] * vf[i][1] + af[i].m[j][2] * vf[i][2];
+                         sinkf = r[0] + r[1] + r[2]; }));
+    printf("| %-16s | %8.2f | %8.2f |\n", "inverse",
+           ns_per_op(iterations, [&](size_t i)
+                     { FixedMat<3, 3, Inv_t> r; sink = inverse(a[i], r) ? r.m[1][1].getM() : 0; }),
+           ns_per_op(iterations, [&](size_t i)
+                     { Mat3f r; sinkf = inv(af[i], r) ? r.m[1][1] : 0; }));
+    return 0;
+}
@@ -0,0 +1,125 @@
+/**
+ * @file fixedpoint_ops_bench.cpp
+ * @brief Host time of every FixedPoint operator, for each storage and for cross-format operands, the accuracy of the same
+ *        operators is checked by tests/fixedpoint_ops.cpp
+ *
+ * usage: fixedpoint_ops_bench [iterations]
+ *        the numbers are host nanoseconds : they rank the operators on the host only, no cycle count of the target is measured
+ */
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include "fixedpoint.hpp"
+#include "bench.hpp"
+
+static constexpr size_t N = 4096;
+
+/**
+ * @brief Best of 5 runs of op(i) over the N operands, in ns per call
+ */
+template <typename Op>
+static double ns_per_op(int iterations, Op op)
+{
+    volatile int64_t sink = 0;
+    return wsim_bench::ns_per(double(iterations) * N, [&]()
+                              {
+        for (int it = 0; it < iterations; ++it)
+        {
+            int64_t acc = 0;
+            for (size_t i = 0; i < N; ++i)
+                acc ^= op(i);
+            sink = sink ^ acc;
+        } });
+}
+
+/**
+ * @brief N random operands of the format, with |value| < 2^(I / 2) so that products fit the result
+ */
+template <typename Fp>
+static std::vector<Fp> operands(unsigned seed)
+{
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> dist(-std::ldexp(1.0, Fp::Ipart() / 2), std::ldexp(1.0, Fp::Ipart() / 2));
+    std::vector<Fp> v(N);
+    for (auto &x : v)
+    {
+        x = Fp(dist(rng));
+        if (x.getM() == 0)
+            x = Fp(typename Fp::raw_t(1));
+    }
+    return v;
+}
+
+template <typename Fp>
+static void bench(const char *name, int iterations)
+{
+    const std::vector<Fp> a = operands<Fp>(1), b = operands<Fp>(2);
+    std::vector<int> k(N);
+    std::vector<double> d(N);
+    std::mt19937 rng(3);
+    for (size_t i = 0; i < N; ++i)
+    {
+        k[i] = static_cast<int>(rng() % 6) + 1;
+        d[i] = double(a[i]);
+    }
+    const double add = ns_per_op(iterations, [&](size_t i)
+                                 { return (a[i] + b[i]).getM(); });
+    const double sub = ns_per_op(iterations, [&](size_t i)
+                                 { return (a[i] - b[i]).getM(); });
+    const double mul = ns_per_op(iterations, [&](size_t i)
+                                 { return (a[i] * b[i]).getM(); });
+    const double div = ns_per_op(iterations, [&](size_t i)
+                                 { return (a[i] / b[i]).getM(); });
+    const double neg = ns_per_op(iterations, [&](size_t i)
+                                 { return (-a[i]).getM(); });
+    const double fabs = ns_per_op(iterations, [&](size_t i)
+                                  { return abs(a[i]).getM(); });
+    const double mul_int = ns_per_op(iterations, [&](size_t i)
+                                     { return (a[i] * k[i]).getM(); });
+    const double div_int = ns_per_op(iterations, [&](size_t i)
+                                     { return (a[i] / k[i]).getM(); });
+    const double from_double = ns_per_op(iterations, [&](size_t i)
+                                         { return Fp(d[i]).getM(); });
+    const double cmp = ns_per_op(iterations, [&](size_t i)
+                                 { return int64_t(a[i] < b[i]); });
+    printf("| %-22s | %5.2f | %5.2f | %5.2f | %5.2f | %5.2f | %5.2f | %5.2f | %5.2f | %5.2f | %5.2f |\n", name, add, sub, mul, div, neg, fabs, mul_int, div_int, from_double, cmp);
+}
+
+template <typename A, typename B>
+static void bench_cross(const char *name, int iterations)
+{
+    const std::vector<A> a = operands<A>(1);
+    const std::vector<B> b = operands<B>(2);
+    const double add = ns_per_op(iterations, [&](size_t i)
+                                 { return int64_t((a[i] + b[i]).getM()); });
+    const double sub = ns_per_op(iterations, [&](size_t i)
+                                 { return int64_t((a[i] - b[i]).getM()); });
+    const double mul = ns_per_op(iterations, [&](size_t i)
+                                 { return int64_t((a[i] * b[i]).getM()); });
+    const double div = ns_per_op(iterations, [&](size_t i)
+                                 { return int64_t((a[i] / b[i]).getM()); });
+    printf("| %-22s | %5.2f | %5.2f | %5.2f | %5.2f |\n", name, add, sub, mul, div);
+}
+
+int main(int argc, char **argv)
+{
+    const int iterations = (argc > 1) ? atoi(argv[1]) : 200;
+    printf("| %-22s | %5s | %5s | %5s | %5s | %5s | %5s | %5s | %5s | %5s | %5s |\n", "format (ns)", "+", "-", "*", "/", "neg", "abs", "*int", "/int", "dbl", "<");
+    bench<FixedPoint16<3, 4>>("FixedPoint16<3,4>", iterations);
+    bench<FixedPoint16<4, 10>>("FixedPoint16<4,10>", iterations);
+    bench<FixedPoint<7, 8>>("FixedPoint<7,8>", iterations);
+    bench<FixedPoint<4, 16>>("FixedPoint<4,16>", iterations);
+    bench<FixedPoint<10, 16>>("FixedPoint<10,16>", iterations);
+    bench<FixedPoint<2, 28>>("FixedPoint<2,28>", iterations);
+    bench<FixedPoint64<15, 16>>("FixedPoint64<15,16>", iterations);
+    bench<FixedPoint64<20, 40>>("FixedPoint64<20,40>", iterations);
+
+    printf("\n| %-22s | %5s | %5s | %5s | %5s |\n", "cross-format (ns)", "+", "-", "*", "/");
+    bench_cross<FixedPoint<4, 16>, FixedPoint<10, 16>>("<4,16> x <10,16>", iterations);
+    bench_cross<FixedPoint<7, 8>, FixedPoint<2, 28>>("<7,8> x <2,28>", iterations);
+    bench_cross<FixedPoint16<4, 10>, FixedPoint<10, 16>>("16<4,10> x <10,16>", iterations);
+    bench_cross<FixedPoint<10, 16>, FixedPoint64<20, 40>>("<10,16> x 64<20,40>", iterations);
+    return 0;
+}
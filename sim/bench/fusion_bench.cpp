@@ -0,0 +1,58 @@
+/**
+ * @file fusion_bench.cpp
+ * @brief Host time of one step of the fusion filters, with the formats of sim/tests/fusion.cpp
+ *
+ * usage: fusion_bench [steps]
+ *        the numbers are host nanoseconds : they compare the filters on the host only, no cycle count of the target is measured
+ */
+#include <cstdio>
+#include <cstdlib>
+#include "fusion.hpp"
+#include "bench.hpp"
+
+template <typename Step>
+static double ns_per_step(int steps, Step step)
+{
+    return wsim_bench::ns_per(steps, [&]()
+                              {
+        for (int k = 0; k < steps; ++k)
+            step(k); });
+}
+
+int main(int argc, char **argv)
+{
+    const int steps = (argc > 1) ? atoi(argv[1]) : 1000000;
+    volatile double one = 1.0; // model unknown to the compiler
+    volatile int32_t sink = 0;
+
+    using Value_t = FixedPoint<14, 16>;
+    using Coef_t = FixedPoint<2, 16>;
+    using Kalman = LinearKalman<2, 1, 1, Value_t, Coef_t>;
+    Kalman::Model model;
+    model.F = {{{Coef_t(one), Coef_t(0.02 * one)}, {Coef_t(0), Coef_t(one)}}};
+    model.B = {{{Coef_t(0)}, {Coef_t(0)}}};
+    model.H = {{{Coef_t(one), Coef_t(0)}}};
+    model.Q = {{{Value_t(0.0001 * one), Value_t(0.01 * one)}, {Value_t(0.01 * one), Value_t(one)}}};
+    model.R = {{{Value_t(100 * one)}}};
+    Kalman kf(model, {{Value_t(1000), Value_t(0)}}, {{{Value_t(1000), Value_t(0)}, {Value_t(0), Value_t(1000)}}});
+
+    RangeFilter<> range{FixedPoint<1, 16>(0.5 * one), FixedPoint<1, 16>(0.1 * one)};
+    ComplementaryFilter<FixedPoint<10, 16>, FixedPoint<1, 20>> complementary{FixedPoint<1, 20>(0.98 * one), FixedPoint<1, 20>(0.01 * one)};
+
+    printf("| %-32s | %8s |\n", "filter", "ns/step");
+    printf("| %-32s | %8.2f |\n", "LinearKalman<2, 1, 1> predict", ns_per_step(steps, [&](int k)
+                                                                                { kf.predict(); sink = kf.getState()[0].getM(); }));
+    kf.reset({{Value_t(1000), Value_t(0)}}, {{{Value_t(1000), Value_t(0)}, {Value_t(0), Value_t(1000)}}});
+    printf("| %-32s | %8.2f |\n", "LinearKalman<2, 1, 1> update", ns_per_step(steps, [&](int k)
+                                                                               { kf.update({{Value_t(1000 + (k & 15))}}); sink = kf.getState()[0].getM(); }));
+    printf("| %-32s | %8.2f |\n", "RangeFilter update", ns_per_step(steps, [&](int k)
+                                                                     {
+                                                                         const Ultrasound_Measurement_t m = {.timestamp_us = int64_t(k) * 60000 + 60000, .distance_mm = 2000 + (k & 31)};
+                                                                         range.reset();
+                                                                         range.update({.timestamp_us = int64_t(k) * 60000, .distance_mm = 2000});
+                                                                         range.update(m);
+                                                                         sink = range.getVelocityMmPerS().getM(); }));
+    printf("| %-32s | %8.2f |\n", "ComplementaryFilter step", ns_per_step(steps, [&](int k)
+                                                                           { sink = complementary.step(FixedPoint<10, 16>(k & 7), FixedPoint<10, 16>(k & 15)).getM(); }));
+    return 0;
+}
@@ -0,0 +1,79 @@
+/**
+ * @file kernels_bench.cpp
+ * @brief Host time of the span kernels for the sizes and unroll factors of misc::kernels_benchmark, and of dot_q
+ *
+ * usage: kernels_bench [iterations]
+ *        the numbers are host nanoseconds per call : the plain loops are auto-vectorized by the host compiler, so they
+ *        do not predict the gain of unrolling on the in-order Xtensa core, measured in cycles by misc::kernels_benchmark
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include "kernels.hpp"
+#include "bench.hpp"
+
+/**
+ * @brief Best of 5 runs of kernel(), in ns per call
+ */
+template <typename Kernel>
+static double ns_per_call(int iterations, Kernel kernel)
+{
+    volatile int64_t sink = 0;
+    return wsim_bench::ns_per(iterations, [&]()
+                              {
+        for (int it = 0; it < iterations; ++it)
+            sink = sink + int64_t(kernel()); });
+}
+
+template <typename Kernel>
+static void line(const char *name, std::size_t size, int iterations, Kernel kernel)
+{
+    printf("| %-11s | %5u | %7.1f | %7.1f | %7.1f | %7.1f |\n", name, (unsigned)size,
+           ns_per_call(iterations, [&]()
+                       { return kernel(std::integral_constant<std::size_t, 1>()); }),
+           ns_per_call(iterations, [&]()
+                       { return kernel(std::integral_constant<std::size_t, 2>()); }),
+           ns_per_call(iterations, [&]()
+                       { return kernel(std::integral_constant<std::size_t, 4>()); }),
+           ns_per_call(iterations, [&]()
+                       { return kernel(std::integral_constant<std::size_t, 8>()); }));
+}
+
+int main(int argc, char **argv)
+{
+    const int iterations = (argc > 1) ? atoi(argv[1]) : 20000;
+    std::mt19937 rng(1);
+    std::vector<int32_t> a(1024), b(1024);
+    std::vector<int16_t> c(1024), d(1024);
+    for (std::size_t i = 0; i < a.size(); ++i)
+    {
+        a[i] = int32_t(rng() >> 8) - (1 << 23);
+        c[i] = int16_t(rng());
+        d[i] = int16_t(rng());
+    }
+    printf("| %-11s | %5s | %7s | %7s | %7s | %7s |\n", "kernel (ns)", "size", "U=1", "U=2", "U=4", "U=8");
+    printf("| ----------- | ----: | ------: | ------: | ------: | ------: |\n");
+    for (std::size_t size : {16, 64, 256, 1024})
+    {
+        const std::span<const int32_t> x(a.data(), size);
+        const std::span<int32_t> out(b.data(), size);
+        line("sum", size, iterations, [&](auto u)
+             { return misc::sum<decltype(u)::value, int64_t>(x); });
+        line("dot", size, iterations, [&](auto u)
+             { return misc::dot<decltype(u)::value, int64_t>(x, x); });
+        line("min_index", size, iterations, [&](auto u)
+             { return misc::min_index<decltype(u)::value>(x).index; });
+        line("max_index", size, iterations, [&](auto u)
+             { return misc::max_index<decltype(u)::value>(x).index; });
+        line("clamp", size, iterations, [&](auto u)
+             { misc::clamp<decltype(u)::value>(x, out, -1000, 1000); return out[size - 1]; });
+        line("prefix_sum", size, iterations, [&](auto u)
+             { return misc::prefix_sum<decltype(u)::value>(x, out); });
+        const std::span<const int16_t> xq(c.data(), size), yq(d.data(), size);
+        printf("| %-11s | %5u | %7.1f |         |         |         |\n", "dot_q", (unsigned)size,
+               ns_per_call(iterations, [&]()
+                           { return misc::dot_q(xq, yq, 15); }));
+    }
+    return 0;
+}
@@ -0,0 +1,86 @@
+/**
+ * @file wtrace_bench.cpp
+ * @brief Host time of a notification ping-pong between two NTask, built twice : wtrace_bench without the WTrace hooks
+ *        and wtrace_bench_traced with CONFIG_WTASK_TRACE (library wtask_sim_trace)
+ *
+ * usage: wtrace_bench [virtual us per run]
+ *        the numbers are host nanoseconds : the round trip includes the context switches of the simulator, so the
+ *        ratio of the two builds is an upper bound of the overhead only if the hooks cost the same on the target
+ */
+#include <cstdio>
+#include <cstdlib>
+#include "wsim.hpp"
+#include "NTask.hpp"
+#include "WTrace.hpp"
+#include "bench.hpp"
+
+#define NOTIF_PING 1
+#define NOTIF_PONG 2
+
+class PongTask : public NTask
+{
+public:
+    PongTask() : NTask(1, "pong", 4096, 5, 0) {};
+    NTask *ping = nullptr;
+
+private:
+    void run(void *data)
+    {
+        while (true)
+        {
+            receiveNotification(portMAX_DELAY);
+            sendNotificationTo(ping, NOTIF_PONG, portMAX_DELAY);
+        }
+    };
+};
+
+class PingTask : public NTask
+{
+public:
+    PingTask(PongTask *pong) : NTask(2, "ping", 4096, 5, 0), pong(pong) {};
+    uint64_t rounds = 0;
+
+private:
+    PongTask *pong;
+    void run(void *data)
+    {
+        while (true)
+        {
+            wsim::consume(1000); // 1 us per round trip, for the virtual time to move
+            sendNotificationTo(pong, NOTIF_PING, portMAX_DELAY);
+            receiveNotification(portMAX_DELAY);
+            ++rounds;
+        }
+    };
+};
+
+int main(int argc, char **argv)
+{
+    const uint64_t duration_us = (argc > 1) ? strtoull(argv[1], nullptr, 10) : 200000;
+    PongTask pong;
+    PingTask ping(&pong);
+    pong.ping = &ping;
+    pong.start();
+    ping.start();
+
+    uint64_t done = 0;
+    const double best = wsim_bench::best_of_5([&]()
+                                              {
+        const uint64_t before = ping.rounds;
+        const double ns = wsim_bench::elapsed_ns([&]()
+                                                 { wsim::run_for(duration_us * 1000); });
+        done = ping.rounds - before;
+        return ns / done; });
+#if CONFIG_WTASK_TRACE
+    printf("traced     : %.1f ns per round trip (%llu round trips per run)\n", best, (unsigned long long)done);
+    const int records = 1000000;
+    const double record_ns = wsim_bench::ns_per(records, []()
+                                                {
+        for (int i = 0; i < records; ++i)
+            WTRACE(WTRACE_NOTIF_RECV, i, 0); });
+    printf("record     : %.1f ns per WTrace::record\n", record_ns);
+#else
+    printf("not traced : %.1f ns per round trip (%llu round trips per run)\n", best, (unsigned long long)done);
+#endif
+    return 0;
+}
@@ -0,0 +1,99 @@
+/**
+ * @file pipeline_tasks.hpp
+ * @brief Tasks of the ultrasound pipeline example, shared by the live run (ultrasound_pipeline) and the replay (replay_bench)
+ */
+#ifndef PIPELINE_TASKS_HPP_
+#define PIPELINE_TASKS_HPP_
+
+#include <cstring>
+#include "wsim.hpp"
+#include "WTask.hpp"
+#include "ultrasound.hpp"
+
+#define TRIG_PIN 4
+#define ECHO_PIN 5
+#define NOTIF_SAMPLE 1
+#define NOTIF_OBSTACLE 2
+#define OBSTACLE_STOP_MM 400
+
+/**
+ * @brief Stops the motors when an obstacle is reported (best effort core)
+ */
+class MotorTask : public NTask
+{
+public:
+    uint32_t stops = 0;
+    MotorTask() : NTask(1, "motor", 4096, 7, 0) {};
+
+private:
+    void run(void *data)
+    {
+        while (true)
+        {
+            Notification_t notif = receiveNotification(portMAX_DELAY);
+            if (notif.value != NOTIF_OBSTACLE)
+                continue;
+            stops++;
+            wsim::consume(50000); // motor driver command
+        }
+    };
+};
+
+/**
+ * @brief Consumer of the ultrasound samples (real-time core)
+ */
+class ObstacleTask : public RTask
+{
+public:
+    ObstacleTask(ultrasound *sensor, NTask *motor) : RTask(2, "obstacle", 4096, 11, 1, 8, 512), sensor(sensor), motor(motor)
+    {
+        setCriticality(TASK_REAL_TIME);
+    };
+
+private:
+    ultrasound *sensor; // nullptr on replay
+
+    NTask *motor;
+    void run(void *data)
+    {
+        while (true)
+        {
+            Notification_t notif = receiveNotification(portMAX_DELAY);
+            if (notif.value != NOTIF_SAMPLE)
+                continue;
+            size_t size;
+            void *item = receiveData(&size, 0);
+            if (item == nullptr)
+                continue;
+            UltrasoundDelivery delivery;
+            memcpy(&delivery, item, sizeof(delivery));
+            returnData(item);
+            if (sensor != nullptr)
+                sensor->recordWakeLatency(delivery.echo_end_us);
+            wsim::consume(200000); // obstacle map update
+            if (delivery.sample.median_mm < OBSTACLE_STOP_MM)
+                sendNotificationTo(motor, NOTIF_OBSTACLE, 0);
+        }
+    };
+};
+
+/**
+ * @brief 100 Hz control loop (real-time core)
+ */
+class ControlTask : public PeriodicTask
+{
+public:
+    ControlTask() : PeriodicTask("control", 10, 4096, 12)
+    {
+        setCore(1);
+        setCriticality(TASK_REAL_TIME);
+    };
+
+private:
+    void step()
+    {
+        wsim::consume(1500000); // control law
+    };
+};
+
+#endif // PIPELINE_TASKS_HPP_
@@ -0,0 +1,49 @@
+/**
+ * @file replay_bench.cpp
+ * @brief Replay of a log recorded by ultrasound_pipeline (or on the robot) into the same tasks, without the sensor
+ *
+ * usage: replay_bench log.wrec [realtime|fast]
+ *        realtime sends each message at its recorded time, fast sends them as soon as the tasks take them (throughput)
+ */
+#include <cstdio>
+#include <cstring>
+#include "pipeline_tasks.hpp"
+#include "wreplay.hpp"
+#include "range_filter.hpp"
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        printf("usage: %s log.wrec [realtime|fast]\n", argv[0]);
+        return 1;
+    }
+    const bool fast = (argc > 2) && (strcmp(argv[2], "fast") == 0);
+    wsim::Replay replay(argv[1]);
+    if (!replay.isValid())
+        return 1;
+
+    // same construction order as ultrasound_pipeline : same identifiers
+    MotorTask motor;
+    ObstacleTask obstacle(nullptr, &motor);
+    ControlTask control;
+    motor.start();
+    obstacle.start();
+    control.start();
+
+    RangeFilter<> filter(FixedPoint<1, 16>(0.5), FixedPoint<1, 16>(0.1));
+    replay.onMeasurement([&filter](gpio_num_t echo_pin, const Ultrasound_Measurement_t &measure)
+                         { filter.update(measure); });
+
+    const wsim::ReplayStats stats = replay.run(fast ? wsim::Replay::Pace::AS_FAST_AS_POSSIBLE : wsim::Replay::Pace::REALTIME);
+
+    wsim::report();
+    printf("replay (%s) : %llu records, %llu injected, %llu measurements, %llu skipped, %llu lost by the recorder\n",
+           fast ? "fast" : "realtime", (unsigned long long)stats.records, (unsigned long long)stats.injected,
+           (unsigned long long)stats.measurements, (unsigned long long)stats.skipped, (unsigned long long)stats.lost);
+    printf("log %.3f s, replayed in %.3f s of virtual time (%.0f messages/s) and %.3f s of host time (%.0f messages/s)\n",
+           stats.log_us / 1e6, stats.virtual_ns / 1e9, (stats.virtual_ns > 0) ? stats.injected * 1e9 / stats.virtual_ns : 0.0,
+           stats.host_s, (stats.host_s > 0) ? stats.injected / stats.host_s : 0.0);
+    printf("motor stops : %u, filtered distance %d mm\n", motor.stops, static_cast<int>(filter.getDistanceMm()));
+    return 0;
+}
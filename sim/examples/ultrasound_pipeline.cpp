@@ -0,0 +1,119 @@
+/**
+ * @file ultrasound_pipeline.cpp
+ * @brief Ultrasound sensor delivering its samples to an obstacle task, next to a 100 Hz control loop, on the simulator
+ *        The onRead callback filters the distance in the deferred task of the real-time core.
+ *
+ * usage: ultrasound_pipeline [seconds] [gpio|mcpwm] [log.wrec]
+ *        the messages of the run are recorded in log.wrec when given, see replay_bench
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "pipeline_tasks.hpp"
+#include "WRecord.h"
+#include "range_filter.hpp"
+
+#define OBSTACLE_NEAR_MM 300
+#define OBSTACLE_FAR_MM 2000
+#define OBSTACLE_SPEED_MM_S 300
+
+/**
+ * @brief Stop the recording from a task : the writer task of the recorder has to run to empty its buffer
+ */
+static void record_stop_task(void *arg)
+{
+    WRecord_Stop();
+    wsim::stop();
+    vTaskDelete(nullptr);
+}
+
+/**
+ * @brief onRead callback, called by the deferred task (ultrasound::deferRead)
+ */
+static void on_read(Ultrasound_Handle_t handle, void *user_data)
+{
+    static_cast<RangeFilter<> *>(user_data)->update(Ultrasound_GetDistance(handle));
+    wsim::consume(20000); // filter update
+}
+
+/**
+ * @brief Obstacle going back and forth between OBSTACLE_NEAR_MM and OBSTACLE_FAR_MM
+ */
+static uint32_t obstacle_distance_mm(uint64_t now_ns)
+{
+    const uint64_t span = OBSTACLE_FAR_MM - OBSTACLE_NEAR_MM;
+    const uint64_t travel = (now_ns / 1000000) * OBSTACLE_SPEED_MM_S / 1000 % (2 * span);
+    return OBSTACLE_FAR_MM - ((travel < span) ? travel : (2 * span - travel));
+}
+
+int main(int argc, char **argv)
+{
+    const uint32_t seconds = (argc > 1) ? atoi(argv[1]) : 10;
+    const bool mcpwm = (argc > 2) && (strcmp(argv[2], "mcpwm") == 0);
+    FILE *record = (argc > 3) ? fopen(argv[3], "wb") : nullptr;
+
+    wsim::EchoSource source = {};
+    source.trig_pin = TRIG_PIN;
+    source.echo_pin = ECHO_PIN;
+    source.distance_mm = obstacle_distance_mm;
+    source.drop_per_mille = 20;
+    source.jitter_ns = 20000;
+    wsim::add_echo_source(source);
+
+    RangeFilter<> filter(FixedPoint<1, 16>(0.5), FixedPoint<1, 16>(0.1));
+    Ultrasound_Init_t config = {};
+    config.gpio_trig_pin = TRIG_PIN;
+    config.gpio_echo_pin = ECHO_PIN;
+    config.measurement_period_ms = 60;
+    config.trig_signal_duration_us = 10;
+    config.median_window = 5;
+    config.spike_threshold_mm = 300;
+    config.degraded_success_percent = 70;
+    config.backend = mcpwm ? ULTRASOUND_BACKEND_MCPWM_CAPTURE : ULTRASOUND_BACKEND_GPIO_ISR;
+    config.onRead = on_read;
+    config.user_data = &filter;
+    ultrasound sensor(config);
+    if (!sensor.isValid())
+        return 1;
+
+    MotorTask motor;
+    ObstacleTask obstacle(&sensor, &motor);
+    ControlTask control;
+    sensor.deliverTo(&obstacle, NOTIF_SAMPLE);
+    sensor.deferRead(true);
+    WDeferred::start();
+    motor.start();
+    obstacle.start();
+    control.start();
+    if (record != nullptr)
+        WRecord_Start(WRecord_FileSink, record);
+    sensor.start();
+
+    wsim::run_for(seconds * 1000000000ULL);
+
+    wsim::report();
+#if CONFIG_WTASK_PARTITION
+    WPartition::report();
+#endif
+    WDeferred::report();
+    Ultrasound_Diagnostics_t diagnostics;
+    sensor.getDiagnostics(diagnostics);
+    const UltrasoundWakeLatency &latency = sensor.getWakeLatency();
+    printf("ultrasound (%s) : %u triggers, %u samples, %u without echo, %u spikes, %u%% success\n", mcpwm ? "mcpwm" : "gpio",
+           diagnostics.trigger_count, diagnostics.success_count, diagnostics.fault_count[ULTRASOUND_FAULT_NO_ECHO],
+           diagnostics.fault_count[ULTRASOUND_FAULT_SPIKE], diagnostics.success_percent);
+    if (latency.count > 0)
+        printf("echo to consumer latency us : min %lld avg %lld max %lld\n", (long long)latency.min_us,
+               (long long)(latency.total_us / latency.count), (long long)latency.max_us);
+    printf("motor stops : %u, control overruns : %u, filtered distance %d mm\n", motor.stops, control.getOverrunCount(),
+           static_cast<int>(filter.getDistanceMm()));
+    if (record != nullptr)
+    {
+        sensor.stop();
+        xTaskCreatePinnedToCore(record_stop_task, "record_stop", 4096, nullptr, 1, nullptr, 0);
+        wsim::run_for(1000000000ULL);
+        fclose(record);
+        printf("recorded %s, %u records lost\n", argv[3], WRecord_GetDropped());
+    }
+    return 0;
+}
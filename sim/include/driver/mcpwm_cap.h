@@ -0,0 +1,70 @@
+/**
+ * @file mcpwm_cap.h
+ * @brief MCPWM capture of the simulator : the edges of the pin are latched on the virtual time, without ISR latency
+ */
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+typedef struct mcpwm_cap_timer_t *mcpwm_cap_timer_handle_t;
+typedef struct mcpwm_cap_channel_t *mcpwm_cap_channel_handle_t;
+
+typedef enum {
+    MCPWM_CAP_EDGE_POS,
+    MCPWM_CAP_EDGE_NEG,
+} mcpwm_capture_edge_t;
+
+typedef struct {
+    uint32_t cap_value;
+    mcpwm_capture_edge_t cap_edge;
+} mcpwm_capture_event_data_t;
+
+typedef bool (*mcpwm_capture_event_cb_t)(mcpwm_cap_channel_handle_t chan, const mcpwm_capture_event_data_t *edata, void *user_data);
+
+typedef struct {
+    mcpwm_capture_event_cb_t on_cap;
+} mcpwm_capture_event_callbacks_t;
+
+#define MCPWM_CAPTURE_CLK_SRC_DEFAULT 0
+#define WSIM_MCPWM_CAPTURE_RESOLUTION_HZ 80000000
+
+typedef struct {
+    int group_id;
+    int clk_src;
+    uint32_t resolution_hz;
+} mcpwm_capture_timer_config_t;
+
+typedef struct {
+    int gpio_num;
+    int intr_priority;
+    uint32_t prescale;
+    struct {
+        uint32_t pos_edge : 1;
+        uint32_t neg_edge : 1;
+        uint32_t pull_up : 1;
+        uint32_t pull_down : 1;
+        uint32_t invert_cap_signal : 1;
+        uint32_t io_loop_back : 1;
+        uint32_t keep_io_conf_at_exit : 1;
+    } flags;
+} mcpwm_capture_channel_config_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+esp_err_t mcpwm_new_capture_timer(const mcpwm_capture_timer_config_t *config, mcpwm_cap_timer_handle_t *timer);
+esp_err_t mcpwm_del_capture_timer(mcpwm_cap_timer_handle_t timer);
+esp_err_t mcpwm_capture_timer_enable(mcpwm_cap_timer_handle_t timer);
+esp_err_t mcpwm_capture_timer_disable(mcpwm_cap_timer_handle_t timer);
+esp_err_t mcpwm_capture_timer_start(mcpwm_cap_timer_handle_t timer);
+esp_err_t mcpwm_capture_timer_stop(mcpwm_cap_timer_handle_t timer);
+esp_err_t mcpwm_capture_timer_get_resolution(mcpwm_cap_timer_handle_t timer, uint32_t *resolution_hz);
+esp_err_t mcpwm_new_capture_channel(mcpwm_cap_timer_handle_t timer, const mcpwm_capture_channel_config_t *config, mcpwm_cap_channel_handle_t *chan);
+esp_err_t mcpwm_del_capture_channel(mcpwm_cap_channel_handle_t chan);
+esp_err_t mcpwm_capture_channel_enable(mcpwm_cap_channel_handle_t chan);
+esp_err_t mcpwm_capture_channel_disable(mcpwm_cap_channel_handle_t chan);
+esp_err_t mcpwm_capture_channel_register_event_callbacks(mcpwm_cap_channel_handle_t chan, const mcpwm_capture_event_callbacks_t *callbacks, void *user_data);
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,6 @@
+#pragma once
+
+#define IRAM_ATTR
+#define DRAM_ATTR
+#define RTC_DATA_ATTR
+#define DRAM_STR(str) (str)
@@ -0,0 +1,13 @@
+#pragma once
+#include <stdint.h>
+
+typedef uint32_t esp_cpu_cycle_count_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+/* Virtual time at the CPU frequency of the cost model */
+esp_cpu_cycle_count_t esp_cpu_get_cycle_count(void);
+#ifdef __cplusplus
+}
+#endif
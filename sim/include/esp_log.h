@@ -0,0 +1,48 @@
+/**
+ * @file esp_log.h
+ * @brief Logs of the simulator : printed with the virtual time instead of the boot time
+ */
+#pragma once
+#include <stdio.h>
+#include "sdkconfig.h"
+#include "esp_attr.h"
+
+typedef enum {
+    ESP_LOG_NONE,
+    ESP_LOG_ERROR,
+    ESP_LOG_WARN,
+    ESP_LOG_INFO,
+    ESP_LOG_DEBUG,
+    ESP_LOG_VERBOSE,
+} esp_log_level_t;
+
+#define LOG_COLOR(color) ""
+#define LOG_RESET_COLOR ""
+#define esp_rom_printf printf
+#define _ESP_LOG_EARLY_ENABLED(level) ((level) <= CONFIG_LOG_DEFAULT_LEVEL)
+
+#define ESP_LOG_LEVEL(level, tag, format, ...)                        \
+    do                                                                \
+    {                                                                 \
+        if ((level) <= CONFIG_LOG_DEFAULT_LEVEL)                      \
+            wsim_log(level, tag, format, ##__VA_ARGS__); \
+    } while (0)
+#define ESP_LOGE(tag, format, ...) ESP_LOG_LEVEL(ESP_LOG_ERROR, tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) ESP_LOG_LEVEL(ESP_LOG_WARN, tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) ESP_LOG_LEVEL(ESP_LOG_INFO, tag, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) ESP_LOG_LEVEL(ESP_LOG_DEBUG, tag, format, ##__VA_ARGS__)
+#define ESP_LOGV(tag, format, ...) ESP_LOG_LEVEL(ESP_LOG_VERBOSE, tag, format, ##__VA_ARGS__)
+#define ESP_EARLY_LOGE ESP_LOGE
+#define ESP_EARLY_LOGW ESP_LOGW
+#define ESP_EARLY_LOGI ESP_LOGI
+#define ESP_DRAM_LOGE ESP_LOGE
+#define ESP_DRAM_LOGW ESP_LOGW
+#define ESP_DRAM_LOGI ESP_LOGI
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+void wsim_log(esp_log_level_t level, const char *tag, const char *format, ...) __attribute__((format(printf, 3, 4)));
+#ifdef __cplusplus
+}
+#endif
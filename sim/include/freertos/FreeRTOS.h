@@ -0,0 +1,77 @@
+/**
+ * @file FreeRTOS.h
+ * @brief FreeRTOS types and port of the simulator : the primitives are modeled by the discrete-event kernel of sim/src/kernel.cpp
+ */
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "sdkconfig.h"
+#include "esp_heap_caps.h"
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+typedef uint8_t StackType_t;
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS pdTRUE
+#define pdFAIL pdFALSE
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+#define tskNO_AFFINITY ((BaseType_t)0x7fffffff)
+#define portNUM_PROCESSORS 2
+#define configTICK_RATE_HZ CONFIG_FREERTOS_HZ
+#define configMAX_PRIORITIES 25
+#define configMINIMAL_STACK_SIZE 768
+#define configMAX_TASK_NAME_LEN 16
+#define configNUM_THREAD_LOCAL_STORAGE_POINTERS CONFIG_FREERTOS_THREAD_LOCAL_STORAGE_POINTERS
+#define portTICK_PERIOD_MS (1000 / configTICK_RATE_HZ)
+#define pdMS_TO_TICKS(ms) ((TickType_t)(((uint64_t)(ms) * configTICK_RATE_HZ) / 1000))
+#define pdTICKS_TO_MS(ticks) ((uint32_t)(((uint64_t)(ticks) * 1000) / configTICK_RATE_HZ))
+#define configASSERT(x) ((x) ? (void)0 : wsim_assert_failed(__FILE__, __LINE__))
+
+/* Run time stats on the virtual time, in microseconds as the IDF port (esp_timer) */
+#define configRUN_TIME_COUNTER_TYPE uint32_t
+#define portGET_RUN_TIME_COUNTER_VALUE() wsim_run_time_counter()
+
+/* Static buffers are accepted, but the host stacks of the tasks are always allocated by the simulator */
+typedef struct { void *dummy[24]; } StaticTask_t;
+typedef struct { void *dummy[20]; } StaticQueue_t;
+typedef StaticQueue_t StaticSemaphore_t;
+
+/* Heap of the port, as the IDF port (heap_caps) */
+#define pvPortMalloc(size) heap_caps_malloc((size), MALLOC_CAP_DEFAULT)
+#define vPortFree(ptr) heap_caps_free(ptr)
+
+/* Single threaded kernel : the critical sections have nothing to protect */
+typedef struct { uint32_t owner; uint32_t count; } portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED {0, 0}
+#define portMUX_INITIALIZE(mux) ((mux)->owner = 0, (mux)->count = 0)
+#define taskENTER_CRITICAL(mux) ((void)(mux))
+#define taskEXIT_CRITICAL(mux) ((void)(mux))
+#define taskENTER_CRITICAL_ISR(mux) ((void)(mux))
+#define taskEXIT_CRITICAL_ISR(mux) ((void)(mux))
+#define portENTER_CRITICAL(mux) ((void)(mux))
+#define portEXIT_CRITICAL(mux) ((void)(mux))
+#define portENTER_CRITICAL_ISR(mux) ((void)(mux))
+#define portEXIT_CRITICAL_ISR(mux) ((void)(mux))
+#define portENTER_CRITICAL_SAFE(mux) ((void)(mux))
+#define portEXIT_CRITICAL_SAFE(mux) ((void)(mux))
+#define portSET_INTERRUPT_MASK_FROM_ISR() ((UBaseType_t)0)
+#define portCLEAR_INTERRUPT_MASK_FROM_ISR(mask) ((void)(mask))
+#define portYIELD_FROM_ISR(...) ((void)0)
+#define portYIELD() vPortYield()
+#define taskYIELD() vPortYield()
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+void wsim_assert_failed(const char *file, int line);
+configRUN_TIME_COUNTER_TYPE wsim_run_time_counter(void);
+BaseType_t xPortGetCoreID(void);
+BaseType_t xPortInIsrContext(void);
+void vPortYield(void);
+#ifdef __cplusplus
+}
+#endif
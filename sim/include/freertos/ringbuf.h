@@ -0,0 +1,29 @@
+#pragma once
+#include "FreeRTOS.h"
+
+typedef struct Ringbuffer *RingbufHandle_t;
+typedef struct { void *dummy[16]; } StaticRingbuffer_t;
+typedef enum {
+    RINGBUF_TYPE_NOSPLIT = 0,
+    RINGBUF_TYPE_ALLOWSPLIT,
+    RINGBUF_TYPE_BYTEBUF,
+} RingbufferType_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+/* Only the no split type is modeled : an item takes its size rounded to 4 bytes plus an 8 bytes header */
+RingbufHandle_t xRingbufferCreate(size_t size, RingbufferType_t type);
+RingbufHandle_t xRingbufferCreateStatic(size_t size, RingbufferType_t type, uint8_t *storage, StaticRingbuffer_t *buffer);
+void vRingbufferDelete(RingbufHandle_t ringbuf);
+size_t xRingbufferGetMaxItemSize(RingbufHandle_t ringbuf);
+size_t xRingbufferGetCurFreeSize(RingbufHandle_t ringbuf);
+BaseType_t xRingbufferSend(RingbufHandle_t ringbuf, const void *data, size_t size, TickType_t ticks);
+BaseType_t xRingbufferSendFromISR(RingbufHandle_t ringbuf, const void *data, size_t size, BaseType_t *woken);
+BaseType_t xRingbufferSendAcquire(RingbufHandle_t ringbuf, void **item, size_t size, TickType_t ticks);
+BaseType_t xRingbufferSendComplete(RingbufHandle_t ringbuf, void *item);
+void *xRingbufferReceive(RingbufHandle_t ringbuf, size_t *size, TickType_t ticks);
+void vRingbufferReturnItem(RingbufHandle_t ringbuf, void *item);
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,35 @@
+#pragma once
+#include "FreeRTOS.h"
+
+typedef struct tskTaskControlBlock *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+#define xTaskCreate(fn, name, depth, arg, prio, handle) xTaskCreatePinnedToCore(fn, name, depth, arg, prio, handle, tskNO_AFFINITY)
+#define xTaskCreateStatic(fn, name, depth, arg, prio, stack, tcb) xTaskCreateStaticPinnedToCore(fn, name, depth, arg, prio, stack, tcb, tskNO_AFFINITY)
+#define vTaskDelayUntil(prev, increment) ((void)xTaskDelayUntil(prev, increment))
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack_depth, void *arg, UBaseType_t priority, TaskHandle_t *handle, BaseType_t core);
+TaskHandle_t xTaskCreateStaticPinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack_depth, void *arg, UBaseType_t priority, StackType_t *stack, StaticTask_t *tcb, BaseType_t core);
+void vTaskDelete(TaskHandle_t task);
+void vTaskSuspend(TaskHandle_t task);
+void vTaskResume(TaskHandle_t task);
+void vTaskDelay(TickType_t ticks);
+BaseType_t xTaskDelayUntil(TickType_t *previous_wake, TickType_t increment);
+TickType_t xTaskGetTickCount(void);
+TickType_t xTaskGetTickCountFromISR(void);
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+const char *pcTaskGetName(TaskHandle_t task);
+UBaseType_t uxTaskPriorityGet(TaskHandle_t task);
+TaskHandle_t xTaskGetIdleTaskHandleForCore(BaseType_t core);
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks);
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *woken);
+configRUN_TIME_COUNTER_TYPE ulTaskGetRunTimeCounter(TaskHandle_t task);
+void vTaskSetThreadLocalStoragePointer(TaskHandle_t task, BaseType_t index, void *value);
+void *pvTaskGetThreadLocalStoragePointer(TaskHandle_t task, BaseType_t index);
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,39 @@
+/**
+ * @file sdkconfig.h
+ * @brief Configuration of the host simulation build (see sim/README.md), in place of the one generated by menuconfig
+ */
+#pragma once
+
+#define CONFIG_IDF_TARGET_LINUX 1
+#define CONFIG_WTASK_SIM 1
+#define CONFIG_FREERTOS_HZ 100
+#define CONFIG_FREERTOS_THREAD_LOCAL_STORAGE_POINTERS 2
+#define CONFIG_LOG_DEFAULT_LEVEL 3
+#define CONFIG_TASK_SUPPORT 1
+#define CONFIG_NTASK_SUPPORT 1
+#define CONFIG_RTASK_SUPPORT 1
+#define CONFIG_WORKQUEUE_SUPPORT 1
+#define CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS 1
+#define CONFIG_WTASK_PARTITION 1
+#define CONFIG_WTASK_PARTITION_RT_CORE 1
+#define CONFIG_WTASK_PARTITION_RT_MIN_PRIORITY 10
+#define CONFIG_WTASK_PARTITION_MAX_TASKS 32
+#define CONFIG_WTASK_DEFERRED 1
+#define CONFIG_WTASK_DEFERRED_QUEUE_LENGTH 32
+#define CONFIG_WTASK_DEFERRED_PRIORITY 20
+#define CONFIG_WTASK_DEFERRED_STACK_SIZE 3072
+#define CONFIG_WTASK_DEFERRED_BATCH 8
+#define CONFIG_WTASK_DEFERRED_BUDGET_US 500
+#define CONFIG_WTASK_RECORD 1
+#define CONFIG_WTASK_RECORD_BUFFER_SIZE 8192
+#define CONFIG_WTASK_RECORD_MAX_PAYLOAD 256
+#define CONFIG_WTASK_RECORD_MAX_ISR_PAYLOAD 64
+#define CONFIG_WTASK_RECORD_WRITER_PRIORITY 1
+#define CONFIG_WTASK_RECORD_TLS_INDEX 1
+// WTrace only in the traced build of the library (wtask_sim_trace), the default one measures the code without the hooks
+#ifdef WSIM_TRACE
+#define CONFIG_WTASK_TRACE 1
+#define CONFIG_WTASK_TRACE_RING_SIZE 1024
+#define CONFIG_WTASK_TRACE_MAX_TASKS 32
+#endif
+#define CONFIG_MISC_HEX_BUFF_COLOR "34"
@@ -0,0 +1,9 @@
+/**
+ * @file soc_caps.h
+ * @brief Capabilities of the ESP32-S3 used by the components and modeled by the simulator
+ */
+#pragma once
+
+#define SOC_MCPWM_GROUPS 2
+#define SOC_MCPWM_CAPTURE_TIMERS_PER_GROUP 1
+#define SOC_MCPWM_CAPTURE_CHANNELS_PER_TIMER 3
@@ -0,0 +1,84 @@
+/**
+ * @file wreplay.hpp
+ * @brief Replay of a WRecord log (components/WTask/WRecord.h) into the tasks of the simulator
+ * @details The log is memory mapped and read in place. A replay task sends the recorded notifications and RTask payloads
+ *          to the tasks of the program that have the recorded identifiers, so the same task code sees the same input
+ *          stream as on the robot. Are not sent :
+ *           - the messages whose sender is one of these tasks : the task sends them again itself
+ *           - the messages to a task that does not exist in the program, or to a WorkQueue (function pointers)
+ *          The ultrasound measurements are given to a handler, e.g. to feed a filter.
+ */
+#ifndef WREPLAY_HPP_
+#define WREPLAY_HPP_
+
+#include <cstdint>
+#include <functional>
+#include "freertos/FreeRTOS.h"
+#include "driver/gpio.h"
+#include "ultrasound.h"
+
+namespace wsim
+{
+	/**
+	 * @brief Result of a replay
+	 *
+	 */
+	struct ReplayStats
+	{
+		uint64_t records;	   ///< records read from the log
+		uint64_t injected;	   ///< notifications and payloads sent to the tasks
+		uint64_t measurements; ///< ultrasound measurements given to the handler
+		uint64_t skipped;	   ///< messages sent again by a task of the program, or without destination
+		uint64_t lost;		   ///< records lost by the recorder (WRECORD_DROP)
+		uint64_t log_us;	   ///< time span of the log
+		uint64_t virtual_ns;   ///< virtual time of the replay, up to the last record
+		double host_s;		   ///< host time of the replay
+	};
+
+	class Replay
+	{
+	public:
+		enum class Pace
+		{
+			REALTIME,			 ///< each record is sent at its recorded time (1x on the virtual time)
+			AS_FAST_AS_POSSIBLE, ///< records are sent back to back, blocking while the destination is full
+		};
+
+		/**
+		 * @brief Map a log
+		 *
+		 * @param path
+		 */
+		explicit Replay(const char *path);
+		~Replay();
+		Replay(const Replay &) = delete;
+		Replay &operator=(const Replay &) = delete;
+
+		bool isValid() const { return base != nullptr; };
+
+		void onMeasurement(std::function<void(gpio_num_t echo_pin, const Ultrasound_Measurement_t &measure)> handler);
+
+		/**
+		 * @brief Replay the log : the tasks of the program must be started, run_for is called until the last record
+		 *
+		 * @param pace
+		 * @param core core of the replay task, which has the highest priority
+		 * @param timeout_ns maximum virtual time of the replay (e.g. a destination that stopped reading)
+		 * @return ReplayStats
+		 */
+		ReplayStats run(Pace pace, BaseType_t core = 0, uint64_t timeout_ns = 3600000000000ULL);
+
+	private:
+		const uint8_t *base = nullptr;
+		size_t length = 0;
+		std::function<void(gpio_num_t, const Ultrasound_Measurement_t &)> measurement_handler;
+		Pace pace = Pace::REALTIME;
+		ReplayStats stats = {};
+		bool finished = false;
+
+		static void task(void *arg);
+		void replay();
+	};
+};
+
+#endif // WREPLAY_HPP_
@@ -0,0 +1,159 @@
+/**
+ * @file wsim.hpp
+ * @brief Discrete-event simulator of the task layer : FreeRTOS, esp_timer and the GPIO are modeled on a virtual time with
+ *        2 virtual cores, so Task, NTask, RTask and the ultrasound driver run unchanged on a PC (see sim/README.md)
+ * @details The kernel is single threaded : each task runs on its own host stack and gives the hand back to the scheduler at
+ *          each FreeRTOS call, so the code itself takes no virtual time. The time is spent by the cost model (API calls,
+ *          context switches, ISR entries) and by the computations declared with wsim::consume. A run only depends on the
+ *          program and the seeds, it is bit-reproducible.
+ */
+#ifndef WSIM_HPP_
+#define WSIM_HPP_
+
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+#include "freertos/FreeRTOS.h"
+#include "driver/gpio.h"
+
+namespace wsim
+{
+	/**
+	 * @brief Virtual cost of the modeled primitives
+	 *
+	 */
+	struct CostModel
+	{
+		uint32_t cpu_mhz = 240;				  ///< frequency of esp_cpu_get_cycle_count
+		uint32_t context_switch_ns = 1500;	  ///< a core switches to another task
+		uint32_t api_call_ns = 400;			  ///< queue, semaphore, ring buffer or task call
+		uint32_t copy_ns_per_byte = 2;		  ///< copy of a queue item or a ring buffer payload
+		uint32_t isr_entry_ns = 1000;		  ///< entry and exit of an ISR (GPIO, ESP_TIMER_ISR timer)
+		uint32_t timer_dispatch_ns = 4000;	  ///< dispatch of an ESP_TIMER_TASK timer callback
+	};
+
+	/**
+	 * @brief Statistics of a task
+	 *
+	 */
+	struct TaskStats
+	{
+		std::string name;
+		BaseType_t core;		 ///< affinity
+		UBaseType_t priority;
+		uint32_t activations;	 ///< wake ups from a blocked state
+		uint32_t preemptions;	 ///< preempted by a higher priority task
+		uint64_t cpu_ns;		 ///< time spent running on a core
+		uint64_t latency_min_ns; ///< wake up to running
+		uint64_t latency_max_ns;
+		uint64_t latency_total_ns; ///< average is latency_total_ns / activations
+		bool deleted;
+	};
+
+	/**
+	 * @brief Statistics of a core
+	 *
+	 */
+	struct CoreStats
+	{
+		uint64_t task_ns;	///< running tasks
+		uint64_t isr_ns;	///< ISR and timer callbacks
+		uint64_t switch_ns; ///< context switches
+	};
+
+	void set_cost_model(const CostModel &model);
+	const CostModel &cost_model();
+
+	/**
+	 * @brief Virtual time since the start of the simulation
+	 *
+	 * @return uint64_t in ns
+	 */
+	uint64_t now();
+
+	/**
+	 * @brief Run the simulation : the tasks created before (e.g. by the constructors and app code) are scheduled from now
+	 *
+	 * @param duration_ns virtual time to simulate
+	 */
+	void run_for(uint64_t duration_ns);
+
+	/**
+	 * @brief Declare a computation of the current task (or ISR) : it occupies its core for the given time, and can be
+	 *        preempted by a higher priority task
+	 *
+	 * @param ns
+	 */
+	void consume(uint64_t ns);
+
+	/**
+	 * @brief Block the current task until a virtual time (exact, not rounded to the tick like vTaskDelay)
+	 *
+	 * @param time_ns absolute virtual time
+	 */
+	void sleep_until(uint64_t time_ns);
+
+	/**
+	 * @brief Make run_for return before its end, after the current event (e.g. a task has finished its work)
+	 */
+	void stop();
+
+	/**
+	 * @brief Run a function in ISR context at a given time (virtual interrupt source)
+	 *
+	 * @param time_ns absolute virtual time, now if in the past
+	 * @param isr called with xPortInIsrContext() true : only the FromISR functions can be used
+	 * @param core core that takes the interrupt
+	 */
+	void at(uint64_t time_ns, std::function<void()> isr, BaseType_t core = 0);
+
+	/**
+	 * @brief Drive the level of an input pin (virtual source), now : an edge calls the GPIO ISR handler of the pin
+	 *
+	 * @param pin
+	 * @param level 0 or 1
+	 */
+	void gpio_drive(gpio_num_t pin, uint32_t level);
+
+	/**
+	 * @brief Observe the level changes of a pin (output pins set by the application, or input pins driven by a source)
+	 *
+	 * @param pin
+	 * @param listener called in the context of the change, with the new level
+	 */
+	void gpio_listen(gpio_num_t pin, std::function<void(gpio_num_t pin, uint32_t level)> listener);
+
+	/**
+	 * @brief Virtual ultrasound sensor : a trigger pulse on trig_pin is answered by an echo pulse on echo_pin
+	 *        (and by the capture backend that latches it, for ULTRASOUND_BACKEND_MCPWM_CAPTURE)
+	 *
+	 */
+	struct EchoSource
+	{
+		gpio_num_t trig_pin;
+		gpio_num_t echo_pin;
+		std::function<uint32_t(uint64_t now_ns)> distance_mm; ///< distance of the obstacle over the time
+		uint32_t sound_speed_mm_s = 343000;
+		uint32_t response_delay_us = 450; ///< end of the trigger to the start of the echo (burst emission)
+		uint32_t max_range_mm = 4000;	  ///< no echo further
+		uint32_t drop_per_mille = 0;	  ///< lost echoes
+		uint32_t jitter_ns = 0;			  ///< uniform jitter of the echo width
+		uint32_t seed = 1;				  ///< seed of the drops and of the jitter
+	};
+
+	void add_echo_source(const EchoSource &source);
+
+	std::vector<TaskStats> task_stats();
+	CoreStats core_stats(BaseType_t core);
+
+	/**
+	 * @brief Print the latency and CPU utilization of each task and the load of each core
+	 *
+	 * @param out
+	 */
+	void report(FILE *out = stdout);
+};
+
+#endif // WSIM_HPP_
@@ -0,0 +1,7 @@
+#pragma once
+#include "esp_cpu.h"
+
+static inline uint32_t xthal_get_ccount(void)
+{
+    return esp_cpu_get_cycle_count();
+}
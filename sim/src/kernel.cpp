@@ -0,0 +1,1120 @@
+/**
+ * @file kernel.cpp
+ * @brief Discrete-event kernel of the simulator : tasks on host stacks (ucontext), 2 virtual cores with fixed priority
+ *        preemptive scheduling, and the FreeRTOS queues, semaphores and ring buffers on the virtual time
+ * @details Main loop : the cores whose task has nothing left to compute resume it until its next FreeRTOS call, then the
+ *          time advances to the first event (end of a computation, timeout, timer, interrupt). Equal priorities are not
+ *          time sliced : a task keeps its core until it blocks or is preempted by a higher priority task.
+ */
+#include <ucontext.h>
+#include <cstdarg>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <list>
+#include <memory>
+#include <queue>
+#include <vector>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/ringbuf.h"
+#include "esp_log.h"
+#include "kernel.hpp"
+
+#define WSIM_HOST_STACK_SIZE (256 * 1024)
+#define WSIM_MAX_ZERO_TIME_RESUMES (10000000)
+#define WSIM_TICK_NS (1000000000ULL / configTICK_RATE_HZ)
+#define WSIM_NO_DEADLINE UINT64_MAX
+#define WSIM_RINGBUF_HEADER 8
+
+enum class TaskState
+{
+	READY,
+	RUNNING,
+	BLOCKED,
+	SUSPENDED,
+	DELETED,
+};
+
+using WaitList = std::vector<tskTaskControlBlock *>;
+
+struct tskTaskControlBlock
+{
+	std::string name;
+	TaskFunction_t fn;
+	void *arg;
+	UBaseType_t priority;
+	BaseType_t affinity;
+	BaseType_t core = -1;	 // core running the task
+	TaskState state = TaskState::READY;
+	ucontext_t context;
+	std::unique_ptr<uint8_t[]> stack;
+	uint64_t busy_ns = 0;	 // computation left before resuming the code
+	WaitList *waiting_on = nullptr;
+	uint64_t block_generation = 0; // invalidates the timeout of a previous block
+	bool timed_out = false;
+	bool measure_latency = false;
+	uint64_t ready_since = 0;
+	uint32_t notify_value = 0; // direct to task notification (counting, as xTaskNotifyGive)
+	WaitList notify_waiters;   // the task itself while it waits for a notification
+	wsim::TaskStats stats;
+	void *tls[configNUM_THREAD_LOCAL_STORAGE_POINTERS] = {}; // thread local storage pointers
+};
+
+namespace
+{
+	struct Event
+	{
+		uint64_t time;
+		uint64_t sequence;
+		std::function<void()> fn;
+		bool operator>(const Event &other) const
+		{
+			return (time != other.time) ? (time > other.time) : (sequence > other.sequence);
+		};
+	};
+
+	struct Core
+	{
+		tskTaskControlBlock *running = nullptr;
+		tskTaskControlBlock *last = nullptr; // last task that ran, to count the switches
+		uint64_t isr_left_ns = 0;			 // stall of the interrupts
+		uint64_t switch_left_ns = 0;		 // stall of the context switch
+		wsim::CoreStats stats = {};
+	};
+
+	wsim::CostModel model;
+	uint64_t now_ns = 0;
+	uint64_t event_sequence = 0;
+	std::priority_queue<Event, std::vector<Event>, std::greater<Event>> events;
+	std::vector<std::unique_ptr<tskTaskControlBlock>> tasks; // creation order, kept for the report
+	std::list<tskTaskControlBlock *> ready;					 // FIFO per priority
+	Core cores[portNUM_PROCESSORS];
+	tskTaskControlBlock idle_tasks[portNUM_PROCESSORS]; // handles of the idle time of the cores for the run time stats, never scheduled
+	ucontext_t scheduler_context;
+	tskTaskControlBlock *current = nullptr; // task whose code is executing
+	BaseType_t isr_core = -1;				// core of the interrupt being executed
+	bool isr_context = false;
+	bool stop_requested = false; // run_for returns
+
+	uint64_t tick_deadline(TickType_t ticks)
+	{
+		if (ticks == portMAX_DELAY)
+			return WSIM_NO_DEADLINE;
+		return (now_ns / WSIM_TICK_NS + ticks) * WSIM_TICK_NS;
+	};
+
+	bool eligible(const tskTaskControlBlock *task, BaseType_t core)
+	{
+		return (task->affinity == tskNO_AFFINITY) || (task->affinity == core);
+	};
+
+	void make_ready(tskTaskControlBlock *task, bool wake_up)
+	{
+		task->state = TaskState::READY;
+		task->waiting_on = nullptr;
+		task->block_generation++;
+		if (wake_up)
+		{
+			task->stats.activations++;
+			task->measure_latency = true;
+			task->ready_since = now_ns;
+		}
+		ready.push_back(task);
+	};
+
+	/**
+	 * @brief Detach a task from the ready list, its wait list or its core
+	 */
+	void detach(tskTaskControlBlock *task)
+	{
+		ready.remove(task);
+		if (task->waiting_on != nullptr)
+		{
+			WaitList &list = *task->waiting_on;
+			list.erase(std::remove(list.begin(), list.end(), task), list.end());
+			task->waiting_on = nullptr;
+		}
+		if ((task->core >= 0) && (cores[task->core].running == task))
+			cores[task->core].running = nullptr;
+		task->block_generation++;
+	};
+
+	/**
+	 * @brief Give the hand back to the scheduler (from a task)
+	 */
+	void yield_to_scheduler()
+	{
+		swapcontext(&current->context, &scheduler_context);
+	};
+
+	/**
+	 * @brief Block the current task on a wait list until it is woken up or the deadline is reached
+	 *
+	 * @return true if woken up, false on timeout
+	 */
+	bool block(WaitList *list, uint64_t deadline)
+	{
+		tskTaskControlBlock *task = current;
+		Core &core = cores[task->core];
+		core.running = nullptr;
+		task->state = TaskState::BLOCKED;
+		task->timed_out = false;
+		task->waiting_on = list;
+		if (list != nullptr)
+			list->push_back(task);
+		const uint64_t generation = ++task->block_generation;
+		if (deadline != WSIM_NO_DEADLINE)
+			wsim::detail::schedule(deadline, [task, generation]()
+								   {
+									   if ((task->state != TaskState::BLOCKED) || (task->block_generation != generation))
+										   return;
+									   detach(task);
+									   task->timed_out = true;
+									   make_ready(task, true); });
+		yield_to_scheduler();
+		return !task->timed_out;
+	};
+
+	/**
+	 * @brief Wake up the highest priority task of a wait list (the first one on ties)
+	 *
+	 * @return tskTaskControlBlock* woken task or nullptr
+	 */
+	tskTaskControlBlock *wake_one(WaitList &list)
+	{
+		auto best = list.end();
+		for (auto it = list.begin(); it != list.end(); ++it)
+			if ((best == list.end()) || ((*it)->priority > (*best)->priority))
+				best = it;
+		if (best == list.end())
+			return nullptr;
+		tskTaskControlBlock *task = *best;
+		list.erase(best);
+		task->waiting_on = nullptr;
+		make_ready(task, true);
+		return task;
+	};
+
+	/**
+	 * @brief Forget the tasks waiting on a deleted object : they stay blocked (until their timeout, if any)
+	 */
+	void orphan(WaitList &list)
+	{
+		for (tskTaskControlBlock *task : list)
+			task->waiting_on = nullptr;
+		list.clear();
+	};
+
+	void wake_all(WaitList &list)
+	{
+		while (wake_one(list) != nullptr)
+		{
+		}
+	};
+
+	/**
+	 * @brief Tell an ISR if the woken task has to preempt the task of its core
+	 */
+	void set_woken(tskTaskControlBlock *task, BaseType_t *woken)
+	{
+		if ((task == nullptr) || (woken == nullptr))
+			return;
+		const BaseType_t core = (isr_core >= 0) ? isr_core : 0;
+		const tskTaskControlBlock *running_task = cores[core].running;
+		if ((running_task == nullptr) || (task->priority > running_task->priority))
+			*woken = pdTRUE;
+	};
+
+	/**
+	 * @brief Host stack entry of the tasks
+	 */
+	void task_entry()
+	{
+		tskTaskControlBlock *task = current;
+		task->fn(task->arg);
+		ESP_LOGE("WSIM", "Task %s returned from its function", task->name.c_str());
+		vTaskDelete(nullptr);
+	};
+
+	/**
+	 * @brief Give the cores to the highest priority ready tasks
+	 */
+	void dispatch()
+	{
+		bool changed = true;
+		while (changed)
+		{
+			changed = false;
+			for (BaseType_t c = 0; c < portNUM_PROCESSORS; c++)
+			{
+				Core &core = cores[c];
+				auto best = ready.end();
+				for (auto it = ready.begin(); it != ready.end(); ++it)
+					if (eligible(*it, c) && ((best == ready.end()) || ((*it)->priority > (*best)->priority)))
+						best = it;
+				if (best == ready.end())
+					continue;
+				tskTaskControlBlock *task = *best;
+				if ((core.running != nullptr) && (task->priority <= core.running->priority))
+					continue;
+				ready.erase(best);
+				if (core.running != nullptr)
+				{
+					tskTaskControlBlock *preempted = core.running;
+					preempted->state = TaskState::READY;
+					preempted->stats.preemptions++;
+					ready.push_front(preempted);
+				}
+				task->state = TaskState::RUNNING;
+				task->core = c;
+				core.running = task;
+				if (core.last != task)
+					core.switch_left_ns += model.context_switch_ns;
+				core.last = task;
+				changed = true;
+			}
+		}
+	};
+
+	/**
+	 * @brief Resume the code of a task until its next FreeRTOS call
+	 */
+	void resume(tskTaskControlBlock *task)
+	{
+		if (task->measure_latency)
+		{
+			const uint64_t latency = now_ns - task->ready_since;
+			task->stats.latency_total_ns += latency;
+			task->stats.latency_min_ns = std::min(task->stats.latency_min_ns, latency);
+			task->stats.latency_max_ns = std::max(task->stats.latency_max_ns, latency);
+			task->measure_latency = false;
+		}
+		current = task;
+		swapcontext(&scheduler_context, &task->context);
+		current = nullptr;
+		if (task->state == TaskState::DELETED)
+			task->stack.reset();
+	};
+
+	/**
+	 * @brief Advance the virtual time : the stalls of the cores first, then the computations of their tasks
+	 */
+	void advance(uint64_t delta)
+	{
+		for (Core &core : cores)
+		{
+			uint64_t left = delta;
+			uint64_t step = std::min(left, core.isr_left_ns);
+			core.isr_left_ns -= step;
+			core.stats.isr_ns += step;
+			left -= step;
+			step = std::min(left, core.switch_left_ns);
+			core.switch_left_ns -= step;
+			core.stats.switch_ns += step;
+			left -= step;
+			if (core.running != nullptr)
+			{
+				step = std::min(left, core.running->busy_ns);
+				core.running->busy_ns -= step;
+				core.running->stats.cpu_ns += step;
+				core.stats.task_ns += step;
+			}
+		}
+		now_ns += delta;
+	};
+
+	uint64_t core_next_time(const Core &core)
+	{
+		const uint64_t stall = core.isr_left_ns + core.switch_left_ns;
+		if (core.running != nullptr)
+			return now_ns + stall + core.running->busy_ns;
+		return (stall > 0) ? (now_ns + stall) : WSIM_NO_DEADLINE;
+	};
+
+	/**
+	 * @brief Queue, semaphore (a queue of items of size 0) or mutex
+	 */
+	enum class QueueKind
+	{
+		QUEUE,
+		BINARY,
+		MUTEX,
+	};
+};
+
+struct QueueDefinition
+{
+	QueueKind kind;
+	UBaseType_t length;
+	UBaseType_t item_size;
+	std::list<std::vector<uint8_t>> items;
+	const tskTaskControlBlock *holder = nullptr; // mutex
+	bool taken = false;							 // mutex
+	WaitList receivers;
+	WaitList senders;
+};
+
+struct Ringbuffer
+{
+	struct Item
+	{
+		std::vector<uint8_t> data;
+		bool received = false;
+		bool complete = true; // false between xRingbufferSendAcquire and xRingbufferSendComplete
+	};
+	size_t size;
+	size_t used = 0;
+	std::list<Item> items;
+	WaitList receivers;
+	WaitList senders;
+};
+
+namespace wsim
+{
+	namespace detail
+	{
+		void schedule(uint64_t time_ns, std::function<void()> fn)
+		{
+			events.push(Event{std::max(time_ns, now_ns), event_sequence++, std::move(fn)});
+		};
+
+		void interrupt(BaseType_t core, uint32_t entry_ns, bool isr, const std::function<void()> &fn)
+		{
+			const BaseType_t previous_core = isr_core;
+			const bool previous_context = isr_context;
+			isr_core = core;
+			isr_context = isr;
+			cores[core].isr_left_ns += entry_ns;
+			fn();
+			isr_core = previous_core;
+			isr_context = previous_context;
+		};
+
+		void charge(uint64_t ns)
+		{
+			if (isr_core >= 0)
+			{
+				cores[isr_core].isr_left_ns += ns;
+				return;
+			}
+			if ((current == nullptr) || (current->state != TaskState::RUNNING))
+				return; // setup code before the simulation
+			current->busy_ns += ns;
+			yield_to_scheduler();
+		};
+	};
+
+	void set_cost_model(const CostModel &cost_model)
+	{
+		model = cost_model;
+	};
+
+	const CostModel &cost_model()
+	{
+		return model;
+	};
+
+	uint64_t now()
+	{
+		return now_ns;
+	};
+
+	void consume(uint64_t ns)
+	{
+		detail::charge(ns);
+	};
+
+	void sleep_until(uint64_t time_ns)
+	{
+		configASSERT((current != nullptr) && (isr_core < 0));
+		if (time_ns > now_ns)
+			block(nullptr, time_ns);
+	};
+
+	void stop()
+	{
+		stop_requested = true;
+	};
+
+	void at(uint64_t time_ns, std::function<void()> isr, BaseType_t core)
+	{
+		detail::schedule(time_ns, [isr = std::move(isr), core]()
+						 { detail::interrupt(core, model.isr_entry_ns, true, isr); });
+	};
+
+	void run_for(uint64_t duration_ns)
+	{
+		configASSERT(current == nullptr);
+		const uint64_t end = now_ns + duration_ns;
+		uint32_t zero_time_resumes = 0;
+		stop_requested = false;
+		while (!stop_requested)
+		{
+			dispatch();
+			tskTaskControlBlock *resumed = nullptr;
+			for (Core &core : cores)
+			{
+				if ((core.running != nullptr) && (core.running->busy_ns == 0) && (core.isr_left_ns == 0) && (core.switch_left_ns == 0))
+				{
+					resumed = core.running;
+					break;
+				}
+			}
+			if (resumed != nullptr)
+			{
+				if (++zero_time_resumes > WSIM_MAX_ZERO_TIME_RESUMES)
+				{
+					ESP_LOGE("WSIM", "Task %s never spends virtual time (busy loop without FreeRTOS call or wsim::consume ?)", resumed->name.c_str());
+					abort();
+				}
+				resume(resumed);
+				continue;
+			}
+			zero_time_resumes = 0;
+			uint64_t next = events.empty() ? WSIM_NO_DEADLINE : events.top().time;
+			for (const Core &core : cores)
+				next = std::min(next, core_next_time(core));
+			if (next > end)
+			{
+				advance(end - now_ns);
+				break;
+			}
+			advance(next - now_ns);
+			while (!events.empty() && (events.top().time == now_ns))
+			{
+				Event event = events.top();
+				events.pop();
+				event.fn();
+			}
+		}
+	};
+
+	std::vector<TaskStats> task_stats()
+	{
+		std::vector<TaskStats> stats;
+		for (const auto &task : tasks)
+			stats.push_back(task->stats);
+		return stats;
+	};
+
+	CoreStats core_stats(BaseType_t core)
+	{
+		return cores[core].stats;
+	};
+
+	void report(FILE *out)
+	{
+		const double elapsed = (now_ns > 0) ? static_cast<double>(now_ns) : 1.0;
+		fprintf(out, "WSIM report : %.6f s simulated\n", now_ns / 1e9);
+		fprintf(out, " task             | core | prio |  wakes | preempt |    cpu ms |  cpu %% | wake latency us min / avg / max\n");
+		fprintf(out, "------------------|------|------|--------|---------|-----------|--------|--------------------------------\n");
+		for (const auto &task : tasks)
+		{
+			const TaskStats &s = task->stats;
+			char core[12];
+			if (s.core == tskNO_AFFINITY)
+				snprintf(core, sizeof(core), "-");
+			else
+				snprintf(core, sizeof(core), "%d", s.core);
+			fprintf(out, " %-16.16s | %4s | %4u | %6u | %7u | %9.3f | %6.2f | ", s.name.c_str(), core, s.priority, s.activations,
+					s.preemptions, s.cpu_ns / 1e6, 100.0 * s.cpu_ns / elapsed);
+			if (s.activations > 0)
+				fprintf(out, "%.1f / %.1f / %.1f", s.latency_min_ns / 1e3, s.latency_total_ns / 1e3 / s.activations, s.latency_max_ns / 1e3);
+			fprintf(out, "%s\n", s.deleted ? " (deleted)" : "");
+		}
+		for (BaseType_t c = 0; c < portNUM_PROCESSORS; c++)
+		{
+			const CoreStats &s = cores[c].stats;
+			fprintf(out, " core %d : tasks %6.2f %%, isr %6.2f %%, switches %6.2f %%, idle %6.2f %%\n", c, 100.0 * s.task_ns / elapsed,
+					100.0 * s.isr_ns / elapsed, 100.0 * s.switch_ns / elapsed,
+					100.0 * (elapsed - s.task_ns - s.isr_ns - s.switch_ns) / elapsed);
+		}
+	};
+};
+
+extern "C"
+{
+	void wsim_assert_failed(const char *file, int line)
+	{
+		fprintf(stderr, "[%12.6f] assert failed %s:%d\n", now_ns / 1e9, file, line);
+		abort();
+	}
+
+	configRUN_TIME_COUNTER_TYPE wsim_run_time_counter(void)
+	{
+		return (configRUN_TIME_COUNTER_TYPE)(now_ns / 1000);
+	}
+
+	void wsim_log(esp_log_level_t level, const char *tag, const char *format, ...)
+	{
+		static const char letters[] = "NEWIDV";
+		printf("%c (%.6f) %s: ", letters[level], now_ns / 1e9, tag);
+		va_list args;
+		va_start(args, format);
+		vprintf(format, args);
+		va_end(args);
+		printf("\n");
+	}
+
+	BaseType_t xPortGetCoreID(void)
+	{
+		if (isr_core >= 0)
+			return isr_core;
+		return ((current != nullptr) && (current->core >= 0)) ? current->core : 0;
+	}
+
+	BaseType_t xPortInIsrContext(void)
+	{
+		return isr_context ? pdTRUE : pdFALSE;
+	}
+
+	void vPortYield(void)
+	{
+		if ((current != nullptr) && (isr_core < 0))
+		{
+			// equal priorities take turns on an explicit yield
+			tskTaskControlBlock *task = current;
+			cores[task->core].running = nullptr;
+			make_ready(task, false);
+			yield_to_scheduler();
+		}
+	}
+
+	/* Tasks */
+
+	TaskHandle_t xTaskCreateStaticPinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack_depth, void *arg, UBaseType_t priority, StackType_t *stack, StaticTask_t *tcb, BaseType_t core)
+	{
+		(void)stack_depth;
+		(void)stack;
+		(void)tcb;
+		configASSERT(priority < configMAX_PRIORITIES);
+		configASSERT((core == tskNO_AFFINITY) || ((core >= 0) && (core < portNUM_PROCESSORS)));
+		auto task = std::make_unique<tskTaskControlBlock>();
+		task->name = (name != nullptr) ? name : "";
+		task->fn = fn;
+		task->arg = arg;
+		task->priority = priority;
+		task->affinity = core;
+		task->stack.reset(new uint8_t[WSIM_HOST_STACK_SIZE]);
+		task->stats = {task->name, core, priority, 0, 0, 0, UINT64_MAX, 0, 0, false};
+		getcontext(&task->context);
+		task->context.uc_stack.ss_sp = task->stack.get();
+		task->context.uc_stack.ss_size = WSIM_HOST_STACK_SIZE;
+		task->context.uc_link = &scheduler_context;
+		makecontext(&task->context, task_entry, 0);
+		tskTaskControlBlock *handle = task.get();
+		tasks.push_back(std::move(task));
+		make_ready(handle, false);
+		wsim::detail::charge(model.api_call_ns);
+		return handle;
+	}
+
+	BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack_depth, void *arg, UBaseType_t priority, TaskHandle_t *handle, BaseType_t core)
+	{
+		TaskHandle_t task = xTaskCreateStaticPinnedToCore(fn, name, stack_depth, arg, priority, nullptr, nullptr, core);
+		if (handle != nullptr)
+			*handle = task;
+		return pdPASS;
+	}
+
+	void vTaskDelete(TaskHandle_t task)
+	{
+		if (task == nullptr)
+			task = current;
+		configASSERT(task != nullptr);
+		detach(task);
+		task->state = TaskState::DELETED;
+		task->stats.deleted = true;
+		if (task == current)
+		{
+			yield_to_scheduler(); // never comes back, the scheduler frees the stack
+			return;
+		}
+		task->stack.reset();
+	}
+
+	void vTaskSuspend(TaskHandle_t task)
+	{
+		if (task == nullptr)
+			task = current;
+		configASSERT(task != nullptr);
+		detach(task);
+		task->state = TaskState::SUSPENDED;
+		if (task == current)
+			yield_to_scheduler();
+	}
+
+	void vTaskResume(TaskHandle_t task)
+	{
+		if ((task == nullptr) || (task->state != TaskState::SUSPENDED))
+			return;
+		make_ready(task, true);
+		wsim::detail::charge(model.api_call_ns);
+	}
+
+	void vTaskDelay(TickType_t ticks)
+	{
+		if (current == nullptr)
+			return;
+		if (ticks == 0)
+		{
+			vPortYield();
+			return;
+		}
+		block(nullptr, tick_deadline(ticks));
+	}
+
+	BaseType_t xTaskDelayUntil(TickType_t *previous_wake, TickType_t increment)
+	{
+		const TickType_t target = *previous_wake + increment;
+		*previous_wake = target;
+		if ((current == nullptr) || (target <= xTaskGetTickCount()))
+		{
+			vPortYield();
+			return pdFALSE;
+		}
+		block(nullptr, static_cast<uint64_t>(target) * WSIM_TICK_NS);
+		return pdTRUE;
+	}
+
+	TickType_t xTaskGetTickCount(void)
+	{
+		return static_cast<TickType_t>(now_ns / WSIM_TICK_NS);
+	}
+
+	TickType_t xTaskGetTickCountFromISR(void)
+	{
+		return xTaskGetTickCount();
+	}
+
+	TaskHandle_t xTaskGetCurrentTaskHandle(void)
+	{
+		return current;
+	}
+
+	void vTaskSetThreadLocalStoragePointer(TaskHandle_t task, BaseType_t index, void *value)
+	{
+		if (task == nullptr)
+			task = current;
+		if ((task != nullptr) && (index >= 0) && (index < configNUM_THREAD_LOCAL_STORAGE_POINTERS))
+			task->tls[index] = value;
+	}
+
+	void *pvTaskGetThreadLocalStoragePointer(TaskHandle_t task, BaseType_t index)
+	{
+		if (task == nullptr)
+			task = current;
+		return ((task != nullptr) && (index >= 0) && (index < configNUM_THREAD_LOCAL_STORAGE_POINTERS)) ? task->tls[index] : nullptr;
+	}
+
+	const char *pcTaskGetName(TaskHandle_t task)
+	{
+		if (task == nullptr)
+			task = current;
+		return (task != nullptr) ? task->name.c_str() : "";
+	}
+
+	TaskHandle_t xTaskGetIdleTaskHandleForCore(BaseType_t core)
+	{
+		configASSERT((core >= 0) && (core < portNUM_PROCESSORS));
+		if (idle_tasks[core].name.empty())
+			idle_tasks[core].name = "IDLE" + std::to_string(core);
+		return &idle_tasks[core];
+	}
+
+	configRUN_TIME_COUNTER_TYPE ulTaskGetRunTimeCounter(TaskHandle_t task)
+	{
+		if (task == nullptr)
+			task = current;
+		if ((task >= &idle_tasks[0]) && (task < &idle_tasks[portNUM_PROCESSORS]))
+		{
+			const wsim::CoreStats &s = cores[task - idle_tasks].stats;
+			return (configRUN_TIME_COUNTER_TYPE)((now_ns - s.task_ns - s.isr_ns - s.switch_ns) / 1000);
+		}
+		return (task != nullptr) ? (configRUN_TIME_COUNTER_TYPE)(task->stats.cpu_ns / 1000) : 0;
+	}
+
+	uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks)
+	{
+		tskTaskControlBlock *task = current;
+		configASSERT((task != nullptr) && (isr_core < 0));
+		const uint64_t deadline = tick_deadline(ticks);
+		while (task->notify_value == 0)
+		{
+			if ((ticks == 0) || !block(&task->notify_waiters, deadline))
+			{
+				wsim::detail::charge(model.api_call_ns);
+				return 0;
+			}
+		}
+		const uint32_t value = task->notify_value;
+		task->notify_value = (clear_on_exit != pdFALSE) ? 0 : value - 1;
+		wsim::detail::charge(model.api_call_ns);
+		return value;
+	}
+
+	BaseType_t xTaskNotifyGive(TaskHandle_t task)
+	{
+		task->notify_value++;
+		wake_one(task->notify_waiters);
+		wsim::detail::charge(model.api_call_ns);
+		return pdPASS;
+	}
+
+	void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *woken)
+	{
+		wsim::detail::charge(model.api_call_ns);
+		task->notify_value++;
+		set_woken(wake_one(task->notify_waiters), woken);
+	}
+
+	UBaseType_t uxTaskPriorityGet(TaskHandle_t task)
+	{
+		if (task == nullptr)
+			task = current;
+		return (task != nullptr) ? task->priority : 0;
+	}
+
+	/* Queues and semaphores */
+
+	static QueueHandle_t queue_create(QueueKind kind, UBaseType_t length, UBaseType_t item_size)
+	{
+		QueueDefinition *queue = new QueueDefinition();
+		queue->kind = kind;
+		queue->length = length;
+		queue->item_size = item_size;
+		return queue;
+	}
+
+	QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size)
+	{
+		configASSERT(length > 0);
+		return queue_create(QueueKind::QUEUE, length, item_size);
+	}
+
+	QueueHandle_t xQueueCreateStatic(UBaseType_t length, UBaseType_t item_size, uint8_t *storage, StaticQueue_t *buffer)
+	{
+		(void)storage;
+		(void)buffer;
+		return xQueueCreate(length, item_size);
+	}
+
+	void vQueueDelete(QueueHandle_t queue)
+	{
+		if (queue == nullptr)
+			return;
+		orphan(queue->receivers);
+		orphan(queue->senders);
+		delete queue;
+	}
+
+	BaseType_t xQueueGenericSend(QueueHandle_t queue, const void *item, TickType_t ticks, BaseType_t position)
+	{
+		const uint64_t deadline = tick_deadline(ticks);
+		while (queue->items.size() >= queue->length)
+		{
+			if ((ticks == 0) || (current == nullptr) || (isr_core >= 0) || !block(&queue->senders, deadline))
+			{
+				wsim::detail::charge(model.api_call_ns);
+				return pdFALSE;
+			}
+		}
+		const uint8_t *bytes = static_cast<const uint8_t *>(item);
+		std::vector<uint8_t> copy;
+		if (bytes != nullptr) // nullptr for the semaphores
+			copy.assign(bytes, bytes + queue->item_size);
+		if (position == queueSEND_TO_FRONT)
+			queue->items.push_front(std::move(copy));
+		else
+			queue->items.push_back(std::move(copy));
+		wake_one(queue->receivers);
+		wsim::detail::charge(model.api_call_ns + model.copy_ns_per_byte * queue->item_size);
+		return pdTRUE;
+	}
+
+	BaseType_t xQueueGenericSendFromISR(QueueHandle_t queue, const void *item, BaseType_t *woken, BaseType_t position)
+	{
+		wsim::detail::charge(model.api_call_ns);
+		if (queue->items.size() >= queue->length)
+			return pdFALSE;
+		const uint8_t *bytes = static_cast<const uint8_t *>(item);
+		std::vector<uint8_t> copy;
+		if (bytes != nullptr) // nullptr for the semaphores
+			copy.assign(bytes, bytes + queue->item_size);
+		if (position == queueSEND_TO_FRONT)
+			queue->items.push_front(std::move(copy));
+		else
+			queue->items.push_back(std::move(copy));
+		set_woken(wake_one(queue->receivers), woken);
+		return pdTRUE;
+	}
+
+	BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks)
+	{
+		const uint64_t deadline = tick_deadline(ticks);
+		while (queue->items.empty())
+		{
+			if ((ticks == 0) || (current == nullptr) || (isr_core >= 0) || !block(&queue->receivers, deadline))
+			{
+				wsim::detail::charge(model.api_call_ns);
+				return pdFALSE;
+			}
+		}
+		if (queue->item_size > 0)
+			memcpy(item, queue->items.front().data(), queue->item_size);
+		queue->items.pop_front();
+		wake_one(queue->senders);
+		wsim::detail::charge(model.api_call_ns + model.copy_ns_per_byte * queue->item_size);
+		return pdTRUE;
+	}
+
+	BaseType_t xQueueReceiveFromISR(QueueHandle_t queue, void *item, BaseType_t *woken)
+	{
+		wsim::detail::charge(model.api_call_ns);
+		if (queue->items.empty())
+			return pdFALSE;
+		if (queue->item_size > 0)
+			memcpy(item, queue->items.front().data(), queue->item_size);
+		queue->items.pop_front();
+		set_woken(wake_one(queue->senders), woken);
+		return pdTRUE;
+	}
+
+	UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue)
+	{
+		return queue->items.size();
+	}
+
+	UBaseType_t uxQueueSpacesAvailable(QueueHandle_t queue)
+	{
+		return queue->length - queue->items.size();
+	}
+
+	SemaphoreHandle_t xSemaphoreCreateMutex(void)
+	{
+		return queue_create(QueueKind::MUTEX, 1, 0);
+	}
+
+	SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t *buffer)
+	{
+		(void)buffer;
+		return xSemaphoreCreateMutex();
+	}
+
+	SemaphoreHandle_t xSemaphoreCreateBinary(void)
+	{
+		return queue_create(QueueKind::BINARY, 1, 0);
+	}
+
+	SemaphoreHandle_t xSemaphoreCreateBinaryStatic(StaticSemaphore_t *buffer)
+	{
+		(void)buffer;
+		return xSemaphoreCreateBinary();
+	}
+
+	BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks)
+	{
+		if (semaphore->kind != QueueKind::MUTEX)
+			return xQueueReceive(semaphore, nullptr, ticks);
+		const uint64_t deadline = tick_deadline(ticks);
+		while (semaphore->taken)
+		{
+			if ((ticks == 0) || (current == nullptr) || (isr_core >= 0) || !block(&semaphore->receivers, deadline))
+			{
+				wsim::detail::charge(model.api_call_ns);
+				return pdFALSE;
+			}
+		}
+		semaphore->taken = true;
+		semaphore->holder = current;
+		wsim::detail::charge(model.api_call_ns);
+		return pdTRUE;
+	}
+
+	BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore)
+	{
+		if (semaphore->kind != QueueKind::MUTEX)
+		{
+			if (!semaphore->items.empty())
+				return pdFALSE;
+			return xQueueGenericSend(semaphore, nullptr, 0, queueSEND_TO_BACK);
+		}
+		if (!semaphore->taken || (semaphore->holder != current))
+			return pdFALSE;
+		semaphore->taken = false;
+		semaphore->holder = nullptr;
+		wake_one(semaphore->receivers);
+		wsim::detail::charge(model.api_call_ns);
+		return pdTRUE;
+	}
+
+	BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t semaphore, BaseType_t *woken)
+	{
+		configASSERT(semaphore->kind != QueueKind::MUTEX);
+		if (!semaphore->items.empty())
+			return pdFALSE;
+		return xQueueGenericSendFromISR(semaphore, nullptr, woken, queueSEND_TO_BACK);
+	}
+
+	void vSemaphoreDelete(SemaphoreHandle_t semaphore)
+	{
+		vQueueDelete(semaphore);
+	}
+
+	/* Ring buffers */
+
+	static size_t ringbuf_item_size(size_t size)
+	{
+		return ((size + 3) & ~static_cast<size_t>(3)) + WSIM_RINGBUF_HEADER;
+	}
+
+	RingbufHandle_t xRingbufferCreate(size_t size, RingbufferType_t type)
+	{
+		configASSERT(type == RINGBUF_TYPE_NOSPLIT);
+		Ringbuffer *ringbuf = new Ringbuffer();
+		ringbuf->size = size & ~static_cast<size_t>(3);
+		return ringbuf;
+	}
+
+	RingbufHandle_t xRingbufferCreateStatic(size_t size, RingbufferType_t type, uint8_t *storage, StaticRingbuffer_t *buffer)
+	{
+		(void)storage;
+		(void)buffer;
+		return xRingbufferCreate(size, type);
+	}
+
+	void vRingbufferDelete(RingbufHandle_t ringbuf)
+	{
+		if (ringbuf == nullptr)
+			return;
+		orphan(ringbuf->receivers);
+		orphan(ringbuf->senders);
+		delete ringbuf;
+	}
+
+	size_t xRingbufferGetMaxItemSize(RingbufHandle_t ringbuf)
+	{
+		return ((ringbuf->size / 2) & ~static_cast<size_t>(3)) - WSIM_RINGBUF_HEADER;
+	}
+
+	size_t xRingbufferGetCurFreeSize(RingbufHandle_t ringbuf)
+	{
+		const size_t free = ringbuf->size - ringbuf->used;
+		return (free > WSIM_RINGBUF_HEADER) ? std::min(free - WSIM_RINGBUF_HEADER, xRingbufferGetMaxItemSize(ringbuf)) : 0;
+	}
+
+	static void ringbuf_push(RingbufHandle_t ringbuf, const void *data, size_t size)
+	{
+		const uint8_t *bytes = static_cast<const uint8_t *>(data);
+		ringbuf->items.push_back({std::vector<uint8_t>(bytes, bytes + size), false});
+		ringbuf->used += ringbuf_item_size(size);
+	}
+
+	/* Wait for the space of an item from a task, false after the timeout */
+	static bool ringbuf_wait_space(RingbufHandle_t ringbuf, size_t size, TickType_t ticks)
+	{
+		if (size > xRingbufferGetMaxItemSize(ringbuf))
+			return false;
+		const uint64_t deadline = tick_deadline(ticks);
+		while (ringbuf->used + ringbuf_item_size(size) > ringbuf->size)
+		{
+			if ((ticks == 0) || (current == nullptr) || (isr_core >= 0) || !block(&ringbuf->senders, deadline))
+			{
+				wsim::detail::charge(model.api_call_ns);
+				return false;
+			}
+		}
+		return true;
+	}
+
+	BaseType_t xRingbufferSend(RingbufHandle_t ringbuf, const void *data, size_t size, TickType_t ticks)
+	{
+		if (!ringbuf_wait_space(ringbuf, size, ticks))
+			return pdFALSE;
+		ringbuf_push(ringbuf, data, size);
+		wake_one(ringbuf->receivers);
+		wsim::detail::charge(model.api_call_ns + model.copy_ns_per_byte * size);
+		return pdTRUE;
+	}
+
+	BaseType_t xRingbufferSendFromISR(RingbufHandle_t ringbuf, const void *data, size_t size, BaseType_t *woken)
+	{
+		wsim::detail::charge(model.api_call_ns + model.copy_ns_per_byte * size);
+		if ((size > xRingbufferGetMaxItemSize(ringbuf)) || (ringbuf->used + ringbuf_item_size(size) > ringbuf->size))
+			return pdFALSE;
+		ringbuf_push(ringbuf, data, size);
+		set_woken(wake_one(ringbuf->receivers), woken);
+		return pdTRUE;
+	}
+
+	/* Reserves the item in place (no split type only, task context): the items after it are received once it is complete */
+	BaseType_t xRingbufferSendAcquire(RingbufHandle_t ringbuf, void **item, size_t size, TickType_t ticks)
+	{
+		configASSERT(isr_core < 0);
+		if (!ringbuf_wait_space(ringbuf, size, ticks))
+			return pdFALSE;
+		ringbuf->items.push_back({std::vector<uint8_t>(size), false, false});
+		ringbuf->used += ringbuf_item_size(size);
+		*item = ringbuf->items.back().data.data();
+		wsim::detail::charge(model.api_call_ns);
+		return pdTRUE;
+	}
+
+	BaseType_t xRingbufferSendComplete(RingbufHandle_t ringbuf, void *item)
+	{
+		for (Ringbuffer::Item &acquired : ringbuf->items)
+		{
+			if (acquired.data.data() != item)
+				continue;
+			acquired.complete = true;
+			wake_one(ringbuf->receivers);
+			wsim::detail::charge(model.api_call_ns);
+			return pdTRUE;
+		}
+		configASSERT(false);
+		return pdFALSE;
+	}
+
+	void *xRingbufferReceive(RingbufHandle_t ringbuf, size_t *size, TickType_t ticks)
+	{
+		const uint64_t deadline = tick_deadline(ticks);
+		while (true)
+		{
+			for (Ringbuffer::Item &item : ringbuf->items)
+			{
+				if (item.received)
+					continue;
+				if (!item.complete)
+					break; // the items are received in order
+				item.received = true;
+				*size = item.data.size();
+				wsim::detail::charge(model.api_call_ns);
+				return item.data.data();
+			}
+			if ((ticks == 0) || (current == nullptr) || (isr_core >= 0) || !block(&ringbuf->receivers, deadline))
+			{
+				wsim::detail::charge(model.api_call_ns);
+				return nullptr;
+			}
+		}
+	}
+
+	void vRingbufferReturnItem(RingbufHandle_t ringbuf, void *item)
+	{
+		for (auto it = ringbuf->items.begin(); it != ringbuf->items.end(); ++it)
+		{
+			if (it->data.data() != item)
+				continue;
+			ringbuf->used -= ringbuf_item_size(it->data.size());
+			ringbuf->items.erase(it);
+			wake_all(ringbuf->senders); // the free space may fit several waiting items of different sizes
+			wsim::detail::charge(model.api_call_ns);
+			return;
+		}
+		configASSERT(false);
+	}
+}
@@ -0,0 +1,38 @@
+/**
+ * @file kernel.hpp
+ * @brief Internals of the simulator shared by the kernel and the peripheral models
+ */
+#ifndef WSIM_KERNEL_HPP_
+#define WSIM_KERNEL_HPP_
+
+#include <cstdint>
+#include <functional>
+#include "wsim.hpp"
+
+namespace wsim
+{
+	namespace detail
+	{
+		/**
+		 * @brief Call a function at a virtual time from the scheduler context (events of the same time keep their order)
+		 */
+		void schedule(uint64_t time_ns, std::function<void()> fn);
+
+		/**
+		 * @brief Run a function now as an interrupt of a core : its entry cost and its calls stall the task of the core
+		 *
+		 * @param core
+		 * @param entry_ns entry cost
+		 * @param isr_context value of xPortInIsrContext during the call
+		 * @param fn
+		 */
+		void interrupt(BaseType_t core, uint32_t entry_ns, bool isr_context, const std::function<void()> &fn);
+
+		/**
+		 * @brief Cost of a primitive : stalls the current task (and gives the scheduler a preemption point) or the current ISR
+		 */
+		void charge(uint64_t ns);
+	};
+};
+
+#endif // WSIM_KERNEL_HPP_
@@ -0,0 +1,466 @@
+/**
+ * @file peripherals.cpp
+ * @brief Peripherals of the simulator on the virtual time : esp_timer, GPIO, cycle counter, MCPWM capture and the virtual
+ *        ultrasound echo sources
+ * @details The esp_timer callbacks and the GPIO ISR run as interrupts of a core (core 0 for the timers, the core that installed
+ *          the ISR service for the GPIO) : their cost stalls the task of that core.
+ */
+#include <memory>
+#include <vector>
+
+#include "esp_timer.h"
+#include "esp_cpu.h"
+#include "driver/gpio.h"
+#include "driver/mcpwm_cap.h"
+#include "soc/soc_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "kernel.hpp"
+
+struct esp_timer
+{
+	esp_timer_cb_t callback;
+	void *arg;
+	esp_timer_dispatch_t dispatch;
+	uint64_t period_us; // 0 for a one shot timer
+	bool active = false;
+	bool deleted = false;
+	uint64_t generation = 0; // invalidates the pending expiry of a stopped timer
+};
+
+struct mcpwm_cap_timer_t
+{
+	int group_id;
+	int channels = 0; // capture channels created on the timer
+	bool running = false;
+};
+
+struct mcpwm_cap_channel_t
+{
+	mcpwm_cap_timer_t *timer;
+	gpio_num_t pin;
+	bool pos_edge;
+	bool neg_edge;
+	bool enabled = false;
+	mcpwm_capture_event_cb_t on_cap = nullptr;
+	void *user_data = nullptr;
+};
+
+namespace
+{
+	struct Pin
+	{
+		uint32_t level = 0;
+		gpio_int_type_t type = GPIO_INTR_DISABLE;
+		bool intr_enabled = false;
+		gpio_isr_t handler = nullptr;
+		void *arg = nullptr;
+		std::vector<std::function<void(gpio_num_t, uint32_t)>> listeners;
+	};
+
+	Pin pins[GPIO_NUM_MAX];
+	BaseType_t gpio_isr_core = -1; // ISR service not installed
+	std::vector<std::unique_ptr<esp_timer>> timers; // never freed, a pending expiry can outlive esp_timer_delete
+	std::vector<std::unique_ptr<mcpwm_cap_channel_t>> capture_channels;
+	mcpwm_cap_timer_t *capture_timers[SOC_MCPWM_GROUPS] = {}; // one capture timer per group, as on the ESP32-S3
+
+	bool valid_pin(gpio_num_t pin)
+	{
+		return (pin >= 0) && (pin < GPIO_NUM_MAX);
+	};
+
+	bool edge_matches(gpio_int_type_t type, uint32_t level)
+	{
+		switch (type)
+		{
+		case GPIO_INTR_POSEDGE:
+		case GPIO_INTR_HIGH_LEVEL:
+			return level == 1;
+		case GPIO_INTR_NEGEDGE:
+		case GPIO_INTR_LOW_LEVEL:
+			return level == 0;
+		case GPIO_INTR_ANYEDGE:
+			return true;
+		default:
+			return false;
+		}
+	};
+
+	/**
+	 * @brief Change the level of a pin : listeners first (e.g. the capture latches the edge), then the GPIO interrupt
+	 */
+	void set_pin_level(gpio_num_t pin, uint32_t level)
+	{
+		Pin &p = pins[pin];
+		level = (level != 0) ? 1 : 0;
+		if (p.level == level)
+			return;
+		p.level = level;
+		for (auto &listener : p.listeners)
+			listener(pin, level);
+		if (p.intr_enabled && (p.handler != nullptr) && (gpio_isr_core >= 0) && edge_matches(p.type, level))
+		{
+			gpio_isr_t handler = p.handler;
+			void *arg = p.arg;
+			wsim::detail::interrupt(gpio_isr_core, wsim::cost_model().isr_entry_ns, true, [handler, arg]()
+									{ handler(arg); });
+		}
+	};
+
+	void timer_arm(esp_timer *timer, uint64_t timeout_us)
+	{
+		timer->active = true;
+		const uint64_t generation = ++timer->generation;
+		wsim::detail::schedule(wsim::now() + timeout_us * 1000, [timer, generation]()
+							   {
+								   if (!timer->active || (timer->generation != generation))
+									   return;
+								   if (timer->period_us > 0)
+									   timer_arm(timer, timer->period_us);
+								   else
+									   timer->active = false;
+								   const bool isr = (timer->dispatch == ESP_TIMER_ISR);
+								   const wsim::CostModel &model = wsim::cost_model();
+								   wsim::detail::interrupt(0, isr ? model.isr_entry_ns : model.timer_dispatch_ns, isr, [timer]()
+														   { timer->callback(timer->arg); }); });
+	};
+
+	uint32_t capture_counter()
+	{
+		return static_cast<uint32_t>(wsim::now() * (WSIM_MCPWM_CAPTURE_RESOLUTION_HZ / 1000000) / 1000);
+	};
+
+	/**
+	 * @brief State of a virtual ultrasound sensor
+	 */
+	struct EchoState
+	{
+		wsim::EchoSource source;
+		uint32_t random;
+
+		uint32_t next_random()
+		{
+			random = random * 1664525u + 1013904223u; // LCG, same sequence on every run
+			return random >> 8;
+		};
+
+		void on_trigger_end()
+		{
+			const uint32_t distance_mm = source.distance_mm(wsim::now());
+			const bool dropped = (source.drop_per_mille > 0) && ((next_random() % 1000) < source.drop_per_mille);
+			const uint32_t jitter_ns = (source.jitter_ns > 0) ? (next_random() % (source.jitter_ns + 1)) : 0;
+			if (dropped || (distance_mm > source.max_range_mm))
+				return;
+			const uint64_t rise = wsim::now() + static_cast<uint64_t>(source.response_delay_us) * 1000;
+			const uint64_t width = 2ULL * distance_mm * 1000000000ULL / source.sound_speed_mm_s + jitter_ns;
+			const gpio_num_t echo_pin = source.echo_pin;
+			wsim::detail::schedule(rise, [echo_pin]()
+								   { set_pin_level(echo_pin, 1); });
+			wsim::detail::schedule(rise + width, [echo_pin]()
+								   { set_pin_level(echo_pin, 0); });
+		};
+	};
+};
+
+namespace wsim
+{
+	void gpio_drive(gpio_num_t pin, uint32_t level)
+	{
+		configASSERT(valid_pin(pin));
+		set_pin_level(pin, level);
+	};
+
+	void gpio_listen(gpio_num_t pin, std::function<void(gpio_num_t pin, uint32_t level)> listener)
+	{
+		configASSERT(valid_pin(pin));
+		pins[pin].listeners.push_back(std::move(listener));
+	};
+
+	void add_echo_source(const EchoSource &source)
+	{
+		auto state = std::make_shared<EchoState>(EchoState{source, source.seed});
+		gpio_listen(source.trig_pin, [state](gpio_num_t, uint32_t level)
+					{
+						if (level == 0)
+							state->on_trigger_end(); });
+	};
+};
+
+extern "C"
+{
+	/* Cycle counter */
+
+	esp_cpu_cycle_count_t esp_cpu_get_cycle_count(void)
+	{
+		return static_cast<esp_cpu_cycle_count_t>(wsim::now() * wsim::cost_model().cpu_mhz / 1000);
+	}
+
+	/* esp_timer */
+
+	esp_err_t esp_timer_init(void)
+	{
+		return ESP_OK;
+	}
+
+	esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *handle)
+	{
+		if ((args == nullptr) || (args->callback == nullptr) || (handle == nullptr))
+			return ESP_ERR_INVALID_ARG;
+		auto timer = std::make_unique<esp_timer>();
+		timer->callback = args->callback;
+		timer->arg = args->arg;
+		timer->dispatch = args->dispatch_method;
+		*handle = timer.get();
+		timers.push_back(std::move(timer));
+		return ESP_OK;
+	}
+
+	esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+	{
+		if ((timer == nullptr) || timer->deleted)
+			return ESP_ERR_INVALID_ARG;
+		if (timer->active)
+			return ESP_ERR_INVALID_STATE;
+		timer->period_us = 0;
+		timer_arm(timer, timeout_us);
+		return ESP_OK;
+	}
+
+	esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period_us)
+	{
+		if ((timer == nullptr) || timer->deleted || (period_us == 0))
+			return ESP_ERR_INVALID_ARG;
+		if (timer->active)
+			return ESP_ERR_INVALID_STATE;
+		timer->period_us = period_us;
+		timer_arm(timer, period_us);
+		return ESP_OK;
+	}
+
+	esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+	{
+		if ((timer == nullptr) || timer->deleted)
+			return ESP_ERR_INVALID_ARG;
+		if (!timer->active)
+			return ESP_ERR_INVALID_STATE;
+		timer->active = false;
+		timer->generation++;
+		return ESP_OK;
+	}
+
+	esp_err_t esp_timer_delete(esp_timer_handle_t timer)
+	{
+		if ((timer == nullptr) || timer->deleted)
+			return ESP_ERR_INVALID_ARG;
+		if (timer->active)
+			return ESP_ERR_INVALID_STATE;
+		timer->deleted = true;
+		return ESP_OK;
+	}
+
+	bool esp_timer_is_active(esp_timer_handle_t timer)
+	{
+		return (timer != nullptr) && timer->active;
+	}
+
+	int64_t esp_timer_get_time(void)
+	{
+		return static_cast<int64_t>(wsim::now() / 1000);
+	}
+
+	/* GPIO */
+
+	esp_err_t gpio_config(const gpio_config_t *config)
+	{
+		if ((config == nullptr) || (config->pin_bit_mask >> GPIO_NUM_MAX) != 0)
+			return ESP_ERR_INVALID_ARG;
+		for (gpio_num_t pin = 0; pin < GPIO_NUM_MAX; pin++)
+		{
+			if ((config->pin_bit_mask & (1ULL << pin)) == 0)
+				continue;
+			pins[pin].type = config->intr_type;
+			pins[pin].intr_enabled = (config->intr_type != GPIO_INTR_DISABLE);
+		}
+		return ESP_OK;
+	}
+
+	esp_err_t gpio_install_isr_service(int intr_alloc_flags)
+	{
+		(void)intr_alloc_flags;
+		if (gpio_isr_core >= 0)
+			return ESP_ERR_INVALID_STATE;
+		gpio_isr_core = xPortGetCoreID();
+		return ESP_OK;
+	}
+
+	void gpio_uninstall_isr_service(void)
+	{
+		gpio_isr_core = -1;
+	}
+
+	esp_err_t gpio_isr_handler_add(gpio_num_t pin, gpio_isr_t handler, void *arg)
+	{
+		if (!valid_pin(pin))
+			return ESP_ERR_INVALID_ARG;
+		if (gpio_isr_core < 0)
+			return ESP_ERR_INVALID_STATE;
+		pins[pin].handler = handler;
+		pins[pin].arg = arg;
+		return ESP_OK;
+	}
+
+	esp_err_t gpio_isr_handler_remove(gpio_num_t pin)
+	{
+		if (!valid_pin(pin))
+			return ESP_ERR_INVALID_ARG;
+		pins[pin].handler = nullptr;
+		pins[pin].arg = nullptr;
+		return ESP_OK;
+	}
+
+	esp_err_t gpio_intr_enable(gpio_num_t pin)
+	{
+		if (!valid_pin(pin))
+			return ESP_ERR_INVALID_ARG;
+		pins[pin].intr_enabled = true;
+		return ESP_OK;
+	}
+
+	esp_err_t gpio_intr_disable(gpio_num_t pin)
+	{
+		if (!valid_pin(pin))
+			return ESP_ERR_INVALID_ARG;
+		pins[pin].intr_enabled = false;
+		return ESP_OK;
+	}
+
+	esp_err_t gpio_set_intr_type(gpio_num_t pin, gpio_int_type_t type)
+	{
+		if (!valid_pin(pin))
+			return ESP_ERR_INVALID_ARG;
+		pins[pin].type = type;
+		return ESP_OK;
+	}
+
+	esp_err_t gpio_set_level(gpio_num_t pin, uint32_t level)
+	{
+		if (!valid_pin(pin))
+			return ESP_ERR_INVALID_ARG;
+		set_pin_level(pin, level);
+		return ESP_OK;
+	}
+
+	int gpio_get_level(gpio_num_t pin)
+	{
+		return valid_pin(pin) ? static_cast<int>(pins[pin].level) : 0;
+	}
+
+	/* MCPWM capture */
+
+	esp_err_t mcpwm_new_capture_timer(const mcpwm_capture_timer_config_t *config, mcpwm_cap_timer_handle_t *timer)
+	{
+		if ((config == nullptr) || (timer == nullptr) || (config->group_id < 0) || (config->group_id >= SOC_MCPWM_GROUPS))
+			return ESP_ERR_INVALID_ARG;
+		if (capture_timers[config->group_id] != nullptr)
+			return ESP_ERR_NOT_FOUND;
+		*timer = new mcpwm_cap_timer_t();
+		(*timer)->group_id = config->group_id;
+		capture_timers[config->group_id] = *timer;
+		return ESP_OK;
+	}
+
+	esp_err_t mcpwm_del_capture_timer(mcpwm_cap_timer_handle_t timer)
+	{
+		if (timer->channels != 0)
+			return ESP_ERR_INVALID_STATE;
+		capture_timers[timer->group_id] = nullptr;
+		delete timer;
+		return ESP_OK;
+	}
+
+	esp_err_t mcpwm_capture_timer_enable(mcpwm_cap_timer_handle_t timer)
+	{
+		(void)timer;
+		return ESP_OK;
+	}
+
+	esp_err_t mcpwm_capture_timer_disable(mcpwm_cap_timer_handle_t timer)
+	{
+		(void)timer;
+		return ESP_OK;
+	}
+
+	esp_err_t mcpwm_capture_timer_start(mcpwm_cap_timer_handle_t timer)
+	{
+		timer->running = true;
+		return ESP_OK;
+	}
+
+	esp_err_t mcpwm_capture_timer_stop(mcpwm_cap_timer_handle_t timer)
+	{
+		timer->running = false;
+		return ESP_OK;
+	}
+
+	esp_err_t mcpwm_capture_timer_get_resolution(mcpwm_cap_timer_handle_t timer, uint32_t *resolution_hz)
+	{
+		(void)timer;
+		*resolution_hz = WSIM_MCPWM_CAPTURE_RESOLUTION_HZ;
+		return ESP_OK;
+	}
+
+	esp_err_t mcpwm_new_capture_channel(mcpwm_cap_timer_handle_t timer, const mcpwm_capture_channel_config_t *config, mcpwm_cap_channel_handle_t *chan)
+	{
+		if ((timer == nullptr) || (config == nullptr) || (chan == nullptr) || !valid_pin(config->gpio_num))
+			return ESP_ERR_INVALID_ARG;
+		if (timer->channels == SOC_MCPWM_CAPTURE_CHANNELS_PER_TIMER)
+			return ESP_ERR_NOT_FOUND;
+		++timer->channels;
+		auto channel = std::make_unique<mcpwm_cap_channel_t>();
+		channel->timer = timer;
+		channel->pin = config->gpio_num;
+		channel->pos_edge = config->flags.pos_edge;
+		channel->neg_edge = config->flags.neg_edge;
+		mcpwm_cap_channel_t *handle = channel.get();
+		// the listener of the pin can't be removed : a deleted channel stays allocated and disabled
+		wsim::gpio_listen(channel->pin, [handle](gpio_num_t, uint32_t level)
+						  {
+							  if (!handle->enabled || !handle->timer->running || (handle->on_cap == nullptr))
+								  return;
+							  if ((level == 1) ? !handle->pos_edge : !handle->neg_edge)
+								  return;
+							  const mcpwm_capture_event_data_t data = {capture_counter(), (level == 1) ? MCPWM_CAP_EDGE_POS : MCPWM_CAP_EDGE_NEG};
+							  wsim::detail::interrupt(0, wsim::cost_model().isr_entry_ns, true, [handle, &data]()
+													  { handle->on_cap(handle, &data, handle->user_data); }); });
+		capture_channels.push_back(std::move(channel));
+		*chan = handle;
+		return ESP_OK;
+	}
+
+	esp_err_t mcpwm_del_capture_channel(mcpwm_cap_channel_handle_t chan)
+	{
+		chan->enabled = false;
+		chan->on_cap = nullptr;
+		--chan->timer->channels;
+		chan->timer = nullptr;
+		return ESP_OK;
+	}
+
+	esp_err_t mcpwm_capture_channel_enable(mcpwm_cap_channel_handle_t chan)
+	{
+		chan->enabled = true;
+		return ESP_OK;
+	}
+
+	esp_err_t mcpwm_capture_channel_disable(mcpwm_cap_channel_handle_t chan)
+	{
+		chan->enabled = false;
+		return ESP_OK;
+	}
+
+	esp_err_t mcpwm_capture_channel_register_event_callbacks(mcpwm_cap_channel_handle_t chan, const mcpwm_capture_event_callbacks_t *callbacks, void *user_data)
+	{
+		chan->on_cap = callbacks->on_cap;
+		chan->user_data = user_data;
+		return ESP_OK;
+	}
+}
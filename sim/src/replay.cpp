@@ -0,0 +1,167 @@
+/**
+ * @file replay.cpp
+ * @brief Replay of a WRecord log into the tasks of the simulator (see wreplay.hpp)
+ */
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <unordered_map>
+
+#include "wreplay.hpp"
+#include "wsim.hpp"
+#include "WRecord.h"
+#include "RTask.hpp"
+#include "esp_log.h"
+
+static const char *WREPLAY_LOG_TAG = "WREPLAY";
+
+namespace wsim
+{
+	Replay::Replay(const char *path)
+	{
+		const int fd = open(path, O_RDONLY);
+		if (fd < 0)
+		{
+			ESP_LOGE(WREPLAY_LOG_TAG, "Can't open %s", path);
+			return;
+		}
+		struct stat st;
+		if ((fstat(fd, &st) != 0) || (static_cast<size_t>(st.st_size) < sizeof(WRecord_FileHeader_t)))
+		{
+			ESP_LOGE(WREPLAY_LOG_TAG, "%s is not a record log", path);
+			close(fd);
+			return;
+		}
+		void *map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd);
+		if (map == MAP_FAILED)
+		{
+			ESP_LOGE(WREPLAY_LOG_TAG, "Can't map %s", path);
+			return;
+		}
+		WRecord_FileHeader_t header;
+		memcpy(&header, map, sizeof(header));
+		if ((memcmp(header.magic, WRECORD_MAGIC, sizeof(header.magic)) != 0) || (header.version != WRECORD_VERSION) ||
+			(header.header_size < sizeof(header)) || (header.header_size > st.st_size))
+		{
+			ESP_LOGE(WREPLAY_LOG_TAG, "%s is not a record log of version %d", path, WRECORD_VERSION);
+			munmap(map, st.st_size);
+			return;
+		}
+		base = static_cast<const uint8_t *>(map);
+		length = st.st_size;
+	};
+
+	Replay::~Replay()
+	{
+		if (base != nullptr)
+			munmap(const_cast<uint8_t *>(base), length);
+	};
+
+	void Replay::onMeasurement(std::function<void(gpio_num_t echo_pin, const Ultrasound_Measurement_t &measure)> handler)
+	{
+		measurement_handler = std::move(handler);
+	};
+
+	void Replay::task(void *arg)
+	{
+		static_cast<Replay *>(arg)->replay();
+		vTaskDelete(nullptr);
+	};
+
+	/**
+	 * @brief Body of the replay task
+	 */
+	void Replay::replay()
+	{
+		// NTask of the program by identifier, looked up once (getNTaskByIdentifier logs the misses)
+		std::unordered_map<uint16_t, NTask *> ntasks;
+		for (uint32_t type = 0; type <= UINT8_MAX; type++)
+			for (NTask *ntask : NTask::getNTaskByType(static_cast<char>(type)))
+				ntasks[ntask->getIdentifier().w_id] = ntask;
+		const uint16_t isr_source = NOTIFICATION_FROM_ISR(0).Identifier.w_id;
+
+		const uint64_t start_ns = wsim::now();
+		int64_t first_us = 0;
+		int64_t last_us = 0;
+		WRecord_FileHeader_t file_header;
+		memcpy(&file_header, base, sizeof(file_header));
+		size_t offset = file_header.header_size;
+		while (offset + sizeof(WRecord_Header_t) <= length)
+		{
+			WRecord_Header_t header;
+			memcpy(&header, base + offset, sizeof(header));
+			if (offset + sizeof(header) + header.size > length)
+				break; // truncated by the end of the recording
+			const uint8_t *payload = base + offset + sizeof(header);
+			offset += WRECORD_NEXT(&header);
+			if (stats.records++ == 0)
+				first_us = header.timestamp_us;
+			last_us = std::max(last_us, header.timestamp_us);
+			// the timestamps can go backwards (WRecord_Header_t) : such a record is injected without waiting
+			if ((pace == Pace::REALTIME) && (header.timestamp_us > first_us))
+				wsim::sleep_until(start_ns + static_cast<uint64_t>(header.timestamp_us - first_us) * 1000);
+
+			if (header.type == WRECORD_DROP)
+			{
+				uint32_t count;
+				memcpy(&count, payload, sizeof(count));
+				stats.lost += count;
+				continue;
+			}
+			if (header.type == WRECORD_ULTRASOUND)
+			{
+				if (measurement_handler)
+				{
+					Ultrasound_Measurement_t measure;
+					memcpy(&measure, payload, sizeof(measure));
+					measurement_handler(static_cast<gpio_num_t>(header.source), measure);
+					stats.measurements++;
+				}
+				continue;
+			}
+			const auto destination = ntasks.find(header.destination);
+			const bool regenerated = (header.source != isr_source) && (ntasks.count(header.source) > 0);
+			if ((destination == ntasks.end()) || regenerated || (destination->second->getType() == (char)NTASK_TYPE_NOTIF_WORK_QUEU))
+			{
+				stats.skipped++;
+				continue;
+			}
+			if ((header.type == WRECORD_NOTIF) || (header.type == WRECORD_NOTIF_FRONT))
+			{
+				Notification_t notif;
+				memcpy(&notif, payload, sizeof(notif));
+				NTask::sendNotificationTo(destination->second, notif, portMAX_DELAY, (header.type == WRECORD_NOTIF_FRONT) ? queueSEND_TO_FRONT : queueSEND_TO_BACK);
+			}
+			else if (header.type == WRECORD_DATA)
+			{
+				RTask::sendDataTo(static_cast<RTask *>(destination->second), const_cast<uint8_t *>(payload), header.size, portMAX_DELAY, false, (Notification_t){.d0 = 0});
+			}
+			stats.injected++;
+		}
+		stats.log_us = last_us - first_us;
+		stats.virtual_ns = wsim::now() - start_ns;
+		finished = true;
+		wsim::stop();
+	};
+
+	ReplayStats Replay::run(Pace replay_pace, BaseType_t core, uint64_t timeout_ns)
+	{
+		stats = {};
+		if (base == nullptr)
+			return stats;
+		pace = replay_pace;
+		finished = false;
+		const auto host_start = std::chrono::steady_clock::now();
+		xTaskCreatePinnedToCore(task, "replay", 4096, this, configMAX_PRIORITIES - 1, nullptr, core);
+		wsim::run_for(timeout_ns);
+		stats.host_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - host_start).count();
+		if (!finished)
+			ESP_LOGE(WREPLAY_LOG_TAG, "Replay not finished after %.3f s of virtual time", timeout_ns / 1e9);
+		return stats;
+	};
+};
@@ -0,0 +1,97 @@
+/**
+ * @file blockfixed.cpp
+ * @brief BlockFixed : choice of the exponent over frames of very different amplitude, conversions from and to FixedPoint,
+ *        scaling by a gain and normalization
+ */
+#include <random>
+#include "check.hpp"
+#include "blockfixed.hpp"
+
+static constexpr std::size_t N = 64;
+
+/**
+ * @brief Loads a frame of raw samples of the given amplitude, returns the worst error relative to the amplitude
+ */
+template <typename M>
+static double check_frame(std::mt19937 &rng, int32_t amplitude)
+{
+    std::uniform_int_distribution<int32_t> dist(-amplitude, amplitude);
+    int32_t samples[N];
+    for (auto &s : samples)
+        s = dist(rng);
+    samples[0] = amplitude; // the frame reaches its amplitude
+
+    BlockFixed<N, M> block;
+    block.load(samples, -16); // samples with 16 fractional bits
+    int32_t largest = 0;
+    double worst = 0;
+    for (std::size_t i = 0; i < N; ++i)
+    {
+        const double value = std::ldexp(double(block.getMantissa(i)), block.getExponent());
+        const double error = std::fabs(value - std::ldexp(double(samples[i]), -16));
+        worst = std::max(worst, error / std::ldexp(double(amplitude), -16));
+        CHECK(error < std::ldexp(1.0, block.getExponent())); // truncated to the exponent of the block
+        largest = std::max<int32_t>(largest, std::abs(int32_t(block.getMantissa(i))));
+    }
+    CHECK(largest >= (1 << (8 * sizeof(M) - 2))); // no headroom left : the largest mantissa uses all the bits
+    return worst;
+}
+
+int main()
+{
+    std::mt19937 rng(33);
+
+    // frames from 2^4 to 2^30 : the relative error only depends on the bits of the mantissa
+    double worst16 = 0, worst32 = 0, worst_q = 0;
+    for (int bits = 4; bits <= 30; ++bits)
+    {
+        const int32_t amplitude = int32_t((int64_t(1) << bits) - 1);
+        worst16 = std::max(worst16, check_frame<int16_t>(rng, amplitude));
+        worst32 = std::max(worst32, check_frame<int32_t>(rng, amplitude));
+        // the same frame in a fixed Q-format of 16 bits clips or loses the small frames
+        const FixedPoint16<7, 7> q(std::min(std::ldexp(double(amplitude), -16), 127.0) / 3);
+        worst_q = std::max(worst_q, std::fabs(double(q) - std::ldexp(double(amplitude), -16) / 3) / std::ldexp(double(amplitude), -16));
+    }
+    printf("frames of 2^4 to 2^30 counts : worst error relative to the amplitude %.2e (int16_t mantissas), %.2e (int32_t), %.2e (FixedPoint16<7, 7>)\n", worst16, worst32, worst_q);
+    CHECK(worst16 < std::ldexp(1.0, -14));
+    CHECK(worst32 < std::ldexp(1.0, -30));
+    CHECK(worst_q > 0.1);
+
+    // FixedPoint values that fit the mantissa are read back exactly, with any format with enough fractional bits
+    FixedPoint<4, 16> in[N], out[N];
+    for (std::size_t i = 0; i < N; ++i)
+        in[i] = FixedPoint<4, 16>(static_cast<FixedPoint<4, 16>::raw_t>(int32_t(i * 97) - 3000)); // |m| < 2^14
+    BlockFixed<N> block;
+    block.load(in);
+    block.store(out);
+    for (std::size_t i = 0; i < N; ++i)
+    {
+        CHECK(out[i] == in[i]);
+        CHECK((block.get<FixedPoint<8, 20>>(i) == FixedPoint<8, 20>(in[i])));
+    }
+    // fewer fractional bits : truncated toward minus infinity
+    CHECK((block.get<FixedPoint<4, 8>>(0).getM() == (-3000 >> 8)));
+
+    // scale by a gain, then compare to the product in double
+    const FixedPoint<2, 12> gain(-1.75);
+    block.scale(gain);
+    for (std::size_t i = 0; i < N; ++i)
+        CHECK_NEAR(double(block.get<FixedPoint<8, 20>>(i)), double(in[i]) * -1.75, std::ldexp(1.0, block.getExponent()));
+
+    // in place modification, then normalization gives back the headroom
+    for (std::size_t i = 0; i < N; ++i)
+        block.data()[i] = static_cast<int16_t>(block.data()[i] / 64);
+    const int before = block.getExponent();
+    block.normalize();
+    CHECK(block.getExponent() == before - 6);
+
+    // a zero frame stays zero
+    const int32_t zeros[N] = {};
+    BlockFixed<N, int32_t> zero;
+    zero.load(zeros);
+    zero.normalize();
+    CHECK((zero.get<FixedPoint<4, 16>>(N - 1).getM() == 0));
+
+    CHECK(reinterpret_cast<uintptr_t>(block.data()) % 16 == 0);
+    return wsim_check::result("blockfixed");
+}
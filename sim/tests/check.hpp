@@ -0,0 +1,50 @@
+/**
+ * @file check.hpp
+ * @brief Minimal checks for the host tests of sim/tests : a failed check prints its location and the test returns non zero
+ */
+#ifndef WSIM_CHECK_HPP_
+#define WSIM_CHECK_HPP_
+
+#include <cmath>
+#include <cstdio>
+
+namespace wsim_check
+{
+	inline int failures = 0;
+
+	inline void fail(const char *file, int line, const char *expr)
+	{
+		++failures;
+		printf("%s:%d: check failed: %s\n", file, line, expr);
+	}
+
+	/**
+	 * @brief Exit code of the test : prints a summary and returns 1 if a check failed
+	 *
+	 */
+	inline int result(const char *name)
+	{
+		printf("%s: %s (%d failed checks)\n", name, (failures == 0) ? "PASS" : "FAIL", failures);
+		return (failures == 0) ? 0 : 1;
+	}
+};
+
+#define CHECK(expr)                                           \
+	do                                                        \
+	{                                                         \
+		if (!(expr))                                          \
+			wsim_check::fail(__FILE__, __LINE__, #expr);      \
+	} while (0)
+
+#define CHECK_NEAR(a, b, tol)                                                                               \
+	do                                                                                                      \
+	{                                                                                                       \
+		const double check_a_ = (a), check_b_ = (b);                                                        \
+		if (!(std::fabs(check_a_ - check_b_) <= (tol)))                                                     \
+		{                                                                                                   \
+			wsim_check::fail(__FILE__, __LINE__, #a " ~ " #b);                                              \
+			printf("    %.9g vs %.9g (tolerance %.3g)\n", check_a_, check_b_, static_cast<double>(tol));   \
+		}                                                                                                   \
+	} while (0)
+
+#endif
@@ -0,0 +1,88 @@
+/**
+ * @file controller.cpp
+ * @brief Pid, Biquad and StateSpace against the same controllers computed in double, on a closed loop and on a step
+ */
+#include "check.hpp"
+#include "controller.hpp"
+
+using Value_t = FixedPoint<10, 16>;
+using Coef_t = FixedPoint<4, 16>;
+
+static void check_pid()
+{
+    // first order plant x' = (u - x) / tau, simulated in double for both controllers
+    constexpr double kp = 2.0, ki = 5.0, kd = 0.1, ts = 0.01, tf = 0.02;
+    Pid<Value_t, Coef_t> pid(Pid<Value_t, Coef_t>::discretize(kp, ki, kd, ts, tf, 0.0, -100, 100));
+    double x = 0, xr = 0, integral = 0, derivative = 0, previous = 0, max_error = 0;
+    for (int k = 0; k < 1000; ++k)
+    {
+        const double setpoint = (k < 500) ? 10.0 : -5.0;
+        const double u = double(pid.step(Value_t(setpoint), Value_t(x)));
+        // reference PID in double, same structure
+        const double error = setpoint - xr;
+        integral += ki * ts * error;
+        derivative += (ts / (tf + ts)) * ((kd / ts) * (previous - xr) - derivative);
+        previous = xr;
+        const double ur = kp * error + integral + derivative;
+        max_error = std::max(max_error, std::fabs(x - xr));
+        x += (u - x) * ts / 0.1;
+        xr += (ur - xr) * ts / 0.1;
+    }
+    CHECK(max_error < 0.01);
+    CHECK_NEAR(x, -5.0, 0.05); // integral action removes the static error
+    printf("pid : max deviation from double %.6f over 1000 steps\n", max_error);
+}
+
+static void check_biquad()
+{
+    // low pass, fc = fs / 10, Q = 0.707
+    constexpr double b0 = 0.0674552738890719, b1 = 0.1349105477781438, b2 = 0.0674552738890719;
+    constexpr double a1 = -1.1429805025399011, a2 = 0.4128015980961887;
+    Biquad<Value_t, Coef_t> biquad({Coef_t(b0), Coef_t(b1), Coef_t(b2), Coef_t(a1), Coef_t(a2)});
+    double s1 = 0, s2 = 0, max_error = 0, y = 0;
+    for (int k = 0; k < 200; ++k)
+    {
+        const double x = 100.0;
+        y = double(biquad.step(Value_t(x)));
+        const double yr = b0 * x + s1;
+        s1 = b1 * x - a1 * yr + s2;
+        s2 = b2 * x - a2 * yr;
+        max_error = std::max(max_error, std::fabs(y - yr));
+    }
+    CHECK(max_error < 0.02);
+    CHECK_NEAR(y, 100.0, 0.05);
+    printf("biquad : max deviation from double %.6f over 200 steps\n", max_error);
+}
+
+static void check_statespace()
+{
+    // discretized double integrator with a damping term
+    constexpr double A[2][2] = {{1.0, 0.01}, {-0.05, 0.98}}, B[2][1] = {{0.00005}, {0.01}}, C[1][2] = {{1.0, 0.0}};
+    StateSpace<2, 1, 1, Value_t, Coef_t> ss({{{Coef_t(A[0][0]), Coef_t(A[0][1])}, {Coef_t(A[1][0]), Coef_t(A[1][1])}},
+                                             {{Coef_t(B[0][0])}, {Coef_t(B[1][0])}},
+                                             {{Coef_t(C[0][0]), Coef_t(C[0][1])}},
+                                             {{Coef_t(0)}}});
+    double x[2] = {0, 0}, max_error = 0;
+    for (int k = 0; k < 1000; ++k)
+    {
+        const Value_t u[1] = {Value_t(50.0)};
+        Value_t y[1];
+        ss.step(u, y);
+        const double yr = C[0][0] * x[0] + C[0][1] * x[1];
+        const double next0 = double(Coef_t(A[0][0])) * x[0] + double(Coef_t(A[0][1])) * x[1] + double(Coef_t(B[0][0])) * 50.0;
+        const double next1 = double(Coef_t(A[1][0])) * x[0] + double(Coef_t(A[1][1])) * x[1] + double(Coef_t(B[1][0])) * 50.0;
+        x[0] = next0;
+        x[1] = next1;
+        max_error = std::max(max_error, std::fabs(double(y[0]) - yr));
+    }
+    CHECK(max_error < 0.01);
+    printf("statespace : max deviation from double %.6f over 1000 steps\n", max_error);
+}
+
+int main()
+{
+    check_pid();
+    check_biquad();
+    check_statespace();
+    return wsim_check::result("controller");
+}
@@ -0,0 +1,41 @@
+/**
+ * @file fixedpoint_expr.cpp
+ * @brief Fused expressions of fixedpoint_expr.hpp against the exact value, and against the same expression written with
+ *        the FixedPoint operators
+ */
+#include <random>
+#include "check.hpp"
+#include "fixedpoint_expr.hpp"
+
+int main()
+{
+    // example of the documentation of fx()
+    const FixedPoint<4, 16> kp(1.25), ki(0.125), e(-0.75), i(2.5), offset(0.0625);
+    const auto u = fx_eval<FixedPoint<8, 16>>(fx(kp) * e + fx(ki) * i - offset);
+    CHECK((std::is_same_v<std::decay_t<decltype(u)>, FixedPoint<8, 16>>));
+    CHECK_NEAR(double(u), 1.25 * -0.75 + 0.125 * 2.5 - 0.0625, 0.0);
+
+    // the fused form truncates once at the end, the operators truncate after each product
+    std::mt19937 rng(32);
+    std::uniform_real_distribution<double> dist(-3.0, 3.0);
+    double worst_fused = 0, worst_plain = 0;
+    for (int n = 0; n < 20000; ++n)
+    {
+        const FixedPoint<4, 16> a(dist(rng)), b(dist(rng)), c(dist(rng)), d(dist(rng));
+        const FixedPoint<2, 28> g(dist(rng) / 2);
+        const double exact = double(a) * double(b) + double(c) * double(d) - double(a) * double(g);
+        const auto fused = fx_eval<FixedPoint<8, 16>>(fx(a) * b + fx(c) * d - fx(a) * g);
+        const FixedPoint<8, 16> plain = a * b + c * d - a * g;
+        worst_fused = std::max(worst_fused, std::fabs(double(fused) - exact) * 65536);
+        worst_plain = std::max(worst_plain, std::fabs(double(plain) - exact) * 65536);
+    }
+    printf("a*b + c*d - a*g in FixedPoint<8, 16> : worst error %.3f ULP fused, %.3f ULP with the operators\n", worst_fused, worst_plain);
+    CHECK(worst_fused < 1);
+    CHECK(worst_plain < 3);
+
+    // negation and the int32_t intermediate of a narrow tree
+    const FixedPoint16<3, 4> s(1.5), t(-2.25);
+    CHECK_NEAR(double(fx_eval<FixedPoint<8, 8>>(-(fx(s) * t))), 3.375, 0.0);
+
+    return wsim_check::result("fixedpoint_expr");
+}
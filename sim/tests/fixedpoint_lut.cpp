@@ -0,0 +1,46 @@
+/**
+ * @file fixedpoint_lut.cpp
+ * @brief FixedPointLut against <cmath> on every input of a dense grid : the error must stay within the requested bound
+ *        plus the output quantization, and max_error() must agree with the error measured at run time
+ */
+#include "check.hpp"
+#include "fixedpoint_lut.hpp"
+
+using In_t = FixedPoint<4, 16>;
+using Out_t = FixedPoint<8, 20>;
+
+template <typename Lut, typename Fn>
+static void check_lut(const char *name, double a, double b, double max_error, Fn fn)
+{
+    const double lsb = 1.0 / Out_t::factor;
+    double err = 0;
+    for (int32_t m = static_cast<int32_t>(a * In_t::factor); m <= static_cast<int32_t>(b * In_t::factor); ++m)
+    {
+        const In_t x(static_cast<In_t::raw_t>(m));
+        err = std::max(err, std::fabs(double(Lut::eval(x)) - fn(double(x))));
+    }
+    const double compile_time = Lut::template max_error<In_t>();
+    CHECK(err <= max_error + lsb);
+    CHECK(compile_time <= err + lsb); // the compile time grid is a subset of the inputs
+    printf("%-24s N=%5zu : max error %.3g (bound %.3g, compile time estimate %.3g)\n", name, Lut::table.size() - 1, err, max_error, compile_time);
+}
+
+int main()
+{
+    check_lut<ExpLut<Out_t, -4.0, 4.0, 1e-3, LutInterpolation::Linear>>("exp linear", -4.0, 4.0, 1e-3, [](double x)
+                                                                        { return std::exp(x); });
+    check_lut<ExpLut<Out_t, -4.0, 4.0, 1e-3>>("exp quadratic", -4.0, 4.0, 1e-3, [](double x)
+                                               { return std::exp(x); });
+    check_lut<LogLut<Out_t, 0.125, 8.0, 1e-4>>("log quadratic", 0.125, 8.0, 1e-4, [](double x)
+                                                { return std::log(x); });
+    check_lut<TanhLut<Out_t, -4.0, 4.0, 1e-4, LutInterpolation::Linear>>("tanh linear", -4.0, 4.0, 1e-4, [](double x)
+                                                                         { return std::tanh(x); });
+    check_lut<SigmoidLut<Out_t>>("sigmoid quadratic", -8.0, 8.0, 1e-3, [](double x)
+                                  { return 1.0 / (1.0 + std::exp(-x)); });
+
+    // inputs outside of the range are clamped
+    using Exp = ExpLut<Out_t, -4.0, 4.0>;
+    CHECK(Exp::eval(In_t(-7.0)) == Exp::eval(In_t(-4.0)));
+    CHECK(Exp::eval(In_t(7.5)) == Exp::eval(In_t(4.0)));
+    return wsim_check::result("fixedpoint_lut");
+}
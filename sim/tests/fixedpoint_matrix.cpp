@@ -0,0 +1,133 @@
+/**
+ * @file fixedpoint_matrix.cpp
+ * @brief FixedVec and FixedMat operations against the same operations in float on random inputs, and 2x2 / 3x3 inverses
+ *        of well and badly scaled matrices
+ */
+#include <random>
+#include "check.hpp"
+#include "fixedpoint_matrix.hpp"
+
+using T = FixedPoint<4, 16>;
+using Inv_t = FixedPoint<12, 16>;
+
+template <size_t N>
+static void float_inverse(const float (&a)[N][N], float (&r)[N][N])
+{
+    // Gauss-Jordan with partial pivoting
+    float m[N][2 * N];
+    for (size_t i = 0; i < N; ++i)
+        for (size_t j = 0; j < 2 * N; ++j)
+            m[i][j] = (j < N) ? a[i][j] : ((j - N) == i ? 1.0f : 0.0f);
+    for (size_t c = 0; c < N; ++c)
+    {
+        size_t p = c;
+        for (size_t i = c + 1; i < N; ++i)
+            if (std::fabs(m[i][c]) > std::fabs(m[p][c]))
+                p = i;
+        for (size_t j = 0; j < 2 * N; ++j)
+            std::swap(m[c][j], m[p][j]);
+        const float d = m[c][c];
+        for (size_t j = 0; j < 2 * N; ++j)
+            m[c][j] /= d;
+        for (size_t i = 0; i < N; ++i)
+            if (i != c)
+            {
+                const float f = m[i][c];
+                for (size_t j = 0; j < 2 * N; ++j)
+                    m[i][j] -= f * m[c][j];
+            }
+    }
+    for (size_t i = 0; i < N; ++i)
+        for (size_t j = 0; j < N; ++j)
+            r[i][j] = m[i][N + j];
+}
+
+template <size_t N>
+static double check_random_inverses(std::mt19937 &rng)
+{
+    std::uniform_real_distribution<double> dist(-4.0, 4.0);
+    double worst = 0;
+    int tested = 0;
+    while (tested < 2000)
+    {
+        FixedMat<N, N, T> x;
+        float xf[N][N], rf[N][N];
+        for (size_t i = 0; i < N * N; ++i)
+        {
+            x.m[i / N][i % N] = T(dist(rng));
+            xf[i / N][i % N] = float(x.m[i / N][i % N]);
+        }
+        float_inverse(xf, rf);
+        double norm = 0;
+        for (size_t i = 0; i < N * N; ++i)
+            norm = std::max(norm, std::fabs(double(rf[i / N][i % N])));
+        if (norm > 50) // badly conditioned : the float reference itself is not accurate
+            continue;
+        FixedMat<N, N, Inv_t> r = FixedMat<N, N, Inv_t>::zero();
+        CHECK(inverse(x, r));
+        for (size_t i = 0; i < N * N; ++i)
+            worst = std::max(worst, std::fabs(double(r.m[i / N][i % N]) - rf[i / N][i % N]) / std::max(norm, 1.0));
+        ++tested;
+    }
+    return worst;
+}
+
+int main()
+{
+    // products against float
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<double> dist(-2.0, 2.0);
+    FixedMat<3, 3, T> a, b;
+    FixedVec<3, T> v;
+    for (size_t i = 0; i < 9; ++i)
+    {
+        a.m[i / 3][i % 3] = T(dist(rng));
+        b.m[i / 3][i % 3] = T(dist(rng));
+    }
+    for (size_t i = 0; i < 3; ++i)
+        v.v[i] = T(dist(rng));
+    const auto ab = a * b;
+    const auto av = a * v;
+    for (size_t i = 0; i < 9; ++i)
+    {
+        float ref = 0;
+        for (size_t j = 0; j < 3; ++j)
+            ref += float(a.m[i / 3][j]) * float(b.m[j][i % 3]);
+        CHECK_NEAR(double(ab.m[i / 3][i % 3]), ref, 3 * 2.0 / T::factor);
+    }
+    for (size_t i = 0; i < 3; ++i)
+    {
+        float ref = 0;
+        for (size_t j = 0; j < 3; ++j)
+            ref += float(a.m[i][j]) * float(v.v[j]);
+        CHECK_NEAR(double(av.v[i]), ref, 3 * 2.0 / T::factor);
+    }
+    CHECK_NEAR(double(dot(v, v)), double(v.v[0]) * double(v.v[0]) + double(v.v[1]) * double(v.v[1]) + double(v.v[2]) * double(v.v[2]), 3.0 / T::factor);
+
+    // small determinants : the determinant 1e-6 is far below the LSB of T but the matrix is not singular
+    FixedMat<2, 2, Inv_t> r2;
+    const FixedMat<2, 2, T> small2{{{T(0.001), T(0)}, {T(0), T(0.001)}}};
+    CHECK(inverse(small2, r2));
+    CHECK_NEAR(double(r2.m[0][0]), 1.0 / double(T(0.001)), 1.0 / Inv_t::factor);
+    CHECK_NEAR(double(r2.m[0][1]), 0.0, 0.0);
+    FixedMat<3, 3, Inv_t> r3;
+    const FixedMat<3, 3, T> tenth3{{{T(0.1), T(0), T(0)}, {T(0), T(0.1), T(0)}, {T(0), T(0), T(0.1)}}};
+    CHECK(inverse(tenth3, r3));
+    CHECK_NEAR(double(r3.m[1][1]), 1.0 / double(T(0.1)), 1.0 / Inv_t::factor);
+    const FixedMat<3, 3, T> small3{{{T(0.01), T(0), T(0)}, {T(0), T(0.01), T(0)}, {T(0), T(0), T(0.01)}}};
+    CHECK(inverse(small3, r3));
+    CHECK_NEAR(double(r3.m[2][2]), 1.0 / double(T(0.01)), 1.0 / Inv_t::factor);
+    const FixedMat<2, 2, T> singular{{{T(1), T(2)}, {T(0.5), T(1)}}};
+    CHECK(!inverse(singular, r2));
+    FixedMat<1, 1, Inv_t> r1;
+    CHECK(inverse(FixedMat<1, 1, T>{{{T(0.001)}}}, r1));
+    CHECK_NEAR(double(r1.m[0][0]), 1.0 / double(T(0.001)), 1.0 / Inv_t::factor);
+
+    // random matrices against the float inverse, error relative to the largest element of the inverse
+    const double worst2 = check_random_inverses<2>(rng);
+    const double worst3 = check_random_inverses<3>(rng);
+    CHECK(worst2 < 1e-4);
+    CHECK(worst3 < 1e-4);
+    printf("inverse against float : worst relative error %.3g (2x2), %.3g (3x3)\n", worst2, worst3);
+    return wsim_check::result("fixedpoint_matrix");
+}
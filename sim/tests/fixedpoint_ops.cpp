@@ -0,0 +1,270 @@
+/**
+ * @file fixedpoint_ops.cpp
+ * @brief Every FixedPoint operator over many <I, E, T> formats and cross-format pairs, against an exact 128 bits reference
+ * @details The reference of each operation is the exact rational value P / Q of the operands' mantissas, and the error
+ *          is reported in ULP of the result format. The operators truncate, so every error must stay below 1 ULP, and the
+ *          exact operations (same-format add and subtract, negation, product by an integer) must have no error at all.
+ *          The type of each mixed-format result is checked against the rules of the README :
+ *          E = min(E1, E2), storage = widest, I = max(I1, I2) for + and -, I1 + I2 for *, I1 for /, clamped to the storage
+ */
+#include <algorithm>
+#include <random>
+#include <type_traits>
+#include "check.hpp"
+#include "fixedpoint.hpp"
+
+using i128 = __int128;
+
+static std::mt19937_64 rng(31);
+
+/**
+ * @brief Error in ULP of the result mantissa r against the exact value P / Q (Q != 0)
+ */
+static long double ulp_error(int64_t r, i128 P, i128 Q)
+{
+    if (Q < 0)
+    {
+        P = -P;
+        Q = -Q;
+    }
+    const i128 t = P / Q; // truncated toward zero, the remainder keeps the sign of P
+    const i128 rem = P - t * Q;
+    return std::fabs(static_cast<long double>(r - t) - static_cast<long double>(rem) / static_cast<long double>(Q));
+}
+
+static i128 pow2(int n) { return static_cast<i128>(1) << n; }
+
+/**
+ * @brief P * 2^s / Q as a fraction with a non negative shift
+ */
+static long double ulp_error_shift(int64_t r, i128 P, int s, i128 Q)
+{
+    return (s >= 0) ? ulp_error(r, P * pow2(s), Q) : ulp_error(r, P, Q * pow2(-s));
+}
+
+/**
+ * @brief Random mantissa of the format with |value| < limit, with a random magnitude so that small operands are covered too
+ */
+template <typename Fp>
+static Fp random_fp(long double limit)
+{
+    limit = std::min(limit, std::ldexp(1.0L, Fp::Ipart()));
+    int64_t span = static_cast<int64_t>(std::ldexp(limit, Fp::Fpart())) - 1;
+    span = std::min<int64_t>(span, std::numeric_limits<typename Fp::storage_t>::max());
+    span >>= rng() % (Fp::bits / 2);
+    const int64_t m = (span <= 0) ? 0 : static_cast<int64_t>(rng() % static_cast<uint64_t>(2 * span + 1)) - span;
+    return Fp(static_cast<typename Fp::raw_t>(m));
+}
+
+/**
+ * @brief Worst error of each operator over a format pair, in ULP of the result
+ */
+struct OpError
+{
+    long double add = 0, sub = 0, mul = 0, div = 0;
+};
+
+template <typename R>
+static constexpr bool has_format(int I, int E, size_t size)
+{
+    return (R::Ipart() == I) && (R::Fpart() == E) && (sizeof(typename R::storage_t) == size);
+}
+
+/**
+ * @brief Checks the result types of a pair and returns the worst error of + - * / and of their compound forms
+ */
+template <typename A, typename B>
+static OpError check_pair(int samples)
+{
+    using Sum = decltype(A() + B());
+    using Dif = decltype(A() - B());
+    using Prod = decltype(A() * B());
+    using Quot = decltype(A() / B());
+    constexpr size_t size = std::max(sizeof(typename A::storage_t), sizeof(typename B::storage_t));
+    constexpr int W = static_cast<int>(size) * 8 - 1;
+    constexpr int Er = std::min(A::Fpart(), B::Fpart());
+    static_assert(has_format<Sum>(std::min(std::max(A::Ipart(), B::Ipart()), W - 1 - Er), Er, size));
+    static_assert(has_format<Dif>(std::min(std::max(A::Ipart(), B::Ipart()), W - 1 - Er), Er, size));
+    static_assert(has_format<Prod>(std::min(A::Ipart() + B::Ipart(), W - 1 - Er), Er, size));
+    static_assert(has_format<Quot>(std::min(A::Ipart(), W - 1 - Er), Er, size));
+
+    const int Ea = A::Fpart(), Eb = B::Fpart();
+    OpError worst;
+    for (int i = 0; i < samples; ++i)
+    {
+        // + and - : each operand takes at most half of the integer part of the result
+        {
+            const long double limit = std::ldexp(1.0L, Sum::Ipart() - 1);
+            const A a = random_fp<A>(limit);
+            const B b = random_fp<B>(limit);
+            const i128 am = a.getM(), bm = b.getM();
+            const int Ec = std::max(Ea, Eb); // common denominator of the exact sum
+            const i128 sum = am * pow2(Ec - Ea) + bm * pow2(Ec - Eb);
+            const i128 dif = am * pow2(Ec - Ea) - bm * pow2(Ec - Eb);
+            const long double e_add = ulp_error_shift((a + b).getM(), sum, Er - Ec, 1);
+            const long double e_sub = ulp_error_shift((a - b).getM(), dif, Er - Ec, 1);
+            worst.add = std::max(worst.add, e_add);
+            worst.sub = std::max(worst.sub, e_sub);
+            if constexpr (std::is_same_v<A, Sum>)
+            {
+                A c = a;
+                CHECK((c += b) == (a + b));
+                c = a;
+                CHECK((c -= b) == (a - b));
+            }
+        }
+        // * : the product fits the integer part of the result
+        {
+            const int half = std::max(Prod::Ipart() - 1, 0);
+            const A a = random_fp<A>(std::ldexp(1.0L, half - half / 2));
+            const B b = random_fp<B>(std::ldexp(1.0L, half / 2));
+            const i128 P = static_cast<i128>(a.getM()) * b.getM();
+            worst.mul = std::max(worst.mul, ulp_error_shift((a * b).getM(), P, Er - Ea - Eb, 1));
+            if constexpr (std::is_same_v<A, Prod>)
+            {
+                A c = a;
+                CHECK((c *= b) == (a * b));
+            }
+        }
+        // / : the quotient fits the integer part of the result and of the intermediate in the format of the numerator
+        {
+            const B b = random_fp<B>(std::ldexp(1.0L, B::Ipart()));
+            if (b.getM() == 0)
+                continue;
+            const long double limit = std::fabs(static_cast<long double>(b)) * std::ldexp(1.0L, std::min(Quot::Ipart(), A::Ipart()) - 1);
+            const A a = random_fp<A>(limit);
+            worst.div = std::max(worst.div, ulp_error_shift((a / b).getM(), a.getM(), Er - Ea + Eb, b.getM()));
+            if constexpr (std::is_same_v<A, Quot>)
+            {
+                A c = a;
+                CHECK((c /= b) == (a / b));
+            }
+        }
+    }
+    return worst;
+}
+
+/**
+ * @brief Operators of a format with itself, with integers and doubles, unary operators, conversions and comparisons
+ */
+template <typename Fp>
+static OpError check_format(const char *name, int samples)
+{
+    const OpError e = check_pair<Fp, Fp>(samples);
+    // same format add and subtract are exact, products and quotients truncate
+    CHECK(e.add == 0);
+    CHECK(e.sub == 0);
+    CHECK(e.mul < 1);
+    CHECK(e.div < 1);
+
+    const int E = Fp::Fpart();
+    long double e_int_div = 0, e_double = 0;
+    for (int i = 0; i < samples; ++i)
+    {
+        const Fp a = random_fp<Fp>(std::ldexp(1.0L, Fp::Ipart() - 1));
+        const i128 am = a.getM();
+        // unary operators and conversion to double are exact
+        CHECK((-a).getM() == -a.getM());
+        CHECK(abs(a).getM() == ((a.getM() < 0) ? -a.getM() : a.getM()));
+        CHECK(-(-a) == a);
+        if constexpr (Fp::bits + 1 <= 53)
+            CHECK(static_cast<double>(a) == std::ldexp(static_cast<double>(a.getM()), -E));
+
+        // product and quotient with an integer : the product is exact when it fits, the quotient truncates
+        const int k = static_cast<int>(rng() % 7) - 3;
+        if (std::fabs(static_cast<long double>(a) * k) < std::ldexp(1.0L, Fp::Ipart()))
+        {
+            CHECK((a * k).getM() == am * k);
+            CHECK((k * a) == (a * k));
+            Fp c = a;
+            CHECK((c *= k) == (a * k));
+        }
+        if (k != 0)
+        {
+            e_int_div = std::max(e_int_div, ulp_error((a / k).getM(), am, k));
+            Fp c = a;
+            CHECK((c /= k) == (a / k));
+        }
+        // addition of a small integer
+        if (Fp::Ipart() >= 3)
+        {
+            const int n = static_cast<int>(rng() % 5) - 2;
+            const Fp small = random_fp<Fp>(std::ldexp(1.0L, Fp::Ipart() - 2));
+            CHECK((small + n).getM() == small.getM() + static_cast<i128>(n) * pow2(E));
+            CHECK((small - n).getM() == small.getM() - static_cast<i128>(n) * pow2(E));
+            CHECK((n + small) == (small + n));
+        }
+
+        // construction from a double truncates toward zero
+        const double d = static_cast<double>(random_fp<Fp>(std::ldexp(1.0L, Fp::Ipart() - 1)).getM()) * 0.7 / std::ldexp(1.0, E);
+        const long double scaled = static_cast<long double>(d) * std::ldexp(1.0L, E);
+        e_double = std::max(e_double, std::fabs(static_cast<long double>(Fp(d).getM()) - scaled));
+
+        // comparisons follow the mantissas
+        const Fp b = random_fp<Fp>(std::ldexp(1.0L, Fp::Ipart() - 1));
+        CHECK((a < b) == (a.getM() < b.getM()));
+        CHECK((a <= b) == (a.getM() <= b.getM()));
+        CHECK((a > b) == (a.getM() > b.getM()));
+        CHECK((a >= b) == (a.getM() >= b.getM()));
+        CHECK((a == b) == (a.getM() == b.getM()));
+        CHECK((a != b) == (a.getM() != b.getM()));
+    }
+    CHECK(e_int_div < 1);
+    CHECK(e_double < 1);
+    CHECK(Fp::MAX_VAL().getM() == std::numeric_limits<typename Fp::storage_t>::max());
+    CHECK(Fp::MIN_VAL() == -Fp::MAX_VAL());
+
+    printf("%-24s  +%5.3Lf  -%5.3Lf  *%5.3Lf  /%5.3Lf  /int %5.3Lf  double %5.3Lf\n", name, e.add, e.sub, e.mul, e.div, e_int_div, e_double);
+    return e;
+}
+
+template <typename A, typename B>
+static void check_cross(const char *name, int samples)
+{
+    const OpError e = check_pair<A, B>(samples);
+    const OpError f = check_pair<B, A>(samples);
+    CHECK(std::max(e.add, f.add) < 1);
+    CHECK(std::max(e.sub, f.sub) < 1);
+    CHECK(std::max(e.mul, f.mul) < 1);
+    CHECK(std::max(e.div, f.div) < 1);
+    printf("%-24s  +%5.3Lf  -%5.3Lf  *%5.3Lf  /%5.3Lf\n", name, std::max(e.add, f.add), std::max(e.sub, f.sub), std::max(e.mul, f.mul), std::max(e.div, f.div));
+}
+
+int main()
+{
+    constexpr int samples = 20000;
+    printf("worst error in ULP of the result format, %d random operands per operator (rounded to 3 decimals, each one is checked < 1)\n", samples);
+
+    check_format<FixedPoint16<0, 14>>("FixedPoint16<0,14>", samples);
+    check_format<FixedPoint16<3, 4>>("FixedPoint16<3,4>", samples);
+    check_format<FixedPoint16<4, 10>>("FixedPoint16<4,10>", samples);
+    check_format<FixedPoint16<7, 7>>("FixedPoint16<7,7>", samples);
+    check_format<FixedPoint16<14, 0>>("FixedPoint16<14,0>", samples);
+    check_format<FixedPoint<0, 30>>("FixedPoint<0,30>", samples);
+    check_format<FixedPoint<1, 16>>("FixedPoint<1,16>", samples);
+    check_format<FixedPoint<2, 28>>("FixedPoint<2,28>", samples);
+    check_format<FixedPoint<4, 16>>("FixedPoint<4,16>", samples);
+    check_format<FixedPoint<7, 8>>("FixedPoint<7,8>", samples);
+    check_format<FixedPoint<10, 16>>("FixedPoint<10,16>", samples);
+    check_format<FixedPoint<15, 15>>("FixedPoint<15,15>", samples);
+    check_format<FixedPoint<20, 10>>("FixedPoint<20,10>", samples);
+    check_format<FixedPoint<30, 0>>("FixedPoint<30,0>", samples);
+    check_format<FixedPoint64<1, 60>>("FixedPoint64<1,60>", samples);
+    check_format<FixedPoint64<15, 16>>("FixedPoint64<15,16>", samples);
+    check_format<FixedPoint64<20, 40>>("FixedPoint64<20,40>", samples);
+    check_format<FixedPoint64<31, 31>>("FixedPoint64<31,31>", samples);
+
+    check_cross<FixedPoint<4, 16>, FixedPoint<10, 16>>("<4,16> x <10,16>", samples);
+    check_cross<FixedPoint<1, 16>, FixedPoint<16, 12>>("<1,16> x <16,12>", samples);
+    check_cross<FixedPoint<7, 8>, FixedPoint<2, 28>>("<7,8> x <2,28>", samples);
+    check_cross<FixedPoint<15, 15>, FixedPoint<0, 30>>("<15,15> x <0,30>", samples);
+    check_cross<FixedPoint16<3, 4>, FixedPoint16<0, 14>>("16<3,4> x 16<0,14>", samples);
+    check_cross<FixedPoint16<4, 10>, FixedPoint<10, 16>>("16<4,10> x <10,16>", samples);
+    check_cross<FixedPoint16<7, 7>, FixedPoint<2, 28>>("16<7,7> x <2,28>", samples);
+    check_cross<FixedPoint<10, 16>, FixedPoint64<20, 40>>("<10,16> x 64<20,40>", samples);
+    check_cross<FixedPoint<2, 28>, FixedPoint64<15, 16>>("<2,28> x 64<15,16>", samples);
+    check_cross<FixedPoint16<3, 4>, FixedPoint64<1, 60>>("16<3,4> x 64<1,60>", samples);
+    check_cross<FixedPoint64<31, 31>, FixedPoint64<1, 60>>("64<31,31> x 64<1,60>", samples);
+
+    return wsim_check::result("fixedpoint_ops");
+}
@@ -0,0 +1,62 @@
+/**
+ * @file fixedpoint_storage.cpp
+ * @brief FixedPoint with int16_t, int32_t and int64_t storage : products, divisions, pow and promotion between storages
+ */
+#include <random>
+#include <type_traits>
+#include "check.hpp"
+#include "fixedpoint.hpp"
+
+template <typename Fp>
+static void check_pow(double x, uint32_t n, double tol)
+{
+    CHECK_NEAR(double(pow(Fp(x), n)), std::pow(double(Fp(x)), n), tol);
+}
+
+int main()
+{
+    // pow goes through the wide type, which is int64_t itself for int64_t storage
+    check_pow<FixedPoint16<4, 8>>(1.1, 3, 4.0 / 256);
+    check_pow<FixedPoint<10, 16>>(1.1, 3, 4.0 / 65536);
+    check_pow<FixedPoint<10, 16>>(-1.5, 5, 16.0 / 65536);
+    check_pow<FixedPoint64<10, 40>>(1.1, 3, 1e-9);
+    check_pow<FixedPoint64<10, 40>>(-1.5, 5, 1e-9);
+    check_pow<FixedPoint64<20, 40>>(3.0, 12, 1e-6);
+    check_pow<FixedPoint64<10, 40>>(0.5, 0, 0.0);
+
+    // products and divisions beyond 63 bits
+    const FixedPoint64<20, 40> a(1234.5678), b(-0.001);
+    CHECK_NEAR(double(a * b), double(a) * double(b), 1e-9);
+    CHECK_NEAR(double(a / b), double(a) / double(b), 1e-6);
+
+    // long division of the int64_t storage against a 128 bits reference of the host
+    std::mt19937_64 rng(7);
+    for (int i = 0; i < 20000; ++i)
+    {
+        const int shift = static_cast<int>(rng() % 48);
+        const int64_t num = static_cast<int64_t>(rng()) >> (16 + rng() % 40);
+        int64_t den = static_cast<int64_t>(rng()) >> (rng() % 63);
+        den = (den == 0) ? 1 : den;
+        const __int128 ref = (static_cast<__int128>(num) * (static_cast<__int128>(1) << shift)) / den;
+        if ((ref > INT64_MAX) || (ref < -INT64_MAX))
+            continue; // the quotient does not fit the storage
+        CHECK(fixedpoint_detail::div_shift64(num, den, shift) == static_cast<int64_t>(ref));
+        CHECK(fixedpoint_detail::mul_shift64(num, den, shift) == static_cast<int64_t>((static_cast<__int128>(num) * den) / (static_cast<__int128>(1) << shift)) ||
+              (((static_cast<__int128>(num) * den) >> shift) > INT64_MAX) || (((static_cast<__int128>(num) * den) >> shift) < -INT64_MAX));
+    }
+
+    // products of int16_t storage that fit 15 bits, and that need the int32_t intermediate
+    CHECK_NEAR(double(FixedPoint16<3, 4>(2.5) * FixedPoint16<3, 4>(1.5)), 3.75, 0.0);
+    CHECK_NEAR(double(FixedPoint16<4, 10>(3.25) * FixedPoint16<4, 10>(-2.0)), -6.5, 0.0);
+    CHECK_NEAR(double(FixedPoint16<4, 10>(3.25) / FixedPoint16<4, 10>(0.5)), 6.5, 0.0);
+
+    // the storage of a mixed operation is the widest one
+    using Mixed16_32 = decltype(FixedPoint16<4, 8>(1) + FixedPoint<10, 16>(1));
+    using Mixed32_64 = decltype(FixedPoint<10, 16>(1) * FixedPoint64<20, 32>(1));
+    CHECK((std::is_same_v<Mixed16_32::storage_t, int32_t>));
+    CHECK((std::is_same_v<Mixed32_64::storage_t, int64_t>));
+    CHECK_NEAR(double(FixedPoint16<4, 8>(1.5) + FixedPoint<10, 16>(100.25)), 101.75, 0.0);
+    CHECK_NEAR(double(FixedPoint<10, 16>(3.0) * FixedPoint64<20, 32>(1000000.5)), 3000001.5, 0.0);
+
+    return wsim_check::result("fixedpoint_storage");
+}
@@ -0,0 +1,157 @@
+/**
+ * @file fusion.cpp
+ * @brief LinearKalman, RangeFilter and ComplementaryFilter against the same filters computed in double, on noisy
+ *        simulated measurements : the fixed point estimates must follow the double ones and keep their accuracy
+ */
+#include <random>
+#include "check.hpp"
+#include "fusion.hpp"
+
+/**
+ * @brief Constant velocity Kalman filter (position in mm, velocity in mm/s) on a target moving at 250 mm/s,
+ *        measured every 20 ms with a noise of 10 mm
+ */
+static void check_kalman()
+{
+    using Value_t = FixedPoint<14, 16>;
+    using Coef_t = FixedPoint<2, 16>;
+    using Kalman = LinearKalman<2, 1, 1, Value_t, Coef_t>;
+    constexpr double dt = 0.02, q = 50.0, r = 100.0;
+    Kalman::Model model;
+    model.F = {{{Coef_t(1), Coef_t(dt)}, {Coef_t(0), Coef_t(1)}}};
+    model.B = {{{Coef_t(0)}, {Coef_t(0)}}};
+    model.H = {{{Coef_t(1), Coef_t(0)}}};
+    model.Q = {{{Value_t(q * dt * dt * dt / 3), Value_t(q * dt * dt / 2)}, {Value_t(q * dt * dt / 2), Value_t(q * dt)}}};
+    model.R = {{{Value_t(r)}}};
+    Kalman kf(model, {{Value_t(1000), Value_t(0)}}, {{{Value_t(1000), Value_t(0)}, {Value_t(0), Value_t(1000)}}});
+
+    // same filter in double, with the quantized model
+    double x[2] = {1000, 0}, P[2][2] = {{1000, 0}, {0, 1000}};
+    const double F01 = double(Coef_t(dt)), Q[2][2] = {{double(model.Q[0][0]), double(model.Q[0][1])}, {double(model.Q[1][0]), double(model.Q[1][1])}};
+
+    std::mt19937 rng(11);
+    std::normal_distribution<double> noise(0.0, 10.0);
+    double max_dev_pos = 0, max_dev_vel = 0, se_fixed = 0, se_double = 0;
+    constexpr int steps = 1000;
+    for (int k = 1; k <= steps; ++k)
+    {
+        const double truth = 1000 + 250 * dt * k;
+        const double z = std::round(truth + noise(rng));
+        kf.predict();
+        CHECK(kf.update({{Value_t(z)}}));
+
+        x[0] += F01 * x[1];
+        const double P00 = P[0][0] + 2 * F01 * P[0][1] + F01 * F01 * P[1][1] + Q[0][0];
+        const double P01 = P[0][1] + F01 * P[1][1] + Q[0][1];
+        const double P11 = P[1][1] + Q[1][1];
+        const double S = P00 + r;
+        const double K0 = P00 / S, K1 = P01 / S;
+        const double y = z - x[0];
+        x[0] += K0 * y;
+        x[1] += K1 * y;
+        P[0][0] = (1 - K0) * P00;
+        P[0][1] = (1 - K0) * P01;
+        P[1][0] = P[0][1];
+        P[1][1] = P11 - K1 * P01;
+
+        if (k > 100) // after the convergence
+        {
+            max_dev_pos = std::max(max_dev_pos, std::fabs(double(kf.getState()[0]) - x[0]));
+            max_dev_vel = std::max(max_dev_vel, std::fabs(double(kf.getState()[1]) - x[1]));
+            se_fixed += (double(kf.getState()[0]) - truth) * (double(kf.getState()[0]) - truth);
+            se_double += (x[0] - truth) * (x[0] - truth);
+        }
+    }
+    const double rms_fixed = std::sqrt(se_fixed / (steps - 100)), rms_double = std::sqrt(se_double / (steps - 100));
+    CHECK(max_dev_pos < 0.05);
+    CHECK(max_dev_vel < 0.1);
+    CHECK(rms_fixed < rms_double * 1.05);
+    CHECK_NEAR(double(kf.getState()[1]), 250.0, 25.0);
+    printf("kalman : deviation from double %.3f mm, %.3f mm/s ; rms error %.3f mm (double %.3f mm, measurement 10 mm)\n",
+           max_dev_pos, max_dev_vel, rms_fixed, rms_double);
+}
+
+/**
+ * @brief RangeFilter on an obstacle closing at 400 mm/s, measured every 60 ms (+- 2 ms of jitter) with a noise of 5 mm,
+ *        with invalid and stale measurements in the stream
+ */
+static void check_range_filter()
+{
+    constexpr double alpha = 0.5, beta = 0.1;
+    RangeFilter<> filter{FixedPoint<1, 16>(alpha), FixedPoint<1, 16>(beta)};
+    std::mt19937 rng(13);
+    std::normal_distribution<double> noise(0.0, 5.0);
+    std::uniform_int_distribution<int> jitter(-2000, 2000);
+    double d = 0, v = 0, max_dev_d = 0, max_dev_v = 0;
+    int64_t t = 0, last = 0;
+    bool init = false;
+    for (int k = 0; k < 60; ++k)
+    {
+        t += 60000 + jitter(rng);
+        const double truth = 3500 - 0.4 * t / 1000.0;
+        Ultrasound_Measurement_t m = {};
+        m.timestamp_us = t;
+        m.distance_mm = static_cast<int32_t>(std::lround(truth + noise(rng)));
+        CHECK(filter.update(m));
+        if (!init)
+        {
+            d = m.distance_mm;
+            v = 0;
+            init = true;
+        }
+        else
+        {
+            const double dts = double(t - last) / 1e6;
+            const double predicted = d + v * dts;
+            const double residual = m.distance_mm - predicted;
+            d = predicted + alpha * residual;
+            v += beta * residual / dts;
+        }
+        last = t;
+        max_dev_d = std::max(max_dev_d, std::fabs(double(filter.getDistanceMm()) - d));
+        max_dev_v = std::max(max_dev_v, std::fabs(double(filter.getVelocityMmPerS()) - v));
+
+        Ultrasound_Measurement_t invalid = m;
+        invalid.distance_mm = INT32_MAX;
+        CHECK(!filter.update(invalid));
+        CHECK(!filter.update(m)); // not newer than the last one
+    }
+    CHECK(max_dev_d < 0.05);
+    CHECK(max_dev_v < 0.25);
+    CHECK_NEAR(double(filter.getVelocityMmPerS()), -400.0, 40.0);
+    printf("range filter : deviation from double %.3f mm, %.3f mm/s ; velocity %.1f mm/s (truth -400)\n", max_dev_d, max_dev_v,
+           double(filter.getVelocityMmPerS()));
+}
+
+/**
+ * @brief ComplementaryFilter fusing a biased rate with a noisy absolute angle
+ */
+static void check_complementary()
+{
+    using Value_t = FixedPoint<10, 16>;
+    using Coef_t = FixedPoint<1, 20>;
+    constexpr double alpha = 0.98, dt = 0.01;
+    ComplementaryFilter<Value_t, Coef_t> filter{Coef_t(alpha), Coef_t(dt)};
+    std::mt19937 rng(17);
+    std::normal_distribution<double> noise(0.0, 2.0);
+    double e = 0, max_dev = 0;
+    for (int k = 0; k < 2000; ++k)
+    {
+        const double angle = 30 * std::sin(k * dt);
+        const double rate = 30 * std::cos(k * dt) + 0.5; // biased gyroscope
+        const double absolute = angle + noise(rng);
+        filter.step(Value_t(rate), Value_t(absolute));
+        e = double(Coef_t(alpha)) * (e + double(Coef_t(dt)) * double(Value_t(rate))) + (1 - double(Coef_t(alpha))) * double(Value_t(absolute));
+        max_dev = std::max(max_dev, std::fabs(double(filter.getEstimate()) - e));
+    }
+    CHECK(max_dev < 0.01);
+    printf("complementary : deviation from double %.5f\n", max_dev);
+}
+
+int main()
+{
+    check_kalman();
+    check_range_filter();
+    check_complementary();
+    return wsim_check::result("fusion");
+}
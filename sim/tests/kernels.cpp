@@ -0,0 +1,98 @@
+/**
+ * @file kernels.cpp
+ * @brief Span kernels on the host : every unroll factor against a plain loop (tails included), and dot_q against the exact
+ *        floor shift with negative products and saturation
+ */
+#include <climits>
+#include <random>
+#include <vector>
+#include "check.hpp"
+#include "kernels.hpp"
+
+/**
+ * @brief floor(s / 2^shift) saturated to int32, computed with a division (not with the shift under test)
+ */
+static int32_t floor_shift(int64_t s, uint8_t shift)
+{
+    const int64_t d = int64_t(1) << shift;
+    int64_t q = s / d; // rounds toward zero
+    if ((s % d != 0) && (s < 0))
+        --q;
+    return int32_t(std::clamp<int64_t>(q, INT32_MIN, INT32_MAX));
+}
+
+template <std::size_t U>
+static void check_unroll(const std::vector<int32_t> &a)
+{
+    std::vector<int32_t> out(a.size()), expected(a.size());
+    const std::span<const int32_t> x(a);
+    int64_t sum = 0, dot = 0, running = 0;
+    std::size_t imin = a.size(), imax = a.size();
+    for (std::size_t i = 0; i < a.size(); ++i)
+    {
+        sum += a[i];
+        dot += int64_t(a[i]) * a[i];
+        if ((imin == a.size()) || (a[i] < a[imin]))
+            imin = i;
+        if ((imax == a.size()) || (a[i] > a[imax]))
+            imax = i;
+        expected[i] = std::clamp(a[i], -1000, 1000);
+    }
+    CHECK((misc::sum<U, int64_t>(x) == sum));
+    CHECK((misc::dot<U, int64_t>(x, x) == dot));
+    CHECK((misc::min_index<U>(x).index == imin));
+    CHECK((misc::max_index<U>(x).index == imax));
+    misc::clamp<U>(x, std::span<int32_t>(out), -1000, 1000);
+    CHECK(out == expected);
+    for (std::size_t i = 0; i < a.size(); ++i)
+        expected[i] = int32_t(running += a[i]);
+    CHECK((misc::prefix_sum<U>(x, std::span<int32_t>(out)) == int32_t(running)));
+    CHECK(out == expected);
+}
+
+int main()
+{
+    std::mt19937 rng(1);
+    for (std::size_t size : {0, 1, 3, 7, 8, 9, 16, 33, 255, 1024})
+    {
+        std::vector<int32_t> a(size);
+        for (auto &v : a)
+            v = int32_t(rng() % 20001) - 10000; // sums fit int32 for prefix_sum
+        check_unroll<1>(a);
+        check_unroll<2>(a);
+        check_unroll<4>(a);
+        check_unroll<8>(a);
+    }
+
+    // dot_q : floor, not rounding nor truncation toward zero
+    const int16_t m5[] = {-5, -5, -5, -5}, one[] = {1, 1, 1, 1}, p5[] = {5, 5, 5, 5};
+    CHECK(misc::dot_q(m5, one, 4) == -2);
+    CHECK(misc::dot_q(p5, one, 4) == 1);
+    CHECK(misc::dot_q(std::span<const int16_t>(m5, 1), std::span<const int16_t>(one, 1), 15) == -1);
+    std::vector<int16_t> big(64, -32768), max(64, 32767);
+    CHECK(misc::dot_q(big, big, 0) == INT32_MAX);
+    CHECK(misc::dot_q(big, max, 0) == INT32_MIN);
+    CHECK(misc::dot_q(big, max, 15) == -2097088);
+    uint32_t negative = 0, inexact = 0, checks = 0;
+    for (int k = 0; k < 2000; ++k)
+    {
+        std::vector<int16_t> x(1 + rng() % 64), y(x.size());
+        int64_t s = 0;
+        for (std::size_t i = 0; i < x.size(); ++i)
+        {
+            x[i] = int16_t(rng());
+            y[i] = int16_t(rng());
+            s += int64_t(x[i]) * y[i];
+        }
+        const uint8_t shift = rng() % 24;
+        CHECK(misc::dot_q(x, y, shift) == floor_shift(s, shift));
+        negative += (s < 0);
+        inexact += ((s < 0) && ((s & ((int64_t(1) << shift) - 1)) != 0));
+        ++checks;
+    }
+    printf("dot_q: %u random cases, %u negative, %u negative and inexact : floor shift\n", (unsigned)checks, (unsigned)negative, (unsigned)inexact);
+
+    // self check and table of the target (the cycles are virtual on the simulator)
+    CHECK(misc::kernels_benchmark());
+    return wsim_check::result("kernels");
+}
@@ -0,0 +1,64 @@
+/**
+ * @file periodic_task.cpp
+ * @brief PeriodicTask on the simulator (CONFIG_FREERTOS_HZ=100) : tick periods with xTaskDelayUntil, sub-tick and
+ *        non multiple periods with the esp_timer, change of period at run time, overruns and refused periods
+ */
+#include "check.hpp"
+#include "wsim.hpp"
+#include "PeriodicTask.hpp"
+
+class CountTask : public PeriodicTask
+{
+public:
+    CountTask(const char *name, uint32_t periodMs, uint8_t priority, uint64_t stepNs = 0) : PeriodicTask(name, periodMs, 4096, priority), stepNs(stepNs) {}
+    uint32_t steps = 0;
+    uint64_t stepNs;
+
+private:
+    void step()
+    {
+        ++steps;
+        if (stepNs != 0)
+            wsim::consume(stepNs);
+    }
+};
+
+int main()
+{
+    CountTask tick("tick", 20, 5);          // 2 ticks : xTaskDelayUntil
+    CountTask fast("fast", 10, 5);          // set to 1 ms below : esp_timer
+    CountTask odd("odd", 15, 5);            // 1.5 ticks : esp_timer
+    CountTask slow("slow", 1, 4, 1500000);  // step of 1.5 ms every 1 ms, below the others : overruns
+    CountTask zero("zero", 0, 5);           // refused : one tick
+    CHECK(zero.getPeriodUs() == 10000);
+    zero.setPeriodMs(UINT32_MAX / 1000 + 1); // would wrap to 704 us : refused
+    CHECK(zero.getPeriodUs() == 10000);
+    fast.setPeriodUs(1000);
+    CHECK(fast.getPeriodUs() == 1000);
+    tick.start();
+    fast.start();
+    odd.start();
+    slow.start();
+
+    wsim::run_for(1000000000ULL);
+    printf("steps in 1 s : 20 ms %u, 1 ms %u, 15 ms %u, overloaded 1 ms %u (%u overruns)\n", (unsigned)tick.steps,
+           (unsigned)fast.steps, (unsigned)odd.steps, (unsigned)slow.steps, (unsigned)slow.getOverrunCount());
+    CHECK((tick.steps >= 50) && (tick.steps <= 51));
+    CHECK((fast.steps >= 999) && (fast.steps <= 1001));
+    CHECK((odd.steps >= 66) && (odd.steps <= 68));
+    CHECK(fast.getOverrunCount() == 0);
+    CHECK(slow.getOverrunCount() > 0);
+    CHECK(slow.steps + slow.getOverrunCount() >= 990);
+
+    // back to the tick, then to the timer again, while the task is waiting
+    fast.setPeriodMs(10);
+    const uint32_t before = fast.steps;
+    wsim::run_for(1000000000ULL);
+    CHECK((fast.steps - before >= 100) && (fast.steps - before <= 102));
+    fast.setPeriodUs(500);
+    const uint32_t before2 = fast.steps;
+    wsim::run_for(1000000000ULL);
+    CHECK((fast.steps - before2 >= 1999) && (fast.steps - before2 <= 2001));
+
+    return wsim_check::result("periodic_task");
+}
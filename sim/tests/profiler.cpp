@@ -0,0 +1,74 @@
+/**
+ * @file profiler.cpp
+ * @brief Profiler zones on the simulator : a zone first used from an ISR is registered without guard nor log, the name
+ *        is published with the zone, every core has its statistics, and a full table is counted
+ */
+#define CONFIG_MISC_PROFILER 1
+#include <cstring>
+#include "check.hpp"
+#include "wsim.hpp"
+#include "profiler.hpp"
+
+static void isr_work()
+{
+    MISC_PROFILE_ZONE("isr");
+    wsim::consume(2000);
+}
+
+static void task_work()
+{
+    MISC_PROFILE_ZONE("task");
+    wsim::consume(5000);
+}
+
+static misc::ProfileZoneId find(const char *name)
+{
+    for (misc::ProfileZoneId id = 0; id < misc::profiler_zone_count(); ++id)
+        if ((misc::profiler_name(id) != nullptr) && (strcmp(misc::profiler_name(id), name) == 0))
+            return id;
+    return misc::profile_zone_invalid;
+}
+
+int main()
+{
+    CHECK(misc::profiler_zone_count() == 0);
+    // first use from an ISR, on both cores
+    for (int i = 0; i < 10; ++i)
+    {
+        wsim::at(1000000ULL * (i + 1), isr_work, i & 1);
+        wsim::at(1000000ULL * (i + 1) + 500000, task_work, 0);
+    }
+    wsim::run_for(20000000ULL);
+    CHECK(misc::profiler_zone_count() == 2); // one registration per zone
+    const misc::ProfileZoneId isr = find("isr"), task = find("task");
+    CHECK(isr == 0 && task == 1); // named when published
+    misc::ProfileStats core0, core1, stats;
+    CHECK(misc::profiler_get(isr, 0, core0));
+    CHECK(misc::profiler_get(isr, 1, core1));
+    CHECK(core0.count == 5 && core1.count == 5);
+    CHECK(misc::profiler_get(task, 0, stats));
+    CHECK(stats.count == 10 && stats.migrated == 0);
+    CHECK(stats.min <= stats.max && stats.min != UINT32_MAX);
+    CHECK(!misc::profiler_get(misc::profiler_zone_count(), 0, stats)); // not registered
+    CHECK(misc::profiler_name(misc::profiler_zone_count()) == nullptr);
+    CHECK(misc::profiler_overflow() == 0);
+
+    // a scope started on core 1 and ended on core 0 is counted by core 0, not measured
+    misc::profiler_record(task, 1, 100);
+    CHECK(misc::profiler_get(task, 0, stats) && stats.migrated == 1 && stats.count == 10);
+    CHECK(misc::profiler_get(task, 1, stats) && stats.migrated == 0 && stats.count == 0);
+    misc::profiler_dump();
+
+    // full table : refused without log, counted, and the zone is not measured
+    while (misc::profiler_zone_count() < CONFIG_MISC_PROFILER_MAX_ZONES)
+        CHECK(misc::profiler_register("filler") != misc::profile_zone_invalid);
+    CHECK(misc::profiler_register("one too many") == misc::profile_zone_invalid);
+    static constinit misc::ProfileZone late{"late"};
+    CHECK(late.id() == misc::profile_zone_invalid);
+    CHECK(late.id() == misc::profile_zone_invalid); // refused once, not registered again
+    CHECK(misc::profiler_overflow() == 2);
+    CHECK(find("late") == misc::profile_zone_invalid);
+    printf("isr zone: %u + %u scopes, task zone: %u scopes, %u zones, %u refused\n", (unsigned)core0.count, (unsigned)core1.count,
+           (unsigned)stats.count, (unsigned)misc::profiler_zone_count(), (unsigned)misc::profiler_overflow());
+    return wsim_check::result("profiler");
+}
@@ -0,0 +1,168 @@
+/**
+ * @file reproducible.cpp
+ * @brief Bit-reproducibility of a run : the same small task graph (data between the cores, notifications, timer and
+ *        preemptions) runs twice in child processes, the task and core statistics of the two runs must be identical
+ */
+#include <cstring>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "check.hpp"
+#include "wsim.hpp"
+#include "RTask.hpp"
+#include "PeriodicTask.hpp"
+
+#define NOTIF_ITEM 1
+#define NOTIF_LOG 2
+
+class LoggerTask : public NTask
+{
+public:
+    LoggerTask() : NTask(3, "logger", 4096, 4, 0) {};
+
+private:
+    void run(void *data)
+    {
+        while (true)
+        {
+            receiveNotification(portMAX_DELAY);
+            wsim::consume(1000000);
+        }
+    };
+};
+
+class ConsumerTask : public RTask
+{
+public:
+    ConsumerTask(NTask *logger) : RTask(2, "consumer", 4096, 11, 1, 8, 256), logger(logger)
+    {
+        setCriticality(TASK_REAL_TIME);
+    };
+
+private:
+    NTask *logger;
+    void run(void *data)
+    {
+        while (true)
+        {
+            receiveNotification(portMAX_DELAY);
+            size_t size;
+            void *item = receiveData(&size, 0);
+            if (item == nullptr)
+                continue;
+            uint32_t index;
+            memcpy(&index, item, sizeof(index));
+            returnData(item);
+            wsim::consume(200000);
+            if (index % 3 == 0)
+                sendNotificationTo(logger, NOTIF_LOG, 0);
+        }
+    };
+};
+
+class ProducerTask : public RTask
+{
+public:
+    ProducerTask(RTask *consumer) : RTask(1, "producer", 4096, 6, 0), consumer(consumer) {};
+
+private:
+    RTask *consumer;
+    void run(void *data)
+    {
+        for (uint32_t index = 0;; ++index)
+        {
+            delay(10);
+            wsim::consume((index * 7919) % 500 * 1000); // varying computation
+            sendDataTo(consumer, &index, sizeof(index), portMAX_DELAY, NOTIF_ITEM);
+        }
+    };
+};
+
+class TimerTask : public PeriodicTask
+{
+public:
+    TimerTask() : PeriodicTask("timer", 0, 4096, 5) { setPeriodUs(2700); };
+
+private:
+    void step() { wsim::consume(400000); };
+};
+
+/**
+ * @brief Run the graph for 2 s of virtual time
+ *
+ * @return std::string the task and core statistics, one line each
+ */
+static std::string run_graph()
+{
+    LoggerTask logger;
+    ConsumerTask consumer(&logger);
+    ProducerTask producer(&consumer);
+    TimerTask timer;
+    logger.start();
+    consumer.start();
+    producer.start();
+    timer.start();
+    wsim::run_for(2000000000ULL);
+
+    std::string out;
+    char line[256];
+    for (const wsim::TaskStats &t : wsim::task_stats())
+    {
+        snprintf(line, sizeof(line), "%s %d %u %u %u %llu %llu %llu %llu\n", t.name.c_str(), (int)t.core, (unsigned)t.priority,
+                 (unsigned)t.activations, (unsigned)t.preemptions, (unsigned long long)t.cpu_ns, (unsigned long long)t.latency_min_ns,
+                 (unsigned long long)t.latency_max_ns, (unsigned long long)t.latency_total_ns);
+        out += line;
+    }
+    for (BaseType_t core = 0; core < 2; ++core)
+    {
+        const wsim::CoreStats c = wsim::core_stats(core);
+        snprintf(line, sizeof(line), "core %d %llu %llu %llu\n", (int)core, (unsigned long long)c.task_ns, (unsigned long long)c.isr_ns,
+                 (unsigned long long)c.switch_ns);
+        out += line;
+    }
+    return out;
+}
+
+/**
+ * @brief Run the graph in a child process : the simulator state is global, each run needs a fresh one
+ *
+ * @return std::string statistics printed by the child, empty on failure
+ */
+static std::string run_in_child()
+{
+    int fds[2];
+    if (pipe(fds) != 0)
+        return "";
+    fflush(stdout);
+    const pid_t pid = fork();
+    if (pid == 0)
+    {
+        close(fds[0]);
+        const std::string stats = run_graph();
+        const ssize_t written = write(fds[1], stats.data(), stats.size());
+        _exit((written == (ssize_t)stats.size()) ? 0 : 1);
+    }
+    close(fds[1]);
+    std::string stats;
+    char buffer[1024];
+    ssize_t n;
+    while ((n = read(fds[0], buffer, sizeof(buffer))) > 0)
+        stats.append(buffer, n);
+    close(fds[0]);
+    int status = 0;
+    if ((pid < 0) || (waitpid(pid, &status, 0) != pid) || !WIFEXITED(status) || (WEXITSTATUS(status) != 0))
+        return "";
+    return stats;
+}
+
+int main()
+{
+    const std::string first = run_in_child();
+    const std::string second = run_in_child();
+    printf("%s", first.c_str());
+    CHECK(!first.empty());
+    CHECK(first.find("consumer") != std::string::npos);
+    CHECK(first.find("timer") != std::string::npos);
+    CHECK(first == second);
+    return wsim_check::result("reproducible");
+}
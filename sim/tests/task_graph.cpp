@@ -0,0 +1,174 @@
+/**
+ * @file task_graph.cpp
+ * @brief TaskGraph and TaskSet : sizes derived from the channels and checks of invalid graphs at compile time, then a
+ *        started TaskSet exchanging data and notifications, its tasks found back by their type:ID
+ */
+#include "check.hpp"
+#include "wsim.hpp"
+#include "esp_timer.h"
+#include "TaskGraph.hpp"
+
+#define NOTIF_MEASURE 1
+#define NOTIF_LOG 2
+
+struct Measure_t
+{
+    int64_t timestamp_us;
+    int32_t distance_mm;
+    uint32_t index;
+};
+
+static constexpr auto graph = makeTaskGraph(
+    {TaskSpec{.name = "sensor", .type = 1, .core = 1, .priority = 12, .stack = 4096, .load = 100, .criticality = TASK_REAL_TIME},
+     TaskSpec{.name = "control", .type = 2, .core = 1, .priority = 11, .stack = 4096, .load = 200, .criticality = TASK_REAL_TIME},
+     TaskSpec{.name = "logger", .type = 2, .ID = 7, .core = 0, .priority = 3, .stack = 4096, .load = 50}},
+    {makeChannel<Measure_t>("sensor", "control", 100, 50),
+     makeChannel<void>("control", "logger", 20, 100)});
+
+// sizes : 100 messages/s pending 50 ms, 20 messages/s pending 100 ms
+static_assert(graph.indexOf("control") == 1);
+static_assert(graph.indexOf("motor") == TASKGRAPH_NOT_FOUND);
+static_assert(graph.channelOf("control", "logger") == 1);
+static_assert(graph.channelOf("logger", "control") == TASKGRAPH_NOT_FOUND);
+static_assert(graph.pendingMessages(0) == 5);
+static_assert(graph.pendingMessages(1) == 2);
+static_assert(graph.queueLength(0) == 1); // no incoming channel
+static_assert(graph.queueLength(1) == 5);
+static_assert(graph.queueLength(2) == 2);
+static_assert(graph.ringbufferSize(1) == 5 * (sizeof(Measure_t) + TASKGRAPH_RINGBUF_HEADER));
+static_assert(graph.ringbufferSize(2) == 0); // notifications only
+static_assert(graph.ID(0) == 1 && graph.ID(2) == 7);
+static_assert(graph.coreLoad(1) == 300);
+static_assert(graph.valid());
+
+// a single slow message still gets a slot, and the largest item fits in half of the ring buffer
+static constexpr auto slow_graph = makeTaskGraph(
+    {TaskSpec{.name = "a", .type = 1}, TaskSpec{.name = "b", .type = 2}},
+    {makeChannel<uint8_t[100]>("a", "b", 1, 10)});
+static_assert(slow_graph.pendingMessages(0) == 1);
+static_assert(slow_graph.queueLength(1) == 1);
+static_assert(slow_graph.ringbufferSize(1) == 2 * (100 + TASKGRAPH_RINGBUF_HEADER));
+
+// each check rejects its invalid graph
+static constexpr auto clash = makeTaskGraph({TaskSpec{.name = "a", .type = 1, .ID = 2}, TaskSpec{.name = "b", .type = 1, .ID = 2}});
+static_assert(!clash.identifiersUnique());
+static constexpr auto overloaded = makeTaskGraph({TaskSpec{.name = "a", .type = 1, .load = 600}, TaskSpec{.name = "b", .type = 2, .load = 500}});
+static_assert(!overloaded.coresNotOverloaded());
+static constexpr auto unknown_end = makeTaskGraph({TaskSpec{.name = "a", .type = 1}}, {makeChannel<void>("a", "b", 10, 10)});
+static_assert(!unknown_end.channelsValid());
+static constexpr auto flooded = makeTaskGraph({TaskSpec{.name = "a", .type = 1}, TaskSpec{.name = "b", .type = 2}},
+                                              {makeChannel<void>("a", "b", 10000, 100)});
+static_assert(!flooded.queuesValid());
+static constexpr auto misplaced = makeTaskGraph({TaskSpec{.name = "a", .type = 1, .core = 0, .priority = 12, .criticality = TASK_REAL_TIME}});
+static_assert(!misplaced.partitionRespected());
+
+class SensorTask : public RTask
+{
+public:
+    SensorTask(const TaskConfig_t &config) : RTask(config) {};
+    uint32_t sent = 0;
+
+private:
+    void run(void *data);
+};
+
+class ControlTask : public RTask
+{
+public:
+    ControlTask(const TaskConfig_t &config) : RTask(config) {};
+    uint32_t received = 0;
+    uint32_t lost = 0;
+
+private:
+    void run(void *data);
+};
+
+class LoggerTask : public NTask
+{
+public:
+    LoggerTask(const TaskConfig_t &config) : NTask(config) {};
+    uint32_t logs = 0;
+
+private:
+    void run(void *data)
+    {
+        while (true)
+            if (receiveNotification(portMAX_DELAY).value == NOTIF_LOG)
+                ++logs;
+    };
+};
+
+static TaskSet<graph, SensorTask, ControlTask, LoggerTask> tasks;
+
+void SensorTask::run(void *data)
+{
+    for (uint32_t index = 0;; ++index)
+    {
+        delay(10);
+        const Measure_t measure = {.timestamp_us = esp_timer_get_time(), .distance_mm = 1000, .index = index};
+        static_assert(sizeof(measure) == decltype(tasks)::payloadSize<graph.channelOf("sensor", "control")>());
+        if (sendDataTo(tasks.destination<graph.channelOf("sensor", "control")>(), (void *)&measure, sizeof(measure), 0, NOTIF_MEASURE) == pdTRUE)
+            ++sent;
+    }
+}
+
+void ControlTask::run(void *data)
+{
+    uint32_t next = 0;
+    while (true)
+    {
+        if (receiveNotification(portMAX_DELAY).value != NOTIF_MEASURE)
+            continue;
+        size_t size;
+        Measure_t *measure = static_cast<Measure_t *>(receiveData(&size, 0));
+        if (measure == nullptr)
+            continue;
+        lost += measure->index - next;
+        next = measure->index + 1;
+        returnData(measure);
+        ++received;
+        wsim::consume(500000);
+        if (received % 5 == 0)
+            sendNotificationTo(tasks.destination<graph.channelOf("control", "logger")>(), NOTIF_LOG, 0);
+    }
+}
+
+int main()
+{
+    // the tasks are registered with the identifiers of the graph before they start
+    for (std::size_t i = 0; i < graph.tasks.size(); ++i)
+    {
+        Identifier_t identifier = {};
+        identifier.type = graph.tasks[i].type;
+        identifier.ID = graph.ID(i);
+        NTask *task = NTask::getNTaskByIdentifier(identifier);
+        CHECK(task != nullptr);
+        if (task != nullptr)
+            CHECK(task->getIdentifier().w_id == identifier.w_id);
+    }
+    Identifier_t logger_id = {};
+    logger_id.type = 2;
+    logger_id.ID = 7;
+    CHECK(NTask::getNTaskByIdentifier(logger_id) == &tasks.get<2>());
+    logger_id.ID = 3;
+    CHECK(NTask::getNTaskByIdentifier(logger_id) == nullptr);
+
+    tasks.start();
+    wsim::run_for(1000000000ULL);
+    SensorTask &sensor = tasks.get<0>();
+    ControlTask &control = tasks.get<1>();
+    printf("1 s : %u measures sent, %u received, %u lost, %u logs\n", (unsigned)sensor.sent, (unsigned)control.received,
+           (unsigned)control.lost, (unsigned)tasks.get<2>().logs);
+    CHECK(sensor.sent >= 99);
+    CHECK(control.received + 1 >= sensor.sent);
+    CHECK(control.lost == 0);
+    CHECK(tasks.get<2>().logs == control.received / 5);
+
+    // the task found by its identifier is the running one
+    Identifier_t control_id = {};
+    control_id.type = 2;
+    control_id.ID = 2;
+    CHECK(NTask::getNTaskByIdentifier(control_id) == &control);
+    CHECK(control.is_task_running());
+    return wsim_check::result("task_graph");
+}
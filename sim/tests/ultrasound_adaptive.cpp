@@ -0,0 +1,137 @@
+/**
+ * @file ultrasound_adaptive.cpp
+ * @brief Adaptive period of the ultrasound driver on the simulator, with a virtual echo source : the period follows the
+ *        distance and the speed, the ring-down floor, the maximum period at speed 0 or without echo, and the echo
+ *        timeout cancelled at each echo end (no stale trigger)
+ */
+#include "check.hpp"
+#include "wsim.hpp"
+#include "ultrasound.h"
+
+#define TRIG_PIN 4
+#define ECHO_PIN 5
+#define MAX_PERIOD_MS 100
+#define RING_DOWN_US 8000
+#define PHASE_NS 1000000000ULL
+
+/**
+ * @brief Distance of each phase of 1 s
+ */
+static uint32_t phase_mm(uint64_t now_ns)
+{
+    static const uint32_t distances[] = {2000, 400, 400, 400, 400, 5000};
+    const uint64_t phase = now_ns / PHASE_NS;
+    return distances[(phase < 6) ? phase : 5];
+}
+
+/**
+ * @brief Time between the triggers of the last samples : all the same within 200 us (distance of 399 or 400 mm), else 0
+ */
+static int64_t sample_spacing_us(Ultrasound_Handle_t sensor)
+{
+    Ultrasound_Sample_t samples[4];
+    const size_t n = Ultrasound_GetHistory(sensor, 0, INT64_MAX, samples, 4);
+    if (n < 4)
+        return 0;
+    const int64_t spacing = samples[3].timestamp_us - samples[2].timestamp_us;
+    for (size_t i = 1; i < n; ++i)
+    {
+        const int64_t d = samples[i].timestamp_us - samples[i - 1].timestamp_us;
+        if ((d < spacing - 200) || (d > spacing + 200))
+            return 0;
+    }
+    return spacing;
+}
+
+/**
+ * @brief Adaptive period expected from the last distance : time to the obstacle / ULTRASOUND_ADAPTIVE_SAMPLES_TO_OBSTACLE
+ */
+static uint32_t expected_period_us(Ultrasound_Handle_t sensor, uint32_t speed_mm_s)
+{
+    const uint32_t period = Ultrasound_GetDistance(sensor).distance_mm * (1000000u / ULTRASOUND_ADAPTIVE_SAMPLES_TO_OBSTACLE) / speed_mm_s;
+    return (period < MAX_PERIOD_MS * 1000) ? period : MAX_PERIOD_MS * 1000;
+}
+
+int main()
+{
+    wsim::EchoSource source = {};
+    source.trig_pin = static_cast<gpio_num_t>(TRIG_PIN);
+    source.echo_pin = static_cast<gpio_num_t>(ECHO_PIN);
+    source.distance_mm = phase_mm;
+    wsim::add_echo_source(source);
+
+    Ultrasound_Init_t config = {};
+    config.gpio_trig_pin = source.trig_pin;
+    config.gpio_echo_pin = source.echo_pin;
+    config.measurement_period_ms = MAX_PERIOD_MS;
+    config.trig_signal_duration_us = 10;
+    config.adaptive_period = true;
+    config.min_period_ms = 1;
+    config.ring_down_us = RING_DOWN_US;
+    Ultrasound_Handle_t sensor = Ultrasound_Init(&config);
+    CHECK(sensor != NULL);
+    CHECK(Ultrasound_SetSpeed(sensor, 1000) == ESP_OK);
+    Ultrasound_Start(sensor);
+
+    // 2 m at 1 m/s : 8 samples before the obstacle would take 250 ms, bounded by the maximum period
+    wsim::run_for(PHASE_NS);
+    int64_t spacing = sample_spacing_us(sensor);
+    printf("2000 mm at 1000 mm/s : period %u us, triggers every %lld us\n", (unsigned)Ultrasound_GetPeriodUs(sensor), (long long)spacing);
+    CHECK(Ultrasound_GetPeriodUs(sensor) == MAX_PERIOD_MS * 1000);
+    CHECK((spacing >= MAX_PERIOD_MS * 1000) && (spacing < MAX_PERIOD_MS * 1000 + 50));
+
+    // closer : 400 mm / 8 / 1000 mm/s = 50 ms
+    wsim::run_for(PHASE_NS);
+    spacing = sample_spacing_us(sensor);
+    printf(" 400 mm at 1000 mm/s : period %u us, triggers every %lld us\n", (unsigned)Ultrasound_GetPeriodUs(sensor), (long long)spacing);
+    CHECK(Ultrasound_GetPeriodUs(sensor) == expected_period_us(sensor, 1000));
+    CHECK((spacing >= 49700) && (spacing < 50050));
+
+    // faster : 25 ms
+    CHECK(Ultrasound_SetSpeed(sensor, 2000) == ESP_OK);
+    wsim::run_for(PHASE_NS);
+    spacing = sample_spacing_us(sensor);
+    printf(" 400 mm at 2000 mm/s : period %u us, triggers every %lld us\n", (unsigned)Ultrasound_GetPeriodUs(sensor), (long long)spacing);
+    CHECK(Ultrasound_GetPeriodUs(sensor) == expected_period_us(sensor, 2000));
+    CHECK((spacing >= 24800) && (spacing < 25050));
+
+    // stopped : back to the maximum period
+    CHECK(Ultrasound_SetSpeed(sensor, 0) == ESP_OK);
+    wsim::run_for(PHASE_NS);
+    spacing = sample_spacing_us(sensor);
+    printf(" 400 mm at    0 mm/s : period %u us, triggers every %lld us\n", (unsigned)Ultrasound_GetPeriodUs(sensor), (long long)spacing);
+    CHECK(Ultrasound_GetPeriodUs(sensor) == MAX_PERIOD_MS * 1000);
+    CHECK((spacing >= MAX_PERIOD_MS * 1000) && (spacing < MAX_PERIOD_MS * 1000 + 50));
+
+    // very fast : a 5 ms period, but the next trigger waits RING_DOWN_US after the echo end (10 + 450 + 2332 us echo)
+    CHECK(Ultrasound_SetSpeed(sensor, 10000) == ESP_OK);
+    wsim::run_for(PHASE_NS);
+    spacing = sample_spacing_us(sensor);
+    printf(" 400 mm at 10 m/s    : period %u us, triggers every %lld us (ring-down %u us)\n", (unsigned)Ultrasound_GetPeriodUs(sensor),
+           (long long)spacing, (unsigned)RING_DOWN_US);
+    CHECK(Ultrasound_GetPeriodUs(sensor) == expected_period_us(sensor, 10000));
+    CHECK(Ultrasound_GetPeriodUs(sensor) < 5001);
+    CHECK((spacing >= 2780 + RING_DOWN_US) && (spacing < 2790 + RING_DOWN_US + 100));
+
+    // every echo so far ended before its timeout, which was cancelled : no fault and no extra trigger
+    Ultrasound_Diagnostics_t diag;
+    CHECK(Ultrasound_GetDiagnostics(sensor, &diag) == ESP_OK);
+    printf("%u triggers, %u samples, %u without echo\n", (unsigned)diag.trigger_count, (unsigned)diag.success_count,
+           (unsigned)diag.fault_count[ULTRASOUND_FAULT_NO_ECHO]);
+    CHECK(diag.fault_count[ULTRASOUND_FAULT_NO_ECHO] == 0);
+    CHECK(diag.fault_count[ULTRASOUND_FAULT_ECHO_NOT_ENDED] == 0);
+    CHECK(diag.trigger_count - diag.success_count <= 1); // the last trigger may wait for its echo
+    const uint32_t triggers = diag.trigger_count, samples = diag.success_count;
+
+    // out of range : no echo, the timeout triggers again at the maximum period
+    wsim::run_for(PHASE_NS);
+    CHECK(Ultrasound_GetDiagnostics(sensor, &diag) == ESP_OK);
+    const uint32_t silent = diag.trigger_count - triggers;
+    printf("out of range : %u triggers in 1 s, %u without echo\n", (unsigned)silent, (unsigned)diag.fault_count[ULTRASOUND_FAULT_NO_ECHO]);
+    CHECK((silent >= 9) && (silent <= 11));
+    CHECK(diag.success_count - samples <= 1);
+    CHECK(diag.fault_count[ULTRASOUND_FAULT_NO_ECHO] + 1 >= silent);
+
+    Ultrasound_Stop(sensor);
+    return wsim_check::result("ultrasound_adaptive");
+}
@@ -0,0 +1,151 @@
+/**
+ * @file ultrasound_array.cpp
+ * @brief UltrasoundArray driven by its simulated echo source : slots of each schedule, distances of the frames, channels
+ *        without echo, per sensor diagnostics, scan rate and speed of sound
+ */
+#include <vector>
+#include "check.hpp"
+#include "wsim.hpp"
+#include "ultrasound_array.h"
+
+static constexpr uint8_t channels = 6;
+static constexpr uint32_t slot_us = 25000;
+
+/**
+ * @brief Obstacles seen by the simulated sensors, and the trigger times of each channel
+ */
+struct Scene
+{
+    int32_t distance_mm[channels] = {300, 650, 1000, 1800, 2500, -1}; // last sensor sees nothing
+    std::vector<int64_t> trig_us[channels];
+    uint32_t scans = 0;
+    UltrasoundArray_Frame_t last = {};
+};
+
+static int32_t echo_source(uint8_t channel, int64_t trig_time_us, void *user_data)
+{
+    Scene *scene = static_cast<Scene *>(user_data);
+    scene->trig_us[channel].push_back(trig_time_us);
+    if (scene->distance_mm[channel] < 0)
+        return -1;
+    return static_cast<int32_t>(scene->distance_mm[channel] * 2000LL / 343); // round trip at 343 m/s, in us
+}
+
+static void on_scan(UltrasoundArray_Handle_t, const UltrasoundArray_Frame_t *frame, void *user_data)
+{
+    Scene *scene = static_cast<Scene *>(user_data);
+    ++scene->scans;
+    scene->last = *frame;
+}
+
+static UltrasoundArray_Handle_t start(Scene &scene, UltrasoundArray_Schedule_t schedule, uint8_t groups)
+{
+    UltrasoundArray_Init_t init = {};
+    init.channel_count = channels;
+    init.schedule = schedule;
+    init.group_count = groups;
+    init.slot_period_us = slot_us;
+    init.trig_signal_duration_us = 10;
+    init.onScan = on_scan;
+    init.user_data = &scene;
+    init.echo_source = echo_source;
+    UltrasoundArray_Handle_t handle = UltrasoundArray_Init(&init);
+    CHECK(handle != NULL);
+    CHECK(UltrasoundArray_Start(handle) == ESP_OK);
+    return handle;
+}
+
+/**
+ * @brief Frames of an array : distances within 1 mm, no echo marked invalid, one missed echo per scan, scan period
+ */
+static void check_frames(const char *name, UltrasoundArray_Handle_t handle, const Scene &scene, uint32_t slots)
+{
+    UltrasoundArray_Frame_t frame;
+    CHECK(UltrasoundArray_GetFrame(handle, &frame) == ESP_OK);
+    const UltrasoundArray_Stats_t stats = UltrasoundArray_GetStats(handle);
+    CHECK(stats.scan_count == scene.scans);
+    CHECK(frame.scan_index == scene.last.scan_index);
+    CHECK(frame.scan_index + 1 == stats.scan_count);
+    CHECK(frame.valid_mask == (1u << (channels - 1)) - 1);
+    for (uint8_t c = 0; c + 1 < channels; ++c)
+        CHECK_NEAR(frame.channel[c].distance_mm, scene.distance_mm[c], 1);
+    CHECK(frame.channel[channels - 1].distance_mm == INT32_MAX);
+    CHECK(stats.missed_echo_count == stats.scan_count);
+    // the slots follow each other without gap : one scan every slots * slot period
+    CHECK_NEAR(double(stats.last_scan_duration_us), double(slots * slot_us), 50);
+    // per sensor diagnostics : one outcome per closed slot, the last sensor never gets an echo
+    Ultrasound_Diagnostics_t diag;
+    CHECK(UltrasoundArray_GetDiagnostics(handle, channels, &diag) == ESP_ERR_INVALID_ARG);
+    for (uint8_t c = 0; c < channels; ++c)
+    {
+        CHECK(UltrasoundArray_GetDiagnostics(handle, c, &diag) == ESP_OK);
+        CHECK(diag.trigger_count >= stats.scan_count && diag.trigger_count <= stats.scan_count + 1);
+        CHECK(diag.fault_count[ULTRASOUND_FAULT_ECHO_NOT_ENDED] == 0);
+        CHECK(diag.fault_count[ULTRASOUND_FAULT_SPIKE] == 0);
+        CHECK(diag.health == ULTRASOUND_HEALTH_OK);
+        uint32_t histogram = 0;
+        for (uint32_t i = 0; i < ULTRASOUND_ECHO_HISTOGRAM_BINS; ++i)
+            histogram += diag.echo_width_histogram[i];
+        if (c + 1 < channels)
+        {
+            const uint32_t width_us = uint32_t(scene.distance_mm[c] * 2000LL / 343);
+            CHECK(diag.success_count == diag.trigger_count);
+            CHECK(diag.fault_count[ULTRASOUND_FAULT_NO_ECHO] == 0);
+            CHECK(diag.success_percent == 100);
+            // the echo of the open slot may already be counted
+            CHECK(histogram >= diag.success_count && histogram <= diag.success_count + 1);
+            CHECK(diag.echo_width_histogram[31 - __builtin_clz(width_us)] == histogram);
+        }
+        else
+        {
+            CHECK(diag.success_count == 0);
+            CHECK(diag.fault_count[ULTRASOUND_FAULT_NO_ECHO] == diag.trigger_count);
+            CHECK(diag.success_window == 0 && diag.success_percent == 0);
+            CHECK(histogram == 0);
+        }
+    }
+    printf("%-12s %u slots : %u scans in 3 s, %.2f scans/s\n", name, (unsigned)slots, (unsigned)stats.scan_count, 1e6 / double(stats.last_scan_duration_us));
+}
+
+int main()
+{
+    CHECK(UltrasoundArray_Init(NULL) == NULL);
+    UltrasoundArray_Init_t bad = {};
+    bad.channel_count = channels;
+    bad.schedule = ULTRASOUND_SCHEDULE_INTERLEAVED;
+    bad.slot_period_us = slot_us;
+    CHECK(UltrasoundArray_Init(&bad) == NULL); // no group
+
+    Scene round_robin, interleaved, all;
+    UltrasoundArray_Handle_t rr = start(round_robin, ULTRASOUND_SCHEDULE_ROUND_ROBIN, 0);
+    UltrasoundArray_Handle_t il = start(interleaved, ULTRASOUND_SCHEDULE_INTERLEAVED, 2);
+    UltrasoundArray_Handle_t at = start(all, ULTRASOUND_SCHEDULE_ALL_AT_ONCE, 0);
+    UltrasoundArray_Frame_t frame;
+    CHECK(UltrasoundArray_GetFrame(rr, &frame) == ESP_ERR_INVALID_STATE); // no scan yet
+
+    wsim::run_for(3000000000ULL);
+    check_frames("round robin", rr, round_robin, channels);
+    check_frames("interleaved", il, interleaved, 2);
+    check_frames("all at once", at, all, 1);
+
+    // one sensor per slot, in order
+    for (uint8_t c = 1; c < channels; ++c)
+        CHECK(round_robin.trig_us[c][0] - round_robin.trig_us[c - 1][0] == slot_us);
+    // even channels, then odd channels
+    for (uint8_t c = 2; c < channels; ++c)
+        CHECK(interleaved.trig_us[c][0] == interleaved.trig_us[c % 2][0]);
+    CHECK(interleaved.trig_us[1][0] - interleaved.trig_us[0][0] == slot_us);
+    // every sensor in the same slot
+    for (uint8_t c = 1; c < channels; ++c)
+        CHECK(all.trig_us[c] == all.trig_us[0]);
+
+    // the speed of sound applies from the next echo : the echoes are still timed at 343 m/s, the distances use 330 m/s
+    CHECK(UltrasoundArray_SetSoundSpeed(at, 0) == ESP_ERR_INVALID_ARG);
+    CHECK(UltrasoundArray_SetSoundSpeed(at, 330 << 16) == ESP_OK);
+    wsim::run_for(100000000ULL);
+    CHECK(UltrasoundArray_GetFrame(at, &frame) == ESP_OK);
+    for (uint8_t c = 0; c + 1 < channels; ++c)
+        CHECK_NEAR(frame.channel[c].distance_mm, (all.distance_mm[c] * 2000LL / 343) * 0.165, 1);
+
+    return wsim_check::result("ultrasound_array");
+}
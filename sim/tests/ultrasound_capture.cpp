@@ -0,0 +1,184 @@
+/**
+ * @file ultrasound_capture.cpp
+ * @brief Capture backends of the ultrasound driver : a mock Ultrasound_CaptureHal_t through ULTRASOUND_BACKEND_CUSTOM,
+ *        and the MCPWM capture backend on the simulated peripheral (capture timer shared per group, sensor limit)
+ */
+#include "check.hpp"
+#include "wsim.hpp"
+#include "ultrasound.h"
+
+/**
+ * @brief Mock capture HAL : a pulse of pulse_ticks is delivered delay_ns after each arm, from ISR context
+ */
+struct MockCapture
+{
+    Ultrasound_CaptureDone_t done = nullptr;
+    void *ctx = nullptr;
+    gpio_num_t pin = static_cast<gpio_num_t>(-1);
+    uint32_t inits = 0, deinits = 0, arms = 0, disarms = 0, delivered = 0;
+    bool armed = false;
+    bool fail_init = false;
+    uint32_t pulse_ticks = 0; // 0 : no echo
+    uint64_t delay_ns = 500000;
+};
+
+static MockCapture mock;
+static constexpr uint32_t mock_resolution_hz = 10000000;
+
+static esp_err_t mock_init(void **backend, gpio_num_t gpio_echo_pin, Ultrasound_CaptureDone_t done, void *ctx)
+{
+    if (mock.fail_init)
+        return ESP_FAIL;
+    ++mock.inits;
+    mock.done = done;
+    mock.ctx = ctx;
+    mock.pin = gpio_echo_pin;
+    *backend = &mock;
+    return ESP_OK;
+}
+
+static esp_err_t mock_arm(void *backend)
+{
+    MockCapture *m = static_cast<MockCapture *>(backend);
+    ++m->arms;
+    m->armed = true;
+    if (m->pulse_ticks != 0)
+    {
+        wsim::at(wsim::now() + m->delay_ns, [m]()
+                 {
+                     if (!m->armed)
+                         return;
+                     m->armed = false;
+                     ++m->delivered;
+                     m->done(m->ctx, m->pulse_ticks); });
+    }
+    return ESP_OK;
+}
+
+static esp_err_t mock_disarm(void *backend)
+{
+    MockCapture *m = static_cast<MockCapture *>(backend);
+    ++m->disarms;
+    m->armed = false;
+    return ESP_OK;
+}
+
+static esp_err_t mock_deinit(void *backend)
+{
+    ++static_cast<MockCapture *>(backend)->deinits;
+    return ESP_OK;
+}
+
+static uint32_t mock_get_resolution_hz(void *) { return mock_resolution_hz; }
+
+static const Ultrasound_CaptureHal_t mock_hal = {
+    .init = mock_init,
+    .arm = mock_arm,
+    .disarm = mock_disarm,
+    .deinit = mock_deinit,
+    .get_resolution_hz = mock_get_resolution_hz,
+};
+
+static Ultrasound_Init_t sensor_config(gpio_num_t trig, gpio_num_t echo, Ultrasound_Backend_t backend)
+{
+    Ultrasound_Init_t config = {};
+    config.gpio_trig_pin = trig;
+    config.gpio_echo_pin = echo;
+    config.measurement_period_ms = 60;
+    config.trig_signal_duration_us = 10;
+    config.backend = backend;
+    return config;
+}
+
+static void check_mock()
+{
+    Ultrasound_Init_t config = sensor_config(static_cast<gpio_num_t>(4), static_cast<gpio_num_t>(5), ULTRASOUND_BACKEND_CUSTOM);
+    CHECK(Ultrasound_Init(&config) == NULL); // custom backend without HAL
+    config.capture_hal = &mock_hal;
+    mock.fail_init = true;
+    CHECK(Ultrasound_Init(&config) == NULL); // the error of the HAL is reported
+    mock.fail_init = false;
+
+    Ultrasound_Handle_t sensor = Ultrasound_Init(&config);
+    CHECK(sensor != NULL);
+    CHECK(mock.inits == 1);
+    CHECK(mock.pin == 5);
+    CHECK(!mock.armed); // disarmed until the first trigger
+
+    // 5830.9 us at 10 MHz : 1000 mm at 343 m/s
+    mock.pulse_ticks = 58309;
+    CHECK(Ultrasound_Start(sensor) == ESP_OK);
+    wsim::run_for(1000000000ULL);
+    Ultrasound_Diagnostics_t diagnostics;
+    CHECK(Ultrasound_GetDiagnostics(sensor, &diagnostics) == ESP_OK);
+    printf("mock : %u triggers, %u arms, %u pulses delivered, %u samples, distance %d mm\n", (unsigned)diagnostics.trigger_count,
+           (unsigned)mock.arms, (unsigned)mock.delivered, (unsigned)diagnostics.success_count, (int)Ultrasound_GetDistance(sensor).distance_mm);
+    CHECK(mock.arms == diagnostics.trigger_count);
+    CHECK(diagnostics.success_count == mock.delivered);
+    CHECK(diagnostics.success_count + 1 >= diagnostics.trigger_count);
+    CHECK_NEAR(Ultrasound_GetDistance(sensor).distance_mm, 1000, 1);
+
+    // the resolution of the HAL is used for the sound coefficient : 330 m/s
+    CHECK(Ultrasound_SetSoundSpeed(sensor, 330 << 16) == ESP_OK);
+    wsim::run_for(200000000ULL);
+    CHECK_NEAR(Ultrasound_GetDistance(sensor).distance_mm, 58309 * 330.0 / 2 / 10000, 1);
+
+    // no pulse delivered : no echo faults
+    mock.pulse_ticks = 0;
+    const uint32_t faults = diagnostics.fault_count[ULTRASOUND_FAULT_NO_ECHO];
+    wsim::run_for(600000000ULL);
+    CHECK(Ultrasound_GetDiagnostics(sensor, &diagnostics) == ESP_OK);
+    CHECK(diagnostics.fault_count[ULTRASOUND_FAULT_NO_ECHO] >= faults + 9);
+
+    CHECK(Ultrasound_Deinit(sensor) == ESP_OK);
+    CHECK(mock.deinits == 1);
+    CHECK(!mock.armed);
+}
+
+static void check_mcpwm()
+{
+    static constexpr int sensors = 7; // one more than the capture channels of the 2 MCPWM groups
+    Ultrasound_Handle_t handle[sensors] = {};
+    for (int s = 0; s < sensors; ++s)
+    {
+        const gpio_num_t trig = static_cast<gpio_num_t>(10 + 2 * s), echo = static_cast<gpio_num_t>(11 + 2 * s);
+        wsim::EchoSource source = {};
+        source.trig_pin = trig;
+        source.echo_pin = echo;
+        source.distance_mm = [s](uint64_t)
+        { return 400u + 250u * s; };
+        wsim::add_echo_source(source);
+        const Ultrasound_Init_t config = sensor_config(trig, echo, ULTRASOUND_BACKEND_MCPWM_CAPTURE);
+        handle[s] = Ultrasound_Init(&config);
+    }
+    static_assert(ULTRASOUND_MCPWM_MAX_SENSORS == 6);
+    for (int s = 0; s < ULTRASOUND_MCPWM_MAX_SENSORS; ++s)
+        CHECK(handle[s] != NULL);
+    CHECK(handle[sensors - 1] == NULL); // no capture channel left
+
+    for (int s = 0; s < ULTRASOUND_MCPWM_MAX_SENSORS; ++s)
+        Ultrasound_Start(handle[s]);
+    wsim::run_for(1000000000ULL);
+    for (int s = 0; s < ULTRASOUND_MCPWM_MAX_SENSORS; ++s)
+        CHECK_NEAR(Ultrasound_GetDistance(handle[s]).distance_mm, 400 + 250 * s, 1);
+
+    // a released channel is given to the next sensor, the other sensors of the group keep their shared timer
+    CHECK(Ultrasound_Deinit(handle[1]) == ESP_OK);
+    const Ultrasound_Init_t config = sensor_config(static_cast<gpio_num_t>(10 + 2 * (sensors - 1)), static_cast<gpio_num_t>(11 + 2 * (sensors - 1)),
+                                                   ULTRASOUND_BACKEND_MCPWM_CAPTURE);
+    handle[sensors - 1] = Ultrasound_Init(&config);
+    CHECK(handle[sensors - 1] != NULL);
+    Ultrasound_Start(handle[sensors - 1]);
+    wsim::run_for(1000000000ULL);
+    CHECK_NEAR(Ultrasound_GetDistance(handle[0]).distance_mm, 400, 1);
+    CHECK_NEAR(Ultrasound_GetDistance(handle[2]).distance_mm, 900, 1);
+    CHECK_NEAR(Ultrasound_GetDistance(handle[sensors - 1]).distance_mm, 400 + 250 * (sensors - 1), 1);
+    printf("mcpwm : %d sensors on 2 groups of 3 capture channels, the 7th one is refused until a channel is released\n", ULTRASOUND_MCPWM_MAX_SENSORS);
+}
+
+int main()
+{
+    check_mock();
+    check_mcpwm();
+    return wsim_check::result("ultrasound_capture");
+}
@@ -0,0 +1,97 @@
+/**
+ * @file ultrasound_defer.cpp
+ * @brief ultrasound::deferRead on the simulator : the onRead callback runs in the deferred task of the real-time core,
+ *        and the destructor waits for the reads still queued when the sensor is destroyed
+ */
+#include "check.hpp"
+#include "wsim.hpp"
+#include "ultrasound.hpp"
+
+#define TRIG_PIN 4
+#define ECHO_PIN 5
+
+struct Reads
+{
+    uint32_t count = 0;
+    uint32_t other_core = 0;
+};
+
+static void on_read(Ultrasound_Handle_t handle, void *user_data)
+{
+    Reads *reads = static_cast<Reads *>(user_data);
+    ++reads->count;
+    if (xPortGetCoreID() != WPartition::realTimeCore())
+        ++reads->other_core;
+}
+
+/**
+ * @brief Real-time task above the deferred task : the reads queue up while it runs, then it destroys the sensor
+ */
+class OwnerTask : public Task
+{
+public:
+    OwnerTask(ultrasound *sensor, Reads &reads) : Task("owner", 4096, 22), sensor(sensor), reads(reads)
+    {
+        setCriticality(TASK_REAL_TIME);
+    }
+    uint32_t pending_before = 0;
+    uint32_t reads_after = 0;
+    bool done = false;
+
+private:
+    ultrasound *sensor;
+    Reads &reads;
+
+    void run(void *data)
+    {
+        sensor->start();
+        wsim::consume(300000000ULL); // 5 measurements, the deferred task can't run
+        WDeferredStats_t stats;
+        WDeferred::getStats(WPartition::realTimeCore(), stats);
+        pending_before = stats.posted - stats.handled;
+        delete sensor;
+        reads_after = reads.count;
+        done = true;
+        while (true)
+            vTaskDelay(1000);
+    }
+};
+
+int main()
+{
+    wsim::EchoSource source = {};
+    source.trig_pin = static_cast<gpio_num_t>(TRIG_PIN);
+    source.echo_pin = static_cast<gpio_num_t>(ECHO_PIN);
+    source.distance_mm = [](uint64_t) { return 1000u; };
+    wsim::add_echo_source(source);
+
+    Reads reads;
+    Ultrasound_Init_t config = {};
+    config.gpio_trig_pin = static_cast<gpio_num_t>(TRIG_PIN);
+    config.gpio_echo_pin = static_cast<gpio_num_t>(ECHO_PIN);
+    config.measurement_period_ms = 60;
+    config.trig_signal_duration_us = 10;
+    config.median_window = 1;
+    config.backend = ULTRASOUND_BACKEND_GPIO_ISR;
+    config.onRead = on_read;
+    config.user_data = &reads;
+    ultrasound *sensor = new ultrasound(config);
+    CHECK(sensor->isValid());
+    sensor->deferRead(true);
+    CHECK(WDeferred::start());
+
+    OwnerTask owner(sensor, reads);
+    owner.start();
+    wsim::run_for(1000000000ULL);
+
+    WDeferredStats_t stats;
+    CHECK(WDeferred::getStats(WPartition::realTimeCore(), stats));
+    printf("reads : %u queued at the destruction, %u handled, %u posted\n", (unsigned)owner.pending_before,
+           (unsigned)stats.handled, (unsigned)stats.posted);
+    CHECK(owner.done);
+    CHECK(owner.pending_before >= 4);
+    CHECK(owner.reads_after == stats.posted); // all handled before the destructor returned
+    CHECK(reads.count == owner.reads_after);  // none after
+    CHECK(reads.other_core == 0);
+    return wsim_check::result("ultrasound_defer");
+}
@@ -0,0 +1,124 @@
+/**
+ * @file ultrasound_filter.cpp
+ * @brief History of the ultrasound driver on the simulator : median window, spike rejection and restart of the median
+ *        on a step change, range selection of getHistory and FixedPoint velocity of an approaching obstacle
+ */
+#include <algorithm>
+#include <vector>
+#include "check.hpp"
+#include "wsim.hpp"
+#include "ultrasound.hpp"
+
+#define TRIG_PIN 4
+#define ECHO_PIN 5
+#define PERIOD_MS 60
+#define WINDOW 5
+#define SPIKE_MM 200
+#define RAMP_START 25        // measurement index of the start of the ramp
+#define RAMP_SPEED_MM_S 500 // approaching obstacle
+
+/**
+ * @brief Scripted distance of the measurement index (one trigger every PERIOD_MS from time 0)
+ */
+static uint32_t script_mm(uint32_t index)
+{
+    static const uint32_t noise[] = {1000, 1040, 980, 1020, 1000, 960, 1010, 1050, 990, 1000};
+    if (index == 10)
+        return 3000; // single spike
+    if (index < 15)
+        return noise[index % 10];
+    if (index < RAMP_START)
+        return 2000; // step change
+    return 2000 - RAMP_SPEED_MM_S * (index - RAMP_START) * PERIOD_MS / 1000;
+}
+
+int main()
+{
+    wsim::EchoSource source = {};
+    source.trig_pin = static_cast<gpio_num_t>(TRIG_PIN);
+    source.echo_pin = static_cast<gpio_num_t>(ECHO_PIN);
+    source.distance_mm = [](uint64_t now_ns)
+    { return script_mm(static_cast<uint32_t>((now_ns + PERIOD_MS * 500000ULL) / (PERIOD_MS * 1000000ULL))); };
+    wsim::add_echo_source(source);
+
+    Ultrasound_Init_t config = {};
+    config.gpio_trig_pin = source.trig_pin;
+    config.gpio_echo_pin = source.echo_pin;
+    config.measurement_period_ms = PERIOD_MS;
+    config.trig_signal_duration_us = 10;
+    config.median_window = WINDOW;
+    config.spike_threshold_mm = SPIKE_MM;
+    ultrasound sensor(config);
+    CHECK(sensor.isValid());
+    Ultrasound_Sample_t last;
+    CHECK(sensor.getLastSample(last) == ESP_ERR_NOT_FOUND);
+    sensor.start();
+    wsim::run_for(20 * PERIOD_MS * 1000000ULL - 1);
+
+    // median of the accepted distances, window restarted after ULTRASOUND_SPIKE_MAX_CONSECUTIVE spikes
+    Ultrasound_Sample_t samples[ULTRASOUND_HISTORY_LENGTH];
+    const size_t count = sensor.getHistory(0, INT64_MAX, samples);
+    printf("%u samples in the first %u ms\n", (unsigned)count, 20 * PERIOD_MS);
+    CHECK(count == 20);
+    std::vector<int32_t> window;
+    uint32_t spikes = 0, step_spikes = 0, consecutive = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        const Ultrasound_Sample_t &s = samples[i];
+        CHECK(std::abs(s.distance_mm - (int32_t)script_mm(i)) <= 2);
+        if (i > 0)
+            CHECK(s.timestamp_us > samples[i - 1].timestamp_us);
+        if (s.flags & ULTRASOUND_SAMPLE_SPIKE)
+        {
+            ++spikes;
+            if (i >= 15)
+                ++step_spikes;
+            CHECK(s.median_mm == samples[i - 1].median_mm); // median kept
+            ++consecutive;
+            continue;
+        }
+        if (consecutive == ULTRASOUND_SPIKE_MAX_CONSECUTIVE)
+            window.clear(); // step change accepted
+        consecutive = 0;
+        window.push_back(s.distance_mm);
+        if (window.size() > WINDOW)
+            window.erase(window.begin());
+        std::vector<int32_t> sorted = window;
+        std::sort(sorted.begin(), sorted.end());
+        CHECK(s.median_mm == sorted[sorted.size() / 2]);
+    }
+    CHECK(spikes == 1 + ULTRASOUND_SPIKE_MAX_CONSECUTIVE);
+    CHECK(samples[10].flags & ULTRASOUND_SAMPLE_SPIKE);
+    CHECK(step_spikes == ULTRASOUND_SPIKE_MAX_CONSECUTIVE);
+    CHECK(!(samples[15 + ULTRASOUND_SPIKE_MAX_CONSECUTIVE].flags & ULTRASOUND_SAMPLE_SPIKE));
+    CHECK(std::abs(samples[15 + ULTRASOUND_SPIKE_MAX_CONSECUTIVE].median_mm - 2000) <= 2); // restarted on the new distance
+    CHECK(sensor.getLastSample(last) == ESP_OK);
+    CHECK(last.timestamp_us == samples[count - 1].timestamp_us);
+
+    // range selection : inclusive bounds, oldest first, the newest samples of the range when the buffer is short
+    Ultrasound_Sample_t range[4];
+    size_t n = sensor.getHistory(samples[5].timestamp_us, samples[7].timestamp_us, range);
+    CHECK(n == 3);
+    CHECK((range[0].timestamp_us == samples[5].timestamp_us) && (range[2].timestamp_us == samples[7].timestamp_us));
+    n = sensor.getHistory(samples[5].timestamp_us - 1, samples[12].timestamp_us + 1, range);
+    CHECK(n == 4);
+    CHECK((range[0].timestamp_us == samples[9].timestamp_us) && (range[3].timestamp_us == samples[12].timestamp_us));
+    n = sensor.getHistory(samples[5].timestamp_us + 1, samples[6].timestamp_us - 1, range);
+    CHECK(n == 0);
+    n = sensor.getHistory(samples[count - 1].timestamp_us + 1, INT64_MAX, range);
+    CHECK(n == 0);
+
+    // velocity : the spikes are skipped, the step just accepted reads as a receding obstacle
+    ultrasound::Velocity_t velocity;
+    CHECK(sensor.getVelocity(velocity) == ESP_OK);
+    CHECK(double(velocity) < -1000);
+    // no motion once the median only holds the new distance, then the ramp once it only holds ramp distances
+    wsim::run_for((RAMP_START - 20) * PERIOD_MS * 1000000ULL);
+    CHECK(sensor.getVelocity(velocity) == ESP_OK);
+    CHECK(std::abs(double(velocity)) < 1);
+    wsim::run_for(15 * PERIOD_MS * 1000000ULL);
+    CHECK(sensor.getVelocity(velocity) == ESP_OK);
+    printf("velocity on the ramp : %.1f mm/s (%d mm/s)\n", double(velocity), RAMP_SPEED_MM_S);
+    CHECK(std::abs(double(velocity) - RAMP_SPEED_MM_S) < RAMP_SPEED_MM_S * 0.02);
+    return wsim_check::result("ultrasound_filter");
+}
@@ -0,0 +1,87 @@
+/**
+ * @file ultrasound_sound.cpp
+ * @brief Speed of sound of ultrasound_sound.h across the temperature and humidity range, distance of the multiply-shift
+ *        for the echo resolutions of the backends, and compensation of the driver fed with the air temperature
+ */
+#include <cmath>
+#include "check.hpp"
+#include "wsim.hpp"
+#include "ultrasound.h"
+
+static double speed_exact(double celsius, double humidity)
+{
+    return 331.3 * std::sqrt(1.0 + celsius / 273.15) + 0.0124 * humidity;
+}
+
+int main()
+{
+    // speed of sound every 0.25 °C from -10 °C to 50 °C, dry to saturated air
+    double worst_speed = 0;
+    for (int quarter = -40; quarter <= 200; ++quarter)
+    {
+        for (uint8_t humidity = 0; humidity <= 100; humidity += 25)
+        {
+            const double celsius = quarter / 4.0;
+            const double speed = Ultrasound_SoundSpeedFromAir(static_cast<Ultrasound_Temperature_t>(quarter * 64), humidity) / 65536.0;
+            worst_speed = std::max(worst_speed, std::fabs(speed - speed_exact(celsius, humidity)) / speed_exact(celsius, humidity));
+        }
+    }
+    printf("speed of sound from -10 to 50 degC : worst relative error %.4f %%\n", 100 * worst_speed);
+    CHECK(worst_speed < 0.0005); // documented 0.05 %
+    CHECK_NEAR(Ultrasound_SoundSpeedFromAir(20 << 8, 0) / 65536.0, 343.2, 0.1);
+
+    // distance of the multiply-shift against the exact one, from 2 cm to 4 m, for the GPIO (1 MHz) and MCPWM (80 MHz) ticks
+    const uint32_t resolutions[] = {1000000, 80000000};
+    for (uint32_t resolution : resolutions)
+    {
+        double worst_mm = 0, worst_coef = 0;
+        for (int celsius = 5; celsius <= 35; celsius += 5)
+        {
+            const Ultrasound_SoundSpeed_t speed = Ultrasound_SoundSpeedFromAir(celsius << 8, 50);
+            const uint32_t coef = Ultrasound_SoundCoef(speed, resolution);
+            const double coef_exact = speed / 65536.0 * 500 / resolution * 4294967296.0;
+            worst_coef = std::max(worst_coef, std::fabs(coef - coef_exact) / coef_exact);
+            for (int mm = 20; mm <= 4000; mm += 7)
+            {
+                const uint32_t ticks = static_cast<uint32_t>(2.0 * mm / (speed / 65536.0 * 1000) * resolution);
+                const double exact = ticks / double(resolution) * (speed / 65536.0) * 1000 / 2;
+                worst_mm = std::max(worst_mm, std::fabs(Ultrasound_SoundDistanceMm(ticks, coef) - exact));
+            }
+        }
+        printf("multiply-shift at %u Hz, 5 to 35 degC : coefficient within %.1e, distance below the exact one by less than %.3f mm (truncation)\n",
+               (unsigned)resolution, worst_coef, worst_mm);
+        CHECK(worst_mm < 1);
+    }
+
+    // range error of the fixed 343 m/s over the warehouse range, that the compensation removes
+    const double cold = speed_exact(5, 50), hot = speed_exact(35, 50);
+    printf("fixed 343 m/s : range error %+.2f %% at 5 degC, %+.2f %% at 35 degC\n", 100 * (343 / cold - 1), 100 * (343 / hot - 1));
+    CHECK(std::fabs(343 / cold - 1) > 0.02);
+
+    // driver at 5 °C : echoes timed at the speed of cold air, the distance is right once the temperature is given
+    wsim::EchoSource source = {};
+    source.trig_pin = static_cast<gpio_num_t>(4);
+    source.echo_pin = static_cast<gpio_num_t>(5);
+    source.distance_mm = [](uint64_t)
+    { return 2000u; };
+    source.sound_speed_mm_s = static_cast<uint32_t>(speed_exact(5, 50) * 1000);
+    wsim::add_echo_source(source);
+    Ultrasound_Init_t config = {};
+    config.gpio_trig_pin = source.trig_pin;
+    config.gpio_echo_pin = source.echo_pin;
+    config.measurement_period_ms = 60;
+    config.trig_signal_duration_us = 10;
+    Ultrasound_Handle_t sensor = Ultrasound_Init(&config);
+    CHECK(sensor != NULL);
+    Ultrasound_Start(sensor);
+    wsim::run_for(500000000ULL);
+    const int32_t uncompensated = Ultrasound_GetDistance(sensor).distance_mm;
+    CHECK(Ultrasound_SetAirConditions(sensor, 5 << 8, 50) == ESP_OK);
+    wsim::run_for(500000000ULL);
+    const int32_t compensated = Ultrasound_GetDistance(sensor).distance_mm;
+    printf("obstacle at 2000 mm in air at 5 degC : %d mm at 343 m/s, %d mm compensated\n", (int)uncompensated, (int)compensated);
+    CHECK(std::abs(uncompensated - 2000) > 40);
+    CHECK(std::abs(compensated - 2000) <= 2);
+
+    return wsim_check::result("ultrasound_sound");
+}
@@ -0,0 +1,168 @@
+#!/usr/bin/env python3
+"""Generate header-only register accessors from a CMSIS SVD file.
+
+For each register (and register array) of the selected peripherals, the header defines the
+address, the field shifts and masks as constant expressions, and always-inline read/write
+accessors. With a constant index, a register write compiles to a single store.
+The header is plain C so it can be used from the C drivers as well as from C++.
+
+Usage: svd2regs.py esp32s3.svd GPIO [MCPWM0 ...] -o esp32s3_regs.h
+"""
+import argparse
+import re
+import sys
+import xml.etree.ElementTree as ET
+
+
+def number(text, default=None):
+    if text is None:
+        return default
+    text = text.strip().lower()
+    if text.startswith("0x"):
+        return int(text, 16)
+    if text.startswith("#"):
+        return int(text[1:].replace("x", "0"), 2)
+    return int(text, 0)
+
+
+def identifier(name):
+    return re.sub(r"[^A-Za-z0-9_]", "_", name.replace("%s", "")).strip("_")
+
+
+def comment(text):
+    return " ".join((text or "").split()).replace("*/", "* /")
+
+
+class Field:
+    def __init__(self, node, register_access):
+        self.name = identifier(node.findtext("name"))
+        if node.find("bitOffset") is not None:
+            self.offset = number(node.findtext("bitOffset"))
+            self.width = number(node.findtext("bitWidth"), 1)
+        elif node.find("lsb") is not None:
+            self.offset = number(node.findtext("lsb"))
+            self.width = number(node.findtext("msb")) - self.offset + 1
+        else:
+            msb, lsb = re.match(r"\[(\d+):(\d+)\]", node.findtext("bitRange")).groups()
+            self.offset, self.width = int(lsb), int(msb) - int(lsb) + 1
+        self.access = node.findtext("access") or register_access
+        self.description = comment(node.findtext("description"))
+
+    @property
+    def mask(self):
+        return ((1 << self.width) - 1) << self.offset
+
+
+class Register:
+    def __init__(self, node, default_access):
+        self.name = identifier(node.findtext("name"))
+        self.offset = number(node.findtext("addressOffset"))
+        self.dim = number(node.findtext("dim"), 1) if node.find("dim") is not None else None
+        self.stride = number(node.findtext("dimIncrement"), 4)
+        self.access = node.findtext("access") or default_access
+        self.description = comment(node.findtext("description"))
+        fields = node.find("fields")
+        self.fields = [Field(f, self.access) for f in fields] if fields is not None else []
+        # a register without register level access takes the access of its fields
+        if node.find("access") is None and self.fields:
+            accesses = {f.access for f in self.fields}
+            if accesses == {"write-only"}:
+                self.access = "write-only"
+            elif accesses == {"read-only"}:
+                self.access = "read-only"
+
+
+def load(path, names):
+    device = ET.parse(path).getroot()
+    default_access = device.findtext("access") or "read-write"
+    peripherals = {p.findtext("name"): p for p in device.find("peripherals")}
+    result = []
+    for name in names:
+        if name not in peripherals:
+            sys.exit("svd2regs: unknown peripheral %s" % name)
+        node = peripherals[name]
+        base = number(node.findtext("baseAddress"))
+        source = node
+        while source.find("registers") is None and source.get("derivedFrom"):
+            source = peripherals[source.get("derivedFrom")]
+        registers = [Register(r, default_access) for r in source.find("registers") if r.tag == "register"]
+        result.append((identifier(name), base, comment(source.findtext("description")), registers))
+    return device.findtext("name"), result
+
+
+def readable(access):
+    return access != "write-only"
+
+
+def writable(access):
+    return access not in ("read-only",)
+
+
+def emit(device, peripherals, out):
+    guard = "SVD_%s_REGS_H_" % identifier(device).upper()
+    w = out.write
+    w("/* Generated by tools/svd2regs.py from the %s SVD : do not edit */\n" % device)
+    w("#ifndef %s\n#define %s\n\n#include <stdint.h>\n\n" % (guard, guard))
+    w("#define SVD_REG(addr) (*(volatile uint32_t *)(uintptr_t)(addr))\n\n")
+    for periph, base, description, registers in peripherals:
+        P = periph.upper()
+        p = periph.lower()
+        w("/* %s : %s */\n" % (periph, description))
+        w("#define SVD_%s_BASE 0x%08Xu\n\n" % (P, base))
+        for reg in registers:
+            R = "%s_%s" % (P, reg.name.upper())
+            r = "%s_%s" % (p, reg.name.lower())
+            w("/* %s.%s : %s */\n" % (periph, reg.name, reg.description))
+            if reg.dim:
+                w("#define SVD_%s_COUNT %du\n" % (R, reg.dim))
+                w("#define SVD_%s_ADDR(n) (SVD_%s_BASE + 0x%Xu + 0x%Xu * (uint32_t)(n))\n" % (R, P, reg.offset, reg.stride))
+                index, index_arg, addr = "n", "uint32_t n", "SVD_%s_ADDR(n)" % R
+            else:
+                w("#define SVD_%s_ADDR (SVD_%s_BASE + 0x%Xu)\n" % (R, P, reg.offset))
+                index, index_arg, addr = "", "", "SVD_%s_ADDR" % R
+            for f in reg.fields:
+                if len(reg.fields) == 1 and f.offset == 0 and f.width == 32:
+                    continue
+                w("#define SVD_%s_%s_SHIFT %du\n" % (R, f.name.upper(), f.offset))
+                w("#define SVD_%s_%s_MASK 0x%08Xu\n" % (R, f.name.upper(), f.mask))
+            sep = ", " if index_arg else ""
+            if readable(reg.access):
+                w("static inline __attribute__((always_inline)) uint32_t svd_%s_read(%s)\n{\n    return SVD_REG(%s);\n}\n"
+                  % (r, index_arg or "void", addr))
+            if writable(reg.access):
+                w("static inline __attribute__((always_inline)) void svd_%s_write(%s%svalue)\n{\n    SVD_REG(%s) = value;\n}\n"
+                  % (r, index_arg, sep + "uint32_t " if index_arg else "uint32_t ", addr))
+            for f in reg.fields:
+                if len(reg.fields) == 1 and f.offset == 0 and f.width == 32:
+                    continue
+                F = "SVD_%s_%s" % (R, f.name.upper())
+                fn = "%s_%s" % (r, f.name.lower())
+                if readable(f.access) and readable(reg.access):
+                    w("/* %s */\n" % f.description)
+                    w("static inline __attribute__((always_inline)) uint32_t svd_%s_get(%s)\n{\n    return (SVD_REG(%s) & %s_MASK) >> %s_SHIFT;\n}\n"
+                      % (fn, index_arg or "void", addr, F, F))
+                if writable(f.access) and readable(reg.access):
+                    # read-modify-write : not atomic, the register must not be shared with another context
+                    w("static inline __attribute__((always_inline)) void svd_%s_set(%s%svalue)\n{\n"
+                      "    SVD_REG(%s) = (SVD_REG(%s) & ~%s_MASK) | ((value << %s_SHIFT) & %s_MASK);\n}\n"
+                      % (fn, index_arg, sep + "uint32_t " if index_arg else "uint32_t ", addr, addr, F, F, F))
+            w("\n")
+    w("#endif /* %s */\n" % guard)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("svd", help="SVD file")
+    parser.add_argument("peripherals", nargs="+", help="peripherals to generate (e.g. GPIO)")
+    parser.add_argument("-o", "--output", help="output header (stdout by default)")
+    args = parser.parse_args()
+    device, peripherals = load(args.svd, args.peripherals)
+    if args.output:
+        with open(args.output, "w") as out:
+            emit(device, peripherals, out)
+    else:
+        emit(device, peripherals, sys.stdout)
+
+
+if __name__ == "__main__":
+    main()